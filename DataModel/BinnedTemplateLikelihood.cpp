@@ -0,0 +1,152 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "BinnedTemplateLikelihood.h"
+
+#include <cmath>
+#include <stdexcept>
+
+BinnedTemplateLikelihood::BinnedTemplateLikelihood(int nbins_in) : nbins(nbins_in) {
+	if(nbins<1) throw std::invalid_argument("BinnedTemplateLikelihood - need at least one bin");
+	data.assign(nbins, 0.);
+	expected.resize(nbins);
+	residual.resize(nbins);
+}
+
+int BinnedTemplateLikelihood::AddTemplate(const std::string& name, const std::vector<double>& expected_counts, double norm_sigma){
+	if(int(expected_counts.size())!=nbins){
+		throw std::invalid_argument("BinnedTemplateLikelihood::AddTemplate - template "+name+" has the wrong number of bins");
+	}
+	templates.push_back(expected_counts);
+	morphed.emplace_back(nbins);
+	params.push_back(Parameter{name, int(templates.size())-1, norm_sigma});
+	template_pars.push_back(params.size()-1);
+	return params.size()-1;
+}
+
+int BinnedTemplateLikelihood::AddShapeNuisance(const std::string& name){
+	params.push_back(Parameter{name, -1, 1.});
+	return params.size()-1;
+}
+
+void BinnedTemplateLikelihood::SetMorph(int nuisance_par, int template_par, const std::vector<double>& up, const std::vector<double>& down){
+	if(!IsNuisance(nuisance_par) || IsNuisance(template_par)){
+		throw std::invalid_argument("BinnedTemplateLikelihood::SetMorph - bad parameter indices");
+	}
+	if(int(up.size())!=nbins || int(down.size())!=nbins){
+		throw std::invalid_argument("BinnedTemplateLikelihood::SetMorph - templates have the wrong number of bins");
+	}
+	const int templ = params[template_par].templ;
+	Morph morph{nuisance_par, templ, up, down};
+	for(int b=0; b<nbins; ++b){
+		morph.up_delta[b] -= templates[templ][b];
+		morph.down_delta[b] -= templates[templ][b];
+	}
+	morphs.push_back(std::move(morph));
+}
+
+void BinnedTemplateLikelihood::SetData(const std::vector<double>& counts){
+	if(int(counts.size())!=nbins){
+		throw std::invalid_argument("BinnedTemplateLikelihood::SetData - data has the wrong number of bins");
+	}
+	data = counts;
+}
+
+void BinnedTemplateLikelihood::GetNominal(double* pars) const {
+	for(size_t par=0; par<params.size(); ++par) pars[par] = IsNuisance(par) ? 0. : 1.;
+}
+
+void BinnedTemplateLikelihood::MorphedTemplate(const double* pars, int templ, double* out) const {
+	const double* nominal = templates[templ].data();
+	for(int b=0; b<nbins; ++b) out[b] = nominal[b];
+	for(const Morph& morph : morphs){
+		if(morph.templ!=templ) continue;
+		const double alpha = pars[morph.nuisance_par];
+		// piecewise linear: towards the +1 sigma template for alpha>0, the -1 sigma template for alpha<0
+		const double* delta = (alpha>=0) ? morph.up_delta.data() : morph.down_delta.data();
+		const double coeff = std::abs(alpha);
+		for(int b=0; b<nbins; ++b) out[b] += coeff*delta[b];
+	}
+}
+
+void BinnedTemplateLikelihood::TemplateExpectation(const double* pars, int template_par, double* out) const {
+	const int templ = params.at(template_par).templ;
+	if(templ<0) throw std::invalid_argument("BinnedTemplateLikelihood::TemplateExpectation - not a template");
+	MorphedTemplate(pars, templ, out);
+	const double norm = pars[template_par];
+	for(int b=0; b<nbins; ++b) out[b] *= norm;
+}
+
+void BinnedTemplateLikelihood::Expectation(const double* pars, double* out) const {
+	for(int b=0; b<nbins; ++b) out[b] = 0;
+	for(size_t templ=0; templ<templates.size(); ++templ){
+		double* morphed_templ = morphed[templ].data();
+		MorphedTemplate(pars, templ, morphed_templ);
+		const double norm = pars[template_pars[templ]];
+		for(int b=0; b<nbins; ++b) out[b] += norm*morphed_templ[b];
+	}
+}
+
+double BinnedTemplateLikelihood::Evaluate(const double* pars, double* grad) const {
+	// fills the morphed templates as well as the expectation
+	Expectation(pars, expected.data());
+
+	// Poisson likelihood ratio, sum of (mu - n + n*log(n/mu))
+	double nll=0;
+	for(int b=0; b<nbins; ++b){
+		const double mu = expected[b] > 1e-300 ? expected[b] : 1e-300;
+		const double n = data[b];
+		nll += mu - n;
+		if(n>0) nll += n*std::log(n/mu);
+		residual[b] = 1. - n/mu;
+	}
+	// constraints
+	for(size_t par=0; par<params.size(); ++par){
+		const Parameter& p = params[par];
+		if(p.sigma<=0) continue;
+		const double pull = (p.templ<0) ? pars[par] : (pars[par]-1.)/p.sigma;
+		nll += 0.5*pull*pull;
+	}
+	if(!grad) return nll;
+
+	for(size_t par=0; par<params.size(); ++par){
+		const Parameter& p = params[par];
+		if(p.sigma<=0) grad[par] = 0;
+		else if(p.templ<0) grad[par] = pars[par];
+		else grad[par] = (pars[par]-1.)/(p.sigma*p.sigma);
+	}
+	for(size_t templ=0; templ<templates.size(); ++templ){
+		const double* morphed_templ = morphed[templ].data();
+		double sum=0;
+		for(int b=0; b<nbins; ++b) sum += residual[b]*morphed_templ[b];
+		grad[template_pars[templ]] += sum;
+	}
+	for(const Morph& morph : morphs){
+		const double alpha = pars[morph.nuisance_par];
+		const double* delta = (alpha>=0) ? morph.up_delta.data() : morph.down_delta.data();
+		double sum=0;
+		for(int b=0; b<nbins; ++b) sum += residual[b]*delta[b];
+		// d|alpha|/dalpha
+		grad[morph.nuisance_par] += pars[template_pars[morph.templ]]*((alpha>=0) ? sum : -sum);
+	}
+	return nll;
+}
+
+double BinnedTemplateLikelihood::NLL(const double* pars) const {
+	return Evaluate(pars, nullptr);
+}
+
+double BinnedTemplateLikelihood::NLLAndGradient(const double* pars, double* grad) const {
+	return Evaluate(pars, grad);
+}
+
+void BinnedTemplateLikelihood::ThrowToy(std::mt19937_64& rng, const double* pars, std::vector<double>& counts) const {
+	Expectation(pars, expected.data());
+	counts.resize(nbins);
+	for(int b=0; b<nbins; ++b){
+		if(expected[b]>0){
+			std::poisson_distribution<long> poisson(expected[b]);
+			counts[b] = poisson(rng);
+		} else {
+			counts[b] = 0;
+		}
+	}
+}
@@ -0,0 +1,82 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef BinnedTemplateLikelihood_H
+#define BinnedTemplateLikelihood_H
+
+#include <vector>
+#include <string>
+#include <random>
+
+/**
+* \class BinnedTemplateLikelihood
+*
+* Binned Poisson likelihood of a set of templates (expected counts per bin of each signal or background
+* distribution) fitted to data, as used for a spectral fit over several regions, with the bins of all regions
+* concatenated into one global set of bins.
+*
+* Each template has a normalisation parameter, relative to its nominal prediction, shared by all the bins
+* (so all regions) it covers; it may be free, or constrained by a Gaussian of given width about 1.
+* Shape nuisance parameters (unit Gaussian constraint about 0) morph the templates they affect, by piecewise
+* linear interpolation of each bin between the nominal and the +-1 sigma templates.
+*
+* The expected counts are a matrix-vector product of the (morphed) templates with the normalisations,
+* and the negative log-likelihood (as the Poisson likelihood ratio, so 0 for a perfect fit) and its analytic
+* gradient are element-wise loops over the bins. Toy datasets are thrown from the same templates.
+* n.b. evaluation uses internal scratch buffers, so one instance should not be evaluated from several threads.
+*/
+class BinnedTemplateLikelihood {
+	public:
+	explicit BinnedTemplateLikelihood(int nbins);
+
+	// parameters are numbered in the order they are added. norm_sigma <= 0 means unconstrained.
+	int AddTemplate(const std::string& name, const std::vector<double>& expected, double norm_sigma=0);
+	int AddShapeNuisance(const std::string& name);
+	// the +-1 sigma versions of a template for a shape nuisance
+	void SetMorph(int nuisance_par, int template_par, const std::vector<double>& up, const std::vector<double>& down);
+
+	void SetData(const std::vector<double>& counts);
+	const std::vector<double>& GetData() const { return data; }
+
+	int GetNBins() const { return nbins; }
+	int GetNParameters() const { return params.size(); }
+	const std::string& GetName(int par) const { return params.at(par).name; }
+	bool IsNuisance(int par) const { return params.at(par).templ<0; }
+	void GetNominal(double* pars) const;   ///< 1 for normalisations, 0 for nuisances
+
+	// expected counts per bin, in total or of one template
+	void Expectation(const double* pars, double* out) const;
+	void TemplateExpectation(const double* pars, int template_par, double* out) const;
+
+	double NLL(const double* pars) const;
+	double NLLAndGradient(const double* pars, double* grad) const;
+
+	// Poisson fluctuations of the expectation for the given parameters
+	void ThrowToy(std::mt19937_64& rng, const double* pars, std::vector<double>& counts) const;
+
+	private:
+	struct Parameter {
+		std::string name;
+		int templ;          // index into templates, or -1 for a shape nuisance
+		double sigma;       // constraint width, <=0 for a free normalisation
+	};
+	struct Morph {
+		int nuisance_par;
+		int templ;
+		std::vector<double> up_delta;     // +1 sigma template - nominal
+		std::vector<double> down_delta;   // -1 sigma template - nominal
+	};
+	void MorphedTemplate(const double* pars, int templ, double* out) const;
+	double Evaluate(const double* pars, double* grad) const;
+
+	int nbins;
+	std::vector<Parameter> params;
+	std::vector<std::vector<double>> templates;
+	std::vector<int> template_pars;   // parameter index of each template
+	std::vector<Morph> morphs;
+	std::vector<double> data;
+	// scratch
+	mutable std::vector<std::vector<double>> morphed;
+	mutable std::vector<double> expected;
+	mutable std::vector<double> residual;
+};
+
+#endif
@@ -0,0 +1,143 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "BonsaiFitService.h"
+#include "VertexPrefit.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "pmt_geometry.h"
+#include "likelihood.h"
+#include "bonsaifit.h"
+#include "goodness.h"
+#include "fourhitgrid.h"
+
+BonsaiFitService::Worker::~Worker(){
+	// the fitter refers to the likelihood, so goes first
+	fit.reset();
+	like.reset();
+	geom.reset();
+}
+
+BonsaiFitService::~BonsaiFitService(){
+	Stop();
+}
+
+void BonsaiFitService::Start(int nthreads, int npmts, const float* xyzpm){
+	if(GetNThreads()) return;
+	if(nthreads<1) nthreads=1;
+	for(int i=0; i<nthreads; ++i){
+		workers.emplace_back(new Worker);
+		Worker& worker = *workers.back();
+		worker.positions.assign(xyzpm, xyzpm+3*npmts);
+		worker.geom.reset(new pmt_geometry(npmts, worker.positions.data()));
+		worker.like.reset(new likelihood(worker.geom->cylinder_radius(), worker.geom->cylinder_height()));
+		worker.fit.reset(new bonsaifit(worker.like.get()));
+	}
+	scheduler.Start(nthreads);
+}
+
+void BonsaiFitService::Stop(){
+	// finish any queued fits before the workers' BONSAI objects go
+	scheduler.Stop();
+	workers.clear();
+}
+
+std::future<BonsaiFitService::Result> BonsaiFitService::Submit(Hits hits){
+	struct Job {
+		Hits hits;
+		std::promise<Result> promise;
+	};
+	std::shared_ptr<Job> job = std::make_shared<Job>();
+	job->hits = std::move(hits);
+	std::future<Result> result = job->promise.get_future();
+	const Prefit job_prefit = prefit;
+	scheduler.Submit([this, job, job_prefit](){
+		Worker& worker = *workers.at(WorkStealingScheduler::CurrentWorker());
+		const float (*xyzpm)[3] = reinterpret_cast<const float(*)[3]>(worker.positions.data());
+		try {
+			job->promise.set_value(Fit(*worker.geom, *worker.like, *worker.fit, job->hits, xyzpm, &job_prefit));
+		} catch(...){
+			// scheduler tasks must not throw; hand it to whoever waits on the result
+			job->promise.set_exception(std::current_exception());
+		}
+	});
+	return result;
+}
+
+BonsaiFitService::Result BonsaiFitService::Fit(pmt_geometry& geom, likelihood& like, bonsaifit& fit, Hits& hits,
+                                               const float (*xyzpm)[3], const Prefit* prefit){
+	Result res;
+	Hits selected;
+	Hits* bonsai_hits = &hits;
+	if(prefit && prefit->prefit){
+		const int nhit = hits.cables.size();
+		const VertexPrefit::Result seed = prefit->prefit->Fit(nhit, hits.cables.data(), hits.times.data());
+		if(seed.ok()){
+			std::copy(seed.vertex, seed.vertex+4, res.seed);
+			std::vector<int> indices;
+			prefit->prefit->SelectHits(nhit, hits.cables.data(), hits.times.data(), seed.vertex, prefit->tmin, prefit->tmax, indices);
+			for(int i : indices){
+				selected.cables.push_back(hits.cables[i]);
+				selected.times.push_back(hits.times[i]);
+				selected.charges.push_back(hits.charges[i]);
+			}
+			bonsai_hits = &selected;
+			if(prefit->max_hits>0 && int(indices.size())>prefit->max_hits){
+				// too many for BONSAI: not fit, as for events over the limit without a prefit
+				return res;
+			}
+		}
+	}
+
+	const int nhit = bonsai_hits->cables.size();
+	res.nbonsai = nhit;
+	goodness bshits(like.sets(), like.chargebins(), &geom, nhit, bonsai_hits->cables.data(), bonsai_hits->times.data(),
+	                bonsai_hits->charges.data());
+	res.nselected = bshits.nselected();
+	if(res.nselected<4) return res;
+
+	fourhitgrid bsgrid(geom.cylinder_radius(), geom.cylinder_height(), &bshits);
+	like.set_hits(&bshits);
+	like.maximize(&fit, &bsgrid);
+	res.nfit = like.nfit();
+	if(res.nfit>0){
+		// best reconstructed vertex and time
+		res.vertex[0] = fit.xfit();
+		res.vertex[1] = fit.yfit();
+		res.vertex[2] = fit.zfit();
+		res.vertex[3] = like.get_zero();
+		// maximal log likelihood and timing goodness
+		std::vector<float> gdn(like.sets());
+		res.good[2] = like.goodness(res.good[0], res.vertex, gdn.data());
+		like.tgood(res.vertex, 0, res.good[1]);
+		res.good[0] = fit.maxq();
+		fit.fitresult();
+		like.get_dir(res.result);
+		res.result[5] = like.get_ll0();
+		// n.b. from all hits, not only those given to BONSAI
+		res.n50 = MaxHitsInWindow(50, res.vertex, hits, xyzpm);
+	}
+	// the goodness object goes out of scope here
+	like.set_hits(NULL);
+	return res;
+}
+
+int BonsaiFitService::MaxHitsInWindow(float window, const float* vertex, const Hits& hits, const float (*xyzpm)[3]){
+	const size_t nhit = hits.cables.size();
+	if(nhit==0) return 0;
+	const float cns2cm = 21.58333;   // speed of light in medium
+	std::vector<float> tof(nhit);
+	for(size_t i=0; i<nhit; ++i){
+		const float* pmt = xyzpm[hits.cables[i]-1];
+		tof[i] = hits.times[i]-sqrt(pow((vertex[0]-pmt[0]),2)+pow((vertex[1]-pmt[1]),2)+pow((vertex[2]-pmt[2]),2))/cns2cm;
+	}
+	std::sort(tof.begin(), tof.end());
+	// widest run of hits with last - first <= window
+	size_t most=1;
+	size_t first=0;
+	for(size_t last=0; last<nhit; ++last){
+		while(tof[last]-tof[first] > window) ++first;
+		most = std::max(most, last-first+1);
+	}
+	return most;
+}
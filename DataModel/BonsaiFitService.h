@@ -0,0 +1,91 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef BonsaiFitService_H
+#define BonsaiFitService_H
+
+#include <vector>
+#include <future>
+#include <memory>
+
+#include "WorkStealingScheduler.h"
+
+class pmt_geometry;
+class likelihood;
+class bonsaifit;
+class VertexPrefit;
+
+/**
+* \class BonsaiFitService
+*
+* Runs BONSAI vertex fits of several events concurrently. Each worker thread owns its own
+* pmt_geometry (built from its own copy of the PMT positions), likelihood and bonsaifit, so no BONSAI
+* object is shared between threads. Events are submitted as snapshots of their hits, so the fits
+* do not need the live common blocks, and results are returned through futures.
+*
+* Fit() is the fit itself, and may also be called directly with a Tool's own BONSAI objects to fit
+* on the calling thread.
+*
+* Optionally a VertexPrefit seeds each fit: only the hits with time residuals from the seed within a window
+* are given to BONSAI, which cuts the dark noise its hit selection, four-hit grid and likelihood work through.
+* Events with more selected hits than BONSAI should take are not fit; their seed is still returned.
+*/
+class BonsaiFitService {
+	public:
+	struct Hits {
+		std::vector<int> cables;
+		std::vector<float> times;     // ns
+		std::vector<float> charges;   // p.e.
+	};
+	struct Result {
+		int nselected = 0;            // hits selected by BONSAI; not fit if < 4
+		int nfit = 0;                 // > 0 if the fit succeeded
+		float vertex[4] = {9999,9999,9999,0};   // x, y, z (cm), t0 (ns); as LOWE bsvertex
+		float good[3] = {0,0,0};      // as LOWE bsgood: max q, timing goodness, log likelihood goodness
+		float result[6] = {0,0,0,0,0,0};        // as LOWE bsresult: direction..., [5] maximal log likelihood
+		int n50 = 0;                  // energy proxy: most hits within 50 ns after time-of-flight subtraction
+		float seed[4] = {9999,9999,9999,0};     // prefit vertex and time, if prefit
+		int nbonsai = 0;              // hits given to BONSAI; 0 if it was not run
+	};
+	struct Prefit {
+		const VertexPrefit* prefit = nullptr;   // no prefit if null
+		float tmin = -100;            // window of time residuals from the seed of the hits given to BONSAI (ns)
+		float tmax = 200;
+		int max_hits = 0;             // don't run BONSAI on more hits than this (0 = no limit)
+	};
+
+	BonsaiFitService()=default;
+	~BonsaiFitService();
+
+	// start nthreads workers, each with BONSAI built from the npmts PMT positions xyzpm[npmts][3] (cm)
+	void Start(int nthreads, int npmts, const float* xyzpm);
+	void Stop();
+	int GetNThreads() const { return scheduler.GetNThreads(); }
+	// seed the fits of subsequent Submit()s; the VertexPrefit must outlive them
+	void SetPrefit(const Prefit& prefit_in){ prefit = prefit_in; }
+
+	// queue a fit of the given hits on the next free worker
+	std::future<Result> Submit(Hits hits);
+
+	// fit the hits with the given BONSAI objects, seeded if a prefit is given; the hit arrays may be modified by BONSAI.
+	// xyzpm is used for n50 and indexed by cable-1
+	static Result Fit(pmt_geometry& geom, likelihood& like, bonsaifit& fit, Hits& hits, const float (*xyzpm)[3],
+	                  const Prefit* prefit=nullptr);
+
+	// the most hits within a window of the given width (ns) once their time of flight from vertex is subtracted.
+	// Same as VertexFitter::CalculateNX, without the list of cables
+	static int MaxHitsInWindow(float window, const float* vertex, const Hits& hits, const float (*xyzpm)[3]);
+
+	private:
+	struct Worker {
+		std::vector<float> positions;   // this worker's copy of the PMT positions
+		std::unique_ptr<pmt_geometry> geom;
+		std::unique_ptr<likelihood> like;
+		std::unique_ptr<bonsaifit> fit;
+		~Worker();
+	};
+
+	Prefit prefit;
+	WorkStealingScheduler scheduler;
+	std::vector<std::unique_ptr<Worker>> workers;
+};
+
+#endif
@@ -1,11 +1,10 @@
 #ifndef CANDIDATE_HH
 #define CANDIDATE_HH
 
-#include <map>
-#include <string>
-
 #include "Rtypes.h"
 
+// A neutron capture candidate, identified by its first hit.
+// Its features are held by EventCandidates, in the candidate's row of the feature matrix.
 class Candidate
 {
     public:
@@ -13,19 +12,11 @@ class Candidate
         virtual ~Candidate();
 
         inline unsigned int HitID() const { return hitID; }
-        
-        float& operator[](const std::string& key) { return featureMap[key];}
-        void Set(const std::string& key, float value) { featureMap[key] = value; }
-        float& Get(const std::string& key) { return featureMap[key];}
-        void Clear() { featureMap.clear(); }
-
-        std::map<std::string, float>& GetFeatureMap() { return featureMap; }
 
     private:
-        std::map<std::string, float> featureMap;
         unsigned int hitID;
         
-    ClassDef(Candidate, 1);
+    ClassDef(Candidate, 2);
 };
 
 #endif
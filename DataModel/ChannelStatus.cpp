@@ -0,0 +1,49 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "ChannelStatus.h"
+
+#include <algorithm>
+
+ChannelStatus::ChannelStatus(int max_cable) : min_words(size_t(std::max(max_cable,0))/64+1) {
+	Clear();
+}
+
+void ChannelStatus::Clear(){
+	bad.assign(min_words, 0);
+	missing.assign(min_words, 0);
+	either.assign(min_words, 0);
+	nbad=0;
+	nmissing=0;
+	run=-1;
+	subrun=-1;
+}
+
+int ChannelStatus::Fill(std::vector<uint64_t>& bits, int n, const int* cables) const {
+	bits.assign(min_words, 0);
+	int nset=0;
+	for(int i=0; i<n; ++i){
+		const int cable = cables[i];
+		if(cable<0 || cable>kMaxCable) continue;
+		const size_t word = size_t(cable)>>6;
+		if(word>=bits.size()) bits.resize(word+1, 0);
+		const uint64_t bit = uint64_t(1)<<(cable&63);
+		nset += !(bits[word] & bit);
+		bits[word] |= bit;
+	}
+	return nset;
+}
+
+void ChannelStatus::Combine(){
+	either.assign(std::max(bad.size(), missing.size()), 0);
+	for(size_t i=0; i<bad.size(); ++i) either[i] |= bad[i];
+	for(size_t i=0; i<missing.size(); ++i) either[i] |= missing[i];
+}
+
+void ChannelStatus::SetBad(int n, const int* cables){
+	nbad = Fill(bad, n, cables);
+	Combine();
+}
+
+void ChannelStatus::SetMissing(int n, const int* cables){
+	nmissing = Fill(missing, n, cables);
+	Combine();
+}
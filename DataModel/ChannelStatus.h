@@ -0,0 +1,66 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef ChannelStatus_H
+#define ChannelStatus_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/**
+* \class ChannelStatus
+*
+* Bad and missing PMT channels as bitsets indexed by cable number, for O(1) lookups per hit
+* instead of searching the list of bad channels.
+* The DataModel holds one (DataModel::GetChannelStatus()), copied from the combad_ common block whenever
+* the run or subrun changes, and by Tools straight after they call skbadch_ (e.g. once from the reference run for MC).
+*
+* The words of BadOrMissingBits() (bit c%64 of word c/64 for cable c) may be passed directly as the mask
+* to HitStore::Fill.
+*/
+class ChannelStatus {
+	public:
+	static const int kMaxCable = 0xFFFF;
+	
+	// bitsets always cover cables up to at least max_cable
+	explicit ChannelStatus(int max_cable=0);
+	void Clear();
+
+	// replace the bad (or missing) channels with the given list of cable numbers.
+	// Entries outside 0..kMaxCable (wider than the 16-bit cable field of a hit) are ignored.
+	void SetBad(int n, const int* cables);
+	void SetMissing(int n, const int* cables);
+
+	bool IsBad(int cable) const { return Test(bad, cable); }
+	bool IsMissing(int cable) const { return Test(missing, cable); }
+	bool IsBadOrMissing(int cable) const { return Test(either, cable); }
+	int GetNBad() const { return nbad; }
+	int GetNMissing() const { return nmissing; }
+
+	// covers cables up to GetMaxCable(); lookups beyond it are not bad
+	const uint64_t* BadOrMissingBits() const { return either.data(); }
+	int GetMaxCable() const { return 64*int(either.size())-1; }
+
+	// the run and subrun the bad channels were read for
+	void SetRun(int run_in, int subrun_in){ run = run_in; subrun = subrun_in; }
+	int GetRun() const { return run; }
+	int GetSubrun() const { return subrun; }
+
+	private:
+	static bool Test(const std::vector<uint64_t>& bits, int cable){
+		const unsigned word = unsigned(cable)>>6;
+		return word < bits.size() && ((bits[word] >> (cable&63)) & 1u);
+	}
+	int Fill(std::vector<uint64_t>& bits, int n, const int* cables) const;
+	void Combine();
+
+	size_t min_words;
+	std::vector<uint64_t> bad;
+	std::vector<uint64_t> missing;
+	std::vector<uint64_t> either;
+	int nbad=0;
+	int nmissing=0;
+	int run=-1;
+	int subrun=-1;
+};
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <cassert>
 #include <vector>
+#include <utility>
 #include <iostream>
 
 #include "Rtypes.h"
@@ -34,6 +35,13 @@ class Cluster
                 Append(copiedCluster->At(i));
         }
 
+        // exchange contents with another Cluster without copying the elements
+        void Swap(Cluster<T>& other)
+        {
+            element.swap(other.element);
+            std::swap(nElements, other.nElements);
+        }
+
         virtual void DumpAllElements() {}
 
         unsigned int GetSize()
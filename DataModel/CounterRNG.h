@@ -0,0 +1,62 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef CounterRNG_H
+#define CounterRNG_H
+
+#include <cstdint>
+#include <limits>
+
+/**
+* \class CounterRNG
+*
+* Counter-based random number generator (Philox4x32-10, Salmon et al., SC'11). Each output block is a
+* pure function of (seed, stream, counter), so a stream, e.g. one per toy experiment, gives the same
+* numbers whichever thread generates it and in whatever order the streams are used, with no state shared
+* between streams. Satisfies UniformRandomBitGenerator, so can drive the std:: distributions.
+*/
+class CounterRNG {
+	public:
+	using result_type = uint32_t;
+	CounterRNG(uint64_t seed, uint64_t stream) : key{uint32_t(seed), uint32_t(seed>>32)},
+	                                             stream_lo(uint32_t(stream)), stream_hi(uint32_t(stream>>32)) {}
+	static constexpr result_type min(){ return 0; }
+	static constexpr result_type max(){ return std::numeric_limits<result_type>::max(); }
+
+	result_type operator()(){
+		if(used==4){
+			Generate();
+			used=0;
+		}
+		return block[used++];
+	}
+	// uniform in (0,1), never exactly 0 or 1
+	double Uniform(){
+		const uint64_t bits = (uint64_t((*this)())<<21) ^ (*this)();   // 53 bits
+		return (double(bits & ((uint64_t(1)<<53)-1)) + 0.5)*(1./9007199254740992.);
+	}
+
+	private:
+	void Generate(){
+		uint32_t ctr[4] = {uint32_t(counter), uint32_t(counter>>32), stream_lo, stream_hi};
+		uint32_t k0 = key[0], k1 = key[1];
+		for(int round=0; round<10; ++round){
+			const uint64_t p0 = uint64_t(0xD2511F53u)*ctr[0];
+			const uint64_t p1 = uint64_t(0xCD9E8D57u)*ctr[2];
+			const uint32_t next[4] = {uint32_t(p1>>32)^ctr[1]^k0, uint32_t(p1),
+			                          uint32_t(p0>>32)^ctr[3]^k1, uint32_t(p0)};
+			for(int i=0; i<4; ++i) ctr[i] = next[i];
+			k0 += 0x9E3779B9u;
+			k1 += 0xBB67AE85u;
+		}
+		for(int i=0; i<4; ++i) block[i] = ctr[i];
+		++counter;
+	}
+
+	uint32_t key[2];
+	uint32_t stream_lo;
+	uint32_t stream_hi;
+	uint64_t counter = 0;
+	uint32_t block[4] = {0,0,0,0};
+	int used = 4;
+};
+
+#endif
@@ -0,0 +1,122 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "DarkNoise.h"
+#include "ChannelStatus.h"
+#include "CounterRNG.h"
+
+#include <cmath>
+
+namespace {
+	// SplitMix64 finaliser, to spread run numbers over the whole key
+	uint64_t Mix(uint64_t x){
+		x += 0x9E3779B97F4A7C15ull;
+		x = (x ^ (x>>30)) * 0xBF58476D1CE4E5B9ull;
+		x = (x ^ (x>>27)) * 0x94D049BB133111EBull;
+		return x ^ (x>>31);
+	}
+	const int kBlock = 64;
+	const double kTwoPi = 6.283185307179586;
+}
+
+void DarkNoise::SetRates(int n, const float* rates, const ChannelStatus* channel_status){
+	cables.clear();
+	std::vector<double> weights;
+	for(int c=0; c<n; ++c){
+		if(!(rates[c]>0)) continue;
+		if(channel_status && channel_status->IsBadOrMissing(c)) continue;
+		cables.push_back(c);
+		weights.push_back(rates[c]);
+	}
+	BuildAliasTable(weights);
+}
+
+void DarkNoise::SetUniformRate(int ncables, double rate, const ChannelStatus* channel_status){
+	cables.clear();
+	std::vector<double> weights;
+	if(rate>0){
+		for(int c=1; c<=ncables; ++c){
+			if(channel_status && channel_status->IsBadOrMissing(c)) continue;
+			cables.push_back(c);
+			weights.push_back(rate);
+		}
+	}
+	BuildAliasTable(weights);
+}
+
+void DarkNoise::BuildAliasTable(const std::vector<double>& weights){
+	// Vose's method: scale weights to mean 1, then pair each column below 1 with one above
+	const size_t n = weights.size();
+	total_rate = 0;
+	for(double w : weights) total_rate += w;
+	accept.assign(n, 1.);
+	alias.resize(n);
+	for(size_t i=0; i<n; ++i) alias[i] = int(i);
+	if(n==0) return;
+
+	std::vector<double> scaled(n);
+	std::vector<size_t> small, large;
+	for(size_t i=0; i<n; ++i){
+		scaled[i] = weights[i]*n/total_rate;
+		if(scaled[i]<1.) small.push_back(i);
+		else large.push_back(i);
+	}
+	while(!small.empty() && !large.empty()){
+		const size_t s = small.back();
+		small.pop_back();
+		const size_t l = large.back();
+		accept[s] = scaled[s];
+		alias[s] = int(l);
+		scaled[l] -= 1. - scaled[s];
+		if(scaled[l]<1.){
+			large.pop_back();
+			small.push_back(l);
+		}
+	}
+	// whatever is left is 1 up to rounding
+	for(size_t i : small) accept[i] = 1.;
+	for(size_t i : large) accept[i] = 1.;
+}
+
+size_t DarkNoise::Generate(int run_in, int event, int window, double t_start, double t_end,
+                           std::vector<Hit>& out) const {
+	out.clear();
+	if(cables.empty() || !(total_rate>0) || !(t_end>t_start)) return 0;
+
+	CounterRNG rng(seed ^ Mix(uint64_t(uint32_t(run_in))), (uint64_t(uint32_t(event))<<32) | uint32_t(window));
+	const double mean_gap = 1e9/total_rate;  // ns
+	const size_t ncolumns = cables.size();
+	out.reserve(size_t((t_end-t_start)/mean_gap*1.1) + 16);
+
+	// the exponential gaps between hits are drawn a block at a time, as they need only a log each
+	// and don't depend on one another; the running sum then gives the (sorted) hit times
+	double gaps[kBlock];
+	double t = t_start;
+	double spare_gauss = 0;
+	bool have_spare = false;
+	while(true){
+		for(int i=0; i<kBlock; ++i) gaps[i] = -std::log(rng.Uniform())*mean_gap;
+		for(int i=0; i<kBlock; ++i){
+			t += gaps[i];
+			const float time = float(t);
+			// n.b. also check after rounding to float, so no hit lands on t_end
+			if(t>=t_end || time>=t_end) return out.size();
+
+			const double u = rng.Uniform()*ncolumns;
+			size_t column = size_t(u);
+			if(column>=ncolumns) column = ncolumns-1;
+			const int cable = (u-column < accept[column]) ? cables[column] : cables[alias[column]];
+
+			// Box-Muller gives gaussians in pairs; use both
+			double gauss = spare_gauss;
+			if(!have_spare){
+				const double r = std::sqrt(-2.*std::log(rng.Uniform()));
+				const double phi = kTwoPi*rng.Uniform();
+				gauss = r*std::cos(phi);
+				spare_gauss = r*std::sin(phi);
+			}
+			have_spare = !have_spare;
+			const float charge = float(std::fabs(charge_mean + charge_sigma*gauss));
+
+			out.push_back({time, charge, cable});
+		}
+	}
+}
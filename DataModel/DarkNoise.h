@@ -0,0 +1,80 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef DarkNoise_H
+#define DarkNoise_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+class ChannelStatus;
+
+/**
+* \class DarkNoise
+*
+* Generates dark-noise hits from per-PMT dark rates, for overlaying onto MC (or otherwise noise-free) events.
+* Rates are set per run (SetRates, or SetUniformRate, with bad channels given zero rate) and
+* sampled by an alias table, so drawing the PMT of a hit costs the same whatever the number of channels.
+*
+* The noise in a time window is generated as one Poisson process with the summed rate: the gaps between hits
+* are exponential, so the hits come out already in time order and need no sorting. Each (run, event, window)
+* draws from its own CounterRNG stream, so the noise added to an event is reproducible, independent of which
+* events were processed before it, and safe to generate from several threads with one const DarkNoise.
+* Merge() then adds them to a time-ordered vector of any hit type with a single linear merge.
+*/
+class DarkNoise {
+	public:
+	struct Hit {
+		float time;      // ns
+		float charge;    // p.e.
+		int cable;
+	};
+
+	explicit DarkNoise(uint64_t seed_in=0) : seed(seed_in) {}
+	void SetSeed(uint64_t seed_in){ seed = seed_in; }
+
+	// rates[c] is the dark rate (Hz) of cable c, for c in [0,n); negative rates count as zero.
+	// Cables flagged bad (or missing) in the optional channel status get no hits.
+	void SetRates(int n, const float* rates, const ChannelStatus* channel_status=nullptr);
+	// the same rate for cables 1..ncables
+	void SetUniformRate(int ncables, double rate, const ChannelStatus* channel_status=nullptr);
+	// summed rate of all cables, Hz
+	double GetTotalRate() const { return total_rate; }
+
+	// hit charges are |gaussian(mean, sigma)|
+	void SetChargeModel(double mean, double sigma){ charge_mean = mean; charge_sigma = sigma; }
+
+	// the run the rates were set for, -1 if none
+	int GetRun() const { return run; }
+	void SetRun(int run_in){ run = run_in; }
+
+	// replace the contents of out with the dark hits of [t_start, t_end) ns for this run, event and window
+	// (any index distinguishing several windows of one event), in ascending time. Returns the number generated.
+	size_t Generate(int run_in, int event, int window, double t_start, double t_end, std::vector<Hit>& out) const;
+
+	// merge noise hits (ascending time) into hits (also ascending), converting each with convert(const Hit&)
+	// and ordering by time_of(const H&). On equal times the existing hit comes first.
+	template<typename H, typename Convert, typename TimeOf>
+	static void Merge(std::vector<H>& hits, const std::vector<Hit>& noise, Convert convert, TimeOf time_of){
+		const size_t n_old = hits.size();
+		hits.reserve(n_old + noise.size());
+		for(const Hit& hit : noise) hits.push_back(convert(hit));
+		std::inplace_merge(hits.begin(), hits.begin()+n_old, hits.end(),
+		                   [&time_of](const H& a, const H& b){ return time_of(a) < time_of(b); });
+	}
+
+	private:
+	void BuildAliasTable(const std::vector<double>& weights);
+
+	uint64_t seed;
+	int run = -1;
+	double total_rate = 0;
+	double charge_mean = 1.;
+	double charge_sigma = 0.7;
+	// alias table over cables: pick column i uniformly, keep it with probability accept[i], else take alias[i]
+	std::vector<int> cables;
+	std::vector<double> accept;
+	std::vector<int> alias;
+};
+
+#endif
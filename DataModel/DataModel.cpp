@@ -3,6 +3,7 @@
 #include "skheadC.h" // for skheadg_.sk_geometry needed to construct the ConnectionTable
 #include "fortran_routines.h"
 #include "MTreeReader.h"
+#include "ToolProfiler.h"
 
 DataModel* DataModel::thisptr=0;
 
@@ -17,6 +18,13 @@ DataModel::DataModel() : eventVariables_p(new BStore(false,true)), eventVariable
 	thisptr = this;
 }
 
+// a lightweight DataModel holding the event-wise members for one event in flight.
+// These are not registered as the singleton instance and do not make a TApplication.
+DataModel::DataModel(DataModel* parent) : eventVariables_p(new BStore(false,true)), eventVariables(*eventVariables_p) {
+	Log=parent->Log;
+	vars=parent->vars;
+}
+
 DataModel::~DataModel(){
 	//if(rootTApp) delete rootTApp;                 // segfaults on application termination, maybe?
 	//if(connectionTable) delete connectionTable;   // segfaults on application termination, maybe?
@@ -28,6 +36,10 @@ DataModel::~DataModel(){
 	if(bonsai_initialised){
 		cfbsexit_();
 	}
+	if(toolProfiler){
+		toolProfiler->Finalise();  // no-op if already done when the Tools were finalised
+		delete toolProfiler;
+	}
 }
 
 // open a file, making it if necessary. Useful for adding data to the same file from multiple Tools.
@@ -144,6 +156,36 @@ ConnectionTable* DataModel::GetConnectionTable(int sk_geometry){
 	return connectionTable;
 }
 
+const HitStore& DataModel::GetInGateHits(){
+	// the commons change on each new entry, on LoadSHE/LoadAFT/LoadCommons,
+	// and their hit times shift with each set_timing_gate call. Tools may also drop hits (e.g. RemoveBadHits)
+	HitStore::Key key;
+	key.run = skhead_.nrunsk;
+	key.subrun = skhead_.nsubsk;
+	key.event = skhead_.nevsk;
+	key.it0xsk = skheadqb_.it0xsk;
+	key.nhits = sktqz_.nqiskz;
+	if(!(inGateHits.GetKey()==key)){
+		inGateHits.Fill(sktqz_.nqiskz, sktqz_.icabiz, sktqz_.ihtiflz, sktqz_.tiskz, sktqz_.qiskz, MAXPM);
+		inGateHits.SetKey(key);
+	}
+	return inGateHits;
+}
+
+const ChannelStatus& DataModel::GetChannelStatus(){
+	if(skhead_.nrunsk!=channelStatusRun || skhead_.nsubsk!=channelStatusSubrun){
+		UpdateChannelStatus(skhead_.nrunsk, skhead_.nsubsk);
+	}
+	return channelStatus;
+}
+
+void DataModel::UpdateChannelStatus(int run, int subrun){
+	channelStatus.SetBad(combad_.nbad, combad_.isqbad);
+	channelStatus.SetRun(run, subrun);
+	channelStatusRun = skhead_.nrunsk;
+	channelStatusSubrun = skhead_.nsubsk;
+}
+
 TApplication* DataModel::GetTApp(){
 	if(rootTApp==nullptr){
 		rootTApp = new TApplication("rootTApp",0,0);
@@ -151,13 +193,14 @@ TApplication* DataModel::GetTApp(){
 	return rootTApp;
 }
 
-bool DataModel::RegisterReader(std::string readerName, MTreeReader* reader, std::function<bool()> hasAFT, std::function<bool()> loadSHE, std::function<bool()> loadAFT, std::function<bool(int)> loadCommon, std::function<int(long)> getTreeEntry){
+bool DataModel::RegisterReader(std::string readerName, MTreeReader* reader, std::function<bool()> hasAFT, std::function<bool()> loadSHE, std::function<bool()> loadAFT, std::function<bool(int)> loadCommon, std::function<int(long)> getTreeEntry, std::function<int()> numBufferedCommon){
 	Trees.emplace(readerName, reader);
 	hasAFTs.emplace(readerName, hasAFT);
 	loadSHEs.emplace(readerName, loadSHE);
 	loadAFTs.emplace(readerName, loadAFT);
 	loadCommons.emplace(readerName, loadCommon);
 	getEntrys.emplace(readerName, getTreeEntry);
+	numBufferedCommons.emplace(readerName, numBufferedCommon);
 	return true;
 }
 
@@ -237,6 +280,7 @@ bool DataModel::LoadSHE(std::string ReaderName){
 		// Typical situation where this may not be the case is if the MTreeReader is not
 		// associated with a TreeReader Tool, and is just a standalone MTreeReader class instance.
 		if(loadSHEs.at(ReaderName)){
+			InvalidateInGateHits();
 			return loadSHEs.at(ReaderName)();
 		} else {
 			std::cerr<<"DataModel::LoadSHE is not available for treeReader "<<ReaderName<<std::endl;
@@ -258,6 +302,7 @@ bool DataModel::LoadAFT(std::string ReaderName){
 		// Typical situation where this may not be the case is if the MTreeReader is not
 		// associated with a TreeReader Tool, and is just a standalone MTreeReader class instance.
 		if(loadAFTs.at(ReaderName)){
+			InvalidateInGateHits();
 			return loadAFTs.at(ReaderName)();
 		} else {
 			std::cerr<<"DataModel::LoadAFT is not available for treeReader "<<ReaderName<<std::endl;
@@ -288,6 +333,7 @@ bool DataModel::LoadCommons(int entry_i, std::string ReaderName){
 		// Typical situation where this may not be the case is if the MTreeReader is not
 		// associated with a TreeReader Tool, and is just a standalone MTreeReader class instance.
 		if(loadCommons.at(ReaderName)){
+			InvalidateInGateHits();
 			return loadCommons.at(ReaderName)(entry_i);
 		} else {
 			std::cerr<<"DataModel::LoadEntry is not available for treeReader "<<ReaderName<<std::endl;
@@ -299,6 +345,23 @@ bool DataModel::LoadCommons(int entry_i, std::string ReaderName){
 	return false;
 }
 
+int DataModel::NumBufferedCommons(std::string ReaderName){
+	if(ReaderName==""){
+		if(numBufferedCommons.size()) ReaderName = numBufferedCommons.begin()->first;
+	}
+	if(numBufferedCommons.count(ReaderName)){
+		if(numBufferedCommons.at(ReaderName)){
+			return numBufferedCommons.at(ReaderName)();
+		} else {
+			std::cerr<<"DataModel::NumBufferedCommons is not available for treeReader "<<ReaderName<<std::endl;
+			return 0;
+		}
+	} else {
+		std::cerr<<"DataModel::NumBufferedCommons requested for Unknown reader "<<ReaderName<<std::endl;
+	}
+	return 0;
+}
+
 void DataModel::KZInit(){
 	// wrapper to make sure this only gets invoked once
 	if(!kz_initialized){
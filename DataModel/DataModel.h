@@ -23,6 +23,7 @@
 #include "BStore.h"
 #include "Logging.h"
 #include "LoggingLevels.h"
+#include "LazyLog.h"
 #include "Utilities.h"
 #include "StoreToTTree.h"
 #include "Constants.h"
@@ -32,6 +33,8 @@
 #include "EventParticles.h"
 #include "EventTrueCaptures.h"
 #include "PMTHitCluster.h"
+#include "HitStore.h"
+#include "ChannelStatus.h"
 
 #include "MParticle.h"
 #include "NCapture.h"
@@ -45,6 +48,7 @@
 #include "MVertex.h"
 
 #include "ParticleCand.h"
+#include "TimeOrderedCandStore.h"
 #include "skroot_loweC.h"
 
 #include "MTreeSelection.h"
@@ -52,6 +56,7 @@
 class MTreeReader;
 class TreeReader;
 class ConnectionTable;
+class ToolProfiler;
 
 /**
  * \class DataModel
@@ -70,6 +75,8 @@ class DataModel {
  public:
   
   DataModel(); ///< Simple constructor
+  explicit DataModel(DataModel* parent); ///< Constructor for per-event contexts, see ParallelEvents. Shares the parent's Log and copies its vars.
+  std::vector<std::pair<int,std::string>>* eventLog=nullptr; ///< for per-event contexts: (level, message) of lines logged by EventParallelTools, printed when the event is committed
   ~DataModel(); ///< Simple destructor
   
   // some of our helper classes in the DataModel dir could benefit from access
@@ -96,6 +103,7 @@ class DataModel {
   std::unordered_map<std::string, std::function<bool()>> loadAFTs;
   std::unordered_map<std::string, std::function<bool(int)>> loadCommons;
   std::unordered_map<std::string, std::function<int(long)>> getEntrys;
+  std::unordered_map<std::string, std::function<int()>> numBufferedCommons;
   MTreeReader* GetTreeReader();
   
   Store vars; ///< This Store can be used for any variables. It is an inefficent ascii based storage and command line arguments will be placed in here along with ToolChain variables
@@ -104,7 +112,7 @@ class DataModel {
   
   // This function is used to register a TreeReader tool's member functions with the DataModel,
   // which provides access from other Tools
-  bool RegisterReader(std::string readerName, MTreeReader* reader, std::function<bool()> hasAFT={}, std::function<bool()> loadSHE={}, std::function<bool()> loadAFT={}, std::function<bool(int)> loadCommon={}, std::function<int(long)> getTreeEntry={});
+  bool RegisterReader(std::string readerName, MTreeReader* reader, std::function<bool()> hasAFT={}, std::function<bool()> loadSHE={}, std::function<bool()> loadAFT={}, std::function<bool(int)> loadCommon={}, std::function<int(long)> getTreeEntry={}, std::function<int()> numBufferedCommon={});
   int getTreeEntry(std::string ReaderName="", long entrynum=0, bool reloadevenifcurrententry=false);
   // These retain function pointers to call the corresponding TreeReader functions.
   // The TreeReader instance is obtained from the name specified in their config file.
@@ -112,6 +120,7 @@ class DataModel {
   bool LoadSHE(std::string ReaderName="");
   bool LoadAFT(std::string ReaderName="");
   bool LoadCommons(int entry_i, std::string ReaderName="");
+  int NumBufferedCommons(std::string ReaderName="");  // entries LoadCommons can load; may be short at the end of the input
   // tracking fortran logic unit numbers (LUNs, file handles)
   int GetNextLUN(std::string reader="reader", int lun=0);
   int GetLUN(std::string reader);
@@ -141,6 +150,18 @@ class DataModel {
   BStore* eventVariables_p; // TODO replace with a pointer and update tools to use -> instead of .
   BStore &eventVariables;   // use references to preserve current behaviour...
   
+  // in-gate ID hits of the event currently in the sktqz_ common block, refilled when it changes.
+  // Tools that modify sktqz_ in place should call InvalidateInGateHits afterwards
+  const HitStore& GetInGateHits();
+  void InvalidateInGateHits(){ inGateHits.Invalidate(); }
+  
+  // bad channels of the current run/subrun as a bitset, for O(1) per-hit lookups.
+  // Copied from combad_ again whenever the run or subrun in skhead_ changes, since skread_ and skbadch_
+  // refresh combad_ then. Tools that call skbadch_ themselves (e.g. with the reference run for MC) should
+  // call UpdateChannelStatus straight after, giving the run and subrun they read.
+  const ChannelStatus& GetChannelStatus();
+  void UpdateChannelStatus(int run, int subrun);
+  
   // NTag classes
   PMTHitCluster eventPMTHits;
   EventCandidates eventCandidates;
@@ -164,9 +185,9 @@ class DataModel {
   bool newMuon = false;   // flag for a new muon
   bool newRelic = false;  //flag for a new relic candidate
   
-  //deques of ALL muon candidates and relic candidates (before/during matching)
-  std::deque<ParticleCand> muonCandDeque;
-  std::deque<ParticleCand> relicCandDeque;
+  //time-ordered stores of ALL muon candidates and relic candidates (before/during matching)
+  TimeOrderedCandStore muonCandStore;
+  TimeOrderedCandStore relicCandStore;
   
   //deque of muons that need to be reconstructed (i.e. those matched to a relic candidate)
   std::vector<ParticleCand> muonsToRec;
@@ -176,6 +197,9 @@ class DataModel {
   
   //cached lowe common blocks, for use during matching
   std::map<long, skroot_lowe_common> loweCommonBufferMap;
+  
+  // per-Tool execution profiling, created by the Factory if 'profile_tools' is set in the ToolChainConfig
+  ToolProfiler* toolProfiler=nullptr;
 
   
  private:
@@ -184,6 +208,10 @@ class DataModel {
   //std::map<std::string,TTree*> m_trees; 
   TApplication* rootTApp=nullptr;
   ConnectionTable* connectionTable=nullptr;
+  HitStore inGateHits;
+  ChannelStatus channelStatus{MAXPM};
+  int channelStatusRun=-1;     // skhead_ run and subrun when channelStatus was last copied from combad_
+  int channelStatusSubrun=-1;
   
   // output ROOT files, for sharing between Tools
   // use OpenFile and CloseFile functions to access this.
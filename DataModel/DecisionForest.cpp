@@ -0,0 +1,643 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "DecisionForest.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include "TXMLEngine.h"
+
+namespace {
+	// TMVA reads its attributes with stringstreams, which convert as strtof/strtod
+	bool ReadAttr(TXMLEngine& xml, XMLNodePointer_t node, const char* name, float& value){
+		const char* attr = xml.GetAttr(node, name);
+		if(attr==nullptr) return false;
+		value = std::strtof(attr, nullptr);
+		return true;
+	}
+	bool ReadAttr(TXMLEngine& xml, XMLNodePointer_t node, const char* name, double& value){
+		const char* attr = xml.GetAttr(node, name);
+		if(attr==nullptr) return false;
+		value = std::strtod(attr, nullptr);
+		return true;
+	}
+	bool ReadAttr(TXMLEngine& xml, XMLNodePointer_t node, const char* name, int& value){
+		const char* attr = xml.GetAttr(node, name);
+		if(attr==nullptr) return false;
+		value = std::atoi(attr);
+		return true;
+	}
+	XMLNodePointer_t FindChild(TXMLEngine& xml, XMLNodePointer_t node, const char* name){
+		for(XMLNodePointer_t child=xml.GetChild(node); child!=nullptr; child=xml.GetNext(child)){
+			if(std::strcmp(xml.GetNodeName(child), name)==0) return child;
+		}
+		return nullptr;
+	}
+
+	// a minimal JSON document model for the tree dumps of XGBoost and export_bdt.py.
+	// Numbers keep their text, so they can be converted to float or double as the trainer held them
+	struct JsonValue {
+		enum Type { kNull, kBool, kNumber, kString, kArray, kObject };
+		Type type = kNull;
+		std::string text;                 // strings, and numbers as written; "true"/"false" for bools
+		std::vector<JsonValue> items;     // array elements, or object member values
+		std::vector<std::string> keys;    // object member names
+
+		const JsonValue* Find(const std::string& key) const {
+			for(size_t i=0; i<keys.size(); ++i) if(keys[i]==key) return &items[i];
+			return nullptr;
+		}
+		double Double() const { return (type==kBool) ? (text=="true") : std::strtod(text.c_str(), nullptr); }
+		float Float() const { return (type==kBool) ? (text=="true") : std::strtof(text.c_str(), nullptr); }
+		int Int() const { return (type==kBool) ? (text=="true") : std::atoi(text.c_str()); }
+	};
+
+	class JsonParser {
+		public:
+		explicit JsonParser(const std::string& text_in) : text(text_in) {}
+		bool Parse(JsonValue& value){
+			if(!ParseValue(value)) return false;
+			SkipSpace();
+			return pos==text.size();
+		}
+		size_t Position() const { return pos; }
+
+		private:
+		void SkipSpace(){ while(pos<text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) ++pos; }
+		bool ParseString(std::string& out){
+			if(pos>=text.size() || text[pos]!='"') return false;
+			++pos;
+			while(pos<text.size() && text[pos]!='"'){
+				if(text[pos]=='\\'){
+					if(++pos>=text.size()) return false;
+					switch(text[pos]){
+						case 'n': out += '\n'; break;
+						case 't': out += '\t'; break;
+						case 'r': out += '\r'; break;
+						case 'b': out += '\b'; break;
+						case 'f': out += '\f'; break;
+						case 'u': out += '?'; pos += 4; break;   // names only; no need to decode
+						default: out += text[pos];
+					}
+					++pos;
+				} else {
+					out += text[pos++];
+				}
+			}
+			if(pos>=text.size()) return false;
+			++pos;
+			return true;
+		}
+		bool ParseValue(JsonValue& value){
+			SkipSpace();
+			if(pos>=text.size()) return false;
+			const char c = text[pos];
+			if(c=='{' || c=='['){
+				value.type = (c=='{') ? JsonValue::kObject : JsonValue::kArray;
+				const char close = (c=='{') ? '}' : ']';
+				++pos;
+				SkipSpace();
+				if(pos<text.size() && text[pos]==close){ ++pos; return true; }
+				while(true){
+					if(value.type==JsonValue::kObject){
+						SkipSpace();
+						value.keys.emplace_back();
+						if(!ParseString(value.keys.back())) return false;
+						SkipSpace();
+						if(pos>=text.size() || text[pos]!=':') return false;
+						++pos;
+					}
+					value.items.emplace_back();
+					if(!ParseValue(value.items.back())) return false;
+					SkipSpace();
+					if(pos>=text.size()) return false;
+					if(text[pos]==','){ ++pos; continue; }
+					if(text[pos]==close){ ++pos; return true; }
+					return false;
+				}
+			}
+			if(c=='"'){
+				value.type = JsonValue::kString;
+				return ParseString(value.text);
+			}
+			const size_t start = pos;
+			while(pos<text.size() && (std::isalnum(static_cast<unsigned char>(text[pos])) || std::strchr("+-.", text[pos]))) ++pos;
+			value.text = text.substr(start, pos-start);
+			if(value.text=="true" || value.text=="false") value.type = JsonValue::kBool;
+			else if(value.text=="null") value.type = JsonValue::kNull;
+			else if(!value.text.empty()) value.type = JsonValue::kNumber;
+			else return false;
+			return true;
+		}
+
+		const std::string& text;
+		size_t pos = 0;
+	};
+
+	bool ReadJson(const std::string& filename, JsonValue& document, std::string& error){
+		std::ifstream file(filename);
+		if(!file.is_open()){
+			error = "can't open "+filename;
+			return false;
+		}
+		std::stringstream contents;
+		contents << file.rdbuf();
+		const std::string text = contents.str();
+		JsonParser parser(text);
+		if(!parser.Parse(document)){
+			error = "can't parse "+filename+" near character "+std::to_string(parser.Position());
+			return false;
+		}
+		return true;
+	}
+
+	// an array member of a JSON object, of at least n elements
+	const JsonValue* FindArray(const JsonValue& object, const char* key, size_t n){
+		const JsonValue* array = object.Find(key);
+		return (array!=nullptr && array->type==JsonValue::kArray && array->items.size()>=n) ? array : nullptr;
+	}
+
+	// the smallest float greater than the double threshold, so that for float x, x <= threshold is !(x >= cut)
+	float CutAbove(double threshold){
+		float cut = static_cast<float>(threshold);
+		if(!(double(cut) > threshold)) cut = std::nextafter(cut, std::numeric_limits<float>::infinity());
+		return cut;
+	}
+}
+
+bool DecisionForest::LoadTMVA(const std::string& filename){
+	error.clear();
+	TXMLEngine xml;
+	xml.SetSkipComments(true);
+	XMLDocPointer_t doc = xml.ParseFile(filename.c_str());
+	if(doc==nullptr){
+		error = "can't parse "+filename;
+		return false;
+	}
+	// read into a new forest, so this one is only replaced once the whole file has been read
+	DecisionForest forest;
+	bool ok = [&](){
+		XMLNodePointer_t setup = xml.DocGetRootElement(doc);
+		const char* method = (setup!=nullptr) ? xml.GetAttr(setup, "Method") : nullptr;
+		if(method==nullptr || std::strncmp(method, "BDT", 3)!=0){
+			error = filename+" is not a TMVA BDT weight file";
+			return false;
+		}
+
+		// the options that change how the forest is evaluated
+		std::string boost_type = "AdaBoost";
+		bool yes_no_leaf = true;
+		bool preselection = false;
+		XMLNodePointer_t options = FindChild(xml, setup, "Options");
+		for(XMLNodePointer_t option=(options!=nullptr) ? xml.GetChild(options) : nullptr; option!=nullptr; option=xml.GetNext(option)){
+			const char* name = xml.GetAttr(option, "name");
+			const char* content = xml.GetNodeContent(option);
+			if(name==nullptr || content==nullptr) continue;
+			if(std::strcmp(name, "BoostType")==0) boost_type = content;
+			else if(std::strcmp(name, "UseYesNoLeaf")==0) yes_no_leaf = (std::strcmp(content, "True")==0);
+			else if(std::strcmp(name, "DoPreselection")==0) preselection = (std::strcmp(content, "True")==0);
+		}
+		// as TMVA::MethodBDT::ProcessOptions
+		if(boost_type=="RealAdaBoost") yes_no_leaf = false;
+		if(preselection){
+			error = "preselection cuts are not supported";
+			return false;
+		}
+
+		XMLNodePointer_t variables = FindChild(xml, setup, "Variables");
+		int nvars = 0;
+		if(variables==nullptr || !ReadAttr(xml, variables, "NVar", nvars)){
+			error = "no input variables";
+			return false;
+		}
+		std::vector<std::string> names(nvars);
+		for(XMLNodePointer_t variable=xml.GetChild(variables); variable!=nullptr; variable=xml.GetNext(variable)){
+			int index = -1;
+			const char* expression = xml.GetAttr(variable, "Expression");
+			if(!ReadAttr(xml, variable, "VarIndex", index) || index<0 || index>=nvars || expression==nullptr){
+				error = "bad input variable";
+				return false;
+			}
+			names[index] = expression;
+		}
+		forest.SetInputNames(names);
+
+		// spectators are not inputs, but a TMVA Reader booking the same file must declare them
+		std::vector<std::string> spectators;
+		XMLNodePointer_t spectator_list = FindChild(xml, setup, "Spectators");
+		int nspectators = 0;
+		if(spectator_list!=nullptr) ReadAttr(xml, spectator_list, "NSpec", nspectators);
+		if(nspectators>0){
+			spectators.resize(nspectators);
+			for(XMLNodePointer_t spectator=xml.GetChild(spectator_list); spectator!=nullptr; spectator=xml.GetNext(spectator)){
+				int index = -1;
+				const char* expression = xml.GetAttr(spectator, "Expression");
+				if(!ReadAttr(xml, spectator, "SpecIndex", index) || index<0 || index>=nspectators || expression==nullptr){
+					error = "bad spectator";
+					return false;
+				}
+				spectators[index] = expression;
+			}
+		}
+		forest.SetSpectatorNames(spectators);
+
+		// the Reader would apply these to the inputs before the forest
+		int ntransformations = 0;
+		XMLNodePointer_t transformations = FindChild(xml, setup, "Transformations");
+		if(transformations!=nullptr) ReadAttr(xml, transformations, "NTransformations", ntransformations);
+		if(ntransformations>0){
+			error = "input variable transformations are not supported";
+			return false;
+		}
+
+		XMLNodePointer_t weights = FindChild(xml, setup, "Weights");
+		int analysis_type = 0;   // TMVA::Types::kClassification; trees of gradient boosted forests are kRegression
+		if(weights==nullptr){
+			error = "no trees";
+			return false;
+		}
+		if(!ReadAttr(xml, weights, "AnalysisType", analysis_type)) ReadAttr(xml, weights, "TreeType", analysis_type);
+		const bool grad = (boost_type=="Grad");
+
+		// as TMVA::DecisionTree::CheckEvent: the leaf response for regression trees,
+		// otherwise the leaf type (+1 signal, -1 background) or its purity
+		std::function<int(XMLNodePointer_t, double, std::vector<TreeNode>&)> add_node;
+		add_node = [&](XMLNodePointer_t xmlnode, double weight, std::vector<TreeNode>& tree) -> int {
+			const int index = tree.size();
+			tree.emplace_back();
+			int ncoef = 0, type = 0, cut_type = 1;
+			ReadAttr(xml, xmlnode, "NCoef", ncoef);
+			if(ncoef>0){
+				error = "Fisher cuts are not supported";
+				return -1;
+			}
+			if(!ReadAttr(xml, xmlnode, "nType", type)){
+				error = "tree node without a type";
+				return -1;
+			}
+			if(type!=0){
+				float leaf = 0;
+				if(analysis_type==1){
+					ReadAttr(xml, xmlnode, "res", leaf);
+				} else if(yes_no_leaf && !grad){
+					leaf = type;
+				} else if(!ReadAttr(xml, xmlnode, "purity", leaf)){
+					float nsig = 0, nbkg = 0;
+					ReadAttr(xml, xmlnode, "nS", nsig);
+					ReadAttr(xml, xmlnode, "nB", nbkg);
+					leaf = nsig/(nsig+nbkg);
+				}
+				tree[index].value = weight*leaf;
+				return index;
+			}
+			TreeNode& node = tree[index];
+			if(!ReadAttr(xml, xmlnode, "IVar", node.input) || !ReadAttr(xml, xmlnode, "Cut", node.cut)
+			   || node.input<0 || node.input>=nvars){
+				error = "bad tree node";
+				return -1;
+			}
+			ReadAttr(xml, xmlnode, "cType", cut_type);
+			// cType 1: inputs >= cut go right; cType 0: they go left
+			int left = -1, right = -1;
+			for(XMLNodePointer_t child=xml.GetChild(xmlnode); child!=nullptr; child=xml.GetNext(child)){
+				const char* pos = xml.GetAttr(child, "pos");
+				if(pos==nullptr || std::strcmp(xml.GetNodeName(child), "Node")!=0) continue;
+				int child_index = add_node(child, weight, tree);
+				if(child_index<0) return -1;
+				if(pos[0]=='l') left = child_index;
+				else if(pos[0]=='r') right = child_index;
+			}
+			if(left<0 || right<0){
+				error = "tree node without two children";
+				return -1;
+			}
+			tree[index].child[0] = cut_type ? left : right;
+			tree[index].child[1] = cut_type ? right : left;
+			return index;
+		};
+
+		double weight_sum = 0;
+		std::vector<TreeNode> tree;
+		for(XMLNodePointer_t xmltree=xml.GetChild(weights); xmltree!=nullptr; xmltree=xml.GetNext(xmltree)){
+			if(std::strcmp(xml.GetNodeName(xmltree), "BinaryTree")!=0) continue;
+			double boost_weight = 1;
+			ReadAttr(xml, xmltree, "boostWeight", boost_weight);
+			XMLNodePointer_t root = FindChild(xml, xmltree, "Node");
+			tree.clear();
+			if(root==nullptr || add_node(root, grad ? 1. : boost_weight, tree)<0){
+				if(error.empty()) error = "empty tree";
+				return false;
+			}
+			forest.AddTree(tree);
+			weight_sum += boost_weight;
+		}
+		if(forest.GetNTrees()==0){
+			error = "no trees";
+			return false;
+		}
+		if(grad) forest.SetTransform(kTMVAGradBoost);
+		else forest.SetTransform(kWeightedMean, weight_sum);
+		return true;
+	}();
+	xml.FreeDoc(doc);
+	if(!ok) return false;
+
+	*this = std::move(forest);
+	error.clear();
+	return true;
+}
+
+bool DecisionForest::LoadXGBoost(const std::string& filename){
+	error.clear();
+	JsonValue document;
+	if(!ReadJson(filename, document, error)) return false;
+	const JsonValue* learner = document.Find("learner");
+	const JsonValue* booster = (learner!=nullptr) ? learner->Find("gradient_booster") : nullptr;
+	const JsonValue* booster_name = (booster!=nullptr) ? booster->Find("name") : nullptr;
+	if(booster_name==nullptr){
+		error = filename+" is not an XGBoost JSON model";
+		return false;
+	}
+	if(booster_name->text!="gbtree"){
+		error = "only gbtree boosters are supported, not "+booster_name->text;
+		return false;
+	}
+	const JsonValue* model = booster->Find("model");
+	const JsonValue* trees = (model!=nullptr) ? FindArray(*model, "trees", 1) : nullptr;
+	const JsonValue* params = learner->Find("learner_model_param");
+	const JsonValue* objective = learner->Find("objective");
+	const JsonValue* objective_name = (objective!=nullptr) ? objective->Find("name") : nullptr;
+	if(trees==nullptr || params==nullptr || objective_name==nullptr){
+		error = "no trees";
+		return false;
+	}
+	const JsonValue* num_class = params->Find("num_class");
+	if(num_class!=nullptr && num_class->Int()>1){
+		error = "multi-class models are not supported";
+		return false;
+	}
+
+	DecisionForest forest;
+	int nfeatures = 0;
+	if(const JsonValue* num_feature = params->Find("num_feature")) nfeatures = num_feature->Int();
+	std::vector<std::string> names;
+	const JsonValue* feature_names = learner->Find("feature_names");
+	if(feature_names!=nullptr && int(feature_names->items.size())==nfeatures){
+		for(const JsonValue& name : feature_names->items) names.push_back(name.text);
+	} else {
+		for(int i=0; i<nfeatures; ++i) names.push_back("f"+std::to_string(i));
+	}
+	forest.SetInputNames(names);
+
+	// inputs < split_condition go left, and missing inputs the default way
+	std::vector<TreeNode> tree;
+	for(const JsonValue& xgbtree : trees->items){
+		const JsonValue* left = FindArray(xgbtree, "left_children", 1);
+		const size_t nnodes = (left!=nullptr) ? left->items.size() : 0;
+		const JsonValue* right = FindArray(xgbtree, "right_children", nnodes);
+		const JsonValue* conditions = FindArray(xgbtree, "split_conditions", nnodes);
+		const JsonValue* indices = FindArray(xgbtree, "split_indices", nnodes);
+		const JsonValue* default_left = FindArray(xgbtree, "default_left", nnodes);
+		const JsonValue* split_type = FindArray(xgbtree, "split_type", nnodes);
+		if(left==nullptr || right==nullptr || conditions==nullptr || indices==nullptr || default_left==nullptr){
+			error = "bad tree";
+			return false;
+		}
+		tree.assign(nnodes, TreeNode());
+		for(size_t i=0; i<nnodes; ++i){
+			TreeNode& node = tree[i];
+			if(left->items[i].Int()<0){
+				// leaf values are kept in split_conditions
+				node.value = conditions->items[i].Float();
+				continue;
+			}
+			if(split_type!=nullptr && split_type->items[i].Int()!=0){
+				error = "categorical splits are not supported";
+				return false;
+			}
+			node.input = indices->items[i].Int();
+			node.cut = conditions->items[i].Float();
+			node.child[0] = left->items[i].Int();
+			node.child[1] = right->items[i].Int();
+			node.missing_high = !default_left->items[i].Int();
+			if(node.input<0 || node.input>=nfeatures || node.child[0]<=0 || size_t(node.child[0])>=nnodes
+			   || node.child[1]<=0 || size_t(node.child[1])>=nnodes){
+				error = "bad tree node";
+				return false;
+			}
+		}
+		forest.AddTree(tree);
+	}
+
+	// base_score is given as a prediction, e.g. a probability for logistic objectives
+	const JsonValue* base_score = params->Find("base_score");
+	std::string base_text = (base_score!=nullptr) ? base_score->text : "0.5";
+	base_text.erase(std::remove(base_text.begin(), base_text.end(), '['), base_text.end());
+	const double base_prediction = std::strtod(base_text.c_str(), nullptr);
+	const std::string& name = objective_name->text;
+	if(name=="binary:logistic" || name=="reg:logistic"){
+		forest.SetTransform(kLogistic);
+		forest.SetBaseValue(-std::log(1.0/base_prediction-1.0));
+	} else if(name=="binary:logitraw" || name.compare(0, 4, "reg:")==0){
+		forest.SetTransform(kIdentity);
+		forest.SetBaseValue(base_prediction);
+	} else {
+		error = "objective "+name+" is not supported";
+		return false;
+	}
+
+	*this = std::move(forest);
+	return true;
+}
+
+bool DecisionForest::LoadSklearn(const std::string& filename){
+	error.clear();
+	JsonValue document;
+	if(!ReadJson(filename, document, error)) return false;
+	const JsonValue* format = document.Find("format");
+	if(format==nullptr || format->text!="sklearn-tree-ensemble"){
+		error = filename+" was not written by export_bdt.py";
+		return false;
+	}
+	const JsonValue* nfeatures_value = document.Find("n_features");
+	const JsonValue* transform_value = document.Find("transform");
+	const JsonValue* trees = FindArray(document, "trees", 1);
+	if(nfeatures_value==nullptr || transform_value==nullptr || trees==nullptr){
+		error = "no trees";
+		return false;
+	}
+
+	DecisionForest forest;
+	const int nfeatures = nfeatures_value->Int();
+	std::vector<std::string> names;
+	const JsonValue* feature_names = document.Find("feature_names");
+	if(feature_names!=nullptr && int(feature_names->items.size())==nfeatures){
+		for(const JsonValue& name : feature_names->items) names.push_back(name.text);
+	} else {
+		for(int i=0; i<nfeatures; ++i) names.push_back("x"+std::to_string(i));
+	}
+	forest.SetInputNames(names);
+
+	// inputs <= threshold go left; missing inputs right, unless missing_left
+	std::vector<TreeNode> tree;
+	for(const JsonValue& sktree : trees->items){
+		const JsonValue* left = FindArray(sktree, "left", 1);
+		const size_t nnodes = (left!=nullptr) ? left->items.size() : 0;
+		const JsonValue* right = FindArray(sktree, "right", nnodes);
+		const JsonValue* feature = FindArray(sktree, "feature", nnodes);
+		const JsonValue* threshold = FindArray(sktree, "threshold", nnodes);
+		const JsonValue* value = FindArray(sktree, "value", nnodes);
+		const JsonValue* missing_left = FindArray(sktree, "missing_left", nnodes);
+		if(left==nullptr || right==nullptr || feature==nullptr || threshold==nullptr || value==nullptr){
+			error = "bad tree";
+			return false;
+		}
+		tree.assign(nnodes, TreeNode());
+		for(size_t i=0; i<nnodes; ++i){
+			TreeNode& node = tree[i];
+			if(left->items[i].Int()<0){
+				node.value = value->items[i].Double();
+				continue;
+			}
+			node.input = feature->items[i].Int();
+			node.cut = CutAbove(threshold->items[i].Double());
+			node.child[0] = left->items[i].Int();
+			node.child[1] = right->items[i].Int();
+			node.missing_high = (missing_left==nullptr) || !missing_left->items[i].Int();
+			if(node.input<0 || node.input>=nfeatures || node.child[0]<=0 || size_t(node.child[0])>=nnodes
+			   || node.child[1]<=0 || size_t(node.child[1])>=nnodes){
+				error = "bad tree node";
+				return false;
+			}
+		}
+		forest.AddTree(tree);
+	}
+
+	const JsonValue* base = document.Find("base");
+	if(base!=nullptr) forest.SetBaseValue(base->Double());
+	const std::string& transform_name = transform_value->text;
+	if(transform_name=="logistic"){
+		forest.SetTransform(kLogistic);
+	} else if(transform_name=="mean"){
+		forest.SetTransform(kWeightedMean, forest.GetNTrees());
+	} else if(transform_name=="identity"){
+		forest.SetTransform(kIdentity);
+	} else {
+		error = "transform "+transform_name+" is not supported";
+		return false;
+	}
+
+	*this = std::move(forest);
+	return true;
+}
+
+void DecisionForest::AddTree(const std::vector<TreeNode>& tree){
+	const int32_t offset = nodes.size();
+	roots.push_back(offset);
+	for(size_t i=0; i<tree.size(); ++i){
+		const TreeNode& node = tree[i];
+		Node flat;
+		if(node.input<0){
+			// leaves loop back to themselves, so shallower leaves are simply revisited
+			flat.input = 0;
+			flat.cut = 0;
+			flat.next[0] = flat.next[1] = offset+i;
+			leaf_values.push_back(node.value);
+		} else {
+			flat.input = node.missing_high ? ~node.input : node.input;
+			flat.cut = node.cut;
+			flat.next[0] = offset+node.child[0];
+			flat.next[1] = offset+node.child[1];
+			leaf_values.push_back(0);
+		}
+		nodes.push_back(flat);
+		node_inputs.push_back(flat.input);
+	}
+
+	// the number of steps from the root to the deepest leaf
+	int32_t depth = 0;
+	std::vector<std::pair<int, int32_t>> stack{{0, 0}};
+	while(!stack.empty() && !tree.empty()){
+		const int i = stack.back().first;
+		const int32_t node_depth = stack.back().second;
+		stack.pop_back();
+		depth = std::max(depth, node_depth);
+		if(tree[i].input<0) continue;
+		stack.emplace_back(tree[i].child[0], node_depth+1);
+		stack.emplace_back(tree[i].child[1], node_depth+1);
+	}
+	depths.push_back(depth);
+	if(!columns.empty()) MapInputs(columns);
+}
+
+void DecisionForest::MapInputs(const std::vector<int>& columns_in){
+	columns = columns_in;
+	for(size_t i=0; i<nodes.size(); ++i){
+		if(nodes[i].next[0]==int32_t(i) && nodes[i].next[1]==int32_t(i)) continue;   // leaf
+		const bool missing_high = node_inputs[i]<0;
+		const int32_t input = missing_high ? ~node_inputs[i] : node_inputs[i];
+		const int32_t column = (size_t(input)<columns.size()) ? columns[input] : input;
+		nodes[i].input = missing_high ? ~column : column;
+	}
+}
+
+void DecisionForest::Clear(){
+	nodes.clear();
+	node_inputs.clear();
+	leaf_values.clear();
+	roots.clear();
+	depths.clear();
+	columns.clear();
+	input_names.clear();
+	spectator_names.clear();
+	transform = kIdentity;
+	norm = 1;
+	base = 0;
+}
+
+double DecisionForest::Finish(double sum) const {
+	switch(transform){
+		case kWeightedMean: return (norm>std::numeric_limits<double>::epsilon()) ? sum/norm : 0;
+		case kTMVAGradBoost: return 2.0/(1.0+std::exp(-2.0*sum))-1;
+		case kLogistic: return 1.0/(1.0+std::exp(-sum));
+		default: return sum;
+	}
+}
+
+void DecisionForest::Evaluate(const float* rows, size_t n, size_t stride, double* outputs) const {
+	const Node* node_data = nodes.data();
+	const double* values = leaf_values.data();
+	int32_t index[kBlock];
+	double sums[kBlock];
+	for(size_t begin=0; begin<n; begin+=kBlock){
+		const size_t count = std::min(kBlock, n-begin);
+		const float* block = rows + begin*stride;
+		std::fill(sums, sums+count, base);
+		for(size_t tree=0; tree<roots.size(); ++tree){
+			std::fill(index, index+count, roots[tree]);
+			for(int32_t step=0; step<depths[tree]; ++step){
+				for(size_t k=0; k<count; ++k){
+					const Node& node = node_data[index[k]];
+					const int32_t column = node.input ^ (node.input >> 31);   // ~input for missing_high nodes
+					const float x = block[k*stride+column];
+					index[k] = node.next[(x >= node.cut) | ((node.input < 0) & (x != x))];
+				}
+			}
+			for(size_t k=0; k<count; ++k) sums[k] += values[index[k]];
+		}
+		for(size_t k=0; k<count; ++k) outputs[begin+k] = Finish(sums[k]);
+	}
+}
+
+double DecisionForest::Evaluate(const float* row) const {
+	double output = 0;
+	Evaluate(row, 1, 0, &output);
+	return output;
+}
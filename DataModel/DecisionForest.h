@@ -0,0 +1,104 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef DecisionForest_H
+#define DecisionForest_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+/**
+* \class DecisionForest
+*
+* A forest of binary decision trees (a boosted or bagged tree ensemble) evaluated natively, without the
+* framework it was trained in. The trees are read from a TMVA BDT weight file, an XGBoost JSON model,
+* a scikit-learn ensemble exported to JSON (UserTools/ntag_BDT/export_bdt.py), or given node by node.
+*
+* All trees are flattened into one array of 16 byte nodes, each with the input it cuts on, its cut value and
+* the indices of its two children, and leaves point to themselves. A tree of depth d is then traversed by
+* exactly d steps of next = child[x >= cut], without a branch on the path taken or on reaching a leaf.
+* Evaluate() runs each tree over a block of inputs at a time, so the tree stays in cache and the traversals of
+* the block are independent.
+*
+* The sum over trees is accumulated in double precision in the order the trees were added, as TMVA and
+* scikit-learn do, so a forest read from a TMVA weight file gives the same output as the TMVA Reader to the last bit.
+* XGBoost sums in single precision, so its outputs agree to within float rounding.
+*/
+class DecisionForest {
+	public:
+	// applied to the sum over trees of the leaf values
+	enum Transform {
+		kIdentity,       // the sum
+		kWeightedMean,   // sum/norm, or 0 if norm is not positive (TMVA AdaBoost and bagging)
+		kTMVAGradBoost,  // 2/(1+exp(-2*sum))-1 (TMVA gradient boost)
+		kLogistic        // 1/(1+exp(-sum))
+	};
+	struct TreeNode {
+		int input = -1;          // index of the input cut on; < 0 for a leaf
+		float cut = 0;
+		int child[2] = {0, 0};   // index in the tree of the next node when input < cut, and when >= cut
+		bool missing_high = false;   // NaN inputs go to child[1] rather than child[0]
+		double value = 0;        // leaf value, already multiplied by any tree weight
+	};
+
+	// read a TMVA BDT weight file (.weights.xml). Returns false, keeping the current forest, if the file can't
+	// be read or uses a feature not supported here (input transformations, Fisher cuts, preselection)
+	bool LoadTMVA(const std::string& filename);
+	// read an XGBoost model saved as JSON (Booster.save_model("model.json")). Binary and regression
+	// objectives of gbtree boosters only; the output is the prediction, e.g. the class 1 probability
+	bool LoadXGBoost(const std::string& filename);
+	// read a scikit-learn tree ensemble exported by export_bdt.py. The output is the class 1 probability
+	// (predict_proba(X)[:,1]) of classifiers and the prediction of regressors
+	bool LoadSklearn(const std::string& filename);
+	// why the last load failed
+	const std::string& GetError() const { return error; }
+
+	// add a tree whose root is tree[0]
+	void AddTree(const std::vector<TreeNode>& tree);
+	void SetInputNames(const std::vector<std::string>& names){ input_names = names; }
+	void SetSpectatorNames(const std::vector<std::string>& names){ spectator_names = names; }
+	void SetTransform(Transform transform_in, double norm_in=1){ transform = transform_in; norm = norm_in; }
+	// added to the sum over trees before the transform
+	void SetBaseValue(double base_in){ base = base_in; }
+	void Clear();
+
+	// input names, as given by the variable expressions of a TMVA weight file or the model's feature names
+	const std::vector<std::string>& GetInputNames() const { return input_names; }
+	// spectators of a TMVA weight file, which don't affect the output; empty for other formats
+	const std::vector<std::string>& GetSpectatorNames() const { return spectator_names; }
+	int GetNInputs() const { return input_names.size(); }
+	int GetNTrees() const { return roots.size(); }
+	size_t GetNNodes() const { return nodes.size(); }
+
+	// read input i from column columns[i] of each row of the matrices given to Evaluate,
+	// e.g. the columns of the features in a candidate feature matrix. By default input i is column i
+	void MapInputs(const std::vector<int>& columns);
+
+	// outputs of n rows of inputs, each row stride floats after the last
+	void Evaluate(const float* rows, size_t n, size_t stride, double* outputs) const;
+	double Evaluate(const float* row) const;
+
+	private:
+	struct Node {
+		int32_t input;       // column; ~column if NaN goes to next[1]
+		float cut;
+		int32_t next[2];
+	};
+	static constexpr size_t kBlock = 32;   // inputs traversed together
+	double Finish(double sum) const;
+
+	std::vector<Node> nodes;
+	std::vector<double> leaf_values;   // indexed as nodes; 0 for internal nodes
+	std::vector<int32_t> node_inputs;  // input of each node as in Node, before MapInputs
+	std::vector<int32_t> roots;
+	std::vector<int32_t> depths;
+	std::vector<int> columns;           // column of each input
+	std::vector<std::string> input_names;
+	std::vector<std::string> spectator_names;
+	Transform transform = kIdentity;
+	double norm = 1;
+	double base = 0;
+	std::string error;
+};
+
+#endif
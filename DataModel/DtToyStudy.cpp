@@ -0,0 +1,385 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "DtToyStudy.h"
+#include "CounterRNG.h"
+
+#include <cmath>
+#include <thread>
+#include <random>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+	const int max_iterations = 100;
+	// stop when the predicted decrease in -log(L) is below this
+	const double nll_tolerance = 1e-6;
+	// fitted lifetimes are found to this relative precision
+	const double lifetime_tolerance = 1e-4;
+
+	// in-place Cholesky decomposition of a row-major symmetric n x n matrix, lower triangle.
+	// Returns false if it isn't positive definite.
+	bool CholeskyDecompose(std::vector<double>& a, int n){
+		for(int j=0; j<n; ++j){
+			double diag = a[j*n+j];
+			for(int k=0; k<j; ++k) diag -= a[j*n+k]*a[j*n+k];
+			if(!(diag>0)) return false;
+			diag = std::sqrt(diag);
+			a[j*n+j] = diag;
+			for(int i=j+1; i<n; ++i){
+				double sum = a[i*n+j];
+				for(int k=0; k<j; ++k) sum -= a[i*n+k]*a[j*n+k];
+				a[i*n+j] = sum/diag;
+			}
+		}
+		return true;
+	}
+	// solve (L L^T) x = b, b given in x
+	void CholeskySolve(const std::vector<double>& l, int n, double* x){
+		for(int i=0; i<n; ++i){
+			double sum = x[i];
+			for(int k=0; k<i; ++k) sum -= l[i*n+k]*x[k];
+			x[i] = sum/l[i*n+i];
+		}
+		for(int i=n-1; i>=0; --i){
+			double sum = x[i];
+			for(int k=i+1; k<n; ++k) sum -= l[k*n+i]*x[k];
+			x[i] = sum/l[i*n+i];
+		}
+	}
+	// Hessian restricted to the given parameters, decomposed, with a small ridge added if it is singular
+	bool DecomposeSubmatrix(const std::vector<double>& hess, int npars, const std::vector<int>& pars, std::vector<double>& sub){
+		const int n = pars.size();
+		double trace=0;
+		for(int i=0; i<n; ++i) trace += hess[pars[i]*npars+pars[i]];
+		double ridge=0;
+		for(int attempt=0; attempt<8; ++attempt){
+			sub.resize(n*n);
+			for(int i=0; i<n; ++i){
+				for(int j=0; j<n; ++j) sub[i*n+j] = hess[pars[i]*npars+pars[j]];
+				sub[i*n+i] += ridge;
+			}
+			if(CholeskyDecompose(sub, n)) return true;
+			ridge = (ridge==0) ? 1e-12*trace/n : ridge*100;
+		}
+		return false;
+	}
+}
+
+DtToyStudy::DtToyStudy(const SpallationDtLikelihood& model_in, const std::vector<double>& truth_in) :
+	model(model_in), truth(truth_in), fixed(truth_in.size(), false) {
+	if(int(truth.size())!=model.GetNParameters()){
+		throw std::invalid_argument("DtToyStudy - need one true value per model parameter");
+	}
+	// drop any data from the copy, and evaluate single-threaded, since toys are run in parallel
+	model.SetEvents({});
+	model.SetNThreads(1);
+}
+
+bool DtToyStudy::Fit(const SpallationDtLikelihood& nll, const std::vector<bool>& fixed, std::vector<double>& pars,
+                     std::vector<double>* errors, double* minval){
+	const int npars = nll.GetNParameters();
+	std::vector<double> grad(npars), hess(npars*npars), trial(npars), sub, step;
+	std::vector<int> active;
+	double f = nll.NLLAndGradient(pars.data(), grad.data());
+	bool converged=false;
+	for(int iter=0; iter<max_iterations; ++iter){
+		nll.Hessian(pars.data(), hess.data());
+		// parameters to vary: not fixed, and not held at 0 by the gradient
+		active.clear();
+		for(int par=0; par<npars; ++par) if(!fixed[par] && (pars[par]>0 || grad[par]<0)) active.push_back(par);
+		if(active.empty()){
+			converged=true;
+			break;
+		}
+		if(!DecomposeSubmatrix(hess, npars, active, sub)) break;
+		const int nactive = active.size();
+		step.resize(nactive);
+		for(int i=0; i<nactive; ++i) step[i] = -grad[active[i]];
+		CholeskySolve(sub, nactive, step.data());
+		double decrement=0;
+		for(int i=0; i<nactive; ++i) decrement -= grad[active[i]]*step[i];
+		if(decrement<2*nll_tolerance){
+			converged=true;
+			break;
+		}
+		// backtracking line search, projecting onto pars >= 0
+		auto line_search = [&](){
+			double alpha=1;
+			for(int search=0; search<40; ++search, alpha*=0.5){
+				trial = pars;
+				for(int i=0; i<nactive; ++i) trial[active[i]] = std::max(0., pars[active[i]] + alpha*step[i]);
+				if(nll.NLL(trial.data())<f) return true;
+			}
+			return false;
+		};
+		bool improved = line_search();
+		if(!improved){
+			// the projected Newton step can fail to descend when a correlated parameter is cut off
+			// at 0; fall back to a diagonally scaled gradient step, which always can
+			for(int i=0; i<nactive; ++i) step[i] = -grad[active[i]]/hess[active[i]*npars+active[i]];
+			improved = line_search();
+		}
+		if(!improved){
+			// no further improvement possible within rounding
+			converged = decrement<1e-3;
+			break;
+		}
+		pars = trial;
+		f = nll.NLLAndGradient(pars.data(), grad.data());
+	}
+	if(minval) *minval = f;
+
+	if(errors){
+		errors->assign(npars, 0.);
+		nll.Hessian(pars.data(), hess.data());
+		active.clear();
+		for(int par=0; par<npars; ++par) if(!fixed[par]) active.push_back(par);
+		const int nactive = active.size();
+		if(DecomposeSubmatrix(hess, npars, active, sub)){
+			// diagonal of the inverse Hessian
+			std::vector<double> column(nactive);
+			for(int i=0; i<nactive; ++i){
+				std::fill(column.begin(), column.end(), 0.);
+				column[i] = 1;
+				CholeskySolve(sub, nactive, column.data());
+				(*errors)[active[i]] = std::sqrt(std::max(0., column[i]));
+			}
+		}
+	}
+	return converged;
+}
+
+bool DtToyStudy::FitLifetime(SpallationDtLikelihood& nll, const std::vector<double>& dts, const std::vector<double>& binedges,
+                             int par, double min, double max, const std::vector<bool>& fixed, std::vector<double>& pars,
+                             std::vector<double>* errors, double* minval){
+	const int npars = nll.GetNParameters();
+	if(nll.GetLifetimes(par).size()!=1){
+		throw std::invalid_argument("DtToyStudy::FitLifetime - can only fit the lifetime of a single exponential");
+	}
+	if(!(min>0) || !(max>min)) throw std::invalid_argument("DtToyStudy::FitLifetime - invalid lifetime range");
+	if(int(pars.size())<npars || int(fixed.size())<npars){
+		throw std::invalid_argument("DtToyStudy::FitLifetime - need a starting value and fixed flag for each model parameter");
+	}
+	std::vector<double> amps(pars.begin(), pars.begin()+npars);
+	const std::vector<bool> amps_fixed(fixed.begin(), fixed.begin()+npars);
+
+	// -log(L) minimised over the amplitudes, at a given log(lifetime). Each fit starts from the last one's amplitudes
+	auto set_lifetime = [&](double log_tau){
+		nll.SetLifetime(par, std::exp(log_tau));
+		if(binedges.empty()) nll.SetEvents(dts);
+		else nll.SetBinnedEvents(dts, binedges);
+	};
+	auto profile = [&](double log_tau){
+		set_lifetime(log_tau);
+		double f=0;
+		Fit(nll, amps_fixed, amps, nullptr, &f);
+		return f;
+	};
+
+	// golden section search of the profile, in log(lifetime) as the lifetime range may span decades
+	const double golden = (std::sqrt(5.)-1)/2;
+	const double log_min = std::log(min), log_max = std::log(max);
+	double a = log_min, b = log_max;
+	double c = b - golden*(b-a), d = a + golden*(b-a);
+	double fc = profile(c), fd = profile(d);
+	while(b-a > lifetime_tolerance){
+		if(fc<fd){
+			b = d; d = c; fd = fc;
+			c = b - golden*(b-a);
+			fc = profile(c);
+		} else {
+			a = c; c = d; fc = fd;
+			d = a + golden*(b-a);
+			fd = profile(d);
+		}
+	}
+	const double best = 0.5*(a+b);
+
+	set_lifetime(best);
+	double fmin=0;
+	bool converged = Fit(nll, amps_fixed, amps, nullptr, &fmin);
+	// a minimum at the edge of the range is not a fitted lifetime
+	converged = converged && best-log_min>2*lifetime_tolerance && log_max-best>2*lifetime_tolerance;
+
+	if(errors){
+		// errors from the inverse of the Hessian in the amplitudes and the lifetime, so that those of the
+		// amplitudes include their correlation with the lifetime. The lifetime terms are by finite differences.
+		const double lifetime = std::exp(best);
+		const double h = 1e-3*lifetime;
+		const int n = npars+1;
+		std::vector<double> hess(npars*npars), full(n*n, 0.), grad_up(npars), grad_down(npars);
+		nll.Hessian(amps.data(), hess.data());
+		set_lifetime(std::log(lifetime+h));
+		const double f_up = nll.NLLAndGradient(amps.data(), grad_up.data());
+		set_lifetime(std::log(lifetime-h));
+		const double f_down = nll.NLLAndGradient(amps.data(), grad_down.data());
+		set_lifetime(best);   // leave the model at the best fit
+		for(int i=0; i<npars; ++i){
+			for(int j=0; j<npars; ++j) full[i*n+j] = hess[i*npars+j];
+			full[i*n+npars] = full[npars*n+i] = (grad_up[i]-grad_down[i])/(2*h);
+		}
+		full[npars*n+npars] = (f_up - 2*fmin + f_down)/(h*h);
+
+		errors->assign(n, 0.);
+		std::vector<int> active;
+		for(int i=0; i<npars; ++i) if(!fixed[i]) active.push_back(i);
+		active.push_back(npars);
+		std::vector<double> sub;
+		if(DecomposeSubmatrix(full, n, active, sub)){
+			const int nactive = active.size();
+			std::vector<double> column(nactive);
+			for(int i=0; i<nactive; ++i){
+				std::fill(column.begin(), column.end(), 0.);
+				column[i] = 1;
+				CholeskySolve(sub, nactive, column.data());
+				(*errors)[active[i]] = std::sqrt(std::max(0., column[i]));
+			}
+		} else {
+			converged = false;
+		}
+	}
+
+	pars.resize(npars+1);
+	std::copy(amps.begin(), amps.end(), pars.begin());
+	pars[npars] = std::exp(best);
+	if(minval) *minval = fmin;
+	return converged;
+}
+
+void DtToyStudy::SetFloatLifetime(int par, double min, double max){
+	if(model.GetLifetimes(par).size()!=1){
+		throw std::invalid_argument("DtToyStudy::SetFloatLifetime - can only fit the lifetime of a single exponential");
+	}
+	if(!(min>0) || !(max>min)) throw std::invalid_argument("DtToyStudy::SetFloatLifetime - invalid lifetime range");
+	// the lifetime is an extra parameter, after those of the model
+	if(lifetime_par<0){
+		truth.push_back(0);
+		fixed.push_back(false);
+	}
+	lifetime_par = par;
+	lifetime_min = min;
+	lifetime_max = max;
+	truth.back() = model.GetLifetimes(par).front();
+}
+
+std::string DtToyStudy::GetParameterName(int par) const {
+	if(par<model.GetNParameters()) return model.GetName(par);
+	return model.GetName(lifetime_par)+"_lifetime";
+}
+
+void DtToyStudy::ThrowEvents(uint64_t toy, std::vector<double>& dts) const {
+	CounterRNG rng(seed, toy);
+	dts.clear();
+	const double tmin = model.GetTMin(), tmax = model.GetTMax();
+	for(int par=0; par<model.GetNParameters(); ++par){
+		if(!(truth[par]>0)) continue;
+		const std::vector<double>& lifetimes = model.GetLifetimes(par);
+		if(lifetimes.empty()){
+			std::poisson_distribution<long> poisson(truth[par]*(tmax-tmin));
+			const long n = poisson(rng);
+			for(long i=0; i<n; ++i) dts.push_back(tmin + rng.Uniform()*(tmax-tmin));
+			continue;
+		}
+		// a pair of isotopes shares the amplitude equally
+		for(double tau : lifetimes){
+			const double ea = std::exp(-tmin/tau), eb = std::exp(-tmax/tau);
+			const double mean = truth[par]/lifetimes.size()*(ea-eb);
+			if(!(mean>0)) continue;
+			std::poisson_distribution<long> poisson(mean);
+			const long n = poisson(rng);
+			// inverse of the cumulative distribution, truncated to [tmin, tmax]
+			for(long i=0; i<n; ++i) dts.push_back(-tau*std::log(ea - rng.Uniform()*(ea-eb)));
+		}
+	}
+}
+
+void DtToyStudy::RunRange(int first, int last){
+	SpallationDtLikelihood nll(model);
+	std::vector<double> dts;
+	for(int toy=first; toy<last; ++toy){
+		ThrowEvents(toy, dts);
+		if(toy_binedges.empty()) nll.SetEvents(dts);
+		else nll.SetBinnedEvents(dts, toy_binedges);
+		ToyResult& result = results[toy];
+		result.values = truth;
+		if(lifetime_par>=0){
+			result.converged = FitLifetime(nll, dts, toy_binedges, lifetime_par, lifetime_min, lifetime_max, fixed,
+			                               result.values, &result.errors, &result.nll);
+		} else {
+			result.converged = Fit(nll, fixed, result.values, &result.errors, &result.nll);
+		}
+		result.nevents = nll.GetNumEvents();
+	}
+}
+
+void DtToyStudy::Run(int ntoys){
+	results.assign(std::max(ntoys,0), ToyResult{});
+	const int nthr = std::max(1, std::min(nthreads, ntoys));
+	if(nthr==1){
+		RunRange(0, ntoys);
+		return;
+	}
+	std::vector<std::thread> workers;
+	const int per_thread = (ntoys + nthr - 1)/nthr;
+	for(int t=0; t<nthr; ++t){
+		const int first = t*per_thread;
+		const int last = std::min(ntoys, first+per_thread);
+		if(first>=last) break;
+		workers.emplace_back(&DtToyStudy::RunRange, this, first, last);
+	}
+	for(std::thread& worker : workers) worker.join();
+}
+
+std::vector<DtToyStudy::ParameterSummary> DtToyStudy::Summarise() const {
+	std::vector<ParameterSummary> summaries;
+	for(int par=0; par<int(truth.size()); ++par){
+		ParameterSummary summary;
+		summary.name = GetParameterName(par);
+		summary.truth = truth[par];
+		if(fixed[par]){
+			summaries.push_back(summary);
+			continue;
+		}
+		double sum=0, sum2=0, pull_sum=0, pull_sum2=0, ncovered=0;
+		for(const ToyResult& result : results){
+			if(!result.converged || !(result.errors[par]>0)) continue;
+			const double value = result.values[par];
+			const double pull = (value - truth[par])/result.errors[par];
+			sum += value;
+			sum2 += value*value;
+			pull_sum += pull;
+			pull_sum2 += pull*pull;
+			if(std::abs(pull)<=1) ++ncovered;
+			++summary.ntoys;
+		}
+		if(summary.ntoys>0){
+			const double n = summary.ntoys;
+			summary.mean = sum/n;
+			summary.rms = std::sqrt(std::max(0., sum2/n - summary.mean*summary.mean));
+			summary.bias = summary.mean - truth[par];
+			summary.pull_mean = pull_sum/n;
+			summary.pull_rms = std::sqrt(std::max(0., pull_sum2/n - summary.pull_mean*summary.pull_mean));
+			summary.coverage = ncovered/n;
+		}
+		summaries.push_back(summary);
+	}
+	return summaries;
+}
+
+void DtToyStudy::PrintSummary(std::ostream& os) const {
+	int nconverged=0;
+	for(const ToyResult& result : results) if(result.converged) ++nconverged;
+	os<<nconverged<<" of "<<results.size()<<" toy fits converged"<<std::endl;
+	os<<std::setw(10)<<"parameter"<<std::setw(13)<<"truth"<<std::setw(13)<<"mean"<<std::setw(13)<<"rms"
+	  <<std::setw(13)<<"bias"<<std::setw(11)<<"pull mean"<<std::setw(11)<<"pull rms"<<std::setw(11)<<"coverage"<<std::endl;
+	for(const ParameterSummary& summary : Summarise()){
+		os<<std::setw(10)<<summary.name<<std::setw(13)<<summary.truth;
+		if(summary.ntoys==0){
+			os<<"  (fixed or no converged toys)"<<std::endl;
+			continue;
+		}
+		os<<std::setw(13)<<summary.mean<<std::setw(13)<<summary.rms<<std::setw(13)<<summary.bias
+		  <<std::setw(11)<<std::setprecision(3)<<summary.pull_mean<<std::setw(11)<<summary.pull_rms
+		  <<std::setw(11)<<summary.coverage<<std::setprecision(6)<<std::endl;
+	}
+}
@@ -0,0 +1,100 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef DtToyStudy_H
+#define DtToyStudy_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <iostream>
+
+#include "SpallationDtLikelihood.h"
+
+class TDirectory;
+
+/**
+* \class DtToyStudy
+*
+* Pseudo-experiments for the dt fits (FitSpallationDt, FitLi9Lifetime, FitPurewaterLi9NcaptureDt).
+* Toy datasets are sampled from a SpallationDtLikelihood model with given true parameters, a Poisson
+* number of events from each component, and refit with the same likelihood, to get the bias, pull and
+* coverage of each parameter.
+*
+* Toy i draws its random numbers from its own CounterRNG stream (seed, i), so each toy is reproducible
+* on its own and results don't depend on the number of threads. Toys are split over threads in contiguous
+* ranges, each thread with its own copy of the model.
+*
+* Fits use a projected Newton minimisation with the analytic gradient and Hessian, keeping all parameters
+* >= 0; errors are from the inverse Hessian. The likelihood is convex in its parameters, so the minimum
+* found is the same as Minuit's, without needing a (non thread-safe) minimiser per thread.
+*
+* With SetFloatLifetime the lifetime of one exponential is also fitted in each toy, by minimising the
+* likelihood profiled over the amplitudes (FitLifetime). It is then an extra parameter after those of the model,
+* named "<component>_lifetime". Errors are then from the Hessian in the amplitudes and the lifetime together.
+*/
+class DtToyStudy {
+	public:
+	struct ToyResult {
+		std::vector<double> values;
+		std::vector<double> errors;
+		double nll = 0;
+		double nevents = 0;
+		bool converged = false;
+	};
+	struct ParameterSummary {
+		std::string name;
+		double truth = 0;
+		double mean = 0;        // of fitted values
+		double rms = 0;
+		double bias = 0;        // mean - truth
+		double pull_mean = 0;
+		double pull_rms = 0;
+		double coverage = 0;    // fraction of toys with truth within +-1 error
+		int ntoys = 0;          // converged toys used
+	};
+
+	// model: components set up, any data is ignored. truth: parameter values to throw toys from.
+	DtToyStudy(const SpallationDtLikelihood& model, const std::vector<double>& truth);
+
+	void SetBinning(const std::vector<double>& binedges){ toy_binedges = binedges; }   ///< binned toy fits
+	void SetFixed(int par){ fixed.at(par) = true; }   ///< held at its true value in the toy fits
+	// fit the lifetime of the single-exponential component par, within [min, max], in the toy fits
+	void SetFloatLifetime(int par, double min, double max);
+	void SetSeed(uint64_t seed_in){ seed = seed_in; }
+	void SetNThreads(int n){ nthreads = (n<1) ? 1 : n; }
+
+	void Run(int ntoys);
+	const std::vector<ToyResult>& GetResults() const { return results; }
+	std::vector<ParameterSummary> Summarise() const;
+	void PrintSummary(std::ostream& os=std::cout) const;
+	// per-toy TTree and pull histograms
+	void Write(TDirectory* dir) const;
+
+	// minimise nll from the starting values in pars, parameters with fixed[par] are not varied.
+	// Returns whether it converged.
+	static bool Fit(const SpallationDtLikelihood& nll, const std::vector<bool>& fixed, std::vector<double>& pars,
+	                std::vector<double>* errors=nullptr, double* minval=nullptr);
+	// as Fit, also fitting the lifetime of the single-exponential component par within [min, max].
+	// The model is refilled with dts (binned if binedges are given) for each trial lifetime, and is left at the best.
+	// pars (and errors) have the lifetime appended after the model parameters; pars may be given without it.
+	static bool FitLifetime(SpallationDtLikelihood& nll, const std::vector<double>& dts, const std::vector<double>& binedges,
+	                        int par, double min, double max, const std::vector<bool>& fixed, std::vector<double>& pars,
+	                        std::vector<double>* errors=nullptr, double* minval=nullptr);
+
+	private:
+	void RunRange(int first, int last);
+	std::string GetParameterName(int par) const;
+	void ThrowEvents(uint64_t toy, std::vector<double>& dts) const;
+
+	SpallationDtLikelihood model;
+	std::vector<double> truth;
+	std::vector<bool> fixed;
+	std::vector<double> toy_binedges;   // empty for unbinned fits
+	int lifetime_par = -1;              // component whose lifetime is fitted, if >= 0
+	double lifetime_min = 0;
+	double lifetime_max = 0;
+	uint64_t seed = 0;
+	int nthreads = 1;
+	std::vector<ToyResult> results;
+};
+
+#endif
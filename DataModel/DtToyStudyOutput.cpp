@@ -0,0 +1,69 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+// ROOT output of DtToyStudy, kept apart so that the toy engine itself only needs the standard library
+#include "DtToyStudy.h"
+
+#include "TDirectory.h"
+#include "TTree.h"
+#include "TH1D.h"
+
+void DtToyStudy::Write(TDirectory* dir) const {
+	TDirectory* olddir = gDirectory;
+	dir->cd();
+
+	// one entry per toy
+	TTree tree("toy_fits", "Toy experiment fit results");
+	std::vector<double> values, errors;
+	double nll=0, nevents=0;
+	bool converged=false;
+	tree.Branch("values", &values);
+	tree.Branch("errors", &errors);
+	tree.Branch("nll", &nll);
+	tree.Branch("nevents", &nevents);
+	tree.Branch("converged", &converged);
+	for(const ToyResult& result : results){
+		values = result.values;
+		errors = result.errors;
+		nll = result.nll;
+		nevents = result.nevents;
+		converged = result.converged;
+		tree.Fill();
+	}
+	tree.Write();
+
+	// one entry per parameter
+	const std::vector<ParameterSummary> summaries = Summarise();
+	TTree summary_tree("toy_summary", "Bias, pull and coverage of each parameter");
+	ParameterSummary summary_entry;
+	summary_tree.Branch("name", &summary_entry.name);
+	summary_tree.Branch("truth", &summary_entry.truth);
+	summary_tree.Branch("mean", &summary_entry.mean);
+	summary_tree.Branch("rms", &summary_entry.rms);
+	summary_tree.Branch("bias", &summary_entry.bias);
+	summary_tree.Branch("pull_mean", &summary_entry.pull_mean);
+	summary_tree.Branch("pull_rms", &summary_entry.pull_rms);
+	summary_tree.Branch("coverage", &summary_entry.coverage);
+	summary_tree.Branch("ntoys", &summary_entry.ntoys);
+	for(const ParameterSummary& summary : summaries){
+		summary_entry = summary;
+		summary_tree.Fill();
+	}
+	summary_tree.Write();
+
+	// pull and fitted value distributions of each varied parameter
+	for(size_t par=0; par<summaries.size(); ++par){
+		const ParameterSummary& summary = summaries[par];
+		if(summary.ntoys==0) continue;
+		TH1D pulls(("pull_"+summary.name).c_str(), (summary.name+" pull;(fit - truth)/error;Toys").c_str(), 100, -5, 5);
+		TH1D fitted(("fit_"+summary.name).c_str(), (summary.name+" fitted value;Fitted value;Toys").c_str(), 100,
+		            summary.mean-5*summary.rms, summary.mean+5*summary.rms+1e-9);
+		for(const ToyResult& result : results){
+			if(!result.converged || !(result.errors[par]>0)) continue;
+			pulls.Fill((result.values[par]-summary.truth)/result.errors[par]);
+			fitted.Fill(result.values[par]);
+		}
+		pulls.Write();
+		fitted.Write();
+	}
+
+	olddir->cd();
+}
@@ -9,27 +9,99 @@ EventCandidates::~EventCandidates()
         delete pair.second;
 }
 
+void EventCandidates::Append(const Candidate& candidate)
+{
+    Cluster::Append(candidate);
+    features.resize(features.size() + schema.Size(), 0.f);
+}
+
+void EventCandidates::Append(Cluster<Candidate>& cluster)
+{
+    Cluster::Append(cluster);
+    features.resize(size_t(nElements)*schema.Size(), 0.f);
+}
+
+void EventCandidates::MoveAppend(Candidate& candidate)
+{
+    Cluster::MoveAppend(candidate);
+    features.resize(features.size() + schema.Size(), 0.f);
+}
+
+int EventCandidates::RegisterFeatureName(const std::string& key)
+{
+    int nOld = schema.Size();
+    int id = schema.Register(key);
+    if (schema.Size() != nOld) {
+        // a new column: widen the rows of any existing candidates
+        if (nElements) {
+            std::vector<float> widened(size_t(nElements)*schema.Size(), 0.f);
+            for (unsigned int i = 0; i < nElements; i++)
+                std::copy(features.begin() + size_t(i)*nOld, features.begin() + size_t(i+1)*nOld, widened.begin() + size_t(i)*schema.Size());
+            features.swap(widened);
+        }
+        featureVectorMap[key] = new std::vector<float>;
+    }
+    return id;
+}
+
+float EventCandidates::Get(int iCandidate, const std::string& key) const
+{
+    int id = schema.Find(key);
+    return (id != FeatureSchema::kNotFound) ? Get(iCandidate, id) : 0.f;
+}
+
+void EventCandidates::Swap(EventCandidates& other)
+{
+    // give both the same columns, then the matrices can be exchanged as they are
+    for (const std::string& key: other.schema.Names())
+        RegisterFeatureName(key);
+    for (const std::string& key: schema.Names())
+        other.RegisterFeatureName(key);
+
+    if (schema != other.schema) {
+        // same features registered in a different order: rearrange the columns
+        int nFeatures = schema.Size();
+        std::vector<int> otherID(nFeatures);
+        for (int id = 0; id < nFeatures; id++)
+            otherID[id] = other.schema.Find(schema.Name(id));
+        std::vector<float> toOther(features.size()), toThis(other.features.size());
+        for (unsigned int i = 0; i < nElements; i++)
+            for (int id = 0; id < nFeatures; id++)
+                toOther[size_t(i)*nFeatures + otherID[id]] = features[size_t(i)*nFeatures + id];
+        for (unsigned int i = 0; i < other.nElements; i++)
+            for (int id = 0; id < nFeatures; id++)
+                toThis[size_t(i)*nFeatures + id] = other.features[size_t(i)*nFeatures + otherID[id]];
+        features.swap(toThis);
+        other.features.swap(toOther);
+    }
+    else {
+        features.swap(other.features);
+    }
+    Cluster::Swap(other);
+}
+
 void EventCandidates::Print()
 {
     if (!nElements) {
         std::cerr << "No candidate to print!" << std::endl;
     }
     else {
-        int xWidth = 10;
+        int nFeatures = schema.Size();
         std::cout << "\033[4m\n No. ";
-        auto baseFeatureMap = element[0].GetFeatureMap();
-        for (auto const& pair: baseFeatureMap) {
-            int textWidth = pair.first.size()>6 ? pair.first.size() : 6;
-            std::cout << std::right << std::setw(textWidth) << pair.first << " ";
+        for (int id = 0; id < nFeatures; id++) {
+            const std::string& key = schema.Name(id);
+            int textWidth = key.size()>6 ? key.size() : 6;
+            std::cout << std::right << std::setw(textWidth) << key << " ";
         }
         std::cout << "\033[0m\n";
 
-        for (int iCandidate = 0; iCandidate < nElements; iCandidate++) {
+        for (unsigned int iCandidate = 0; iCandidate < nElements; iCandidate++) {
             std::cout << std::right << std::setw(4) << iCandidate+1 << " ";
-            auto candidateFeatureMap = element[iCandidate].GetFeatureMap();
-            for (auto const& pair: candidateFeatureMap) {
-                int textWidth = pair.first.size()>6 ? pair.first.size() : 6;
-                float value = pair.second;
+            const float* row = Row(iCandidate);
+            for (int id = 0; id < nFeatures; id++) {
+                const std::string& key = schema.Name(id);
+                int textWidth = key.size()>6 ? key.size() : 6;
+                float value = row[id];
 
                 if (fabs(value) < 1 && value != 0) {
                     value = roundf(value*100)/100;
@@ -53,35 +125,14 @@ void EventCandidates::FillVectorMap()
         std::cerr << "No elements in EventCandidates... skipping EventCandidates::FillVectorMap." << std::endl;
 
     else {
-        //auto baseFeatureMap = element[0].GetFeatureMap();
-        bool areFeaturesIdentical = true;
-        for (int iCandidate = 0; iCandidate < nElements; iCandidate++) {
-            auto comparedFeatureMap = element[iCandidate].GetFeatureMap();
-
-            for (auto const& basePair: featureVectorMap) {
-
-                if (!comparedFeatureMap.count(basePair.first)) {
-                    std::cerr << "Registered key " << basePair.first << " not found in candidate!" << std::endl;
-                    areFeaturesIdentical = false;
-                }
-                else {
-                    featureVectorMap[basePair.first]->resize(iCandidate);
-                    featureVectorMap[basePair.first]->push_back(comparedFeatureMap[basePair.first]);
-                }
-            }
-
-            for (auto const& comparedPair: comparedFeatureMap) {
-                if (!featureVectorMap.count(comparedPair.first)) {
-                    std::cerr << "Candidate key " << comparedPair.first << " not found in registered keys!" << std::endl;
-                    areFeaturesIdentical = false;
-                }
-            }
-        }
-
-        if (!areFeaturesIdentical) {
-            std::cerr << "Make sure all candidates share the same set of features specified by EventCandidates::RegisterFeatureNames!" << std::endl;
+        // one column of the feature matrix per output vector
+        int nFeatures = schema.Size();
+        for (auto const& pair: featureVectorMap) {
+            int id = schema.Find(pair.first);
+            std::vector<float>& column = *pair.second;
+            column.resize(nElements);
+            for (unsigned int iCandidate = 0; iCandidate < nElements; iCandidate++)
+                column[iCandidate] = features[size_t(iCandidate)*nFeatures + id];
         }
-        
-        assert(featureVectorMap.begin()->second->size() == nElements);
     }
 }
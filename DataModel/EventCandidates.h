@@ -1,36 +1,71 @@
 #ifndef EVENTCANDIDATES_HH
 #define EVENTCANDIDATES_HH
 
-#include <memory>
+#include <map>
+#include <string>
+#include <vector>
 
 #include "Candidate.h"
 #include "Cluster.h"
+#include "FeatureSchema.h"
 
+// The candidates of an event and their features.
+// Feature names are registered once into a FeatureSchema, and the features of all candidates are held
+// in one row-major matrix with a row per candidate and a column per registered feature.
+// Tools should look up the column IDs at Initialise and use the indexed accessors (or Row()) per candidate;
+// the accessors by name are a slow path. Features that are never set are 0.
 class EventCandidates : public Cluster<Candidate>
 {
     public:
         ~EventCandidates();
         
         void Print();
-        void Clear() {
+
+        // appended candidates get a row of zeros
+        void Append(const Candidate& candidate) override;
+        void Append(Cluster<Candidate>& cluster) override;
+        void MoveAppend(Candidate& candidate) override;
+        void Clear() override {
             Cluster::Clear();
+            features.clear();
             for (std::map<std::string, std::vector<float>*>::iterator pair=featureVectorMap.begin(); pair!=featureVectorMap.end(); ++pair){
                 pair->second->clear();
             }
         }
+        // exchange candidates and their features with another EventCandidates.
+        // Each keeps its own featureVectorMap; features registered on only one side are registered on both.
+        void Swap(EventCandidates& other);
+
         void FillVectorMap();
-        void RegisterFeatureNames(std::vector<std::string> keyList)
+        void RegisterFeatureNames(const std::vector<std::string>& keyList)
         { 
-            for (std::vector<std::string>::iterator key=keyList.begin(); key!=keyList.end(); ++key)
+            for (std::vector<std::string>::const_iterator key=keyList.begin(); key!=keyList.end(); ++key)
                 RegisterFeatureName(*key);
         };
-        void RegisterFeatureName(const std::string& key) 
-        { 
-            if (!featureVectorMap.count(key))
-                featureVectorMap[key] = new std::vector<float>; 
-        }
+        // returns the column ID of the feature
+        int RegisterFeatureName(const std::string& key);
+        const FeatureSchema& GetSchema() const { return schema; }
+        int GetFeatureID(const std::string& key) const { return schema.Find(key); }
+        int GetNFeatures() const { return schema.Size(); }
 
+        // indexed access, by column ID from the schema
+        float* Row(int iCandidate) { return features.data() + size_t(iCandidate)*schema.Size(); }
+        const float* Row(int iCandidate) const { return features.data() + size_t(iCandidate)*schema.Size(); }
+        void Set(int iCandidate, int featureID, float value) { Row(iCandidate)[featureID] = value; }
+        float Get(int iCandidate, int featureID) const { return Row(iCandidate)[featureID]; }
+        // nElements x GetNFeatures(), row-major
+        const float* GetFeatureMatrix() const { return features.data(); }
+
+        // access by name: Set registers unknown features, Get returns 0 for them
+        void Set(int iCandidate, const std::string& key, float value) { Set(iCandidate, RegisterFeatureName(key), value); }
+        float Get(int iCandidate, const std::string& key) const;
+
+        // per-feature vectors of all candidates of the event, for output branches; filled by FillVectorMap
         std::map<std::string, std::vector<float>*> featureVectorMap;
+
+    private:
+        FeatureSchema schema;
+        std::vector<float> features;
 };
 
 #endif
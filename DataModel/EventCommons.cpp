@@ -0,0 +1,124 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "EventCommons.h"
+
+#include <utility> // std::swap
+
+void EventCommons::Capture(){
+	skhead = skhead_;
+	skheada = skheada_;
+	skheadg = skheadg_;
+	skheadf = skheadf_;
+	skheadc = skheadc_;
+	skheadqb = skheadqb_;
+	skroot_lowe = skroot_lowe_;
+	skroot_mu = skroot_mu_;
+	skroot_sle = skroot_sle_;
+	skq = skq_;
+	skqa = skqa_;
+	skt = skt_;
+	skta = skta_;
+	skchnl = skchnl_;
+	skthr = skthr_;
+	sktqz = sktqz_;
+	sktqaz = sktqaz_;
+	rawtqinfo = rawtqinfo_;
+	sktrighit = sktrighit_;
+	skqv = skqv_;
+	sktv = sktv_;
+	skchlv = skchlv_;
+	skthrv = skthrv_;
+	skhitv = skhitv_;
+	skpdstv = skpdstv_;
+	skatmv = skatmv_;
+	odmaskflag = odmaskflag_;
+	skdbstat = skdbstat_;
+	skqbstat = skqbstat_;
+	skspacer = skspacer_;
+	skgps = skgps_;
+	t2kgps = t2kgps_;
+	prevt0 = prevt0_;
+	mintdiff = mintdiff_;
+	sktrg = sktrg_;
+	vcvrtx = vcvrtx_;
+	vcwork = vcwork_;
+}
+
+void EventCommons::Restore() const {
+	skhead_ = skhead;
+	skheada_ = skheada;
+	skheadg_ = skheadg;
+	skheadf_ = skheadf;
+	skheadc_ = skheadc;
+	skheadqb_ = skheadqb;
+	skroot_lowe_ = skroot_lowe;
+	skroot_mu_ = skroot_mu;
+	skroot_sle_ = skroot_sle;
+	skq_ = skq;
+	skqa_ = skqa;
+	skt_ = skt;
+	skta_ = skta;
+	skchnl_ = skchnl;
+	skthr_ = skthr;
+	sktqz_ = sktqz;
+	sktqaz_ = sktqaz;
+	rawtqinfo_ = rawtqinfo;
+	sktrighit_ = sktrighit;
+	skqv_ = skqv;
+	sktv_ = sktv;
+	skchlv_ = skchlv;
+	skthrv_ = skthrv;
+	skhitv_ = skhitv;
+	skpdstv_ = skpdstv;
+	skatmv_ = skatmv;
+	odmaskflag_ = odmaskflag;
+	skdbstat_ = skdbstat;
+	skqbstat_ = skqbstat;
+	skspacer_ = skspacer;
+	skgps_ = skgps;
+	t2kgps_ = t2kgps;
+	prevt0_ = prevt0;
+	mintdiff_ = mintdiff;
+	sktrg_ = sktrg;
+	vcvrtx_ = vcvrtx;
+	vcwork_ = vcwork;
+}
+
+void EventCommons::Swap(){
+	std::swap(skhead_, skhead);
+	std::swap(skheada_, skheada);
+	std::swap(skheadg_, skheadg);
+	std::swap(skheadf_, skheadf);
+	std::swap(skheadc_, skheadc);
+	std::swap(skheadqb_, skheadqb);
+	std::swap(skroot_lowe_, skroot_lowe);
+	std::swap(skroot_mu_, skroot_mu);
+	std::swap(skroot_sle_, skroot_sle);
+	std::swap(skq_, skq);
+	std::swap(skqa_, skqa);
+	std::swap(skt_, skt);
+	std::swap(skta_, skta);
+	std::swap(skchnl_, skchnl);
+	std::swap(skthr_, skthr);
+	std::swap(sktqz_, sktqz);
+	std::swap(sktqaz_, sktqaz);
+	std::swap(rawtqinfo_, rawtqinfo);
+	std::swap(sktrighit_, sktrighit);
+	std::swap(skqv_, skqv);
+	std::swap(sktv_, sktv);
+	std::swap(skchlv_, skchlv);
+	std::swap(skthrv_, skthrv);
+	std::swap(skhitv_, skhitv);
+	std::swap(skpdstv_, skpdstv);
+	std::swap(skatmv_, skatmv);
+	std::swap(odmaskflag_, odmaskflag);
+	std::swap(skdbstat_, skdbstat);
+	std::swap(skqbstat_, skqbstat);
+	std::swap(skspacer_, skspacer);
+	std::swap(skgps_, skgps);
+	std::swap(t2kgps_, t2kgps);
+	std::swap(prevt0_, prevt0);
+	std::swap(mintdiff_, mintdiff);
+	std::swap(sktrg_, sktrg);
+	std::swap(vcvrtx_, vcvrtx);
+	std::swap(vcwork_, vcwork);
+}
@@ -0,0 +1,87 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef EventCommons_H
+#define EventCommons_H
+
+#include "fortran_routines.h"
+
+/**
+* \struct EventCommons
+*
+* A copy of the event-wise fortran common blocks populated by skread/skrawread.
+* Used by the TreeReader to buffer SHE and AFT events together, and by the
+* ParallelEvents Tool to carry an event's commons alongside it while the ToolChain
+* moves on to later events.
+* Capture copies the global commons into this object, Restore copies them back,
+* and Swap exchanges the two without an intermediate copy.
+*/
+struct EventCommons {
+
+	void Capture();
+	void Restore() const;
+	void Swap();
+
+	// TODO trim down this list, almost certainly many of these are either
+	// not populated by skread/skrawread, or are not used by reconstruction algorithms
+	// and therefore do not need to be buffered.
+
+	// event header - run, event numbers, trigger info...
+	skhead_common skhead;
+	skheada_common skheada;
+	skheadg_common skheadg;
+	skheadf_common skheadf;
+	skheadc_common skheadc;
+	skheadqb_common skheadqb;
+
+	// low-e event variables
+	skroot_lowe_common skroot_lowe;
+	skroot_mu_common skroot_mu;
+	skroot_sle_common skroot_sle;
+
+	// commons containing arrays of T, Q, ICAB....
+	skq_common skq;
+	skqa_common skqa;
+	skt_common skt;
+	skta_common skta;
+	skchnl_common skchnl;
+	skthr_common skthr;
+	sktqz_common sktqz;
+	sktqaz_common sktqaz;
+	rawtqinfo_common rawtqinfo;
+
+	sktrighit_common sktrighit;
+	skqv_common skqv;
+	sktv_common sktv;
+	skchlv_common skchlv;
+	skthrv_common skthrv;
+	skhitv_common skhitv;
+	skpdstv_common skpdstv;
+	skatmv_common skatmv;
+
+	// OD mask....? nhits, charge, flag...
+	odmaskflag_common odmaskflag;
+
+	// hardware trigger variables; counters, trigger words, prevt0...
+	// spacer and trigger info.
+	skdbstat_common skdbstat;
+	skqbstat_common skqbstat;
+	skspacer_common skspacer;
+
+	// gps word and time.
+	skgps_common skgps;
+	t2kgps_common t2kgps;
+
+	// hw counter difference to previous event.
+	prevt0_common prevt0;
+	// tdiff_common is not included: swapping it segfaults
+	mintdiff_common mintdiff;
+
+	// trigger hardware counters, word, spacer length...
+	sktrg_common sktrg;
+
+	// MC particles and vertices, event-wise.
+	vcvrtx_common vcvrtx;
+	vcwork_common vcwork;
+
+};
+
+#endif
@@ -0,0 +1,120 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "EventContext.h"
+
+#include <set>
+#include <sstream>
+#include <iostream>
+
+#include "TVector3.h"
+
+namespace {
+	// function-local so that it is constructed before the Tools' static declarations use it
+	std::set<std::string>& EventParallelTools(){
+		static std::set<std::string> tools;
+		return tools;
+	}
+
+	template<typename T>
+	bool CopyEntry(const std::string& name, BStore& from, BStore& to){
+		T value;
+		if(!from.Get(name, value)){
+			to.Remove(name);
+			return false;
+		}
+		to.Set(name, value);
+		return true;
+	}
+}
+
+bool DeclareEventParallelTool(const std::string& toolclass){
+	EventParallelTools().insert(toolclass);
+	return true;
+}
+
+bool IsEventParallelTool(const std::string& toolclass){
+	return EventParallelTools().count(toolclass);
+}
+
+std::vector<std::string> GetEventParallelTools(){
+	return std::vector<std::string>(EventParallelTools().begin(), EventParallelTools().end());
+}
+
+bool EventVariable::Copy(BStore& from, BStore& to) const {
+	if(type=="int") return CopyEntry<int>(name, from, to);
+	if(type=="float") return CopyEntry<float>(name, from, to);
+	if(type=="double") return CopyEntry<double>(name, from, to);
+	if(type=="bool") return CopyEntry<bool>(name, from, to);
+	if(type=="size_t") return CopyEntry<size_t>(name, from, to);
+	if(type=="string") return CopyEntry<std::string>(name, from, to);
+	if(type=="TVector3") return CopyEntry<TVector3>(name, from, to);
+	return false;
+}
+
+bool ParseEventVariables(const std::string& list, std::vector<EventVariable>& vars_out){
+	std::stringstream ss(list);
+	std::string entry;
+	while(std::getline(ss, entry, ',')){
+		if(entry.empty()) continue;
+		size_t sep = entry.find(':');
+		if(sep==std::string::npos){
+			std::cerr<<"ParseEventVariables Error! entry '"<<entry<<"' should be of the form name:type"<<std::endl;
+			return false;
+		}
+		EventVariable var{entry.substr(0,sep), entry.substr(sep+1)};
+		if(var.type!="int" && var.type!="float" && var.type!="double" && var.type!="bool"
+		   && var.type!="size_t" && var.type!="string" && var.type!="TVector3"){
+			std::cerr<<"ParseEventVariables Error! unsupported type '"<<var.type<<"' for variable "
+			         <<var.name<<std::endl;
+			return false;
+		}
+		vars_out.push_back(var);
+	}
+	return true;
+}
+
+EventContext::EventContext(DataModel* parent) : data(parent){
+	data.eventLog = &log;
+}
+
+void EventContext::SwapMembers(DataModel& main){
+	data.eventPMTHits.Swap(main.eventPMTHits);
+	// n.b. only the candidates and their feature rows are exchanged: each DataModel keeps
+	// its own featureVectorMap, since output Tools hold pointers to its vectors
+	data.eventCandidates.Swap(main.eventCandidates);
+	data.eventPrimaries.Swap(main.eventPrimaries);
+	data.eventSecondaries.Swap(main.eventSecondaries);
+	data.eventTrueCaptures.Swap(main.eventTrueCaptures);
+	data.eventParticles.swap(main.eventParticles);
+	data.eventVertices.swap(main.eventVertices);
+}
+
+void EventContext::Clear(){
+	data.eventPMTHits = PMTHitCluster();
+	data.eventCandidates.Clear();
+	data.eventPrimaries.Clear();
+	data.eventSecondaries.Clear();
+	data.eventTrueCaptures.Clear();
+	data.eventParticles.clear();
+	data.eventVertices.clear();
+	log.clear();
+	sequence=-1;
+	ok=true;
+	done=false;
+}
+
+void EventContext::Capture(DataModel& main, const std::vector<EventVariable>& variables){
+	commons.Capture();
+	SwapMembers(main);
+	for(auto&& var : variables) var.Copy(main.eventVariables, data.eventVariables);
+}
+
+void EventContext::Load(DataModel& main, const std::vector<EventVariable>& variables){
+	commons.Restore();
+	SwapMembers(main);
+	for(auto&& var : variables) var.Copy(data.eventVariables, main.eventVariables);
+}
+
+void EventContext::Unload(DataModel& main){
+	SwapMembers(main);
+	Clear();
+}
@@ -0,0 +1,73 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef EventContext_H
+#define EventContext_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+
+#include "DataModel.h"
+#include "EventCommons.h"
+
+/*
+ Tools that only read and write the event-wise DataModel members (eventPMTHits, eventCandidates,
+ eventVariables etc.), keep no state between events and do not touch the fortran common blocks
+ or other global state during Execute may declare themselves event-parallel by adding
+	EVENT_PARALLEL_TOOL(MyTool)
+ at file scope in their .cpp, and derive from EventParallelTool (EventParallelTool.h) so that their
+ logging is kept with the event. The ParallelEvents Tool will only run declared Tools on its workers.
+*/
+bool DeclareEventParallelTool(const std::string& toolclass);
+bool IsEventParallelTool(const std::string& toolclass);
+std::vector<std::string> GetEventParallelTools();
+
+#define EVENT_PARALLEL_TOOL(toolclass) \
+	static const bool toolclass##_event_parallel = DeclareEventParallelTool(#toolclass)
+
+/**
+* \struct EventVariable
+*
+* An eventVariables entry to be carried with an EventContext. BStore entries are typed,
+* so the type must be given; supported types are int, float, double, bool, size_t, string and TVector3.
+*/
+struct EventVariable {
+	std::string name;
+	std::string type;
+	bool Copy(BStore& from, BStore& to) const; ///< returns false if the entry was not present
+};
+
+/// parse a list of the form "name:type,name:type,..."
+bool ParseEventVariables(const std::string& list, std::vector<EventVariable>& vars_out);
+
+/**
+* \class EventContext
+*
+* The state of one event in flight in the ParallelEvents Tool: a snapshot of the event-wise
+* fortran common blocks, and a per-event DataModel holding the event-wise members
+* (hits, candidates, true particles and captures) and a set of eventVariables.
+* Capture moves the current event's members out of the main DataModel, leaving them empty,
+* Load moves them back (with the common blocks and variables) so that serial Tools
+* may process the event, and Unload takes them out again and clears the context for reuse.
+* Members are exchanged with Swap, so the hit and candidate vectors are never copied.
+*/
+class EventContext {
+	public:
+	EventContext(DataModel* parent);
+
+	void Capture(DataModel& main, const std::vector<EventVariable>& variables);
+	void Load(DataModel& main, const std::vector<EventVariable>& variables);
+	void Unload(DataModel& main);
+
+	DataModel data;          // per-event DataModel passed to the worker Tools
+	EventCommons commons;
+	std::vector<std::pair<int,std::string>> log;   // lines logged by the worker Tools, as data.eventLog
+	long sequence=-1;        // order in which events entered the ParallelEvents Tool
+	bool ok=true;            // whether all worker Tools returned true
+	std::atomic<bool> done{false};
+
+	private:
+	void SwapMembers(DataModel& main);
+	void Clear();
+};
+
+#endif
@@ -0,0 +1,34 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef EventParallelTool_H
+#define EventParallelTool_H
+
+#include <string>
+#include <sstream>
+
+#include "Tool.h"
+
+/**
+* \class EventParallelTool
+*
+* Base for Tools declared with EVENT_PARALLEL_TOOL (see EventContext.h). The ToolChain's Logging is
+* not thread-safe, so when such a Tool runs on a ParallelEvents worker its Log calls (including
+* LOG_LAZY and LOG_LIMITED) are kept with the event in its EventContext, and ParallelEvents prints them
+* on the ToolChain thread when the event is committed. Elsewhere they go to the Logging as usual.
+*/
+class EventParallelTool: public Tool {
+
+	protected:
+	template <typename T> void Log(T message, int messagelevel=1, int verbosity=1){
+		if(m_data==nullptr || m_data->eventLog==nullptr){
+			Tool::Log(message, messagelevel, verbosity);
+			return;
+		}
+		if(messagelevel>verbosity) return;
+		std::stringstream ss;
+		ss<<message;
+		m_data->eventLog->emplace_back(messagelevel, ss.str());
+	}
+
+};
+
+#endif
@@ -0,0 +1,24 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "FeatureSchema.h"
+
+int FeatureSchema::Register(const std::string& name){
+	auto it = ids.find(name);
+	if(it!=ids.end()) return it->second;
+	const int id = names.size();
+	names.push_back(name);
+	ids.emplace(name, id);
+	return id;
+}
+
+int FeatureSchema::Find(const std::string& name) const {
+	auto it = ids.find(name);
+	return (it!=ids.end()) ? it->second : kNotFound;
+}
+
+std::vector<std::string> FeatureSchema::Missing(const std::vector<std::string>& required) const {
+	std::vector<std::string> missing;
+	for(const std::string& name : required){
+		if(!Contains(name)) missing.push_back(name);
+	}
+	return missing;
+}
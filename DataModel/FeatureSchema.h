@@ -0,0 +1,43 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef FeatureSchema_H
+#define FeatureSchema_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+/**
+* \class FeatureSchema
+*
+* The columns of a feature matrix: feature names registered once, each given the next integer column ID.
+* Tools look the IDs up at Initialise and then read and write features by index; looking up a name is the slow path.
+* A Tool that consumes features produced by another can check with Missing() that they are all registered.
+*/
+class FeatureSchema {
+	public:
+	static const int kNotFound = -1;
+
+	// the column ID of name, adding it as a new column if not yet registered
+	int Register(const std::string& name);
+	// column ID of name, or kNotFound
+	int Find(const std::string& name) const;
+	bool Contains(const std::string& name) const { return Find(name)!=kNotFound; }
+
+	int Size() const { return names.size(); }
+	const std::string& Name(int id) const { return names.at(id); }
+	// in column order
+	const std::vector<std::string>& Names() const { return names; }
+
+	// the names in the list that are not registered; empty if all are
+	std::vector<std::string> Missing(const std::vector<std::string>& required) const;
+
+	void Clear(){ names.clear(); ids.clear(); }
+	bool operator==(const FeatureSchema& other) const { return names==other.names; }
+	bool operator!=(const FeatureSchema& other) const { return !(*this==other); }
+
+	private:
+	std::vector<std::string> names;
+	std::unordered_map<std::string, int> ids;
+};
+
+#endif
@@ -0,0 +1,48 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "HitStore.h"
+
+void HitStore::Clear(){
+	T.clear();
+	Q.clear();
+	cable.clear();
+	flags.clear();
+	raw_index.clear();
+	key = Key{};
+}
+
+size_t HitStore::Fill(int n, const int* cables, const int* hit_flags, const float* times, const float* charges,
+                      int max_cable, int flag_mask, const uint64_t* bad_channel_bits){
+	n = (n>0) ? n : 0;
+	T.resize(n);
+	Q.resize(n);
+	cable.resize(n);
+	flags.resize(n);
+	raw_index.resize(n);
+	size_t nkept=0;
+	for(int i=0; i<n; ++i){
+		const int c = cables[i];
+		// n.b. unsigned comparison catches c<=0 too
+		const bool valid = unsigned(c-1) < unsigned(max_cable);
+		const bool bad = valid && bad_channel_bits && ((bad_channel_bits[c>>6] >> (c&63)) & 1u);
+		const bool keep = valid && (hit_flags[i] & flag_mask) && !bad;
+		T[nkept] = times[i];
+		Q[nkept] = charges[i];
+		cable[nkept] = c;
+		flags[nkept] = hit_flags[i];
+		raw_index[nkept] = i;
+		nkept += keep;
+	}
+	T.resize(nkept);
+	Q.resize(nkept);
+	cable.resize(nkept);
+	flags.resize(nkept);
+	raw_index.resize(nkept);
+	return nkept;
+}
+
+long HitStore::FindHit(int n, const int* cables, const float* charges, int cable, float charge){
+	for(int i=0; i<n; ++i){
+		if(charges[i]==charge && cables[i]==cable) return i;
+	}
+	return -1;
+}
@@ -0,0 +1,60 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef HitStore_H
+#define HitStore_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/**
+* \class HitStore
+*
+* Structure-of-arrays copy of the selected ID hits of an event, so Tools can share one pass over
+* the sktqz_ common block instead of each re-walking it with its own cable range and gate checks.
+* DataModel::GetInGateHits() fills one from sktqz_ once per event (and timing gate), keeping hits with
+* a valid cable number, the in-gate flag (ihtiflz & 0x02) set, and not on a bad channel.
+*
+* Fill() compacts without branches (each hit is written, and the output index advanced only if it passes),
+* so the loop has no data-dependent jumps. raw_index records the position of each hit in the source arrays,
+* for Tools that need other per-hit arrays (e.g. TQREAL) alongside.
+*/
+class HitStore {
+	public:
+	std::vector<float> T;            // ns
+	std::vector<float> Q;            // p.e.
+	std::vector<int> cable;
+	std::vector<int> flags;          // ihtiflz
+	std::vector<int> raw_index;      // index in the source arrays
+
+	size_t Size() const { return T.size(); }
+	bool Empty() const { return T.empty(); }
+	void Clear();
+
+	// replace the contents with the hits among the n given that have 0 < cable <= max_cable,
+	// (flags & flag_mask) != 0, and, if bad_channel_bits is given, the bit for their cable unset
+	// (bit c%64 of word c/64, for c up to max_cable). Returns the number kept.
+	size_t Fill(int n, const int* cables, const int* hit_flags, const float* times, const float* charges,
+	            int max_cable, int flag_mask=0x02, const uint64_t* bad_channel_bits=nullptr);
+
+	// the first of the n hits with this cable and charge, or -1. To find a hit seen in one readout
+	// (e.g. the last hit of an SHE) among the raw hits of another that overlaps it (the following AFT).
+	static long FindHit(int n, const int* cables, const float* charges, int cable, float charge);
+
+	// the event (and timing gate) the contents were filled from, and its number of hits, to know when they
+	// need refilling. Tools that edit the hits in place without changing their number must Invalidate().
+	struct Key {
+		int run=-1, subrun=-1, event=-1, it0xsk=-1, nhits=-1;
+		bool operator==(const Key& other) const {
+			return run==other.run && subrun==other.subrun && event==other.event && it0xsk==other.it0xsk
+			    && nhits==other.nhits;
+		}
+	};
+	const Key& GetKey() const { return key; }
+	void SetKey(const Key& key_in){ key = key_in; }
+	void Invalidate(){ key = Key{}; }
+
+	private:
+	Key key;
+};
+
+#endif
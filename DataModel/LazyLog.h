@@ -0,0 +1,104 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef LazyLog_H
+#define LazyLog_H
+
+#include <string>
+#include <map>
+#include <utility>
+#include <sstream>
+
+/*
+ Logging helpers for hot paths.
+
+ Tool::Log(message, level, verbosity) takes an already-built string, so the concatenation
+ and toString formatting of e.g.
+	Log(m_unique_name+": hit "+toString(i)+" time "+toString(t), v_debug, m_verbose);
+ run on every call, even when the message is discarded. The macros below take exactly
+ the same arguments as Log, but only evaluate the message expression when it will be printed:
+	LOG_LAZY(m_unique_name+": hit "+toString(i)+" time "+toString(t), v_debug, m_verbose);
+
+ Messages with a level above LOG_MAX_VERBOSITY are removed at compile time, so building
+ with e.g. -DLOG_MAX_VERBOSITY=2 strips all debug logging from production builds.
+ Like Log, these may only be used within Tool member functions.
+
+ LOG_LIMITED additionally suppresses a message after it has been printed 'max_repeats'
+ times from the same call site, for warnings that may recur every event. Each Tool holds its
+ own LogRateLimiter, so limits are per-Tool instance:
+	LOG_LIMITED(m_log_limiter, m_unique_name+" warning: no hits!", v_warning, m_verbose);
+*/
+
+#ifndef LOG_MAX_VERBOSITY
+#define LOG_MAX_VERBOSITY 99
+#endif
+
+#define LOG_LAZY(message, level, verbosity) \
+	do { \
+		if((level)<=LOG_MAX_VERBOSITY && (level)<=(verbosity)) Log((message),(level),(verbosity)); \
+	} while(0)
+
+#define LOG_LIMITED(limiter, message, level, verbosity) \
+	do { \
+		if((level)<=LOG_MAX_VERBOSITY && (level)<=(verbosity)){ \
+			int log_limited_state_ = (limiter).Check(__FILE__, __LINE__); \
+			if(log_limited_state_==LogRateLimiter::kPrint) Log((message),(level),(verbosity)); \
+			else if(log_limited_state_==LogRateLimiter::kLast) \
+				Log(std::string(message)+" (further occurrences suppressed)",(level),(verbosity)); \
+		} \
+	} while(0)
+
+// build a message from a sequence of streamable arguments,
+// e.g. LOG_LAZY(LogMsg(m_unique_name," hit ",i," time ",t), v_debug, m_verbose);
+inline void LogMsgAppend(std::stringstream&){}
+template<typename T, typename... Rest>
+inline void LogMsgAppend(std::stringstream& ss, const T& first, const Rest&... rest){
+	ss<<first;
+	LogMsgAppend(ss, rest...);
+}
+template<typename... Args>
+inline std::string LogMsg(const Args&... args){
+	std::stringstream ss;
+	LogMsgAppend(ss, args...);
+	return ss.str();
+}
+
+class LogRateLimiter {
+	public:
+	enum { kSuppress=0, kPrint=1, kLast=2 };
+
+	LogRateLimiter(int max_repeats_in=10) : max_repeats(max_repeats_in){}
+	void SetMaxRepeats(int max_repeats_in){ max_repeats=max_repeats_in; }
+
+	// returns kPrint for the first max_repeats calls from a given call site,
+	// kLast for the next one (so a suppression notice can be added), then kSuppress.
+	// max_repeats<0 disables limiting.
+	int Check(const char* file, int line){
+		if(max_repeats<0) return kPrint;
+		int count = ++counts[std::make_pair(file,line)];
+		if(count<=max_repeats) return kPrint;
+		if(count==max_repeats+1) return kLast;
+		return kSuppress;
+	}
+
+	// number of times the given call site has been reached (including suppressed messages)
+	int GetCount(const char* file, int line) const {
+		auto it = counts.find(std::make_pair(file,line));
+		return (it==counts.end()) ? 0 : it->second;
+	}
+
+	// total number of messages suppressed over all call sites
+	long GetSuppressed() const {
+		long nsuppressed=0;
+		for(auto&& acount : counts){
+			if(acount.second>max_repeats+1) nsuppressed += acount.second - (max_repeats+1);
+		}
+		return nsuppressed;
+	}
+
+	private:
+	int max_repeats;
+	// keyed on the __FILE__ pointer and line. string literals for the same file may not
+	// be pooled across translation units, but all call sites in one Tool are in one file.
+	std::map<std::pair<const char*,int>, int> counts;
+};
+
+#endif
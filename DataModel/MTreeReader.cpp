@@ -19,9 +19,15 @@
 #include <sstream>
 #include <algorithm> // std::find
 #include <cassert>
+#include <chrono>
 
 #include "Algorithms.h"  // CheckPath
 
+bool MTreeReader::profileIO=false;
+uint64_t MTreeReader::profiledEntries=0;
+uint64_t MTreeReader::profiledBytes=0;
+double MTreeReader::profiledSeconds=0;
+
 bool Notifier::Notify(){
 	if(verbosity) std::cout<<"Notifier for "<<treeReader->GetName()<<" loading new TTree"<<std::endl;
 	//treeReader->GetTree()->Show();
@@ -603,7 +609,15 @@ int MTreeReader::GetEntry(long entry_number, bool skipTreeRead){
 		// load data from tree
 		// The function returns the number of bytes read from the input buffer.
 		// If entry does not exist the function returns 0. If an I/O error occurs, the function returns -1.
-		bytesread = thetree->GetEntry(entry_number);
+		if(profileIO){
+			auto t0 = std::chrono::steady_clock::now();
+			bytesread = thetree->GetEntry(entry_number);
+			profiledSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+			++profiledEntries;
+			if(bytesread>0) profiledBytes += bytesread;
+		} else {
+			bytesread = thetree->GetEntry(entry_number);
+		}
 		if(status<0){
 			std::cerr<<"MTreeReader error loading next TTree from TChain! "
 					 <<"TChain::GetEntry returned "<<status<<"\n";
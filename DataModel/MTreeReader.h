@@ -272,6 +272,13 @@ class MTreeReader {
 	int UpdateBranchPointer(std::string branchname);
 	int UpdateBranchPointers();
 	
+	// global read statistics over all MTreeReaders, accumulated only when profileIO is set
+	// (by the ToolProfiler) so that GetEntry incurs no timing overhead otherwise
+	static bool profileIO;
+	static uint64_t profiledEntries;
+	static uint64_t profiledBytes;
+	static double profiledSeconds;
+	
 	protected:
 	
 	// variables
@@ -0,0 +1,85 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "MuonTrackGeometry.h"
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+namespace MuonTrackGeometry {
+
+namespace {
+
+// squared transverse distance (from the cross product with the track direction, which unlike
+// |d|^2 - appr^2 cannot go negative through rounding) and projection of each vertex onto one track.
+// n.b. no branches or function calls, so this vectorises over vertices.
+void TrackProjections(const float* direction, const float* entrypoint,
+                      size_t nvertices, const float* vx, const float* vy, const float* vz,
+                      float* perp2_out, float* appr_out){
+	const double ux = direction[0], uy = direction[1], uz = direction[2];
+	const double ex = entrypoint[0], ey = entrypoint[1], ez = entrypoint[2];
+	for(size_t i=0; i<nvertices; ++i){
+		const double dx = vx[i] - ex;
+		const double dy = vy[i] - ey;
+		const double dz = vz[i] - ez;
+		const double cx = dy*uz - dz*uy;
+		const double cy = dz*ux - dx*uz;
+		const double cz = dx*uy - dy*ux;
+		perp2_out[i] = cx*cx + cy*cy + cz*cz;
+		appr_out[i] = dx*ux + dy*uy + dz*uz;
+	}
+}
+
+}
+
+void TrackDistance(const float* direction, const float* entrypoint, const float* vertex, float& dlt, float& appr){
+	float perp2;
+	TrackProjections(direction, entrypoint, 1, &vertex[0], &vertex[1], &vertex[2], &perp2, &appr);
+	dlt = std::sqrt(perp2);
+}
+
+void TrackDistances(const float* direction, const float* const* entrypoints, int ntracks,
+                    size_t nvertices, const float* vx, const float* vy, const float* vz,
+                    float* dlt_out, float* appr_out, int* track_out){
+
+	// n.b. squared distances are held in dlt_out until the end
+	TrackProjections(direction, entrypoints[0], nvertices, vx, vy, vz, dlt_out, appr_out);
+	if(track_out) std::fill(track_out, track_out+nvertices, 0);
+
+	if(ntracks>1){
+		// keep the nearest track for each vertex
+		std::vector<float> perp2(nvertices), appr(nvertices);
+		for(int track=1; track<ntracks; ++track){
+			TrackProjections(direction, entrypoints[track], nvertices, vx, vy, vz, perp2.data(), appr.data());
+			for(size_t i=0; i<nvertices; ++i){
+				if(perp2[i] < dlt_out[i]){
+					dlt_out[i] = perp2[i];
+					appr_out[i] = appr[i];
+					if(track_out) track_out[i] = track;
+				}
+			}
+		}
+	}
+
+	for(size_t i=0; i<nvertices; ++i) dlt_out[i] = std::sqrt(dlt_out[i]);
+}
+
+double MaxDedxPosition(const float* dedx, int* max_bin, double* max_edep){
+	// running sum over the window, rather than re-summing all 9 bins at each step.
+	// Summing in double, the result is the same as the direct sum for any realistic dE/dx values.
+	double window_sum = 0;
+	for(int j=0; j<kDedxWindow; ++j) window_sum += dedx[j];
+	double best = 0;
+	int best_bin = 0;
+	for(int i=0; i<kDedxNumWindows; ++i){
+		if(i>0) window_sum += double(dedx[i+kDedxWindow-1]) - double(dedx[i-1]);
+		if(window_sum > best){
+			best = window_sum;
+			best_bin = i + kDedxWindow/2;   // centre bin of the window
+		}
+	}
+	if(max_bin) *max_bin = best_bin;
+	if(max_edep) *max_edep = best;
+	return kDedxBinWidth*best_bin;
+}
+
+}
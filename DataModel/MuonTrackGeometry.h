@@ -0,0 +1,40 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef MuonTrackGeometry_H
+#define MuonTrackGeometry_H
+
+#include <cstddef>
+
+/*
+ Native replacements for the per-pair geometry used in spallation and neutron cloud variables.
+
+ TrackDistance is equivalent to the SKOFL routine getdl_: for a straight muon track with
+ the given entry point and (unit) direction, it returns the transverse distance of a vertex
+ from the track (dlt) and the distance along the track from the entry point to the point of
+ closest approach (appr). The longitudinal distance used for spallation is then
+ dll = MaxDedxPosition(dedx) - appr.
+
+ TrackDistances does the same for a batch of vertices given as separate x, y, z arrays,
+ against a muon with one or more parallel tracks (as from muboy, where all tracks share
+ muboy_dir and have entry points muboy_entpos[0..ntracks-1]). For each vertex the track
+ giving the smallest dlt is used; its index is returned in track_out if given.
+ The distance calculation is written so that the compiler can vectorise it over vertices.
+*/
+namespace MuonTrackGeometry {
+
+void TrackDistance(const float* direction, const float* entrypoint, const float* vertex, float& dlt, float& appr);
+
+void TrackDistances(const float* direction, const float* const* entrypoints, int ntracks,
+                    size_t nvertices, const float* vx, const float* vy, const float* vz,
+                    float* dlt_out, float* appr_out, int* track_out=nullptr);
+
+// the SK-style 'position of maximum energy deposition': the centre of the 9-bin window (of the first
+// 119 bins of the 50cm dE/dx histogram) with the largest sum, found with a running window sum.
+// Returns the distance along the track in cm, and optionally the window bin and sum.
+constexpr int kDedxWindow = 9;
+constexpr int kDedxNumWindows = 111;
+constexpr double kDedxBinWidth = 50.;  // [cm]
+double MaxDedxPosition(const float* dedx, int* max_bin=nullptr, double* max_edep=nullptr);
+
+}
+
+#endif
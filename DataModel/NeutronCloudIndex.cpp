@@ -0,0 +1,79 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "NeutronCloudIndex.h"
+
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+NeutronCloudIndex::NeutronCloudIndex(double cell_size_in, double half_width, double half_height) : cell_size(cell_size_in) {
+	if(!(cell_size>0) || !(half_width>0) || !(half_height>0)){
+		throw std::invalid_argument("NeutronCloudIndex - invalid grid dimensions");
+	}
+	const double half[3] = {half_width, half_width, half_height};
+	for(int dim=0; dim<3; ++dim){
+		lo[dim] = -half[dim];
+		ncells[dim] = std::max(1, int(std::ceil(2*half[dim]/cell_size)));
+	}
+}
+
+void NeutronCloudIndex::Clear(){
+	clouds.clear();
+	times.clear();
+	cell_start.clear();
+	built=false;
+}
+
+int NeutronCloudIndex::CellCoord(double pos, int dim) const {
+	// n.b. NaN goes to cell 0
+	const double cell = std::floor((pos - lo[dim])/cell_size);
+	return (cell>=0) ? int(std::min(cell, double(ncells[dim]-1))) : 0;
+}
+
+void NeutronCloudIndex::Build(){
+	const size_t ntotal = size_t(ncells[0])*ncells[1]*ncells[2];
+	std::vector<uint32_t> cell_of(clouds.size());
+	for(size_t i=0; i<clouds.size(); ++i){
+		const float* v = clouds[i].vertex;
+		cell_of[i] = (size_t(CellCoord(v[2],2))*ncells[1] + CellCoord(v[1],1))*ncells[0] + CellCoord(v[0],0);
+	}
+	// counting sort by cell, then by time within each cell
+	cell_start.assign(ntotal+1, 0);
+	for(uint32_t cell : cell_of) ++cell_start[cell+1];
+	for(size_t cell=0; cell<ntotal; ++cell) cell_start[cell+1] += cell_start[cell];
+	std::vector<uint32_t> fill(cell_start.begin(), cell_start.end()-1);
+	std::vector<Cloud> sorted(clouds.size());
+	for(size_t i=0; i<clouds.size(); ++i) sorted[fill[cell_of[i]]++] = clouds[i];
+	for(size_t cell=0; cell<ntotal; ++cell){
+		std::sort(sorted.begin()+cell_start[cell], sorted.begin()+cell_start[cell+1],
+		          [](const Cloud& a, const Cloud& b){ return a.time < b.time; });
+	}
+	clouds = std::move(sorted);
+	times.resize(clouds.size());
+	for(size_t i=0; i<clouds.size(); ++i) times[i] = clouds[i].time;
+	built=true;
+}
+
+void NeutronCloudIndex::Query(const float* vertex, double time, double radius, double dt, std::vector<size_t>& out) const {
+	if(!built) throw std::logic_error("NeutronCloudIndex::Query - Build() must be called after adding clouds");
+	int first[3], last[3];
+	for(int dim=0; dim<3; ++dim){
+		first[dim] = CellCoord(vertex[dim]-radius, dim);
+		last[dim] = CellCoord(vertex[dim]+radius, dim);
+	}
+	const double radius2 = radius*radius;
+	for(int iz=first[2]; iz<=last[2]; ++iz){
+		for(int iy=first[1]; iy<=last[1]; ++iy){
+			for(int ix=first[0]; ix<=last[0]; ++ix){
+				const size_t cell = (size_t(iz)*ncells[1] + iy)*ncells[0] + ix;
+				const double* begin = times.data() + cell_start[cell];
+				const double* end = times.data() + cell_start[cell+1];
+				for(const double* t=std::lower_bound(begin, end, time-dt); t!=end && *t<=time+dt; ++t){
+					const size_t i = t - times.data();
+					const float* v = clouds[i].vertex;
+					const double dx = v[0]-vertex[0], dy = v[1]-vertex[1], dz = v[2]-vertex[2];
+					if(dx*dx + dy*dy + dz*dz <= radius2) out.push_back(i);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,57 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef NeutronCloudIndex_H
+#define NeutronCloudIndex_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/**
+* \class NeutronCloudIndex
+*
+* Space and time index of neutron clouds (one per muon, from CalculateNeutronCloudVertex), to find all
+* clouds within a distance R and time dt of a point (e.g. a relic candidate) without looping over all clouds.
+*
+* Clouds are binned in a uniform grid of cubic cells over the tank, and within each cell sorted by time,
+* so a query visits only the cells overlapping the sphere's bounding box, and in each of those
+* binary-searches the time window: O(cells * log(n) + k) for k clouds returned.
+* Clouds outside the grid are kept in the nearest edge cell, so nothing is lost.
+*
+* Times are in seconds from any common origin (e.g. the start of a run); build one index per run.
+* Usage: Add() each cloud, Build(), then Query(). Adding after Build() requires another Build().
+*/
+class NeutronCloudIndex {
+	public:
+	struct Cloud {
+		float vertex[3];        // cm
+		double time;            // s
+		long entry;             // e.g. the entry in the cloud tree
+		int multiplicity;
+		float muon_dir[3];
+	};
+
+	// the grid covers |x|,|y| <= half_width and |z| <= half_height, in cells of cell_size [cm]
+	explicit NeutronCloudIndex(double cell_size=200., double half_width=1700., double half_height=1820.);
+
+	void Clear();
+	void Add(const Cloud& cloud){ clouds.push_back(cloud); built=false; }
+	void Build();
+	size_t Size() const { return clouds.size(); }
+	const Cloud& Get(size_t i) const { return clouds[i]; }
+
+	// appends the indices of clouds with |cloud time - time| <= dt and distance <= radius
+	void Query(const float* vertex, double time, double radius, double dt, std::vector<size_t>& out) const;
+
+	private:
+	int CellCoord(double pos, int dim) const;
+
+	double cell_size;
+	double lo[3];
+	int ncells[3];
+	bool built = false;
+	std::vector<Cloud> clouds;          // sorted by cell, then time, by Build
+	std::vector<double> times;          // of the clouds, for the binary searches
+	std::vector<uint32_t> cell_start;   // first cloud of each cell, plus the end
+};
+
+#endif
@@ -19,6 +19,20 @@ void PMTHitCluster::Append(const PMTHit& hit)
     } 
 }
 
+void PMTHitCluster::AppendSorted(const std::vector<PMTHit>& hits)
+{
+    // n.b. Append does not clear bSorted, so check the existing hits
+    bool wasSorted = std::is_sorted(element.begin(), element.end());
+    unsigned int nOld = element.size();
+    for (auto const& hit: hits)
+        Append(hit);
+    if (wasSorted)
+        std::inplace_merge(element.begin(), element.begin()+nOld, element.end());
+    else
+        std::sort(element.begin(), element.end());
+    bSorted = true;
+}
+
 void PMTHitCluster::SetVertex(const TVector3& inVertex)
 {
     if (bHasVertex)
@@ -58,6 +72,14 @@ void PMTHitCluster::Sort()
     bSorted = true;
 }
 
+void PMTHitCluster::Swap(PMTHitCluster& other)
+{
+    Cluster<PMTHit>::Swap(other);
+    std::swap(bSorted, other.bSorted);
+    std::swap(bHasVertex, other.bHasVertex);
+    std::swap(vertex, other.vertex);
+}
+
 PMTHitCluster PMTHitCluster::Slice(int startIndex, float tWidth)
 {
     if (!bSorted)
@@ -17,6 +17,8 @@ class PMTHitCluster : public Cluster<PMTHit>
         PMTHitCluster();
         
         void Append(const PMTHit& hit);
+        // append hits that are already in time order, merging them in so the cluster stays (or becomes) sorted
+        void AppendSorted(const std::vector<PMTHit>& hits);
 
         void SetVertex(const TVector3& inVertex);
         inline const TVector3& GetVertex() const { return vertex; }
@@ -24,6 +26,8 @@ class PMTHitCluster : public Cluster<PMTHit>
         void RemoveVertex();
 
         void Sort();
+        bool IsSorted() const { return bSorted; }
+        void Swap(PMTHitCluster& other);
 
         void DumpAllElements() { for (auto& hit: element) hit.Dump(); }
 
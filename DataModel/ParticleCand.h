@@ -1,9 +1,14 @@
 #ifndef PARTICLECAND_H
 #define PARTICLECAND_H
 
+#include <vector>
+#include <utility>
+#include <cstdint>
+
 #include "skroot_loweC.h"
 
-struct ParticleCand {
+// the small, fixed-size part of a muon or relic candidate used while matching
+struct ParticleCandCore {
 	bool flaggedForWrite;
 	int EventNumber;
 	int SubTriggerNumber;
@@ -14,6 +19,12 @@ struct ParticleCand {
 	int InEntryNumber;  // entry number in input file TTree
 	int OutEntryNumber; // entry number in output file TTree
 	int PID = 0; //0 = muon 1 = LowE
+	bool hasAFT;
+	int AFTEntryNum; // may not be InEntryNumber+1...
+};
+
+// the bulky part, only needed when recording matches and writing out
+struct ParticleCandPayload {
 	std::vector<int> matchedParticleEvNum;         // nevsk of matches
 	std::vector<int> matchedParticleInEntryNum;    // TTree entry number of matches in input tree
 	std::vector<int> matchedParticleOutEntryNum;   // TTree entry number of matches in output tree
@@ -21,8 +32,12 @@ struct ParticleCand {
 	std::vector<float> matchedParticleTimeDiff;
 	std::vector<float> matchedParticleBSEnergy;
 	skroot_lowe_common LowECommon;
-	bool hasAFT;
-	int AFTEntryNum; // may not be InEntryNumber+1...
+};
+
+struct ParticleCand : public ParticleCandCore, public ParticleCandPayload {
+	ParticleCand(){}
+	ParticleCand(const ParticleCandCore& core, ParticleCandPayload&& payload)
+		: ParticleCandCore(core), ParticleCandPayload(std::move(payload)) {}
 };
 
 #endif
@@ -0,0 +1,46 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "SoftwareTrigger.h"
+
+#include <stdexcept>
+#include <limits>
+#include <string>
+
+size_t SoftwareTrigger::Find(const std::vector<double>& hit_times, const std::vector<int>& types, std::vector<Trigger>& out) const {
+	const size_t ntypes = types.size();
+	std::vector<const Condition*> conds(ntypes);
+	for(size_t k=0; k<ntypes; ++k){
+		auto it = conditions.find(types[k]);
+		if(it==conditions.end()){
+			throw std::invalid_argument("SoftwareTrigger::Find - no condition set for trigger type "+std::to_string(types[k]));
+		}
+		conds[k] = &it->second;
+	}
+	// per type: first hit still within the window, and the end of the holdoff after the last trigger
+	std::vector<size_t> window_start(ntypes, 0);
+	std::vector<double> live_from(ntypes, -std::numeric_limits<double>::infinity());
+	const size_t nbefore = out.size();
+	for(size_t i=0; i<hit_times.size(); ++i){
+		const double t = hit_times[i];
+		for(size_t k=0; k<ntypes; ++k){
+			const Condition& cond = *conds[k];
+			size_t& first = window_start[k];
+			while(hit_times[first] <= t - cond.window) ++first;
+			if(t < live_from[k]) continue;
+			const int nhits = i - first + 1;
+			if(nhits < cond.threshold || cond.threshold<=0) continue;
+			out.push_back(Trigger{types[k], t + cond.t0_offset, nhits, first, i});
+			live_from[k] = t + cond.holdoff;
+		}
+	}
+	return out.size() - nbefore;
+}
+
+void SoftwareTrigger::Coincidences(const std::vector<double>& a, const std::vector<double>& b, double max_dt,
+                                   std::vector<std::pair<size_t,size_t>>& pairs){
+	size_t j=0;
+	for(size_t i=0; i<a.size(); ++i){
+		// b times too early for this a are too early for all later ones too
+		while(j<b.size() && b[j] <= a[i] - max_dt) ++j;
+		if(j<b.size() && b[j] < a[i] + max_dt) pairs.emplace_back(i, j);
+	}
+}
@@ -0,0 +1,62 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef SoftwareTrigger_H
+#define SoftwareTrigger_H
+
+#include <map>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+/**
+* \class SoftwareTrigger
+*
+* Native emulation of the hitsum software trigger, to replace per-event calls of the Fortran softtrg routines.
+* A trigger of a given type fires when the number of hits within a sliding window of width `window`
+* (ending on the latest hit) reaches the threshold; the trigger time is that of the hit which crossed it,
+* plus the type's t0 offset. No further trigger of the same type is issued until `holdoff` after that.
+*
+* Conditions are set per trigger type (TriggerType enum, times in ns) and tagged with the run they were
+* read for, so tools need only refresh them when the run changes.
+* Find() scans a sorted vector of hit times once, counting hits in the window of every requested type together;
+* ID types (LE/HE/SLE) and the OD type are scanned in separate calls over the ID and OD hits respectively.
+* Coincidences() pairs up two sorted lists of trigger times (e.g. HE and OD) with a single merge.
+*/
+class SoftwareTrigger {
+	public:
+	struct Condition {
+		int threshold = 0;       // hits within the window
+		double window = 200;     // ns
+		double t0_offset = 0;    // ns, added to the time of the hit that crossed threshold
+		double holdoff = 0;      // ns, after a trigger before another of the same type may fire
+	};
+	struct Trigger {
+		int type;
+		double time;             // ns, crossing time + t0 offset
+		int nhits;               // hits in the window when it fired (== threshold)
+		size_t first_hit;        // indices into the scanned hit times of the window that fired
+		size_t last_hit;
+	};
+
+	void SetCondition(int type, const Condition& condition){ conditions[type] = condition; }
+	bool HasCondition(int type) const { return conditions.count(type); }
+	const Condition& GetCondition(int type) const { return conditions.at(type); }
+	void ClearConditions(){ conditions.clear(); run=-1; }
+	// the run the current conditions were loaded for, -1 if none
+	int GetRun() const { return run; }
+	void SetRun(int run_in){ run = run_in; }
+
+	// appends the triggers of the given types found in hit_times, which must be sorted ascending.
+	// Returns the number found; triggers are appended in time order.
+	size_t Find(const std::vector<double>& hit_times, const std::vector<int>& types, std::vector<Trigger>& out) const;
+
+	// for each time in a (sorted), the index of the first time in b (sorted) with |b - a| < max_dt.
+	// Appends (index in a, index in b) pairs for those that have one.
+	static void Coincidences(const std::vector<double>& a, const std::vector<double>& b, double max_dt,
+	                         std::vector<std::pair<size_t,size_t>>& pairs);
+
+	private:
+	std::map<int,Condition> conditions;
+	int run = -1;
+};
+
+#endif
@@ -0,0 +1,239 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "SpallationDtLikelihood.h"
+
+#include <cmath>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+	// points are summed in chunks of this many. Per-position partial sums are kept across chunks,
+	// so that the inner loops are element-wise and can be vectorised without reordering the sums
+	const size_t chunk_size = 256;
+	// not worth another thread for fewer points than this
+	const size_t min_points_per_thread = 16*chunk_size;
+}
+
+SpallationDtLikelihood::SpallationDtLikelihood(double tmin_in, double tmax_in) : tmin(tmin_in), tmax(tmax_in) {
+	if(!(tmax>tmin) || tmin<0){
+		throw std::invalid_argument("SpallationDtLikelihood - invalid time window");
+	}
+}
+
+int SpallationDtLikelihood::AddExponential(const std::string& name, double lifetime){
+	if(!basis.empty()) throw std::logic_error("SpallationDtLikelihood - components must be added before the data");
+	if(!(lifetime>0)) throw std::invalid_argument("SpallationDtLikelihood::AddExponential - invalid lifetime");
+	components.push_back(Component{name, {lifetime}});
+	window_integrals.push_back(Cumulative(components.back(), tmax) - Cumulative(components.back(), tmin));
+	return components.size()-1;
+}
+
+int SpallationDtLikelihood::AddExponentialPair(const std::string& name, double lifetime1, double lifetime2){
+	if(!basis.empty()) throw std::logic_error("SpallationDtLikelihood - components must be added before the data");
+	if(!(lifetime1>0) || !(lifetime2>0)){
+		throw std::invalid_argument("SpallationDtLikelihood::AddExponentialPair - invalid lifetime");
+	}
+	components.push_back(Component{name, {lifetime1, lifetime2}});
+	window_integrals.push_back(Cumulative(components.back(), tmax) - Cumulative(components.back(), tmin));
+	return components.size()-1;
+}
+
+int SpallationDtLikelihood::AddConstant(const std::string& name){
+	if(!basis.empty()) throw std::logic_error("SpallationDtLikelihood - components must be added before the data");
+	components.push_back(Component{name, {}});
+	window_integrals.push_back(tmax - tmin);
+	return components.size()-1;
+}
+
+void SpallationDtLikelihood::SetLifetime(int par, double lifetime){
+	Component& comp = components.at(par);
+	if(comp.lifetimes.size()!=1) throw std::logic_error("SpallationDtLikelihood::SetLifetime - not a single exponential");
+	if(!(lifetime>0)) throw std::invalid_argument("SpallationDtLikelihood::SetLifetime - invalid lifetime");
+	comp.lifetimes[0] = lifetime;
+	basis.clear();
+	weights.clear();
+	npoints = 0;
+	nevents = 0;
+	for(size_t i=0; i<components.size(); ++i){
+		window_integrals[i] = Cumulative(components[i], tmax) - Cumulative(components[i], tmin);
+	}
+}
+
+double SpallationDtLikelihood::Density(const Component& comp, double t) const {
+	if(comp.lifetimes.empty()) return 1.;
+	double density=0;
+	for(double tau : comp.lifetimes) density += std::exp(-t/tau)/tau;
+	return density/comp.lifetimes.size();
+}
+
+double SpallationDtLikelihood::Cumulative(const Component& comp, double t) const {
+	if(comp.lifetimes.empty()) return t;
+	double integral=0;
+	// 1-exp(-t/tau), with expm1 to keep precision for t << tau
+	for(double tau : comp.lifetimes) integral += -std::expm1(-t/tau);
+	return integral/comp.lifetimes.size();
+}
+
+double SpallationDtLikelihood::ExpectedEvents(int par, double value) const {
+	return value*window_integrals.at(par);
+}
+
+void SpallationDtLikelihood::Allocate(size_t n){
+	npoints = n;
+	basis.assign(components.size(), std::vector<float>(n));
+	weights.assign(n, 1.f);
+}
+
+void SpallationDtLikelihood::SetEvents(const std::vector<double>& dts){
+	std::vector<double> inwindow;
+	inwindow.reserve(dts.size());
+	for(double dt : dts) if(dt>=tmin && dt<=tmax) inwindow.push_back(dt);
+	Allocate(inwindow.size());
+	nevents = inwindow.size();
+	// in case previously restricted to a binned range
+	for(size_t comp=0; comp<components.size(); ++comp){
+		window_integrals[comp] = Cumulative(components[comp], tmax) - Cumulative(components[comp], tmin);
+	}
+	for(size_t comp=0; comp<components.size(); ++comp){
+		for(size_t i=0; i<inwindow.size(); ++i) basis[comp][i] = Density(components[comp], inwindow[i]);
+	}
+}
+
+void SpallationDtLikelihood::SetBinnedEvents(const std::vector<double>& dts, const std::vector<double>& binedges){
+	if(binedges.size()<2 || !std::is_sorted(binedges.begin(), binedges.end())
+	   || binedges.front()<tmin || binedges.back()>tmax){
+		throw std::invalid_argument("SpallationDtLikelihood::SetBinnedEvents - bin edges must be increasing and within the fit window");
+	}
+	const size_t nbins = binedges.size()-1;
+	std::vector<double> counts(nbins, 0.);
+	nevents = 0;
+	for(double dt : dts){
+		if(dt<binedges.front() || dt>binedges.back()) continue;
+		size_t bin = std::upper_bound(binedges.begin(), binedges.end(), dt) - binedges.begin();
+		bin = std::min(bin, nbins) - 1;   // the upper edge belongs to the last bin
+		++counts[bin];
+		++nevents;
+	}
+	// empty bins contribute only to the expected number of events, which doesn't depend on the binning
+	size_t nfilled = std::count_if(counts.begin(), counts.end(), [](double c){ return c>0; });
+	Allocate(nfilled);
+	size_t point=0;
+	for(size_t bin=0; bin<nbins; ++bin){
+		if(counts[bin]==0) continue;
+		weights[point] = counts[bin];
+		for(size_t comp=0; comp<components.size(); ++comp){
+			basis[comp][point] = Cumulative(components[comp], binedges[bin+1]) - Cumulative(components[comp], binedges[bin]);
+		}
+		++point;
+	}
+	// the extended term uses the integral over [tmin, tmax]; bins that do not cover the whole window
+	// would make it inconsistent, so restrict it to the binned range
+	for(size_t comp=0; comp<components.size(); ++comp){
+		window_integrals[comp] = Cumulative(components[comp], binedges.back()) - Cumulative(components[comp], binedges.front());
+	}
+}
+
+void SpallationDtLikelihood::SumRange(size_t begin, size_t end, const double* pars, double* nll, double* grad) const {
+	const size_t ncomps = components.size();
+	// per-position partial sums, reduced at the end
+	std::vector<double> loglike_acc(chunk_size, 0.);
+	std::vector<double> grad_acc(grad ? ncomps*chunk_size : 0, 0.);
+	double lambda[chunk_size];
+	double ratio[chunk_size];
+	for(size_t chunk=begin; chunk<end; chunk+=chunk_size){
+		const size_t n = std::min(chunk_size, end-chunk);
+		const float* w = weights.data() + chunk;
+		// model density at each point
+		for(size_t j=0; j<n; ++j) lambda[j] = 0;
+		for(size_t comp=0; comp<ncomps; ++comp){
+			const double amp = pars[comp];
+			const float* b = basis[comp].data() + chunk;
+			for(size_t j=0; j<n; ++j) lambda[j] += amp*b[j];
+		}
+		// a zero density (e.g. all amplitudes 0) gives a large but finite NLL
+		for(size_t j=0; j<n; ++j){
+			const double l = lambda[j] > 1e-300 ? lambda[j] : 1e-300;
+			loglike_acc[j] += w[j]*std::log(l);
+			ratio[j] = w[j]/l;
+		}
+		if(!grad) continue;
+		for(size_t comp=0; comp<ncomps; ++comp){
+			const float* b = basis[comp].data() + chunk;
+			double* acc = grad_acc.data() + comp*chunk_size;
+			for(size_t j=0; j<n; ++j) acc[j] += ratio[j]*b[j];
+		}
+	}
+	double loglike=0;
+	for(double acc : loglike_acc) loglike += acc;
+	*nll = -loglike;
+	if(!grad) return;
+	for(size_t comp=0; comp<ncomps; ++comp){
+		double sum=0;
+		for(size_t j=0; j<chunk_size; ++j) sum += grad_acc[comp*chunk_size+j];
+		grad[comp] = -sum;
+	}
+}
+
+double SpallationDtLikelihood::Evaluate(const double* pars, double* grad) const {
+	const size_t ncomps = components.size();
+	const int nthr = std::max<size_t>(1, std::min<size_t>(nthreads, npoints/min_points_per_thread));
+	std::vector<double> nlls(nthr, 0.);
+	std::vector<double> grads(grad ? nthr*ncomps : 0, 0.);
+	// split on chunk boundaries, so the chunks (and so the result) only depend on the number of threads
+	const size_t nchunks = (npoints + chunk_size - 1)/chunk_size;
+	const size_t chunks_per_thread = (nchunks + nthr - 1)/nthr;
+	auto range = [&](int t){
+		const size_t begin = std::min(npoints, t*chunks_per_thread*chunk_size);
+		const size_t end = std::min(npoints, begin + chunks_per_thread*chunk_size);
+		SumRange(begin, end, pars, &nlls[t], grad ? &grads[t*ncomps] : nullptr);
+	};
+	if(nthr==1){
+		range(0);
+	} else {
+		std::vector<std::thread> workers;
+		for(int t=0; t<nthr; ++t) workers.emplace_back(range, t);
+		for(std::thread& worker : workers) worker.join();
+	}
+
+	// extended term: the expected number of events
+	double nll=0;
+	for(size_t comp=0; comp<ncomps; ++comp) nll += pars[comp]*window_integrals[comp];
+	for(int t=0; t<nthr; ++t) nll += nlls[t];
+	if(grad){
+		for(size_t comp=0; comp<ncomps; ++comp){
+			grad[comp] = window_integrals[comp];
+			for(int t=0; t<nthr; ++t) grad[comp] += grads[t*ncomps+comp];
+		}
+	}
+	return nll;
+}
+
+void SpallationDtLikelihood::Hessian(const double* pars, double* hess) const {
+	// the extended term is linear, leaving sum over points of w*b_k*b_l/lambda^2
+	const size_t ncomps = components.size();
+	std::fill(hess, hess+ncomps*ncomps, 0.);
+	std::vector<double> b(ncomps);
+	for(size_t i=0; i<npoints; ++i){
+		double lambda=0;
+		for(size_t comp=0; comp<ncomps; ++comp){
+			b[comp] = basis[comp][i];
+			lambda += pars[comp]*b[comp];
+		}
+		lambda = lambda > 1e-300 ? lambda : 1e-300;
+		const double scale = weights[i]/(lambda*lambda);
+		for(size_t k=0; k<ncomps; ++k){
+			for(size_t l=0; l<=k; ++l) hess[k*ncomps+l] += scale*b[k]*b[l];
+		}
+	}
+	for(size_t k=0; k<ncomps; ++k){
+		for(size_t l=0; l<k; ++l) hess[l*ncomps+k] = hess[k*ncomps+l];
+	}
+}
+
+double SpallationDtLikelihood::NLL(const double* pars) const {
+	return Evaluate(pars, nullptr);
+}
+
+double SpallationDtLikelihood::NLLAndGradient(const double* pars, double* grad) const {
+	return Evaluate(pars, grad);
+}
@@ -0,0 +1,86 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef SpallationDtLikelihood_H
+#define SpallationDtLikelihood_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+/**
+* \class SpallationDtLikelihood
+*
+* Extended negative log-likelihood, with analytic gradient, of the muon to low-e time differences
+* in a window [tmin, tmax], modelled as a sum of exponential decays with known lifetimes and a constant
+* (random) background, all fitted at once.
+*
+* The parameter of each decay component is its total number of decays, from dt=0 to infinity
+* (so the same as the amplitude of A/tau*exp(-dt/tau)); that of a constant component is its rate, in events
+* per second. A pair of isotopes with a shared amplitude contributes A/2 to each lifetime.
+* All parameters should be kept >= 0 by the minimiser.
+*
+* Since the lifetimes are fixed, each component's density at each data point is calculated once, in SetEvents,
+* after which each evaluation is a weighted sum over the points, done in chunks so that the compiler can
+* vectorise it, and optionally split over threads. Results are independent of the number of threads used
+* to within rounding, and reproducible for a given number of threads.
+*
+* With SetBinnedEvents the data are first histogrammed, and the points are bins, using the exact integral
+* of each component over each bin: this is a Poisson binned likelihood, with the same parameters,
+* and is much faster for large samples.
+*/
+class SpallationDtLikelihood {
+	public:
+	SpallationDtLikelihood(double tmin, double tmax);
+
+	// components, in the order of the parameters. Returns the parameter index.
+	// n.b. components must all be added before the data is set.
+	int AddExponential(const std::string& name, double lifetime);
+	int AddExponentialPair(const std::string& name, double lifetime1, double lifetime2);
+	int AddConstant(const std::string& name);
+	// change the lifetime of a single-exponential component. This drops any data, which must be set again.
+	void SetLifetime(int par, double lifetime);
+
+	// values outside [tmin, tmax] are ignored
+	void SetEvents(const std::vector<double>& dts);
+	void SetBinnedEvents(const std::vector<double>& dts, const std::vector<double>& binedges);
+	void SetNThreads(int n){ nthreads = (n<1) ? 1 : n; }
+
+	int GetNParameters() const { return components.size(); }
+	const std::string& GetName(int par) const { return components.at(par).name; }
+	bool IsConstant(int par) const { return components.at(par).lifetimes.empty(); }
+	const std::vector<double>& GetLifetimes(int par) const { return components.at(par).lifetimes; }
+	double GetTMin() const { return tmin; }
+	double GetTMax() const { return tmax; }
+	double GetNumEvents() const { return nevents; }   ///< within [tmin, tmax]
+	size_t GetNPoints() const { return npoints; }     ///< events, or bins if binned
+	double ExpectedEvents(int par, double value) const;   ///< in [tmin, tmax], for a given parameter value
+
+	double NLL(const double* pars) const;
+	double NLLAndGradient(const double* pars, double* grad) const;
+	// second derivatives, as a row-major GetNParameters() x GetNParameters() matrix
+	void Hessian(const double* pars, double* hess) const;
+
+	private:
+	struct Component {
+		std::string name;
+		std::vector<double> lifetimes;   // empty for a constant
+	};
+	// integral of the component's unit-amplitude density from 0 to t
+	double Cumulative(const Component& comp, double t) const;
+	double Density(const Component& comp, double t) const;
+	void Allocate(size_t n);
+	void SumRange(size_t begin, size_t end, const double* pars, double* nll, double* grad) const;
+	double Evaluate(const double* pars, double* grad) const;
+
+	double tmin;
+	double tmax;
+	std::vector<Component> components;
+	std::vector<double> window_integrals;   // of each component's density over [tmin, tmax]
+	// component densities (or bin integrals) at each point, one array per component
+	std::vector<std::vector<float>> basis;
+	std::vector<float> weights;             // number of events at each point
+	size_t npoints = 0;
+	double nevents = 0;
+	int nthreads = 1;
+};
+
+#endif
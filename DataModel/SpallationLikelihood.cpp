@@ -0,0 +1,181 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "SpallationLikelihood.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+	const char file_magic[4] = {'S','P','L','K'};
+	const uint32_t file_version = 1;
+	// pairings are evaluated in chunks of this many, one variable at a time, so that the
+	// bin index and lookup loops run over short contiguous arrays
+	const size_t chunk_size = 256;
+}
+
+const char* SpallationLikelihood::VariableName(int var){
+	static const char* names[kNumVariables] = {"dt", "dlt", "dll", "muqismsk", "resQ"};
+	return (var>=0 && var<kNumVariables) ? names[var] : "unknown";
+}
+
+void SpallationLikelihood::SetPDF(int var, double lo, double hi, int nbins, const double* spall, const double* rand){
+	if(var<0 || var>=kNumVariables || nbins<1 || !(hi>lo)){
+		throw std::invalid_argument("SpallationLikelihood::SetPDF - bad variable or binning");
+	}
+
+	// smooth and normalise
+	auto density = [&](const double* contents){
+		std::vector<double> smoothed(nbins);
+		for(int i=0; i<nbins; ++i){
+			const int first = std::max(0, i-smooth_half_width);
+			const int last = std::min(nbins-1, i+smooth_half_width);
+			double sum=0;
+			for(int j=first; j<=last; ++j) sum += contents[j];
+			smoothed[i] = sum/(last-first+1);
+		}
+		double total=0;
+		for(double content : smoothed) total += content;
+		if(total>0) for(double& content : smoothed) content /= total;
+		for(double& content : smoothed) content = std::max(content, floor);
+		return smoothed;
+	};
+	const std::vector<double> spall_density = density(spall);
+	const std::vector<double> rand_density = density(rand);
+
+	Table& table = tables[var];
+	table.lo = lo;
+	table.hi = hi;
+	table.inv_width = nbins/(hi-lo);
+	table.logratio.resize(nbins);
+	for(int i=0; i<nbins; ++i) table.logratio[i] = std::log10(spall_density[i]/rand_density[i]);
+}
+
+bool SpallationLikelihood::IsComplete() const {
+	for(const Table& table : tables) if(table.logratio.empty()) return false;
+	return true;
+}
+
+bool SpallationLikelihood::Write(const std::string& filename) const {
+	if(!IsComplete()) return false;
+	std::ofstream file(filename, std::ios::binary);
+	if(!file.is_open()) return false;
+	const uint32_t nvars = kNumVariables;
+	file.write(file_magic, sizeof(file_magic));
+	file.write(reinterpret_cast<const char*>(&file_version), sizeof(file_version));
+	file.write(reinterpret_cast<const char*>(&nvars), sizeof(nvars));
+	for(const Table& table : tables){
+		const uint32_t nbins = table.logratio.size();
+		file.write(reinterpret_cast<const char*>(&nbins), sizeof(nbins));
+		file.write(reinterpret_cast<const char*>(&table.lo), sizeof(table.lo));
+		file.write(reinterpret_cast<const char*>(&table.hi), sizeof(table.hi));
+		file.write(reinterpret_cast<const char*>(table.logratio.data()), nbins*sizeof(float));
+	}
+	return file.good();
+}
+
+bool SpallationLikelihood::Read(const std::string& filename){
+	std::ifstream file(filename, std::ios::binary);
+	if(!file.is_open()) return false;
+	char magic[4];
+	uint32_t version=0, nvars=0;
+	file.read(magic, sizeof(magic));
+	file.read(reinterpret_cast<char*>(&version), sizeof(version));
+	file.read(reinterpret_cast<char*>(&nvars), sizeof(nvars));
+	if(!file || std::memcmp(magic, file_magic, sizeof(magic))!=0 || version!=file_version || nvars!=kNumVariables){
+		return false;
+	}
+	Table read_tables[kNumVariables];
+	for(Table& table : read_tables){
+		uint32_t nbins=0;
+		file.read(reinterpret_cast<char*>(&nbins), sizeof(nbins));
+		file.read(reinterpret_cast<char*>(&table.lo), sizeof(table.lo));
+		file.read(reinterpret_cast<char*>(&table.hi), sizeof(table.hi));
+		if(!file || nbins==0 || !(table.hi>table.lo)) return false;
+		table.inv_width = nbins/(double(table.hi)-table.lo);
+		table.logratio.resize(nbins);
+		file.read(reinterpret_cast<char*>(table.logratio.data()), nbins*sizeof(float));
+		if(!file) return false;
+	}
+	// only replace the current tables once the whole file has been read
+	for(int var=0; var<kNumVariables; ++var) tables[var] = std::move(read_tables[var]);
+	return true;
+}
+
+float SpallationLikelihood::Lookup(const Table& table, float x) const {
+	const int nbins = table.logratio.size();
+	const float pos = (x - table.lo)*table.inv_width;
+	if(!interpolate){
+		// n.b. written so that NaN goes to the first bin
+		const float clamped = pos>=0 ? std::min(pos, float(nbins-1)) : 0.f;
+		return table.logratio[int(clamped)];
+	}
+	// linear between bin centres, flat beyond the first and last centre
+	const float centre_pos = pos - 0.5f;
+	if(!(centre_pos>0)) return table.logratio.front();
+	if(centre_pos>=nbins-1) return table.logratio.back();
+	const int bin = centre_pos;
+	const float frac = centre_pos - bin;
+	return table.logratio[bin] + frac*(table.logratio[bin+1] - table.logratio[bin]);
+}
+
+double SpallationLikelihood::LogLikelihood(const float* values) const {
+	double sum=0;
+	for(int var=0; var<kNumVariables; ++var) sum += Lookup(tables[var], values[var]);
+	return sum;
+}
+
+void SpallationLikelihood::EvaluateRange(size_t begin, size_t end, const float* const* values, float* out) const {
+	if(interpolate){
+		for(size_t i=begin; i<end; ++i){
+			float sum=0;
+			for(int var=0; var<kNumVariables; ++var) sum += Lookup(tables[var], values[var][i]);
+			out[i] = sum;
+		}
+		return;
+	}
+	// column-wise: bin indices for a chunk of one variable, then the lookups
+	int bins[chunk_size];
+	for(size_t chunk=begin; chunk<end; chunk+=chunk_size){
+		const size_t n = std::min(chunk_size, end-chunk);
+		float* chunk_out = out + chunk;
+		std::fill(chunk_out, chunk_out+n, 0.f);
+		for(int var=0; var<kNumVariables; ++var){
+			const Table& table = tables[var];
+			const float* x = values[var] + chunk;
+			const float lo = table.lo, inv_width = table.inv_width;
+			const float maxpos = table.logratio.size()-1;
+			for(size_t i=0; i<n; ++i){
+				float pos = (x[i] - lo)*inv_width;
+				pos = pos>=0 ? pos : 0;   // also catches NaN
+				pos = pos<=maxpos ? pos : maxpos;
+				bins[i] = pos;
+			}
+			const float* logratio = table.logratio.data();
+			for(size_t i=0; i<n; ++i) chunk_out[i] += logratio[bins[i]];
+		}
+	}
+}
+
+void SpallationLikelihood::Evaluate(size_t n, const float* const* values, float* out, int nthreads) const {
+	if(!IsComplete()){
+		throw std::runtime_error("SpallationLikelihood::Evaluate - not all PDFs have been set");
+	}
+	// not worth starting threads for fewer than a few chunks each
+	nthreads = std::max(1, std::min<int>(nthreads, n/(4*chunk_size)));
+	if(nthreads==1){
+		EvaluateRange(0, n, values, out);
+		return;
+	}
+	std::vector<std::thread> workers;
+	const size_t per_thread = (n + nthreads - 1)/nthreads;
+	for(int t=0; t<nthreads; ++t){
+		const size_t begin = t*per_thread;
+		const size_t end = std::min(n, begin+per_thread);
+		if(begin>=end) break;
+		workers.emplace_back(&SpallationLikelihood::EvaluateRange, this, begin, end, values, out);
+	}
+	for(std::thread& worker : workers) worker.join();
+}
@@ -0,0 +1,63 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef SpallationLikelihood_H
+#define SpallationLikelihood_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+/**
+* \class SpallationLikelihood
+*
+* Spallation log-likelihood ratio for muon-relic pairings, from frozen lookup tables.
+* For each variable (dt, dlt, dll, muqismsk, resQ) the spallation and random PDFs, given as equal-width
+* bin contents, are normalised and reduced to a single table of log10(spall/rand), so that the
+* likelihood of a pairing is the sum of one lookup per variable.
+* Densities below a floor (including the negative bins of a pre-minus-post spallation PDF) are raised to
+* the floor, so every bin has a finite ratio. Optionally the PDFs are smoothed with a moving average
+* before taking the ratio, and lookups interpolate linearly between bin centres.
+* Values outside the table range take the value of the first or last bin.
+*
+* Tables can be written to, and read from, a small binary file, so PDFs built in one job can be reused.
+* Evaluate works on blocks of pairings held as one array per variable, with an optional number of threads.
+*/
+class SpallationLikelihood {
+	public:
+	enum Variable { kDt=0, kDlt, kDll, kMuqismsk, kResQ, kNumVariables };
+	static const char* VariableName(int var);
+
+	// these apply to PDFs set afterwards
+	void SetSmoothing(int half_width){ smooth_half_width = half_width; }  ///< moving average over 2*half_width+1 bins
+	void SetFloor(double density){ floor = density; }                    ///< minimum normalised bin content
+	void SetInterpolate(bool interp){ interpolate = interp; }             ///< also applies to tables read from file
+
+	// spall and rand hold nbins contents over [lo, hi), without under/overflow
+	void SetPDF(int var, double lo, double hi, int nbins, const double* spall, const double* rand);
+	bool IsComplete() const;   ///< whether all variables have a table
+
+	bool Write(const std::string& filename) const;
+	bool Read(const std::string& filename);
+
+	// values holds one value per variable, in the order of Variable
+	double LogLikelihood(const float* values) const;
+	// values[var] holds n values of each variable; results are written to out
+	void Evaluate(size_t n, const float* const* values, float* out, int nthreads=1) const;
+
+	private:
+	struct Table {
+		float lo = 0;
+		float hi = 0;
+		float inv_width = 0;
+		std::vector<float> logratio;
+	};
+	void EvaluateRange(size_t begin, size_t end, const float* const* values, float* out) const;
+	float Lookup(const Table& table, float x) const;
+
+	Table tables[kNumVariables];
+	int smooth_half_width = 0;
+	double floor = 1e-9;
+	bool interpolate = false;
+};
+
+#endif
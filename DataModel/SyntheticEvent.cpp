@@ -0,0 +1,298 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "SyntheticEvent.h"
+
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+#include <array>
+
+#include "fortran_routines.h"
+#include "skparmC.h"
+#include "geopmtC.h"
+#include "geotnkC.h"
+#include "sktqC.h"
+#include "tqrealroot.h"
+#include "PMTHitCluster.h"
+
+namespace {
+	constexpr double C_WATER = 21.5833;     // cm/ns
+	// approximate SK-IV ID layout: 51 rows x 150 columns on the barrel,
+	// and the remaining PMTs on a 70.7cm square grid on each end cap.
+	constexpr int NBARREL_Z = 51;
+	constexpr int NBARREL_PHI = 150;
+	constexpr int NBARREL = NBARREL_Z*NBARREL_PHI;
+	constexpr int NCAP = (MAXPM-NBARREL)/2;
+	constexpr float CAP_SPACING = 70.7;
+	constexpr int CAP_GRID = 48;            // > 2*RINTK/CAP_SPACING
+
+	struct CapLayout {
+		// maps a cap grid cell to its PMT slot (0..NCAP-1), or -1 if there is no PMT
+		std::array<std::array<int,CAP_GRID>,CAP_GRID> slot;
+		std::vector<std::array<float,2>> xy;
+		CapLayout(){
+			std::vector<std::pair<float,std::pair<int,int>>> cells;
+			for(int ix=0; ix<CAP_GRID; ++ix){
+				for(int iy=0; iy<CAP_GRID; ++iy){
+					slot[ix][iy] = -1;
+					float x = (ix-CAP_GRID/2+0.5)*CAP_SPACING;
+					float y = (iy-CAP_GRID/2+0.5)*CAP_SPACING;
+					float r = std::sqrt(x*x+y*y);
+					if(r<RINTK) cells.push_back({r,{ix,iy}});
+				}
+			}
+			// fill from the centre outwards; stable so the layout is deterministic
+			std::stable_sort(cells.begin(), cells.end(),
+			    [](const std::pair<float,std::pair<int,int>>& a, const std::pair<float,std::pair<int,int>>& b){ return a.first<b.first; });
+			for(int i=0; i<NCAP && i<int(cells.size()); ++i){
+				int ix = cells[i].second.first;
+				int iy = cells[i].second.second;
+				slot[ix][iy] = i;
+				xy.push_back({float((ix-CAP_GRID/2+0.5)*CAP_SPACING), float((iy-CAP_GRID/2+0.5)*CAP_SPACING)});
+			}
+		}
+	};
+	const CapLayout& GetCapLayout(){
+		static CapLayout layout;
+		return layout;
+	}
+}
+
+SyntheticEventGenerator::SyntheticEventGenerator(uint64_t seed) : engine(seed){}
+
+void SyntheticEventGenerator::SetSeed(uint64_t seed){
+	engine.seed(seed);
+}
+
+void SyntheticEventGenerator::FillGeometry(bool force){
+	if(!force){
+		// leave a real geometry (e.g. from geoset_) untouched
+		for(int i=0; i<MAXPM; ++i){
+			if(geopmt_.xyzpm[i][0]!=0 || geopmt_.xyzpm[i][1]!=0 || geopmt_.xyzpm[i][2]!=0) return;
+		}
+	}
+	const double dz = 2.*ZPINTK/NBARREL_Z;
+	const double dphi = 2.*M_PI/NBARREL_PHI;
+	for(int iz=0; iz<NBARREL_Z; ++iz){
+		for(int iphi=0; iphi<NBARREL_PHI; ++iphi){
+			int i = iz*NBARREL_PHI + iphi;
+			double phi = (iphi+0.5)*dphi;
+			geopmt_.xyzpm[i][0] = RINTK*std::cos(phi);
+			geopmt_.xyzpm[i][1] = RINTK*std::sin(phi);
+			geopmt_.xyzpm[i][2] = -ZPINTK + (iz+0.5)*dz;
+		}
+	}
+	const CapLayout& caps = GetCapLayout();
+	for(int side=0; side<2; ++side){
+		for(size_t slot=0; slot<caps.xy.size(); ++slot){
+			int i = NBARREL + side*NCAP + slot;
+			geopmt_.xyzpm[i][0] = caps.xy[slot][0];
+			geopmt_.xyzpm[i][1] = caps.xy[slot][1];
+			geopmt_.xyzpm[i][2] = (side==0) ? ZPINTK : -ZPINTK;
+		}
+	}
+}
+
+int SyntheticEventGenerator::NearestPMT(const float pos[3]){
+	if(std::abs(pos[2]) < ZPINTK-0.5){
+		// barrel
+		double phi = std::atan2(pos[1], pos[0]);
+		if(phi<0) phi += 2.*M_PI;
+		int iphi = int(phi/(2.*M_PI)*NBARREL_PHI) % NBARREL_PHI;
+		int iz = int((pos[2]+ZPINTK)/(2.*ZPINTK)*NBARREL_Z);
+		iz = std::max(0, std::min(NBARREL_Z-1, iz));
+		return iz*NBARREL_PHI + iphi + 1;
+	}
+	const CapLayout& caps = GetCapLayout();
+	int ix = int(std::floor(pos[0]/CAP_SPACING)) + CAP_GRID/2;
+	int iy = int(std::floor(pos[1]/CAP_SPACING)) + CAP_GRID/2;
+	ix = std::max(0, std::min(CAP_GRID-1, ix));
+	iy = std::max(0, std::min(CAP_GRID-1, iy));
+	int slot = caps.slot[ix][iy];
+	if(slot<0){
+		// corner cells without a PMT: use the nearest barrel PMT in the end row instead
+		float edge[3] = {pos[0], pos[1], float((pos[2]>0) ? ZPINTK-1 : -ZPINTK+1)};
+		return NearestPMT(edge);
+	}
+	int side = (pos[2]>0) ? 0 : 1;
+	return NBARREL + side*NCAP + slot + 1;
+}
+
+bool SyntheticEventGenerator::ProjectToWall(const float v[3], const float d[3], float wallpos[3], float& pathlength) const {
+	// intersection of the ray v + s*d with the ID cylinder, for v inside the tank
+	double s = 1e12;
+	double a = d[0]*d[0] + d[1]*d[1];
+	if(a>0){
+		double b = 2.*(v[0]*d[0] + v[1]*d[1]);
+		double c = v[0]*v[0] + v[1]*v[1] - RINTK*RINTK;
+		double disc = b*b - 4.*a*c;
+		if(disc>=0) s = (-b + std::sqrt(disc))/(2.*a);
+	}
+	if(d[2]>0) s = std::min(s, (ZPINTK-v[2])/d[2]);
+	if(d[2]<0) s = std::min(s, (-ZPINTK-v[2])/d[2]);
+	if(s<0 || s>=1e12) return false;
+	for(int i=0; i<3; ++i) wallpos[i] = v[i] + s*d[i];
+	pathlength = s;
+	return true;
+}
+
+void SyntheticEventGenerator::RandomVertex(float vertex[3], float margin){
+	std::uniform_real_distribution<double> uni(0.,1.);
+	double rmax = RINTK - margin;
+	double r = rmax*std::sqrt(uni(engine));
+	double phi = 2.*M_PI*uni(engine);
+	vertex[0] = r*std::cos(phi);
+	vertex[1] = r*std::sin(phi);
+	vertex[2] = (2.*uni(engine)-1.)*(ZPINTK-margin);
+}
+
+void SyntheticEventGenerator::AddFlash(const float vertex[3], const float* direction, float t0, int nphotons,
+                                       float time_jitter, std::vector<SyntheticHit>& hits){
+	// direction==nullptr gives an isotropic flash, otherwise a 42 degree Cherenkov cone
+	std::uniform_real_distribution<double> uni(0.,1.);
+	std::normal_distribution<double> jitter(0., time_jitter);
+	std::normal_distribution<double> charge(1., 0.7);
+	std::normal_distribution<double> spread(0., 0.12);   // angular smearing from scattering/multiple scattering
+	// photons on the same PMT are merged into a single hit
+	std::unordered_map<int,size_t> hit_on_cable;
+
+	// orthonormal basis around the particle direction
+	double u[3]={0,0,1}, e1[3], e2[3];
+	if(direction){
+		double norm = std::sqrt(direction[0]*direction[0]+direction[1]*direction[1]+direction[2]*direction[2]);
+		for(int i=0; i<3; ++i) u[i] = direction[i]/norm;
+	}
+	double ref[3] = {1,0,0};
+	if(std::abs(u[0])>0.9){ ref[0]=0; ref[1]=1; }
+	e1[0] = u[1]*ref[2]-u[2]*ref[1]; e1[1] = u[2]*ref[0]-u[0]*ref[2]; e1[2] = u[0]*ref[1]-u[1]*ref[0];
+	double n1 = std::sqrt(e1[0]*e1[0]+e1[1]*e1[1]+e1[2]*e1[2]);
+	for(int i=0; i<3; ++i) e1[i] /= n1;
+	e2[0] = u[1]*e1[2]-u[2]*e1[1]; e2[1] = u[2]*e1[0]-u[0]*e1[2]; e2[2] = u[0]*e1[1]-u[1]*e1[0];
+
+	const double cherenkov_angle = 42.*M_PI/180.;
+	for(int iphoton=0; iphoton<nphotons; ++iphoton){
+		double costh, phi = 2.*M_PI*uni(engine);
+		if(direction){
+			costh = std::cos(cherenkov_angle + spread(engine));
+		} else {
+			costh = 2.*uni(engine)-1.;
+		}
+		double sinth = std::sqrt(std::max(0.,1.-costh*costh));
+		float d[3];
+		for(int i=0; i<3; ++i){
+			d[i] = costh*u[i] + sinth*(std::cos(phi)*e1[i] + std::sin(phi)*e2[i]);
+		}
+		float wallpos[3];
+		float path;
+		if(!ProjectToWall(vertex, d, wallpos, path)) continue;
+		int cable = NearestPMT(wallpos);
+		float q = std::abs(charge(engine));
+		auto it = hit_on_cable.find(cable);
+		if(it!=hit_on_cable.end()){
+			hits[it->second].q += q;
+			continue;
+		}
+		float t = t0 + path/C_WATER + jitter(engine);
+		hit_on_cable.emplace(cable, hits.size());
+		hits.push_back({cable, t, q, 0x02, true});
+	}
+}
+
+void SyntheticEventGenerator::AddDarkNoise(const SyntheticEventConfig& config, std::vector<SyntheticHit>& hits){
+	std::uniform_real_distribution<double> uni(0.,1.);
+	std::normal_distribution<double> charge(1., 0.7);
+	double window = config.window_end - config.window_start;
+	double mean = config.dark_rate_hz*1e-9*window*MAXPM;
+	std::poisson_distribution<long> poisson(mean);
+	long ndark = poisson(engine);
+	for(long i=0; i<ndark; ++i){
+		int cable = 1 + int(uni(engine)*MAXPM);
+		if(cable>MAXPM) cable=MAXPM;
+		float t = config.window_start + uni(engine)*window;
+		hits.push_back({cable, t, float(std::abs(charge(engine))), 0x02, false});
+	}
+}
+
+void SyntheticEventGenerator::Generate(const SyntheticEventConfig& config, std::vector<SyntheticHit>& hits){
+	hits.clear();
+	AddDarkNoise(config, hits);
+
+	std::poisson_distribution<int> nring(config.ring_hits);
+	if(config.ring_hits>0){
+		AddFlash(config.vertex, config.direction, config.t0, nring(engine), config.time_jitter, hits);
+	}
+
+	std::exponential_distribution<double> capture_time(1./config.capture_tau);
+	std::poisson_distribution<int> ncapture_hits(config.capture_hits);
+	for(int icapture=0; icapture<config.ncaptures; ++icapture){
+		float vtx[3];
+		RandomVertex(vtx);
+		// keep the capture within the readout window
+		double t = config.t0 + capture_time(engine);
+		if(config.window_end>config.t0) t = config.t0 + std::fmod(t-config.t0, config.window_end-config.t0);
+		AddFlash(vtx, nullptr, t, ncapture_hits(engine), config.time_jitter, hits);
+	}
+
+	for(auto& hit : hits){
+		if(hit.t>=config.gate_low && hit.t<config.gate_high) hit.flags |= 0x01;
+	}
+	std::sort(hits.begin(), hits.end(), [](const SyntheticHit& a, const SyntheticHit& b){ return a.t<b.t; });
+}
+
+void SyntheticEventGenerator::GenerateCluster(int nhits, std::vector<SyntheticHit>& hits, float vertex_out[3]){
+	hits.clear();
+	RandomVertex(vertex_out);
+	// generate photons until we have the requested number of distinct PMTs
+	while(int(hits.size())<nhits){
+		AddFlash(vertex_out, nullptr, 0, nhits-hits.size(), 3., hits);
+	}
+	std::sort(hits.begin(), hits.end(), [](const SyntheticHit& a, const SyntheticHit& b){ return a.t<b.t; });
+}
+
+void SyntheticEventGenerator::FillCommons(const std::vector<SyntheticHit>& hits){
+	const size_t maxtqz = sizeof(sktqz_.tiskz)/sizeof(sktqz_.tiskz[0]);
+	size_t n = std::min(hits.size(), maxtqz);
+	sktqz_.nqiskz = n;
+	for(size_t i=0; i<n; ++i){
+		sktqz_.icabiz[i] = hits[i].cable;
+		sktqz_.tiskz[i] = hits[i].t;
+		sktqz_.qiskz[i] = hits[i].q;
+		sktqz_.ihtiflz[i] = hits[i].flags;
+	}
+
+	// skq_/skt_ are indexed by cable and only hold the first hit on each PMT within the 1.3us gate
+	std::vector<bool> seen(MAXPM+1, false);
+	int nqisk=0;
+	float qismsk=0;
+	for(size_t i=0; i<n; ++i){
+		const SyntheticHit& hit = hits[i];
+		if((hit.flags & 0x01)==0 || seen[hit.cable]) continue;
+		seen[hit.cable] = true;
+		skchnl_.ihcab[nqisk] = hit.cable;
+		skq_.qisk[hit.cable-1] = hit.q;
+		skt_.tisk[hit.cable-1] = hit.t;
+		qismsk += hit.q;
+		++nqisk;
+	}
+	skq_.nqisk = nqisk;
+	skq_.qismsk = qismsk;
+}
+
+void SyntheticEventGenerator::FillTQReal(const std::vector<SyntheticHit>& hits, TQReal& tqreal){
+	tqreal.cables.clear();
+	tqreal.T.clear();
+	tqreal.Q.clear();
+	for(auto&& hit : hits){
+		tqreal.cables.push_back(hit.cable | (hit.flags<<16));
+		tqreal.T.push_back(hit.t);
+		tqreal.Q.push_back(hit.q);
+	}
+	tqreal.nhits = hits.size();
+}
+
+void SyntheticEventGenerator::FillCluster(const std::vector<SyntheticHit>& hits, PMTHitCluster& cluster, float tmin, float tmax){
+	cluster.Clear();
+	for(auto&& hit : hits){
+		if(hit.t<tmin || hit.t>=tmax) continue;
+		cluster.Append(PMTHit(hit.t, hit.q, hit.cable));
+	}
+}
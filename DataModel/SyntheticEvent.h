@@ -0,0 +1,94 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef SyntheticEvent_H
+#define SyntheticEvent_H
+
+#include <vector>
+#include <random>
+#include <cstdint>
+
+class TQReal;
+class PMTHitCluster;
+
+/**
+* \struct SyntheticHit
+*
+* One raw hit, as it would appear in the sktqz_ common block.
+* flags follows ihtiflz: 0x01 = within the 1.3us trigger gate, 0x02 = in-gate hit.
+*/
+struct SyntheticHit {
+	int cable;
+	float t;
+	float q;
+	int flags;
+	bool signal;  // from a Cherenkov ring or capture cluster rather than dark noise
+};
+
+/**
+* \struct SyntheticEventConfig
+*
+* Parameters of a generated event. Times are in ns relative to the primary trigger,
+* distances in cm, following the SK conventions.
+*/
+struct SyntheticEventConfig {
+	// dark noise, uniform in time and over all PMTs
+	double dark_rate_hz = 4.5e3;       // per PMT
+	double window_start = -1000;       // readout window [ns]
+	double window_end = 35000;
+	// prompt Cherenkov ring from a point vertex
+	int ring_hits = 50;                // mean number of detected photons (~6 hits/MeV)
+	float vertex[3] = {0,0,0};
+	float direction[3] = {0,0,1};
+	float t0 = 0;
+	float time_jitter = 3;             // PMT timing resolution [ns]
+	// neutron-capture-like clusters: isotropic ~2.2MeV flashes at random vertices
+	int ncaptures = 1;
+	double capture_hits = 7;           // mean detected hits per capture
+	double capture_tau = 204000;       // capture time constant [ns]
+	double gate_low = -400;            // 1.3us gate, flags bit 0x01
+	double gate_high = 900;
+};
+
+/**
+* \class SyntheticEventGenerator
+*
+* Deterministic generator of SK-like hit patterns for benchmarking reconstruction kernels
+* without SKROOT input files or SKOFL detector tables. A given seed always produces the
+* same sequence of events. The generated hits can be used to fill the sktqz_/skq_/skt_/skchnl_
+* common blocks, a TQReal branch object, or a PMTHitCluster.
+*/
+class SyntheticEventGenerator {
+	public:
+	SyntheticEventGenerator(uint64_t seed=12345);
+	void SetSeed(uint64_t seed);
+
+	// fill geopmt_.xyzpm with an approximate SK-IV layout of MAXPM PMTs on the ID cylinder,
+	// unless it already holds a (real) geometry.
+	static void FillGeometry(bool force=false);
+	// cable of the PMT nearest to a point on the ID wall
+	static int NearestPMT(const float pos[3]);
+
+	// generate one event: hits are returned sorted by time
+	void Generate(const SyntheticEventConfig& config, std::vector<SyntheticHit>& hits);
+	// generate only a cluster of n hits from an isotropic flash at a random vertex, time-ordered
+	void GenerateCluster(int nhits, std::vector<SyntheticHit>& hits, float vertex_out[3]);
+
+	// populate common blocks: sktqz_ with all hits, and skq_/skt_/skchnl_ with the hits in the 1.3us gate
+	static void FillCommons(const std::vector<SyntheticHit>& hits);
+	// populate a TQReal with cable|flags<<16, T, Q as read from the TQREAL branch
+	static void FillTQReal(const std::vector<SyntheticHit>& hits, TQReal& tqreal);
+	// populate a PMTHitCluster, optionally only with hits within [tmin,tmax)
+	static void FillCluster(const std::vector<SyntheticHit>& hits, PMTHitCluster& cluster, float tmin=-1e9, float tmax=1e9);
+
+	std::mt19937_64& GetEngine(){ return engine; }
+
+	private:
+	void AddDarkNoise(const SyntheticEventConfig& config, std::vector<SyntheticHit>& hits);
+	void AddFlash(const float vertex[3], const float* direction, float t0, int nphotons,
+	              float time_jitter, std::vector<SyntheticHit>& hits);
+	bool ProjectToWall(const float vertex[3], const float dir[3], float wallpos[3], float& pathlength) const;
+	void RandomVertex(float vertex[3], float margin=200);
+
+	std::mt19937_64 engine;
+};
+
+#endif
@@ -0,0 +1,17 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "TickUnwrapper.h"
+
+int64_t TickUnwrapper::EventTicks(int32_t nevhwsk, int32_t it0){
+	// upper bits from nevhwsk, with its lower 17 bits masked as in tdiff_muon.
+	// it0 is signed, so take its bits as unsigned to not sign-extend into the upper 32 bits
+	int64_t ticks = int64_t(uint32_t(nevhwsk) & ~uint32_t(0x1FFFF)) << 15;
+	return ticks + uint32_t(it0);
+}
+
+int64_t TickUnwrapper::Unwrap(int64_t ticks){
+	if(ticks < last_raw_ticks - (kClockPeriod >> 1)){
+		rollover_offset += kClockPeriod;
+	}
+	last_raw_ticks = ticks;
+	return ticks + rollover_offset;
+}
@@ -0,0 +1,37 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef TickUnwrapper_H
+#define TickUnwrapper_H
+
+#include <cstdint>
+
+/**
+* \class TickUnwrapper
+*
+* Unwraps rollovers of the 47-bit SK event clock (1.92 ticks per ns, upper bits in skheadqb_.nevhwsk and the
+* lower in it0sk), so that event times in ticks keep increasing through a run. Give it the raw ticks of each event
+* in the order they were recorded: the clock only goes backwards on rollover, when it drops by almost 2^47 ticks,
+* so any drop of more than 2^46 adds one clock period to this and all later events. Smaller backward steps
+* (e.g. from subtrigger offsets) are not rollovers.
+*
+* Streams of events unwrapped separately (e.g. muons and relic candidates) agree as long as each starts from
+* the same point, e.g. Reset() with the raw ticks of the first event of the run.
+*/
+class TickUnwrapper {
+	public:
+	static constexpr int64_t kClockPeriod = int64_t(1) << 47;
+
+	// the event time in raw clock ticks, from skheadqb_.nevhwsk and it0sk (or a subtrigger's it0xsk)
+	static int64_t EventTicks(int32_t nevhwsk, int32_t it0);
+
+	// the ticks with rollovers since the last Reset added back
+	int64_t Unwrap(int64_t ticks);
+	// start again, as if the last event was at the given raw ticks
+	void Reset(int64_t last_ticks=0){ last_raw_ticks = last_ticks; rollover_offset = 0; }
+	int GetNRollovers() const { return rollover_offset / kClockPeriod; }
+
+	private:
+	int64_t last_raw_ticks = 0;
+	int64_t rollover_offset = 0;
+};
+
+#endif
@@ -0,0 +1,75 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "TimeOrderedCandStore.h"
+
+#include <algorithm>
+#include <utility>
+
+TimeOrderedCandStore::Index TimeOrderedCandStore::Push(ParticleCand&& cand, int64_t key){
+	if(!entries.empty() && key < entries.back().key){
+		++nclamped;
+		key = entries.back().key;
+	}
+	// payload slots are reused once their candidates have been removed
+	ParticleCandPayload& payload = cand;
+	uint32_t slot;
+	if(!free_payloads.empty()){
+		slot = free_payloads.back();
+		free_payloads.pop_back();
+		payloads[slot] = std::move(payload);
+	} else {
+		slot = payloads.size();
+		payloads.push_back(std::move(payload));
+	}
+	entries.push_back(Entry{key, true, slot, static_cast<const ParticleCandCore&>(cand)});
+	++nlive;
+	return End()-1;
+}
+
+bool TimeOrderedCandStore::IsLive(Index i) const {
+	return i>=first && i<End() && entries[i-first].live;
+}
+
+TimeOrderedCandStore::Index TimeOrderedCandStore::LowerBound(int64_t key) const {
+	auto it = std::lower_bound(entries.begin(), entries.end(), key,
+	                           [](const Entry& entry, int64_t k){ return entry.key < k; });
+	return first + (it - entries.begin());
+}
+
+void TimeOrderedCandStore::Release(Entry& entry){
+	entry.live = false;
+	free_payloads.push_back(entry.payload);
+	--nlive;
+}
+
+ParticleCand TimeOrderedCandStore::Take(Index i){
+	Entry& entry = entries.at(i-first);
+	ParticleCand cand(entry.core, std::move(payloads.at(entry.payload)));
+	Release(entry);
+	Trim();
+	return cand;
+}
+
+void TimeOrderedCandStore::Remove(Index i){
+	if(!IsLive(i)) return;
+	Release(entries[i-first]);
+	Trim();
+}
+
+void TimeOrderedCandStore::Trim(){
+	// drop removed entries from both ends, so that the oldest and newest entries held are live
+	while(!entries.empty() && !entries.front().live){
+		entries.pop_front();
+		++first;
+	}
+	while(!entries.empty() && !entries.back().live){
+		entries.pop_back();
+	}
+}
+
+void TimeOrderedCandStore::Clear(){
+	first = End();
+	entries.clear();
+	payloads.clear();
+	free_payloads.clear();
+	nlive=0;
+}
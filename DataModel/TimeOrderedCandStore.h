@@ -0,0 +1,70 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef TimeOrderedCandStore_H
+#define TimeOrderedCandStore_H
+
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "ParticleCand.h"
+
+/**
+* \class TimeOrderedCandStore
+*
+* Buffer of muon or relic candidates held during relic-muon matching, in order of arrival.
+* Each entry carries a time key (the 47-bit event clock with rollovers unwrapped), which must be
+* non-decreasing; keys that go backwards are clamped to the previous key, and counted, so that
+* LowerBound remains a binary search. Entries are addressed by an Index that is assigned on Push
+* and remains valid until that entry is removed, regardless of removals before it.
+* Removing the oldest or newest entry is O(1); entries removed from the middle are only marked,
+* and dropped once they reach either end. Removed entries are skipped by IsLive and not counted by Size.
+*
+* Only the ParticleCandCore of each candidate is kept in the time-ordered buffer; the payload
+* (lowe common block and match lists) lives in a separate slab whose slots are reused,
+* and is moved out with the core by Take when the candidate is written out.
+*/
+class TimeOrderedCandStore {
+	public:
+	typedef uint64_t Index;
+
+	Index Push(ParticleCand&& cand, int64_t key);
+
+	size_t Size() const { return nlive; }
+	bool Empty() const { return nlive==0; }
+	Index Begin() const { return first; }                   ///< index of the oldest entry held
+	Index End() const { return first + entries.size(); }    ///< one past the newest entry
+	bool IsLive(Index i) const;
+
+	ParticleCandCore& At(Index i){ return entries.at(i-first).core; }
+	ParticleCandPayload& Payload(Index i){ return payloads.at(entries.at(i-first).payload); }
+	ParticleCandCore& Back(){ return entries.back().core; }  ///< newest entry; always live if not Empty
+	ParticleCandPayload& BackPayload(){ return payloads.at(entries.back().payload); }
+	int64_t Key(Index i) const { return entries.at(i-first).key; }
+
+	Index LowerBound(int64_t key) const;                    ///< first entry with Key >= key, or End()
+	ParticleCand Take(Index i);                             ///< remove a live entry, returning the whole candidate
+	void Remove(Index i);
+	void Clear();
+
+	uint64_t GetNumClamped() const { return nclamped; }
+
+	private:
+	struct Entry {
+		int64_t key;
+		bool live;
+		uint32_t payload;   // slot in payloads
+		ParticleCandCore core;
+	};
+	void Release(Entry& entry);
+	void Trim();
+
+	std::deque<Entry> entries;
+	std::vector<ParticleCandPayload> payloads;
+	std::vector<uint32_t> free_payloads;
+	Index first=0;
+	size_t nlive=0;
+	uint64_t nclamped=0;
+};
+
+#endif
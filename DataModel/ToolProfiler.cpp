@@ -0,0 +1,379 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "ToolProfiler.h"
+#include "MTreeReader.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <cmath>
+#include <ctime>
+#include <chrono>
+#include <algorithm>
+#include <sys/resource.h>
+
+#include "TFile.h"
+#include "TTree.h"
+
+// ---------------------------------------------------------------
+// optional allocation counting
+// ---------------------------------------------------------------
+// Build with -DPROFILE_ALLOCS to replace the global operator new/delete with versions
+// that count calls and requested bytes. The counters are process-wide; ToolProfiler takes
+// the difference across each Tool call. The replacements must have default visibility
+// as libDataModel is built with -fvisibility=hidden.
+#ifdef PROFILE_ALLOCS
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+	std::atomic<uint64_t> g_alloc_count{0};
+	std::atomic<uint64_t> g_alloc_bytes{0};
+
+	inline void* counted_alloc(std::size_t size){
+		g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+		g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+		void* p = std::malloc(size ? size : 1);
+		if(p==nullptr) throw std::bad_alloc();
+		return p;
+	}
+}
+
+__attribute__((visibility("default"))) void* operator new(std::size_t size){ return counted_alloc(size); }
+__attribute__((visibility("default"))) void* operator new[](std::size_t size){ return counted_alloc(size); }
+__attribute__((visibility("default"))) void operator delete(void* p) noexcept { std::free(p); }
+__attribute__((visibility("default"))) void operator delete[](void* p) noexcept { std::free(p); }
+__attribute__((visibility("default"))) void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+__attribute__((visibility("default"))) void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+bool ToolProfiler::AllocsEnabled(){ return true; }
+static uint64_t AllocCount(){ return g_alloc_count.load(std::memory_order_relaxed); }
+static uint64_t AllocBytes(){ return g_alloc_bytes.load(std::memory_order_relaxed); }
+#else
+bool ToolProfiler::AllocsEnabled(){ return false; }
+static uint64_t AllocCount(){ return 0; }
+static uint64_t AllocBytes(){ return 0; }
+#endif
+
+// ---------------------------------------------------------------
+// ProfileHistogram
+// ---------------------------------------------------------------
+
+void ProfileHistogram::Fill(double seconds){
+	int bin = 0;
+	if(seconds>minval){
+		bin = int(std::log10(seconds/minval)*binsperdecade);
+		if(bin>=nbins) bin = nbins-1;
+	}
+	++counts[bin];
+	++entries;
+}
+
+double ProfileHistogram::Percentile(double fraction) const {
+	if(entries==0) return 0;
+	if(fraction<0) fraction=0;
+	if(fraction>1) fraction=1;
+	double target = fraction*entries;
+	uint64_t cumulative=0;
+	for(int bin=0; bin<nbins; ++bin){
+		if(counts[bin]==0) continue;
+		if(cumulative+counts[bin] >= target){
+			// interpolate (logarithmically) within the bin
+			double frac_in_bin = (target-cumulative)/counts[bin];
+			return minval*std::pow(10., (bin+frac_in_bin)/binsperdecade);
+		}
+		cumulative += counts[bin];
+	}
+	return minval*std::pow(10., nbins/binsperdecade);
+}
+
+// ---------------------------------------------------------------
+// ToolProfiler
+// ---------------------------------------------------------------
+
+ToolProfiler::ToolProfiler(std::string outfilein, int verbosityin) : outfile(outfilein), verbosity(verbosityin){
+	MTreeReader::profileIO = true;
+}
+
+double ToolProfiler::WallTime(){
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double ToolProfiler::CpuTime(){
+	// process CPU time, so that work done by helper threads spawned by a Tool is attributed to it
+	timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+uint64_t ToolProfiler::PeakRSS(){
+	rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage)!=0) return 0;
+	return uint64_t(usage.ru_maxrss)*1024;  // ru_maxrss is in kB on Linux
+}
+
+uint64_t ToolProfiler::GetEvents() const {
+	uint64_t events=0;
+	for(auto&& prof : profiles) events = std::max(events, prof.calls);
+	return events;
+}
+
+double ToolProfiler::GetExecuteWallTime() const {
+	double total_wall=0;
+	for(auto&& prof : profiles) total_wall += prof.exec_wall;
+	return total_wall;
+}
+
+size_t ToolProfiler::Register(std::string toolname){
+	// disambiguate multiple instances of the same Tool class
+	int ninstances = ++instancecounts[toolname];
+	if(ninstances>1) toolname += "_"+std::to_string(ninstances);
+	profiles.emplace_back();
+	profiles.back().name = toolname;
+	return profiles.size()-1;
+}
+
+void ToolProfiler::SetConfigFile(size_t index, std::string configfile){
+	profiles.at(index).configfile = configfile;
+}
+
+ToolProfiler::Snapshot ToolProfiler::Start() const {
+	Snapshot snap;
+	snap.alloc_count = AllocCount();
+	snap.alloc_bytes = AllocBytes();
+	snap.io_entries = MTreeReader::profiledEntries;
+	snap.io_bytes = MTreeReader::profiledBytes;
+	snap.io_seconds = MTreeReader::profiledSeconds;
+	snap.cpu = CpuTime();
+	snap.wall = WallTime();  // last, so as not to include our own overhead
+	return snap;
+}
+
+void ToolProfiler::StopInitialise(size_t index, const Snapshot& start){
+	double wall = WallTime();
+	double cpu = CpuTime();
+	ToolProfile& prof = profiles.at(index);
+	prof.init_wall += wall - start.wall;
+	prof.init_cpu += cpu - start.cpu;
+}
+
+void ToolProfiler::StopExecute(size_t index, const Snapshot& start, bool ok){
+	double wall = WallTime() - start.wall;
+	double cpu = CpuTime() - start.cpu;
+	ToolProfile& prof = profiles.at(index);
+	++prof.calls;
+	if(!ok) ++prof.failures;
+	prof.exec_wall += wall;
+	prof.exec_cpu += cpu;
+	if(prof.exec_wall_min<0 || wall<prof.exec_wall_min) prof.exec_wall_min = wall;
+	if(wall>prof.exec_wall_max) prof.exec_wall_max = wall;
+	prof.wall_hist.Fill(wall);
+	prof.cpu_hist.Fill(cpu);
+	prof.alloc_count += AllocCount() - start.alloc_count;
+	prof.alloc_bytes += AllocBytes() - start.alloc_bytes;
+	prof.io_entries += MTreeReader::profiledEntries - start.io_entries;
+	prof.io_bytes += MTreeReader::profiledBytes - start.io_bytes;
+	prof.io_seconds += MTreeReader::profiledSeconds - start.io_seconds;
+}
+
+void ToolProfiler::StopFinalise(size_t index, const Snapshot& start){
+	double wall = WallTime();
+	double cpu = CpuTime();
+	ToolProfile& prof = profiles.at(index);
+	prof.final_wall += wall - start.wall;
+	prof.final_cpu += cpu - start.cpu;
+	++nfinalised;
+	if(nfinalised==profiles.size()) Finalise();
+}
+
+void ToolProfiler::Finalise(){
+	if(done) return;
+	done=true;
+	MTreeReader::profileIO = false;
+	if(verbosity>0) PrintSummary();
+	if(outfile.empty()) return;
+	bool ok;
+	if(outfile.length()>5 && outfile.substr(outfile.length()-5)==".root"){
+		ok = WriteROOT(outfile);
+	} else {
+		ok = WriteJSON(outfile);
+	}
+	if(!ok){
+		std::cerr<<"ToolProfiler::Finalise Error writing profile to "<<outfile<<std::endl;
+	} else if(verbosity>0){
+		std::cout<<"ToolProfiler: wrote profile to "<<outfile<<std::endl;
+	}
+}
+
+void ToolProfiler::PrintSummary() const {
+	double total_wall = GetExecuteWallTime();
+	uint64_t events = GetEvents();
+	if(total_wall==0) total_wall=1;
+
+	// use a stringstream so we don't interleave with other output
+	std::stringstream ss;
+	ss<<"\n=============================== ToolChain profile ===============================\n"
+	  <<std::left<<std::setw(32)<<"Tool"<<std::right
+	  <<std::setw(10)<<"calls"
+	  <<std::setw(11)<<"wall [s]"
+	  <<std::setw(8)<<"wall %"
+	  <<std::setw(11)<<"cpu [s]"
+	  <<std::setw(11)<<"p50 [ms]"
+	  <<std::setw(11)<<"p90 [ms]"
+	  <<std::setw(11)<<"p99 [ms]"
+	  <<std::setw(11)<<"max [ms]"
+	  <<std::setw(12)<<"io [MB]"
+	  <<std::setw(11)<<"io [s]";
+	if(AllocsEnabled()) ss<<std::setw(12)<<"allocs"<<std::setw(12)<<"alloc [MB]";
+	ss<<"\n";
+	ss<<std::fixed;
+	for(auto&& prof : profiles){
+		std::string name = prof.name;
+		if(name.length()>31) name = name.substr(0,28)+"...";
+		ss<<std::left<<std::setw(32)<<name<<std::right
+		  <<std::setw(10)<<prof.calls
+		  <<std::setprecision(3)
+		  <<std::setw(11)<<prof.exec_wall
+		  <<std::setprecision(1)
+		  <<std::setw(8)<<100.*prof.exec_wall/total_wall
+		  <<std::setprecision(3)
+		  <<std::setw(11)<<prof.exec_cpu
+		  <<std::setw(11)<<1e3*prof.wall_hist.Percentile(0.5)
+		  <<std::setw(11)<<1e3*prof.wall_hist.Percentile(0.9)
+		  <<std::setw(11)<<1e3*prof.wall_hist.Percentile(0.99)
+		  <<std::setw(11)<<1e3*prof.exec_wall_max
+		  <<std::setw(12)<<prof.io_bytes/1.e6
+		  <<std::setw(11)<<prof.io_seconds;
+		if(AllocsEnabled()) ss<<std::setw(12)<<prof.alloc_count<<std::setw(12)<<prof.alloc_bytes/1.e6;
+		ss<<"\n";
+	}
+	ss<<"Initialise / Finalise wall times [s]:\n";
+	for(auto&& prof : profiles){
+		ss<<"  "<<std::left<<std::setw(32)<<prof.name<<std::right<<std::setprecision(3)
+		  <<std::setw(11)<<prof.init_wall<<std::setw(11)<<prof.final_wall<<"\n";
+	}
+	ss<<std::setprecision(1)<<"Processed "<<events<<" events in "<<total_wall<<" s of Execute time: "
+	  <<events/total_wall<<" events/s, peak RSS "<<PeakRSS()/1.e6<<" MB\n";
+	ss<<"=================================================================================\n";
+	std::cout<<ss.str()<<std::flush;
+}
+
+bool ToolProfiler::WriteJSON(std::string filename) const {
+	std::ofstream out(filename.c_str());
+	if(!out.is_open()) return false;
+	out<<std::setprecision(9);
+	double total_wall = GetExecuteWallTime();
+	out<<"{\n  \"allocs_enabled\": "<<(AllocsEnabled() ? "true" : "false")<<",\n"
+	   <<"  \"events\": "<<GetEvents()<<",\n"
+	   <<"  \"exec_wall_total\": "<<total_wall<<",\n"
+	   <<"  \"events_per_second\": "<<((total_wall>0) ? GetEvents()/total_wall : 0)<<",\n"
+	   <<"  \"peak_rss_bytes\": "<<PeakRSS()<<",\n"
+	   <<"  \"tools\": [\n";
+	for(size_t i=0; i<profiles.size(); ++i){
+		const ToolProfile& prof = profiles.at(i);
+		out<<"    {\n"
+		   <<"      \"name\": \""<<prof.name<<"\",\n"
+		   <<"      \"configfile\": \""<<prof.configfile<<"\",\n"
+		   <<"      \"init_wall\": "<<prof.init_wall<<",\n"
+		   <<"      \"init_cpu\": "<<prof.init_cpu<<",\n"
+		   <<"      \"final_wall\": "<<prof.final_wall<<",\n"
+		   <<"      \"final_cpu\": "<<prof.final_cpu<<",\n"
+		   <<"      \"calls\": "<<prof.calls<<",\n"
+		   <<"      \"failures\": "<<prof.failures<<",\n"
+		   <<"      \"exec_wall\": "<<prof.exec_wall<<",\n"
+		   <<"      \"exec_cpu\": "<<prof.exec_cpu<<",\n"
+		   <<"      \"exec_wall_min\": "<<(prof.exec_wall_min<0 ? 0 : prof.exec_wall_min)<<",\n"
+		   <<"      \"exec_wall_max\": "<<prof.exec_wall_max<<",\n"
+		   <<"      \"exec_wall_p50\": "<<prof.wall_hist.Percentile(0.5)<<",\n"
+		   <<"      \"exec_wall_p90\": "<<prof.wall_hist.Percentile(0.9)<<",\n"
+		   <<"      \"exec_wall_p99\": "<<prof.wall_hist.Percentile(0.99)<<",\n"
+		   <<"      \"exec_cpu_p50\": "<<prof.cpu_hist.Percentile(0.5)<<",\n"
+		   <<"      \"exec_cpu_p90\": "<<prof.cpu_hist.Percentile(0.9)<<",\n"
+		   <<"      \"exec_cpu_p99\": "<<prof.cpu_hist.Percentile(0.99)<<",\n"
+		   <<"      \"alloc_count\": "<<prof.alloc_count<<",\n"
+		   <<"      \"alloc_bytes\": "<<prof.alloc_bytes<<",\n"
+		   <<"      \"io_entries\": "<<prof.io_entries<<",\n"
+		   <<"      \"io_bytes\": "<<prof.io_bytes<<",\n"
+		   <<"      \"io_seconds\": "<<prof.io_seconds<<"\n"
+		   <<"    }"<<((i+1<profiles.size()) ? "," : "")<<"\n";
+	}
+	out<<"  ]\n}\n";
+	return out.good();
+}
+
+bool ToolProfiler::WriteROOT(std::string filename) const {
+	TFile* fout = TFile::Open(filename.c_str(), "RECREATE");
+	if(fout==nullptr || fout->IsZombie()){
+		if(fout) delete fout;
+		return false;
+	}
+	TTree* tree = new TTree("toolProfile", "Per-Tool ToolChain profile");
+	std::string name, configfile;
+	ULong64_t calls, failures, alloc_count, alloc_bytes, io_entries, io_bytes;
+	double init_wall, final_wall, exec_wall, exec_cpu, wall_min, wall_max, io_seconds;
+	double wall_p50, wall_p90, wall_p99, cpu_p50, cpu_p90, cpu_p99;
+	tree->Branch("name", &name);
+	tree->Branch("configfile", &configfile);
+	tree->Branch("calls", &calls);
+	tree->Branch("failures", &failures);
+	tree->Branch("init_wall", &init_wall);
+	tree->Branch("final_wall", &final_wall);
+	tree->Branch("exec_wall", &exec_wall);
+	tree->Branch("exec_cpu", &exec_cpu);
+	tree->Branch("exec_wall_min", &wall_min);
+	tree->Branch("exec_wall_max", &wall_max);
+	tree->Branch("exec_wall_p50", &wall_p50);
+	tree->Branch("exec_wall_p90", &wall_p90);
+	tree->Branch("exec_wall_p99", &wall_p99);
+	tree->Branch("exec_cpu_p50", &cpu_p50);
+	tree->Branch("exec_cpu_p90", &cpu_p90);
+	tree->Branch("exec_cpu_p99", &cpu_p99);
+	tree->Branch("alloc_count", &alloc_count);
+	tree->Branch("alloc_bytes", &alloc_bytes);
+	tree->Branch("io_entries", &io_entries);
+	tree->Branch("io_bytes", &io_bytes);
+	tree->Branch("io_seconds", &io_seconds);
+	for(auto&& prof : profiles){
+		name = prof.name;
+		configfile = prof.configfile;
+		calls = prof.calls;
+		failures = prof.failures;
+		init_wall = prof.init_wall;
+		final_wall = prof.final_wall;
+		exec_wall = prof.exec_wall;
+		exec_cpu = prof.exec_cpu;
+		wall_min = (prof.exec_wall_min<0) ? 0 : prof.exec_wall_min;
+		wall_max = prof.exec_wall_max;
+		wall_p50 = prof.wall_hist.Percentile(0.5);
+		wall_p90 = prof.wall_hist.Percentile(0.9);
+		wall_p99 = prof.wall_hist.Percentile(0.99);
+		cpu_p50 = prof.cpu_hist.Percentile(0.5);
+		cpu_p90 = prof.cpu_hist.Percentile(0.9);
+		cpu_p99 = prof.cpu_hist.Percentile(0.99);
+		alloc_count = prof.alloc_count;
+		alloc_bytes = prof.alloc_bytes;
+		io_entries = prof.io_entries;
+		io_bytes = prof.io_bytes;
+		io_seconds = prof.io_seconds;
+		tree->Fill();
+	}
+	tree->Write();
+
+	// ToolChain totals
+	TTree* summary = new TTree("toolChainSummary", "ToolChain throughput");
+	ULong64_t events = GetEvents();
+	ULong64_t peak_rss = PeakRSS();
+	double total_wall = GetExecuteWallTime();
+	double events_per_second = (total_wall>0) ? events/total_wall : 0;
+	summary->Branch("events", &events);
+	summary->Branch("exec_wall_total", &total_wall);
+	summary->Branch("events_per_second", &events_per_second);
+	summary->Branch("peak_rss_bytes", &peak_rss);
+	summary->Fill();
+	summary->Write();
+
+	fout->Close();
+	delete fout;
+	return true;
+}
@@ -0,0 +1,131 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef ToolProfiler_H
+#define ToolProfiler_H
+
+#include <string>
+#include <vector>
+#include <array>
+#include <map>
+#include <cstdint>
+
+/**
+* \class ProfileHistogram
+*
+* Fixed-size log-binned histogram of durations, used to obtain approximate percentiles
+* of per-call timings without retaining every sample. Bins span 100ns to 1000s with
+* 20 bins per decade (~12% resolution); values outside the range go into the edge bins.
+*/
+class ProfileHistogram {
+	public:
+	static constexpr int nbins = 200;
+	static constexpr double minval = 1e-7;
+	static constexpr double binsperdecade = 20.;
+
+	void Fill(double seconds);
+	double Percentile(double fraction) const;  // fraction in [0,1]
+	uint64_t GetEntries() const { return entries; }
+
+	private:
+	std::array<uint64_t, nbins> counts{};
+	uint64_t entries=0;
+};
+
+/**
+* \struct ToolProfile
+*
+* Accumulated statistics for one Tool instance in the ToolChain.
+*/
+struct ToolProfile {
+	std::string name;
+	std::string configfile;
+
+	// Initialise / Finalise (one call each)
+	double init_wall=0;
+	double init_cpu=0;
+	double final_wall=0;
+	double final_cpu=0;
+
+	// Execute
+	uint64_t calls=0;
+	uint64_t failures=0;       // number of Execute calls that returned false
+	double exec_wall=0;        // totals, seconds
+	double exec_cpu=0;
+	double exec_wall_min=-1;
+	double exec_wall_max=0;
+	ProfileHistogram wall_hist;
+	ProfileHistogram cpu_hist;
+
+	// memory allocations (only filled when built with -DPROFILE_ALLOCS)
+	uint64_t alloc_count=0;
+	uint64_t alloc_bytes=0;
+
+	// MTreeReader::GetEntry activity performed within this Tool
+	uint64_t io_entries=0;
+	uint64_t io_bytes=0;       // uncompressed bytes returned by TTree::GetEntry
+	double io_seconds=0;       // time in TTree::GetEntry, dominated by basket read+decompression
+};
+
+/**
+* \class ToolProfiler
+*
+* Records per-Tool timing, allocation and I/O statistics for the ToolChain.
+* Tools are wrapped by a ProfiledTool proxy in the Factory when the ToolChainConfig contains
+* `profile_tools 1`, so there is no overhead at all when profiling is disabled.
+* When the last wrapped Tool has been Finalised a summary table is printed and,
+* if `profile_output` is given, written to file: as a TTree if the filename
+* ends in '.root', otherwise as JSON.
+*/
+class ToolProfiler {
+	public:
+
+	// snapshot of counters taken at the start of a profiled call
+	struct Snapshot {
+		double wall=0;
+		double cpu=0;
+		uint64_t alloc_count=0;
+		uint64_t alloc_bytes=0;
+		uint64_t io_entries=0;
+		uint64_t io_bytes=0;
+		double io_seconds=0;
+	};
+
+	ToolProfiler(std::string outfilein="", int verbosityin=1);
+
+	// returns an index used to refer to this Tool in subsequent calls
+	size_t Register(std::string toolname);
+	void SetConfigFile(size_t index, std::string configfile);
+
+	Snapshot Start() const;
+	void StopInitialise(size_t index, const Snapshot& start);
+	void StopExecute(size_t index, const Snapshot& start, bool ok);
+	void StopFinalise(size_t index, const Snapshot& start);
+
+	// print summary and write output file. Called automatically once all Tools are finalised.
+	void Finalise();
+	void PrintSummary() const;
+	bool WriteJSON(std::string filename) const;
+	bool WriteROOT(std::string filename) const;
+
+	const std::vector<ToolProfile>& GetProfiles() const { return profiles; }
+
+	// number of ToolChain Execute loops, i.e. the most Execute calls made to any Tool
+	uint64_t GetEvents() const;
+	// summed Execute wall time of all Tools
+	double GetExecuteWallTime() const;
+
+	static double WallTime();
+	static double CpuTime();
+	static bool AllocsEnabled();
+	static uint64_t PeakRSS();   // bytes
+
+	private:
+	std::vector<ToolProfile> profiles;
+	std::map<std::string, int> instancecounts;
+	std::string outfile;
+	int verbosity=1;
+	size_t nfinalised=0;
+	bool done=false;
+
+};
+
+#endif
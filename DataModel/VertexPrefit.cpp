@@ -0,0 +1,339 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "VertexPrefit.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	const float kCWater = 21.5833;          // speed of light in water [cm/ns]
+	const float kInvCWater = 1./kCWater;
+	// spread of hit times beyond the light crossing time of the detector that the prompt window allows for
+	const float kPromptMargin = 50;         // ns
+	const float kTimeBin = 10;              // ns, to find the prompt window
+	// widths of the time residual window for the coarse grid, and for the final fit;
+	// the refinements narrow it in proportion to their spacing
+	const float kCoarseWidth = 30;          // ns
+	const float kFineWidth = 10;
+	const float kFinestSpacing = 25;        // cm
+	const int kMaxIterations = 10;
+	const float kConverged = 0.5;           // cm
+
+	// solve the 4x4 system a.x = b by Gaussian elimination with partial pivoting; b becomes x
+	bool Solve4(double a[4][4], double b[4]){
+		for(int col=0; col<4; ++col){
+			int pivot = col;
+			for(int row=col+1; row<4; ++row) if(std::fabs(a[row][col]) > std::fabs(a[pivot][col])) pivot = row;
+			if(!(std::fabs(a[pivot][col]) > 0)) return false;
+			if(pivot!=col){
+				for(int k=0; k<4; ++k) std::swap(a[col][k], a[pivot][k]);
+				std::swap(b[col], b[pivot]);
+			}
+			for(int row=col+1; row<4; ++row){
+				const double f = a[row][col]/a[col][col];
+				for(int k=col; k<4; ++k) a[row][k] -= f*a[col][k];
+				b[row] -= f*b[col];
+			}
+		}
+		for(int row=3; row>=0; --row){
+			for(int k=row+1; k<4; ++k) b[row] -= a[row][k]*b[k];
+			b[row] /= a[row][row];
+		}
+		return true;
+	}
+}
+
+VertexPrefit::VertexPrefit(int npmts, const float* xyzpm){
+	pmt_x.resize(npmts);
+	pmt_y.resize(npmts);
+	pmt_z.resize(npmts);
+	for(int i=0; i<npmts; ++i){
+		pmt_x[i] = xyzpm[3*i];
+		pmt_y[i] = xyzpm[3*i+1];
+		pmt_z[i] = xyzpm[3*i+2];
+		radius = std::max(radius, std::sqrt(pmt_x[i]*pmt_x[i]+pmt_y[i]*pmt_y[i]));
+		half_height = std::max(half_height, std::fabs(pmt_z[i]));
+	}
+	max_tof = 2*std::sqrt(radius*radius+half_height*half_height)*kInvCWater;
+	BuildGrid();
+}
+
+void VertexPrefit::BuildGrid(){
+	grid_x.clear();
+	grid_y.clear();
+	grid_z.clear();
+	const int nr = int(radius/grid_spacing);
+	const int nz = int(half_height/grid_spacing);
+	for(int ix=-nr; ix<=nr; ++ix){
+		for(int iy=-nr; iy<=nr; ++iy){
+			const float x = ix*grid_spacing;
+			const float y = iy*grid_spacing;
+			if(x*x+y*y > radius*radius) continue;
+			for(int iz=-nz; iz<=nz; ++iz){
+				grid_x.push_back(x);
+				grid_y.push_back(y);
+				grid_z.push_back(iz*grid_spacing);
+			}
+		}
+	}
+}
+
+bool VertexPrefit::Inside(float x, float y, float z) const {
+	return x*x+y*y <= radius*radius && std::fabs(z) <= half_height;
+}
+
+void VertexPrefit::Residuals(size_t n, const float* x, const float* y, const float* z, const float* t,
+                             const float* vertex, float* residuals){
+	const float vx = vertex[0];
+	const float vy = vertex[1];
+	const float vz = vertex[2];
+	for(size_t i=0; i<n; ++i){
+		const float dx = x[i]-vx;
+		const float dy = y[i]-vy;
+		const float dz = z[i]-vz;
+		residuals[i] = t[i] - std::sqrt(dx*dx+dy*dy+dz*dz)*kInvCWater;
+	}
+}
+
+int VertexPrefit::MaxInWindow(const float* residuals, size_t n, float lo, float hi, float width,
+                              float& window_start, std::vector<int>& histogram){
+	// histogram the residuals in bins of a quarter of the window, and slide a four-bin window over them.
+	// All residuals lie in [lo, hi], which spans the hit times less any time of flight in the detector.
+	const float inv_bin_width = 4/width;
+	const int nbins = int((hi-lo)*inv_bin_width) + 1;
+	histogram.assign(nbins+4, 0);
+	for(size_t i=0; i<n; ++i) ++histogram[int((residuals[i]-lo)*inv_bin_width)];
+	int count = histogram[0]+histogram[1]+histogram[2]+histogram[3];
+	int best = count;
+	int best_bin = 0;
+	for(int bin=1; bin<nbins; ++bin){
+		count += histogram[bin+3] - histogram[bin-1];
+		if(count>best){
+			best = count;
+			best_bin = bin;
+		}
+	}
+	window_start = lo + best_bin/inv_bin_width;
+	return best;
+}
+
+int VertexPrefit::RefineSearch(const Hits& hits, float* centre, float spacing, int halfsteps, float width,
+                               std::vector<float>& residuals, std::vector<int>& histogram) const {
+	const size_t n = hits.size();
+	float best_point[4] = {centre[0], centre[1], centre[2], centre[3]};
+	int best = -1;
+	float point[3];
+	float window_start = 0;
+	for(int ix=-halfsteps; ix<=halfsteps; ++ix){
+		for(int iy=-halfsteps; iy<=halfsteps; ++iy){
+			for(int iz=-halfsteps; iz<=halfsteps; ++iz){
+				point[0] = centre[0] + ix*spacing;
+				point[1] = centre[1] + iy*spacing;
+				point[2] = centre[2] + iz*spacing;
+				if(!Inside(point[0], point[1], point[2])) continue;
+				Residuals(n, hits.x.data(), hits.y.data(), hits.z.data(), hits.t.data(), point, residuals.data());
+				const int count = MaxInWindow(residuals.data(), n, hits.residual_lo, hits.residual_hi, width,
+				                              window_start, histogram);
+				// on a tie keep the point nearer the centre
+				if(count>best || (count==best && ix*ix+iy*iy+iz*iz==0)){
+					best = count;
+					std::copy(point, point+3, best_point);
+					best_point[3] = window_start + width/2;
+				}
+			}
+		}
+	}
+	std::copy(best_point, best_point+4, centre);
+	return best;
+}
+
+int VertexPrefit::LevenbergMarquardt(const Hits& hits, float* vertex, float width, std::vector<float>& residuals) const {
+	// minimise the sum of (t_i - t0 - |x_i - v|/c)^2 over the hits within width/2 of t0
+	const size_t n = hits.size();
+	Residuals(n, hits.x.data(), hits.y.data(), hits.z.data(), hits.t.data(), vertex, residuals.data());
+	std::vector<size_t> inliers;
+	for(size_t i=0; i<n; ++i) if(std::fabs(residuals[i]-vertex[3]) <= width/2) inliers.push_back(i);
+	if(inliers.size()<5) return 0;
+
+	auto sum_squares = [&](const double* v){
+		double sum = 0;
+		for(size_t i : inliers){
+			const double dx = hits.x[i]-v[0], dy = hits.y[i]-v[1], dz = hits.z[i]-v[2];
+			const double f = hits.t[i] - v[3] - std::sqrt(dx*dx+dy*dy+dz*dz)*kInvCWater;
+			sum += f*f;
+		}
+		return sum;
+	};
+
+	double v[4] = {vertex[0], vertex[1], vertex[2], vertex[3]};
+	double lambda = 1e-3;
+	double chi2 = sum_squares(v);
+	int iterations = 0;
+	for(; iterations<kMaxIterations; ++iterations){
+		double jtj[4][4] = {};
+		double jtf[4] = {};
+		for(size_t i : inliers){
+			const double dx = hits.x[i]-v[0], dy = hits.y[i]-v[1], dz = hits.z[i]-v[2];
+			const double d = std::max(std::sqrt(dx*dx+dy*dy+dz*dz), 1.);
+			const double f = hits.t[i] - v[3] - d*kInvCWater;
+			const double jac[4] = {dx/(d*kCWater), dy/(d*kCWater), dz/(d*kCWater), -1.};
+			for(int a=0; a<4; ++a){
+				jtf[a] += jac[a]*f;
+				for(int b=a; b<4; ++b) jtj[a][b] += jac[a]*jac[b];
+			}
+		}
+		for(int a=0; a<4; ++a) for(int b=0; b<a; ++b) jtj[a][b] = jtj[b][a];
+
+		// try damped steps until one lowers the sum of squares
+		bool accepted = false;
+		double step[4];
+		while(lambda<1e6){
+			double a[4][4];
+			for(int r=0; r<4; ++r){
+				for(int c=0; c<4; ++c) a[r][c] = jtj[r][c];
+				a[r][r] *= 1.+lambda;
+				step[r] = -jtf[r];
+			}
+			if(!Solve4(a, step)) break;
+			double trial[4];
+			for(int r=0; r<4; ++r) trial[r] = v[r]+step[r];
+			const double trial_chi2 = sum_squares(trial);
+			if(trial_chi2<chi2){
+				std::copy(trial, trial+4, v);
+				chi2 = trial_chi2;
+				lambda = std::max(lambda/10, 1e-7);
+				accepted = true;
+				break;
+			}
+			lambda *= 10;
+		}
+		if(!accepted) break;
+		if(std::sqrt(step[0]*step[0]+step[1]*step[1]+step[2]*step[2]) < kConverged){
+			++iterations;
+			break;
+		}
+	}
+	for(int r=0; r<4; ++r) vertex[r] = v[r];
+
+	// keep the vertex in the detector
+	const float rho = std::sqrt(vertex[0]*vertex[0]+vertex[1]*vertex[1]);
+	if(rho>radius){
+		vertex[0] *= radius/rho;
+		vertex[1] *= radius/rho;
+	}
+	vertex[2] = std::max(-half_height, std::min(half_height, vertex[2]));
+	return iterations;
+}
+
+void VertexPrefit::Thin(const std::vector<int>& selection, size_t n, const int* cables, const float* times, Hits& hits) const {
+	n = std::min(n, selection.size());
+	hits.x.resize(n);
+	hits.y.resize(n);
+	hits.z.resize(n);
+	hits.t.resize(n);
+	for(size_t i=0; i<n; ++i){
+		const int hit = selection[(i*selection.size())/n];
+		const int pmt = cables[hit]-1;
+		hits.x[i] = pmt_x[pmt];
+		hits.y[i] = pmt_y[pmt];
+		hits.z[i] = pmt_z[pmt];
+		hits.t[i] = times[hit];
+	}
+	const auto range = std::minmax_element(hits.t.begin(), hits.t.end());
+	hits.residual_lo = *range.first - max_tof;
+	hits.residual_hi = *range.second;
+}
+
+VertexPrefit::Result VertexPrefit::Fit(int nhits, const int* cables, const float* times) const {
+	Result res;
+	const int npmts = pmt_x.size();
+
+	// hits with known PMTs
+	std::vector<int> valid;
+	valid.reserve(nhits);
+	for(int i=0; i<nhits; ++i) if(cables[i]>=1 && cables[i]<=npmts) valid.push_back(i);
+	if(valid.size()<5) return res;
+
+	// the densest window the light of one vertex could span: the light crossing time of the detector plus a margin,
+	// found on a histogram of hit times to avoid sorting them
+	float tmin = times[valid[0]], tmax = times[valid[0]];
+	for(int hit : valid){
+		tmin = std::min(tmin, times[hit]);
+		tmax = std::max(tmax, times[hit]);
+	}
+	const int window_bins = int((max_tof + kPromptMargin)/kTimeBin) + 1;
+	std::vector<int> histogram(int((tmax-tmin)/kTimeBin) + 1 + window_bins, 0);
+	for(int hit : valid) ++histogram[int((times[hit]-tmin)/kTimeBin)];
+	int count = 0;
+	for(int bin=0; bin<window_bins; ++bin) count += histogram[bin];
+	int best_count = count;
+	int best_bin = 0;
+	for(size_t bin=1; bin+window_bins<=histogram.size(); ++bin){
+		count += histogram[bin+window_bins-1] - histogram[bin-1];
+		if(count>best_count){
+			best_count = count;
+			best_bin = bin;
+		}
+	}
+	std::vector<int> prompt;
+	prompt.reserve(best_count);
+	for(int hit : valid){
+		const int bin = int((times[hit]-tmin)/kTimeBin);
+		if(bin>=best_bin && bin<best_bin+window_bins) prompt.push_back(hit);
+	}
+
+	// thin evenly to at most max_hits for the fit, and fewer for the coarse grid
+	Hits hits, coarse_hits;
+	Thin(prompt, (max_hits>0) ? size_t(max_hits) : prompt.size(), cables, times, hits);
+	Thin(prompt, std::min(hits.size(), size_t(max_coarse_hits)), cables, times, coarse_hits);
+	const size_t nused = hits.size();
+	res.nused = nused;
+
+	// coarse grid over the whole detector
+	std::vector<float> residuals(nused);
+	float vertex[4] = {0,0,0,0};
+	int best = -1;
+	float window_start = 0;
+	for(size_t g=0; g<grid_x.size(); ++g){
+		const float point[3] = {grid_x[g], grid_y[g], grid_z[g]};
+		Residuals(coarse_hits.size(), coarse_hits.x.data(), coarse_hits.y.data(), coarse_hits.z.data(), coarse_hits.t.data(),
+		          point, residuals.data());
+		const int count = MaxInWindow(residuals.data(), coarse_hits.size(), coarse_hits.residual_lo, coarse_hits.residual_hi,
+		                              kCoarseWidth, window_start, histogram);
+		if(count>best){
+			best = count;
+			std::copy(point, point+3, vertex);
+			vertex[3] = window_start + kCoarseWidth/2;
+		}
+	}
+
+	// then 3x3x3 grids around the best point, halving the spacing each time
+	for(float spacing=grid_spacing/2; spacing>=kFinestSpacing; spacing/=2){
+		const float width = kFineWidth + (kCoarseWidth-kFineWidth)*spacing/grid_spacing;
+		RefineSearch(hits, vertex, spacing, 1, width, residuals, histogram);
+	}
+
+	// then minimise the residuals of the hits in the window, twice, to reselect them at the fitted vertex
+	res.iterations = LevenbergMarquardt(hits, vertex, kFineWidth, residuals);
+	res.iterations += LevenbergMarquardt(hits, vertex, kFineWidth, residuals);
+
+	Residuals(nused, hits.x.data(), hits.y.data(), hits.z.data(), hits.t.data(), vertex, residuals.data());
+	for(size_t i=0; i<nused; ++i) res.ninwindow += (std::fabs(residuals[i]-vertex[3]) <= kFineWidth/2);
+	std::copy(vertex, vertex+4, res.vertex);
+	return res;
+}
+
+int VertexPrefit::SelectHits(int nhits, const int* cables, const float* times, const float* vertex,
+                             float tmin, float tmax, std::vector<int>& indices) const {
+	indices.clear();
+	const int npmts = pmt_x.size();
+	for(int i=0; i<nhits; ++i){
+		if(cables[i]<1 || cables[i]>npmts) continue;
+		const int pmt = cables[i]-1;
+		const float dx = pmt_x[pmt]-vertex[0];
+		const float dy = pmt_y[pmt]-vertex[1];
+		const float dz = pmt_z[pmt]-vertex[2];
+		const float residual = times[i] - std::sqrt(dx*dx+dy*dy+dz*dz)*kInvCWater - vertex[3];
+		if(residual>=tmin && residual<=tmax) indices.push_back(i);
+	}
+	return indices.size();
+}
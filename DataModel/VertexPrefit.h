@@ -0,0 +1,81 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef VertexPrefit_H
+#define VertexPrefit_H
+
+#include <vector>
+#include <cstddef>
+
+/**
+* \class VertexPrefit
+*
+* A fast point-source vertex fit from hit times alone, to seed BONSAI in place of clusfit.
+*
+* The hits are first cut to the densest time window the detector could hold light from one vertex,
+* and thinned to at most GetMaxHits(). A grid search over the detector, refined around its best point with
+* grids of halving spacing, then picks the vertex with the most hits whose time residual (hit time less time
+* of flight) falls within a narrowing time window. A few Levenberg-Marquardt steps finally minimise the squared
+* residuals of the hits within that window. The time of flight of all hits to a point is computed by one loop
+* over separate x, y, z arrays, which the compiler vectorises.
+*
+* The cost is bounded by the maximum number of hits, so the fit takes about the same time at any occupancy.
+* Fit() is const and keeps its working arrays local, so one VertexPrefit may be used from
+* several threads at once.
+*/
+class VertexPrefit {
+	public:
+	struct Result {
+		float vertex[4] = {9999,9999,9999,0};   // x, y, z (cm), t0 (ns)
+		int nused = 0;          // hits the fit was made with
+		int ninwindow = 0;      // of those, hits within the final time window of t0
+		int iterations = 0;     // Levenberg-Marquardt steps taken
+		bool ok() const { return vertex[0]<9999; }
+	};
+
+	// PMT positions xyzpm[npmts][3] (cm), indexed by cable-1. The grid spans the cylinder that contains them.
+	VertexPrefit(int npmts, const float* xyzpm);
+
+	Result Fit(int nhits, const int* cables, const float* times) const;
+
+	// indices of the hits with time residual in [tmin, tmax] ns from the vertex and t0 in vertex[3]
+	int SelectHits(int nhits, const int* cables, const float* times, const float* vertex,
+	               float tmin, float tmax, std::vector<int>& indices) const;
+
+	// time of flight subtracted hit times from the point vertex, over separate position arrays
+	static void Residuals(size_t n, const float* x, const float* y, const float* z, const float* t,
+	                      const float* vertex, float* residuals);
+
+	void SetMaxHits(int max_hits_in){ max_hits = max_hits_in; }
+	int GetMaxHits() const { return max_hits; }
+	void SetGridSpacing(float spacing){ grid_spacing = spacing; BuildGrid(); }
+	float GetRadius() const { return radius; }
+	float GetHalfHeight() const { return half_height; }
+
+	private:
+	struct Hits {
+		std::vector<float> x, y, z, t;
+		float residual_lo = 0, residual_hi = 0;   // bounds on the time residuals from any point in the detector
+		size_t size() const { return t.size(); }
+	};
+	// evenly spaced hits of the selection, at most n of them
+	void Thin(const std::vector<int>& selection, size_t n, const int* cables, const float* times, Hits& hits) const;
+	// the most residuals within width ns of each other, and where that window starts
+	static int MaxInWindow(const float* residuals, size_t n, float lo, float hi, float width,
+	                       float& window_start, std::vector<int>& histogram);
+	// best vertex of a cubic grid of (2*halfsteps+1)^3 points around centre, inside the detector
+	int RefineSearch(const Hits& hits, float* centre, float spacing, int halfsteps, float width,
+	                 std::vector<float>& residuals, std::vector<int>& histogram) const;
+	int LevenbergMarquardt(const Hits& hits, float* vertex, float width, std::vector<float>& residuals) const;
+	bool Inside(float x, float y, float z) const;
+	void BuildGrid();
+
+	std::vector<float> pmt_x, pmt_y, pmt_z;
+	float radius = 0;
+	float half_height = 0;
+	float max_tof = 0;          // light crossing time of the detector, ns
+	int max_hits = 300;
+	int max_coarse_hits = 100;  // the coarse grid needs fewer hits
+	float grid_spacing = 400;   // cm
+	std::vector<float> grid_x, grid_y, grid_z;
+};
+
+#endif
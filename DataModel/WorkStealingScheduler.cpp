@@ -0,0 +1,91 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "WorkStealingScheduler.h"
+
+namespace {
+	thread_local int current_worker = -1;
+}
+
+int WorkStealingScheduler::CurrentWorker(){
+	return current_worker;
+}
+
+WorkStealingScheduler::~WorkStealingScheduler(){
+	Stop();
+}
+
+void WorkStealingScheduler::Start(int nthreads){
+	if(!workers.empty()) return;
+	if(nthreads<1) nthreads=1;
+	stopping=false;
+	for(int i=0; i<nthreads; ++i) queues.emplace_back(new WorkerQueue);
+	for(int i=0; i<nthreads; ++i) workers.emplace_back(&WorkStealingScheduler::Run, this, i);
+}
+
+void WorkStealingScheduler::Submit(std::function<void()> task){
+	// only called from the ToolChain thread, so next_queue needs no protection
+	WorkerQueue& queue = *queues.at(next_queue);
+	next_queue = (next_queue+1) % queues.size();
+	{
+		std::lock_guard<std::mutex> lock(queue.mtx);
+		queue.tasks.push_back(std::move(task));
+	}
+	{
+		// taken so that the increment cannot fall between a worker's check and its wait
+		std::lock_guard<std::mutex> lock(wake_mtx);
+		++pending;
+	}
+	wake.notify_one();
+}
+
+bool WorkStealingScheduler::TryPop(size_t index, std::function<void()>& task){
+	// own queue first, oldest task first
+	{
+		WorkerQueue& queue = *queues.at(index);
+		std::lock_guard<std::mutex> lock(queue.mtx);
+		if(!queue.tasks.empty()){
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+			return true;
+		}
+	}
+	// otherwise steal the most recently queued task from another worker
+	for(size_t i=1; i<queues.size(); ++i){
+		WorkerQueue& queue = *queues.at((index+i) % queues.size());
+		std::lock_guard<std::mutex> lock(queue.mtx);
+		if(!queue.tasks.empty()){
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+			return true;
+		}
+	}
+	return false;
+}
+
+void WorkStealingScheduler::Run(size_t index){
+	current_worker = int(index);
+	std::function<void()> task;
+	while(true){
+		if(TryPop(index, task)){
+			--pending;
+			task();
+			task = nullptr;
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(wake_mtx);
+		wake.wait(lock, [this]{ return pending>0 || stopping; });
+		if(stopping && pending==0) return;
+	}
+}
+
+void WorkStealingScheduler::Stop(){
+	if(workers.empty()) return;
+	{
+		std::lock_guard<std::mutex> lock(wake_mtx);
+		stopping=true;
+	}
+	wake.notify_all();
+	for(auto&& worker : workers) worker.join();
+	workers.clear();
+	queues.clear();
+	next_queue=0;
+}
@@ -0,0 +1,54 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef WorkStealingScheduler_H
+#define WorkStealingScheduler_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+
+/**
+* \class WorkStealingScheduler
+*
+* A fixed pool of worker threads, each with its own task queue.
+* Submitted tasks are distributed round-robin; a worker takes tasks from the front of its
+* own queue and, when that is empty, steals from the back of another worker's queue,
+* so a long-running event on one worker does not hold up the tasks queued behind it.
+* Tasks must not throw.
+*/
+class WorkStealingScheduler {
+	public:
+	WorkStealingScheduler()=default;
+	~WorkStealingScheduler();
+
+	void Start(int nthreads);
+	void Submit(std::function<void()> task);
+	void Stop();   ///< runs any remaining tasks, then joins the workers
+	int GetNThreads() const { return workers.size(); }
+	// index of the worker running the calling task, or -1 if not called from a worker.
+	// Lets tasks use per-worker resources (e.g. a non thread-safe fitter per worker).
+	static int CurrentWorker();
+
+	private:
+	struct WorkerQueue {
+		std::mutex mtx;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	void Run(size_t index);
+	bool TryPop(size_t index, std::function<void()>& task);
+
+	std::vector<std::thread> workers;
+	std::vector<std::unique_ptr<WorkerQueue>> queues;
+	std::mutex wake_mtx;
+	std::condition_variable wake;
+	std::atomic<long> pending{0};
+	std::atomic<bool> stopping{false};
+	size_t next_queue=0;
+};
+
+#endif
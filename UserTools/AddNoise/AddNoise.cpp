@@ -1,4 +1,8 @@
 #include "AddNoise.h"
+
+// n.b. taken before MAXPM is undefined below
+static const int nIDPMTs = MAXPM;
+
 #include "TROOT.h"
 #include "TChain.h"
 
@@ -18,18 +22,27 @@ bool AddNoise::Initialise(std::string configfile, DataModel &data)
     iPart = 0; nParts = 0;
     iHit = 0; nHits = 0;
 
-    std::string noiseFilePath;
-    m_variables.Get("noise_file_path", noiseFilePath);
+    // a dark rate (Hz per PMT) > 0 generates noise instead of reading it from file
+    darkRate = 0; noiseSeed = 0;
+    m_variables.Get("dark_rate", darkRate);
+    m_variables.Get("noise_seed", noiseSeed);
+    useDarkRate = (darkRate > 0);
+    darkNoise.SetSeed(noiseSeed);
     
     tqi = new TQReal;
     
-    // read in noise file
-    noiseChain.Add(noiseFilePath.c_str());
-    Log("Getting number of entries in the noise chain...");
-    nEntries = noiseChain.GetEntries();
-    Log(Form("Number of entries in the noise chain: %d", nEntries));
-    noiseChain.SetBranchAddress("TQREAL", &tqi);
-    std::cout << std::endl;
+    if (!useDarkRate) {
+        std::string noiseFilePath;
+        m_variables.Get("noise_file_path", noiseFilePath);
+        
+        // read in noise file
+        noiseChain.Add(noiseFilePath.c_str());
+        Log("Getting number of entries in the noise chain...");
+        nEntries = noiseChain.GetEntries();
+        Log(Form("Number of entries in the noise chain: %d", nEntries));
+        noiseChain.SetBranchAddress("TQREAL", &tqi);
+        std::cout << std::endl;
+    }
     
     // read in config files
     m_variables.Get("noise_start_time", noiseStartTime);
@@ -46,6 +59,11 @@ bool AddNoise::Initialise(std::string configfile, DataModel &data)
 
 bool AddNoise::Execute()
 {
+    if (useDarkRate) {
+        AddDarkRateNoise();
+        return true;
+    }
+    
     if (iPart == nParts) {
         GetNewEntry();
         SetNoiseHitCluster();
@@ -68,15 +86,16 @@ bool AddNoise::Execute()
     
     Log(Form("t[ihit]: %3.2f ns", t[iHit]));
 
+    // the noise hits are in time order, so can be merged in rather than re-sorting everything
+    partHits.clear();
     while (noiseEventHits[iHit].t() < partEndTime) {
         PMTHit hit = noiseEventHits[iHit];
-        PMTHit shiftedHit(hit.t() - partStartTime + noiseStartTime, hit.q(), hit.i());
-        eventHits->Append(shiftedHit);
+        partHits.emplace_back(hit.t() - partStartTime + noiseStartTime, hit.q(), hit.i());
         iHit++;
     }
 
     //Log("After appending noise");
-    eventHits->Sort();
+    eventHits->AppendSorted(partHits);
     //eventHits->DumpAllElements();
 
     Log(Form("Completed adding part %d", iPart));
@@ -91,6 +110,24 @@ bool AddNoise::Finalise()
     return true;
 }
 
+void AddNoise::AddDarkRateNoise()
+{
+    // rates are set once per run; bad channels get none
+    if (skhead_.nrunsk != darkNoise.GetRun()) {
+        darkNoise.SetUniformRate(nIDPMTs, darkRate, &m_data->GetChannelStatus());
+        darkNoise.SetRun(skhead_.nrunsk);
+        Log(Form("Dark noise for run %d: total rate %3.2f MHz", skhead_.nrunsk, darkNoise.GetTotalRate()*1e-6));
+    }
+    
+    darkNoise.Generate(skhead_.nrunsk, skhead_.nevsk, 0, noiseStartTime, noiseEndTime, darkHits);
+    partHits.clear();
+    for (auto const& hit: darkHits)
+        partHits.emplace_back(hit.time, hit.charge, hit.cable);
+    
+    m_data->eventPMTHits.AppendSorted(partHits);
+    Log(Form("Added %d dark noise hits", (int)partHits.size()));
+}
+
 void AddNoise::GetNewEntry()
 {
     Log("Getting new entry");
@@ -5,6 +5,8 @@
 
 #include "TChain.h"
 
+#include "DarkNoise.h"
+
 
 class TChain;
 class TQReal;
@@ -23,6 +25,7 @@ class AddNoise : public Tool
         std::string name;
         void GetNewEntry();
         void SetNoiseHitCluster();
+        void AddDarkRateNoise();
         
         TChain noiseChain;
         
@@ -41,6 +44,14 @@ class AddNoise : public Tool
         std::vector<int>   i;
         
         PMTHitCluster noiseEventHits;
+        std::vector<PMTHit> partHits;
+        
+        // generate noise from a dark rate rather than reading it from file
+        bool useDarkRate;
+        float darkRate;
+        int noiseSeed;
+        DarkNoise darkNoise;
+        std::vector<DarkNoise::Hit> darkHits;
 };
 
 #endif
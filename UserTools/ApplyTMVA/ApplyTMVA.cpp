@@ -1,9 +1,15 @@
 #include "ApplyTMVA.h"
 #include "TMVA/Reader.h"
 
+#include <sstream>
+#include <iomanip>
+
 #include "PathGetter.h"
 
-#include "Candidate.h"
+#include "EventCandidates.h"
+#include "EventContext.h"
+
+EVENT_PARALLEL_TOOL(ApplyTMVA);
 
 bool ApplyTMVA::Initialise(std::string configfile, DataModel &data)
 {
@@ -17,39 +23,97 @@ bool ApplyTMVA::Initialise(std::string configfile, DataModel &data)
     likelihoodThreshold = 0.7f;
     mvaMethodName="MLP";
     weightFilePath = GetENV("NTAGPATH") + std::string("weights/MLP_Gd0.011p_calibration.xml");
+    useNativeBDT = false;
+    nValidate = 0;
+    nValidated = 0;
+    nMismatched = 0;
     // update from config file
     m_variables.Get("likelihood_threshold", likelihoodThreshold);
     m_variables.Get("mva_method_name", mvaMethodName);
     m_variables.Get("weight_file_path", weightFilePath);
+    m_variables.Get("native_bdt", useNativeBDT);
+    m_variables.Get("native_validation_candidates", nValidate);
+
+    const FeatureSchema& schema = m_data->eventCandidates.GetSchema();
+
+    if (useNativeBDT) {
+        if (!forest.LoadTMVA(weightFilePath)) {
+            Log("Can't evaluate "+weightFilePath+" natively ("+forest.GetError()+"), using the TMVA Reader", pWARNING, m_verbose);
+            useNativeBDT = false;
+        }
+        else {
+            // the forest reads its inputs straight from the candidate feature matrix
+            std::vector<std::string> missing = schema.Missing(forest.GetInputNames());
+            if (!missing.empty()) {
+                std::string missingList;
+                for (auto const& key: missing) missingList += " " + key;
+                Log("Candidate features needed by the classifier are not registered:" + missingList
+                    + ". Is ExtractFeatures in the toolchain before ApplyTMVA?", pERROR, m_verbose);
+                return false;
+            }
+            std::vector<int> columns;
+            for (auto const& key: forest.GetInputNames())
+                columns.push_back(schema.Find(key));
+            forest.MapInputs(columns);
+            Log("Evaluating "+std::to_string(forest.GetNTrees())+" trees of "+weightFilePath+" natively", pDEFAULT, m_verbose);
+        }
+    }
 
-    featureContainer["NHits"] = 0;
-    featureContainer["N200"] = 0;
-    featureContainer["AngleMean"] = 0.;
-    featureContainer["AngleSkew"] = 0.;
-    featureContainer["AngleStdev"] = 0.;
-    featureContainer["Beta1"] = 0.;
-    featureContainer["Beta2"] = 0.;
-    featureContainer["Beta3"] = 0.;
-    featureContainer["Beta4"] = 0.;
-    featureContainer["Beta5"] = 0.;
-    featureContainer["DWall"] = 0.;
-    featureContainer["DWall_n"] = 0.;
-    featureContainer["DWallMeanDir"] = 0.;
-    featureContainer["prompt_nfit"] = 0.;
-    featureContainer["ThetaMeanDir"] = 0.;
-    featureContainer["TRMS"] = 0.;
-
-
-    tmvaReader = new TMVA::Reader();
-
-    for (auto& pair: featureContainer)
-        tmvaReader->AddVariable(pair.first, &(pair.second));
-
-    tmvaReader->AddSpectator("CaptureType", &(captureType));
+    // the TMVA Reader is only needed without the native forest, or to validate it
+    if (!useNativeBDT || nValidate > 0) {
+        std::vector<std::string> requiredNames;
+        if (useNativeBDT) {
+            // validate with the inputs of the weight file, in its order (already checked to be registered).
+            // Its spectators must be declared too, but don't affect the output
+            featureNames = forest.GetInputNames();
+            spectatorNames = forest.GetSpectatorNames();
+            captureTypeID = -1;
+        }
+        else {
+            // n.b. the order of the variables must be that used in training
+            featureNames = {"AngleMean", "AngleSkew", "AngleStdev",
+                            "Beta1", "Beta2", "Beta3", "Beta4", "Beta5",
+                            "DWall", "DWallMeanDir", "DWall_n", "N200", "NHits",
+                            "TRMS", "ThetaMeanDir", "prompt_nfit"};
+            spectatorNames.clear();
+            requiredNames = featureNames;
+            requiredNames.push_back("CaptureType");
+        }
+
+        // the features must have been registered by the Tools that fill them
+        std::vector<std::string> missing = schema.Missing(requiredNames);
+        if (!missing.empty()) {
+            std::string missingList;
+            for (auto const& key: missing) missingList += " " + key;
+            Log("Candidate features needed by the classifier are not registered:" + missingList
+                + ". Is ExtractFeatures in the toolchain before ApplyTMVA?", pERROR, m_verbose);
+            return false;
+        }
+
+        featureValues.assign(featureNames.size(), 0.);
+        featureIDs.clear();
+        for (auto const& key: featureNames)
+            featureIDs.push_back(schema.Find(key));
+        if (!useNativeBDT) captureTypeID = schema.Find("CaptureType");
+        spectatorValues.assign(spectatorNames.size(), 0.);
+
+        tmvaReader = new TMVA::Reader();
+
+        for (size_t i = 0; i < featureNames.size(); i++)
+            tmvaReader->AddVariable(featureNames[i], &(featureValues[i]));
+
+        if (useNativeBDT) {
+            for (size_t i = 0; i < spectatorNames.size(); i++)
+                tmvaReader->AddSpectator(spectatorNames[i], &(spectatorValues[i]));
+        }
+        else {
+            tmvaReader->AddSpectator("CaptureType", &(captureType));
+        }
+
+        tmvaReader->BookMVA(mvaMethodName, weightFilePath);
+    }
 
-    tmvaReader->BookMVA(mvaMethodName, weightFilePath);
-    
-    m_data->eventCandidates.RegisterFeatureName("TMVAOutput");
+    tmvaOutputID = m_data->eventCandidates.RegisterFeatureName("TMVAOutput");
 
     return true;
 }
@@ -61,12 +125,37 @@ bool ApplyTMVA::Execute()
     EventCandidates* eventCans = &(m_data->eventCandidates);
     unsigned int nCandidates = eventCans->GetSize();
 
-    // candidate loop
-    for (unsigned int i = 0; i < nCandidates; i++) {
-        Candidate* candidate = &(eventCans->At(i));
-        float tmvaOutput = GetClassifierOutput(candidate);
-        if (tmvaOutput > likelihoodThreshold) taggedNeutronCount++;
-        candidate->Set("TMVAOutput", tmvaOutput);
+    if (useNativeBDT) {
+        // all candidates of the event at once
+        forestOutputs.resize(nCandidates);
+        forest.Evaluate(eventCans->GetFeatureMatrix(), nCandidates, eventCans->GetNFeatures(), forestOutputs.data());
+
+        // check the first candidates against the TMVA Reader, which should agree to the last bit
+        for (unsigned int i = 0; i < nCandidates && nValidated < nValidate; i++, nValidated++) {
+            double tmvaValue = GetClassifierOutput(eventCans->Row(i));
+            if (tmvaValue != forestOutputs[i]) {
+                nMismatched++;
+                std::ostringstream message;
+                message << std::setprecision(17) << "Native BDT output " << forestOutputs[i]
+                        << " differs from the TMVA Reader's " << tmvaValue;
+                Log(message.str(), pWARNING, m_verbose);
+            }
+        }
+
+        for (unsigned int i = 0; i < nCandidates; i++) {
+            float tmvaOutput = forestOutputs[i];
+            if (tmvaOutput > likelihoodThreshold) taggedNeutronCount++;
+            eventCans->Set(i, tmvaOutputID, tmvaOutput);
+        }
+    }
+    else {
+        // candidate loop
+        for (unsigned int i = 0; i < nCandidates; i++) {
+            float* features = eventCans->Row(i);
+            float tmvaOutput = GetClassifierOutput(features);
+            if (tmvaOutput > likelihoodThreshold) taggedNeutronCount++;
+            features[tmvaOutputID] = tmvaOutput;
+        }
     }
 
     if(m_verbose>2){
@@ -75,27 +164,32 @@ bool ApplyTMVA::Execute()
     }
     
     m_data->eventVariables.Set("tagged_neutron_count", taggedNeutronCount);
-    std::cout << std::endl;
-    Log(Form("%d neutron-like signals tagged in this event.", taggedNeutronCount));
+    // n.b. avoid ROOT's Form here, whose shared buffer is not safe when run by ParallelEvents.
+    // Nothing is written to std::cout either, so the output stays with the event's log
+    Log(std::to_string(taggedNeutronCount)+" neutron-like signals tagged in this event.");
 
     return true;
 }
 
 bool ApplyTMVA::Finalise()
 {
+    if (useNativeBDT && nValidate > 0) {
+        Log("Native BDT validation: "+std::to_string(nMismatched)+" of "+std::to_string(nValidated)
+            +" candidates differ from the TMVA Reader", nMismatched ? pWARNING : pDEFAULT, m_verbose);
+    }
+    delete tmvaReader;
+    tmvaReader = nullptr;
     return true;
 }
 
-float ApplyTMVA::GetClassifierOutput(Candidate* candidate)
+double ApplyTMVA::GetClassifierOutput(const float* features)
 {
-    // get features from candidate and fill feature container
-    for (auto const& pair: featureContainer) {
-        float value = candidate->Get(pair.first);
-        featureContainer[pair.first] = value;
-    }
+    // fill the Reader's variables from the candidate's features
+    for (size_t i = 0; i < featureIDs.size(); i++)
+        featureValues[i] = features[featureIDs[i]];
 
     // get spectator
-    captureType = candidate->Get("CaptureType");
+    if (captureTypeID >= 0) captureType = features[captureTypeID];
 
     return tmvaReader->EvaluateMVA(mvaMethodName);
 }
@@ -1,15 +1,17 @@
 #ifndef APPLYTMVA_HH
 #define APPLYTMVA_HH
 
-#include "Tool.h"
+#include "EventParallelTool.h"
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "TMVA/Reader.h"
 
-class Candidate;
+#include "DecisionForest.h"
 
-class ApplyTMVA : public Tool
+class ApplyTMVA : public EventParallelTool
 {
     public:
         ApplyTMVA() { name = "ApplyTMVA"; }
@@ -18,17 +20,36 @@ class ApplyTMVA : public Tool
         bool Execute();
         bool Finalise();
 
-        float GetClassifierOutput(Candidate* candidate);
+        // classifier output for a candidate's row of the feature matrix, from the TMVA Reader
+        double GetClassifierOutput(const float* features);
 
     private:
         std::string name;
-        std::map<std::string, float> featureContainer;
+        // input variables of the classifier, in the order given to the TMVA Reader
+        std::vector<std::string> featureNames;
+        // values given to the Reader (which holds their addresses), and their columns in the feature matrix
+        std::vector<float> featureValues;
+        std::vector<int> featureIDs;
         int captureType;
+        int captureTypeID;
+        // spectators of a natively evaluated weight file, declared to the Reader that validates it
+        std::vector<std::string> spectatorNames;
+        std::vector<float> spectatorValues;
+        int tmvaOutputID;
         float likelihoodThreshold;
 
         std::string mvaMethodName;
         std::string weightFilePath;
         TMVA::Reader* tmvaReader=nullptr;
+
+        // BDT weights evaluated natively, for all candidates of an event at once
+        bool useNativeBDT;
+        DecisionForest forest;
+        std::vector<double> forestOutputs;
+        // compare the native outputs of this many candidates with the TMVA Reader's
+        int nValidate;
+        int nValidated;
+        int nMismatched;
 };
 
 #endif
@@ -30,6 +30,8 @@ bool CalculateNeutronCloudVertex::Initialise(std::string configfile, DataModel &
 
 bool CalculateNeutronCloudVertex::Execute(){
   
+  SetMuonInfo();
+  
   int N_SLE = 0;
   m_data->CStore.Get("N_SLE", N_SLE);
   // just for record keeping, number of SLE triggers (before neutron reconstruction and cuts)
@@ -55,6 +57,7 @@ bool CalculateNeutronCloudVertex::Execute(){
   mult_plot.Fill(mult);
   
   // calculate mean position of all neutron vertices
+  std::fill(neutron_cloud_vertex.begin(), neutron_cloud_vertex.end(), 0);
   for (const auto& neutron : neutrons){
     for (int dim = 0; dim < 3; ++dim){
       neutron_cloud_vertex.at(dim) += neutron.bs_vertex.at(dim) / neutrons.size();
@@ -104,6 +107,27 @@ void CalculateNeutronCloudVertex::GetTreeReader(){
 }
 
 
+void CalculateNeutronCloudVertex::SetMuonInfo(){
+  
+  MuInfo* MU_ptr = nullptr;
+  MU_tree_reader->Get("MU", MU_ptr);
+  if(MU_ptr == nullptr){
+    throw std::runtime_error("CalculateNeutronCloudVertex::Execute: failed to get MU branch from tree reader");
+  }
+  muon_dir.assign(MU_ptr->muboy_dir, MU_ptr->muboy_dir+3);
+  
+  // event time in clock ticks, with rollovers since the first muon of the run unwrapped.
+  // NeutCloudCorrelationCuts unwraps its relic times from the first cloud of each run in the same way
+  nrunsk = skhead_.nrunsk;
+  if (nrunsk != clock_run){
+    clock.Reset();
+    clock_run = nrunsk;
+  }
+  event_ticks = clock.Unwrap(TickUnwrapper::EventTicks(skheadqb_.nevhwsk, skheadqb_.it0sk));
+  
+  return;
+}
+
 double CalculateNeutronCloudVertex::ClosestApproach(const std::vector<double>& vertex) {
   // skroot_mu_ not populated unless we do so, just use MU branch
   //const std::vector<double> muon_ent(skroot_mu_.muentpoint, skroot_mu_.muentpoint + 3);
@@ -154,6 +178,9 @@ void CalculateNeutronCloudVertex::CreateOutputFile(){
   nvc_tree_ptr->Branch("neutron_cloud_multiplicity", &mult);
   nvc_tree_ptr->Branch("neutron_cloud_vertex", &neutron_cloud_vertex);
   nvc_tree_ptr->Branch("nevsk",&skhead_.nevsk); // to check Tree alignment
+  nvc_tree_ptr->Branch("nrunsk",&nrunsk);
+  nvc_tree_ptr->Branch("event_ticks",&event_ticks);
+  nvc_tree_ptr->Branch("muon_dir",&muon_dir);
   
   
   // for plots
@@ -8,6 +8,7 @@
 
 #include "NeutronInfo.h"
 #include "MTreeReader.h"
+#include "TickUnwrapper.h"
 
 #include "TH1D.h"
 #include "TTree.h"
@@ -30,6 +31,12 @@ class CalculateNeutronCloudVertex: public Tool {
   
   int mult = 0;
   std::vector<double> neutron_cloud_vertex{0,0,0};
+  // muon run, time and direction, so that clouds can be indexed in space and time downstream
+  int nrunsk = 0;
+  ULong64_t event_ticks = 0;
+  TickUnwrapper clock;
+  int clock_run = -1;
+  std::vector<double> muon_dir{0,0,0};
   MTreeReader* MU_tree_reader = nullptr;
 
   TFile* nvc_file_ptr = nullptr;
@@ -39,6 +46,7 @@ class CalculateNeutronCloudVertex: public Tool {
   void GetTreeReader();
   void CreateOutputFile();
   double ClosestApproach(const std::vector<double>&);
+  void SetMuonInfo();
   
 };
 
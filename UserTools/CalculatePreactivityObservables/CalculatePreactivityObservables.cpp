@@ -95,12 +95,11 @@ bool CalculatePreactivityObservables::Execute(){
 #endif
   
   // fill hits into vector, doing time of flight subtraction as we go.
-  for (int hit_idx = 0; hit_idx < sktqz_.nqiskz; ++hit_idx){
-    // get the cable numbers from sktqz_.icabiz as usual:
-    const int cable_number = sktqz_.icabiz[hit_idx]; // n.b. no need for bitmask here
-    if(cable_number>MAXPM || cable_number<=0) continue;
-    // skip out-of-gate hits (i.e. not within trigger window at all)
-    if((sktqz_.ihtiflz[hit_idx] & 0x02)==0) continue;
+  // in-gate hits (i.e. within trigger window at all) on valid cables
+  const HitStore& inGateHits = m_data->GetInGateHits();
+  for (size_t gate_idx = 0; gate_idx < inGateHits.Size(); ++gate_idx){
+    const int hit_idx = inGateHits.raw_index[gate_idx];
+    const int cable_number = inGateHits.cable[gate_idx];
     
     //float raw_time = sktqz_.tiskz[hit_idx]; // something in muechk seems to change tiskz - perhaps it's internally calling set_timing_gate_
     float raw_time = TQREAL->T[hit_idx];      // get the times from TQREAL T branch directly (FIXME maybe call set_timing_gate(0) for others)
@@ -117,7 +116,7 @@ bool CalculatePreactivityObservables::Execute(){
     
     double tof = TimeOfFlight(lowe_ptr->bsvertex, pmt_loc);
     const double new_time = raw_time - lowe_ptr->bsvertex[3] - tof;
-    if (((sktqz_.ihtiflz[hit_idx] & 0x01)==1) && (new_time < lowest_in_gate_time)){
+    if (((inGateHits.flags[gate_idx] & 0x01)==1) && (new_time < lowest_in_gate_time)){
       lowest_in_gate_time = new_time; // 'in-gate' here refers to in 1.3us window
     }
     tof_sub_hits.emplace_back(new_time, 0, TQREAL->Q[hit_idx]); //calculate goodness in the next loop
@@ -221,108 +220,12 @@ bool CalculatePreactivityObservables::Execute(){
   }
   */
 
-  /*
-    Since a lot of this code would be duplicated, we'll also calculate the q50/n50 variables whilst we're at it.
-   */
-  /////////////////
-  //std::cout << "calculate max q50n50" << std::endl;
-  //rolling window for the q50n50 calculation 
-  std::deque<Hit> q50n50_window = {};
-  size_t next_hit_idx = 0;
-  
-  // prepopulate q50n50_window with first 50ns worth of hits
-  for (size_t i = 0; i < tof_sub_hits.size(); ++i){
-    if (tof_sub_hits.at(i).time - tof_sub_hits.front().time < q50n50_window_size){
-      q50n50_window.push_back(tof_sub_hits.at(i));
-    } else {
-      next_hit_idx = i;
-      break;
-    }
-  }
-  //std::cout << "initial q50n50_window.size(): " << q50n50_window.size() << std::endl;
-  //std::cout << "next_hit_idx: " << next_hit_idx << std::endl;
-  int n50=0;
-  double q50n50_ratio=0;
-  //go through hits
-  while (next_hit_idx != tof_sub_hits.size() - 1){
-    
-    //std::cout << "calculate q50n50 ratio" << std::endl;
-    //const double current_q50 = std::accumulate(q50n50_window.begin(), q50n50_window.end(), 0, [](double a, const Hit& h){return a + h.charge;});
-    if (q50n50_window.size() > n50){
-      n50 = q50n50_window.size();
-      //std::cout << "new n50:" << n50 << std::endl;
-      //std::cout << "accumulate charge" << std::endl;
-      double current_q50 = 0;
-      for (const auto& h : q50n50_window){
-        current_q50 += h.charge;
-        //if(q50n50_ratio==0) std::cout<<" hit charge "<<h.charge<<std::endl;
-      }
-      //std::cout << "new q50: " << current_q50 << std::endl;
-      q50n50_ratio = current_q50 / n50;
-      
-      /* debug
-      std::cout<<"new q50n50: "<<q50n50_ratio<<" based on hits: "<<std::endl;
-      current_q50=0;
-      n50=0;
-      for(const auto& h : q50n50_window){
-              current_q50+=h.charge;
-              ++n50;
-              q50n50_ratio=current_q50/n50;
-              printf("hit at time: %.2f, dt: %.2f, charge: %.2f, total: %.2f, n50: %d, ratio: %.2f\n", h.time, (h.time - q50n50_window.front().time), h.charge, current_q50, n50, q50n50_ratio);
-      }
-      */
-    }
-    //std::cout<<"q50n50 ratio: "<<q50n50_ratio<<std::endl;
-    
-    if(next_hit_idx == tof_sub_hits.size()) break; // no more hits to grab
-
-    //std::cout << "shifting q50n50 window" << std::endl;
-    // drop hits from the the front of the q50n50_window until we exceed the dt to the next hit
-    // (otherwise we're just removing hits and q50 is just going to be falling)
-    double dt_to_next_hit = tof_sub_hits.at(next_hit_idx).time - q50n50_window.back().time;
-    //std::cout<<"dt to next hit "<<dt_to_next_hit<<" vs q50n50 window size: "<<q50n50_window_size<<std::endl;
-    // shortcut
-    if(std::abs(dt_to_next_hit)>q50n50_window_size){
-        q50n50_window.clear();
-    } else {
-        double current_first_hit = q50n50_window.front().time;
-        while (q50n50_window.size() && (q50n50_window.front().time - current_first_hit) < std::abs(dt_to_next_hit)){
-            //std::cout<<"pop with q50n50 size "<<q50n50_window.size()<<std::endl;
-            q50n50_window.pop_front();
-        }
-    }
-    if(q50n50_window.empty()){
-      q50n50_window.push_back(tof_sub_hits.at(next_hit_idx));
-      ++next_hit_idx;
-    }
-
-    //std::cout << "add new hits to the window" << std::endl;
-    //std::cout << "next_hit_idx: " << next_hit_idx << std::endl;
-    //std::cout << "tof_sub_hits.size() " << tof_sub_hits.size() << std::endl;
-    // add new hits until the newly truncated window is 50ns long again
-    while(next_hit_idx < tof_sub_hits.size()){
-      if(std::abs(tof_sub_hits.at(next_hit_idx).time - q50n50_window.front().time) < q50n50_window_size){
-        q50n50_window.push_back(tof_sub_hits.at(next_hit_idx));
-        ++next_hit_idx;
-      } else {
-        break;
-      }
-    }
-  }
-  //std::cout<<"final q50n50_ratio: "<<q50n50_ratio<<std::endl;
-  //////////////////////
-
+  // q50/n50: the max number of hits in a 50ns window, and their mean charge
+  const double q50n50_ratio = CalculateQ50N50(tof_sub_hits);
 
   // back to calculating the preactivity...
-  //std::cout << "give each hit a goodness" << std::endl;
-  // by looping over all pairs of hits, we give each hit a goodness
-  for (size_t i = 0; i < tof_sub_hits.size(); ++i){
-    for (size_t j = i+1; j < tof_sub_hits.size(); ++j){
-      double g = CalculateGoodness(tof_sub_hits.at(i).time, tof_sub_hits.at(j).time);
-      tof_sub_hits.at(i).goodness += g;
-      tof_sub_hits.at(j).goodness += g;
-    }
-  }
+  // give each hit a goodness, from the hits around it
+  AssignGoodness(tof_sub_hits);
 
   //get max goodness
   const auto max_it = std::max_element(tof_sub_hits.begin(), tof_sub_hits.end(), [](const Hit& h1, const Hit& h2){return (h1.goodness < h2.goodness);});
@@ -381,90 +284,13 @@ bool CalculatePreactivityObservables::Execute(){
   }
   */
   
-  //create preactivity window
-  std::deque<double> preact_window = {};
-  // TODO the deque is redundant: the original lecompte.F does it more efficiently, just tracking indices in tof_sub_hits.
-  // replace instances of preact_window.push_back with increment an end index,
-  // replace instances of preact_window.pop_front with increment a start index
-  // and then replace references to preact_window entries with ones to tof_sub_hits.
-  next_hit_idx = 0;
-  
   size_t max_pre = 0;
   size_t max_pregate = 0;
-
-  // prepopulate preact_window with first 15ns worth of hits
-  //std::cout << "prepopulate preact_window with first "<<preact_window_size<<"ns worth of hits" << std::endl;
-  for (size_t i = 0; i < tof_sub_hits.size(); ++i){
-    if ( std::abs(tof_sub_hits.at(i).time - tof_sub_hits.front().time) < preact_window_size && tof_sub_hits.at(i).time<-preact_window_cutoff){
-      preact_window.push_back(tof_sub_hits.at(i).time);
-    } else {
-      next_hit_idx = i;
-      break;
-    }
-  }
-  //std::cout<<"initial preact_window size: "<<preact_window.size()<<std::endl;
-  
-  if(preact_window.size()==0){
+  if(!CalculateMaxPre(tof_sub_hits, lowest_in_gate_time, max_pre, max_pregate)){
     // i think this is prooobably fine...
     Log(m_unique_name+": no hits passing goodness cut with t<preact_window_cutoff",v_message,m_verbose);
   }
 
-  //std::cout << "go through the hits in preactivity window" << std::endl;
-  //std::cout<<"last preact hit time "<<preact_window.back()<<" vs cutoff "<<-preact_window_cutoff
-  //         <<", next hit_idx: "<<next_hit_idx<<" vs tof_sub_hits.size(): "<<tof_sub_hits.size()<<std::endl;
-  
-  if(preact_window.size()){
-    while ((preact_window.back() < -preact_window_cutoff) && (next_hit_idx != tof_sub_hits.size() - 1)){
-
-      //std::cout<<"preact_window.size() after adding new hits "<<preact_window.size()<<std::endl;
-      
-      //std::cout <<"get max_pre for this window iteration" << std::endl;
-      if (preact_window.size() > max_pre){
-        max_pre = preact_window.size();
-      }
-
-      //std::cout << " and the same for max_pregate" << std::endl;
-      if ((preact_window.size() > max_pregate) && ((preact_window.front() >= lowest_in_gate_time))){
-        max_pregate = preact_window.size();
-      }
-
-      if(next_hit_idx == tof_sub_hits.size()) break; // no more hits to grab
-      
-      //std::cout << "shifting preact_window" << std::endl;
-      // drop hits from the the front of the preact_window_size until we exceed the dt to the next hit
-      // (otherwise we're just removing hits and max_pre/max_pregate are just going to be falling)
-      double dt_to_next_hit = tof_sub_hits.at(next_hit_idx).time - preact_window.back();
-      //std::cout<<"dt to next hit: "<<dt_to_next_hit<<std::endl;
-      // shortcut
-      if(std::abs(dt_to_next_hit)>preact_window_size){
-          preact_window.clear();
-      } else {
-          double current_first_hit = preact_window.front();
-          while (preact_window.size() && (preact_window.front() - current_first_hit) < std::abs(dt_to_next_hit)){
-              preact_window.pop_front();
-          }
-      }
-      if(preact_window.empty()){
-        preact_window.push_back(tof_sub_hits.at(next_hit_idx).time);
-        ++next_hit_idx;
-      }
-      //std::cout<<"preact_window.size() before adding new hits "<<preact_window.size()<<std::endl;
-
-      //std::cout << " add new hits until the newly truncated window is 12ns long again" << std::endl;
-      while (next_hit_idx < tof_sub_hits.size()){
-        //std::cout<<"next hit at "<<tof_sub_hits.at(next_hit_idx).time<<" vs current preact first hit "<<preact_window.front()<<std::endl;
-        if (std::abs(tof_sub_hits.at(next_hit_idx).time - preact_window.front()) < preact_window_size){
-          preact_window.push_back(tof_sub_hits.at(next_hit_idx).time);
-          //std::cout<<"added"<<std::endl;
-          ++next_hit_idx;
-        } else {
-          break;
-        } 
-      }
-      
-    }
-  }
-
   //std::cout << "max_pre: " << max_pre << std::endl;
   //std::cout << "max_pregate: " << max_pregate << std::endl;
 #ifdef PREACTIVITY_DEBUG
@@ -508,6 +334,125 @@ double CalculatePreactivityObservables::CalculateGoodness(const double& t1, cons
   return dt2 < 25 ? exp(-0.5 * dt2) : 0;
 };
 
+void CalculatePreactivityObservables::AssignGoodness(std::vector<Hit>& hits) const {
+  // each pair of hits adds to the goodness of both, but the gaussian is cut off at 25ns,
+  // so for time-sorted hits only those within 25ns of one another need pairing.
+  // pairs are visited in the same order as a full i<j loop, so the sums are unchanged.
+  const double kernel_support = 25;
+  size_t band_end = 0;
+  for (size_t i = 0; i < hits.size(); ++i){
+    if (band_end < i+1) band_end = i+1;
+    while (band_end < hits.size() && hits[band_end].time - hits[i].time < kernel_support) ++band_end;
+    for (size_t j = i+1; j < band_end; ++j){
+      double g = CalculateGoodness(hits[i].time, hits[j].time);
+      hits[i].goodness += g;
+      hits[j].goodness += g;
+    }
+  }
+}
+
+double CalculatePreactivityObservables::CalculateQ50N50(const std::vector<Hit>& hits) const {
+  // rolling window of time-sorted hits [first_idx, next_hit_idx)
+  size_t first_idx = 0;
+  size_t next_hit_idx = 0;
+  
+  // prepopulate the window with first 50ns worth of hits
+  while (next_hit_idx < hits.size() && hits[next_hit_idx].time - hits.front().time < q50n50_window_size) ++next_hit_idx;
+  
+  int n50=0;
+  double q50n50_ratio=0;
+  //go through hits
+  while (next_hit_idx != hits.size() - 1){
+    
+    if (next_hit_idx - first_idx > n50){
+      n50 = next_hit_idx - first_idx;
+      double current_q50 = 0;
+      for (size_t i = first_idx; i < next_hit_idx; ++i){
+        current_q50 += hits[i].charge;
+      }
+      q50n50_ratio = current_q50 / n50;
+    }
+    
+    if(next_hit_idx == hits.size()) break; // no more hits to grab
+    
+    // drop hits from the the front of the window until we exceed the dt to the next hit
+    // (otherwise we're just removing hits and q50 is just going to be falling)
+    double dt_to_next_hit = hits[next_hit_idx].time - hits[next_hit_idx-1].time;
+    // shortcut
+    if(std::abs(dt_to_next_hit)>q50n50_window_size){
+      first_idx = next_hit_idx;
+    } else {
+      double current_first_hit = hits[first_idx].time;
+      while (first_idx < next_hit_idx && (hits[first_idx].time - current_first_hit) < std::abs(dt_to_next_hit)){
+        ++first_idx;
+      }
+    }
+    if(first_idx == next_hit_idx){
+      ++next_hit_idx;
+    }
+    
+    // add new hits until the newly truncated window is 50ns long again
+    while(next_hit_idx < hits.size() && std::abs(hits[next_hit_idx].time - hits[first_idx].time) < q50n50_window_size){
+      ++next_hit_idx;
+    }
+  }
+  
+  return q50n50_ratio;
+}
+
+bool CalculatePreactivityObservables::CalculateMaxPre(const std::vector<Hit>& hits, const double lowest_in_gate_time,
+                                                      size_t& max_pre, size_t& max_pregate) const {
+  // rolling window of time-sorted hits [first_idx, next_hit_idx), as in lecompte.F
+  size_t first_idx = 0;
+  size_t next_hit_idx = 0;
+  
+  // prepopulate the window with first 15ns worth of hits
+  while (next_hit_idx < hits.size() && std::abs(hits[next_hit_idx].time - hits.front().time) < preact_window_size
+         && hits[next_hit_idx].time < -preact_window_cutoff){
+    ++next_hit_idx;
+  }
+  
+  if(next_hit_idx==0) return false;
+  
+  while ((hits[next_hit_idx-1].time < -preact_window_cutoff) && (next_hit_idx != hits.size() - 1)){
+    
+    const size_t window_size = next_hit_idx - first_idx;
+    if (window_size > max_pre){
+      max_pre = window_size;
+    }
+    
+    if ((window_size > max_pregate) && (hits[first_idx].time >= lowest_in_gate_time)){
+      max_pregate = window_size;
+    }
+    
+    if(next_hit_idx == hits.size()) break; // no more hits to grab
+    
+    // drop hits from the the front of the window until we exceed the dt to the next hit
+    // (otherwise we're just removing hits and max_pre/max_pregate are just going to be falling)
+    double dt_to_next_hit = hits[next_hit_idx].time - hits[next_hit_idx-1].time;
+    // shortcut
+    if(std::abs(dt_to_next_hit)>preact_window_size){
+      first_idx = next_hit_idx;
+    } else {
+      double current_first_hit = hits[first_idx].time;
+      while (first_idx < next_hit_idx && (hits[first_idx].time - current_first_hit) < std::abs(dt_to_next_hit)){
+        ++first_idx;
+      }
+    }
+    if(first_idx == next_hit_idx){
+      ++next_hit_idx;
+    }
+    
+    // add new hits until the newly truncated window is 15ns long again
+    while (next_hit_idx < hits.size() && std::abs(hits[next_hit_idx].time - hits[first_idx].time) < preact_window_size){
+      ++next_hit_idx;
+    }
+    
+  }
+  
+  return true;
+}
+
 void CalculatePreactivityObservables::GetTreeReader(){
   std::string tree_reader_str = "";
   m_variables.Get("reader", tree_reader_str);
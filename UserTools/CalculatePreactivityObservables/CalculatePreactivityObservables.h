@@ -41,6 +41,11 @@ class CalculatePreactivityObservables: public Tool {
   void GetTreeReader();
   double TimeOfFlight(const float*, const float*) const;
   double CalculateGoodness(const double&, const double&) const;
+  // these all take hits sorted in time
+  void AssignGoodness(std::vector<Hit>&) const;
+  double CalculateQ50N50(const std::vector<Hit>&) const;
+  // false if no hits are before the preactivity window cutoff
+  bool CalculateMaxPre(const std::vector<Hit>&, const double lowest_in_gate_time, size_t& max_pre, size_t& max_pregate) const;
   
 };
 
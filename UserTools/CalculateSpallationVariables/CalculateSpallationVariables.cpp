@@ -2,6 +2,11 @@
 
 #include "MTreeReader.h"
 
+#include <algorithm>
+
+#include "MuonTrackGeometry.h"
+#include "SpallationLikelihood.h"
+
 #include "TH1D.h"
 #include "geotnkC.h"  // for SK tank geometric constants
 
@@ -19,6 +24,24 @@ bool CalculateSpallationVariables::Initialise(std::string configfile, DataModel
   
   GetReaders();
 
+  // join mode: 'random' reads the relic entry of each pairing as the muons are read;
+  // 'sorted' collects the pairings and reads the relic tree once, in order, in Finalise
+  std::string join_mode = "random";
+  m_variables.Get("join_mode", join_mode);
+  if (join_mode != "random" && join_mode != "sorted"){
+    throw std::runtime_error("CalculateSpallationVariables::Initialise - join_mode must be random or sorted!");
+  }
+  sorted_join = (join_mode == "sorted");
+
+  // likelihood PDFs: built from this run's pairings and optionally saved with pdf_output_prefix,
+  // or read from files saved by an earlier job with pdf_input_prefix
+  m_variables.Get("pdf_input_prefix", pdf_input_prefix);
+  m_variables.Get("pdf_output_prefix", pdf_output_prefix);
+  m_variables.Get("pdf_smoothing", pdf_smoothing);
+  m_variables.Get("pdf_floor", pdf_floor);
+  m_variables.Get("pdf_interpolate", pdf_interpolate);
+  m_variables.Get("likelihood_threads", likelihood_threads);
+
   m_variables.Get("run_type", run_type_str);
   if (run_type_str != "cut" && run_type_str != "calculate"){
     throw std::runtime_error("CalculateSpallationVariables::Initialise - no valid run type (calculate / cut) specified in the config file!");
@@ -35,140 +58,206 @@ bool CalculateSpallationVariables::Execute(){
   if (MU_ptr->muboy_status == 0){
     return true;
   }
+
+  // everything we need from the muon, independent of the relic
+  MuonTrackInfo mu = GetMuonTrackInfo();
   
   // "pre" means dt > 0, "post" is opposite - remember these are the times from the muon to the relic, so it's the opposite to the white paper.
   
   std::cout << "CalculateSpallationVariables: looping through " << MatchedTimeDiff_ptr->size() << " matched relics" << std::endl;
+  if (sorted_join){
+    // just note the pairings for now; the relic tree is read in order in Finalise
+    pending_muons.push_back(mu);
+  }
   for (int relic_idx = 0; relic_idx < MatchedTimeDiff_ptr->size(); ++relic_idx){
     
     /* dt - time difference between muon and relic candidate */
     /* mu - relic */
     float dt = MatchedTimeDiff_ptr->at(relic_idx)/pow(10,9);
     dt > 0 ? pre_dt_hist.Fill(abs(dt)) : post_dt_hist.Fill(abs(dt));
+
+    if (sorted_join){
+      PendingPair pair{};
+      pair.relic_entry = MatchedOutEntryNums_ptr->at(relic_idx);
+      pair.muon_idx = pending_muons.size()-1;
+      pair.dt = dt;
+      pending_pairs.push_back(pair);
+      continue;
+    }
     
     relic_tree_ptr->GetEntry(MatchedOutEntryNums_ptr->at(relic_idx));
     GetRelicBranchValues();
+    AddRelic(dt, LOWE_ptr->bsvertex, LOWE_ptr->bsenergy);
+  }
+  CalculatePairings(mu);
+  
+  return true;
+}
 
-    if (LOWE_ptr->bsenergy > 1000){
-      //bad reconstruction, skipping
-      continue;
-    }
+CalculateSpallationVariables::MuonTrackInfo CalculateSpallationVariables::GetMuonTrackInfo(){
 
-    /* dlt - transverse distance between muon and relic candidate */
-    float dlt = 0, appr = 0;
+  MuonTrackInfo mu;
 
-    float* muon_entrypoint = nullptr;
-    float* muon_direction = nullptr;
-    
-    bool did_bff = MU_ptr->muinfo[6];
-    double muon_tracklen = 0;
+  bool did_bff = MU_ptr->muinfo[6];
     
-    if (did_bff){
-      basic_array<float> bff_entrypoint(MU_ptr->mubff_entpos);
-      basic_array<float> bff_dir = MU_ptr->mubff_dir;
+  if (did_bff){
+    basic_array<float> bff_entrypoint(MU_ptr->mubff_entpos);
+    basic_array<float> bff_dir = MU_ptr->mubff_dir;
 
-      muon_entrypoint = const_cast<float*>(bff_entrypoint.data());
-      muon_direction = const_cast<float*>(bff_dir.data());
+    for (int i = 0; i < 3; ++i){
+      mu.entrypoint[i] = bff_entrypoint[i];
+      mu.direction[i] = bff_dir[i];
+    }
 
-      muon_tracklen = CalculateTrackLen(muon_entrypoint, muon_direction);
-    } else {
-      basic_array<float[10][4]> muboy_entrypoint(MU_ptr->muboy_entpos);
-      basic_array<float> muboy_dir = MU_ptr->muboy_dir;
+    mu.tracklen = CalculateTrackLen(mu.entrypoint, mu.direction);
+  } else {
+    basic_array<float[10][4]> muboy_entrypoint(MU_ptr->muboy_entpos);
+    basic_array<float> muboy_dir = MU_ptr->muboy_dir;
 
-      int muboy_idx = MU_ptr->muinfo[7];
-      muon_entrypoint = const_cast<float*>(muboy_entrypoint[muboy_idx].data());
-      muon_direction = const_cast<float*>(muboy_dir.data());
+    int muboy_idx = MU_ptr->muinfo[7];
+    for (int i = 0; i < 3; ++i){
+      mu.entrypoint[i] = muboy_entrypoint[muboy_idx][i];
+      mu.direction[i] = muboy_dir[i];
+    }
 
-      muon_tracklen = muboy_idx == 0 ? MU_ptr->muboy_length : CalculateTrackLen(muon_entrypoint, muon_direction);
+    mu.tracklen = muboy_idx == 0 ? MU_ptr->muboy_length : CalculateTrackLen(mu.entrypoint, mu.direction);
       
-    }
-    
-    float* relic_pos = const_cast<float*>(LOWE_ptr->bsvertex);
+  }
+
+  /* position along the track of maximum energy deposition, for dll */
+  basic_array<float> scott_dedx(MU_ptr->muboy_dedx);
+  mu.max_energy_dep_pos = MuonTrackGeometry::MaxDedxPosition(scott_dedx.data());
+
+  /* muqismsk - max charge deposited in the detector by the muon*/
+  mu.muqismsk = (MU_ptr->muqismsk);
     
-    getdl_(muon_direction,
-	   &relic_pos[0],
-	   &relic_pos[1],
-	   &relic_pos[2],
-	   muon_entrypoint,
-	   &dlt,
-	   &appr);
+  /* 
+     resQ - residual charge deposited by the muon compared to the value expected from the min ionization. 
+     reQ = muqismsk - q_MI * L, where q_MI is the number of photoelectrons per cm expected from the min ionization
+     and L is the track length. L = sum_{i}(Li) for multiple tracks. Does that not make sense to you? yeah well get in line
+  */
+
+  double pe_per_coulomb = 30;     // this might come back to bite me but break in the sun till the sun breaks down old boy
+  const float pe_per_cm = 26.78;
+  double pe_from_muon = MU_ptr->muqismsk * (pe_per_cm / pe_per_coulomb);  // pe*cm^-1 / pe*C^-1 = C/cm
+  double pe_from_MIP = mu.tracklen * pe_per_cm;
+  mu.resQ = pe_from_muon - pe_from_MIP;
+
+  /* lastly, we need the type of muon event: misfit=0, single_through=1, single_stopping=2, multi=3,4, corner=5 */
+  mu.muon_type = MU_ptr->muboy_status;
+
+  return mu;
+}
+
+void CalculateSpallationVariables::AddRelic(float dt, const float* bsvertex, float bsenergy){
+  if (bsenergy > 1000){
+    //bad reconstruction, skipping
+    return;
+  }
+  batch.dt.push_back(dt);
+  batch.x.push_back(bsvertex[0]);
+  batch.y.push_back(bsvertex[1]);
+  batch.z.push_back(bsvertex[2]);
+  batch.bse.push_back(bsenergy);
+}
+
+void CalculateSpallationVariables::CalculatePairings(MuonTrackInfo& mu){
+
+  // pairs the muon with all relics added since the last call
+  const size_t n = batch.dt.size();
+  batch.dlt.resize(n);
+  batch.appr.resize(n);
+
+  /* dlt - transverse distance between muon and relic candidate */
+  /* appr - distance along the muon track to the point of closest approach */
+  const float* muon_entrypoint = mu.entrypoint;
+  const float* muon_direction = mu.direction;
+  MuonTrackGeometry::TrackDistances(muon_direction, &muon_entrypoint, 1, n, batch.x.data(), batch.y.data(), batch.z.data(),
+                                    batch.dlt.data(), batch.appr.data());
+
+  for (size_t i = 0; i < n; ++i){
+    const float dlt = batch.dlt[i];
+    const float appr = batch.appr[i];
 
     if (dlt == 0.0){
-      std::cout << "CalculateSpallationVariables::Execute - dlt = 0, dumping args of getdl_" << std::endl;
-      std::cout<<"calling getdl_ with:\n"
-	       <<"\trelic po: ("<<relic_pos[0]<<", "<<relic_pos[1]<<", "<<relic_pos[2]<<")\n"
+      std::cout << "CalculateSpallationVariables::Execute - dlt = 0, dumping args of TrackDistances" << std::endl;
+      std::cout<<"calling TrackDistances with:\n"
+	       <<"\trelic po: ("<<batch.x[i]<<", "<<batch.y[i]<<", "<<batch.z[i]<<")\n"
 	       <<"\tmuon entry point: ("<<muon_entrypoint[0]<<", "<<muon_entrypoint[1]<<", "<<muon_entrypoint[2]<<")\n"
 	       <<"\tmuon entry dir: ("<<muon_direction[0]<<", "<<muon_direction[1]<<", "<<muon_direction[2]<<")"<<std::endl;
       throw std::runtime_error("CalculateSpallationVariables:: bad dlt");
     }
     
-    dt > 0 ? pre_dlt_hist.Fill(dlt) : post_dlt_hist.Fill(dlt);
-    
     /* dll - longitudinal distance between the muon and relic candidate*/
-    basic_array<float> scott_dedx(MU_ptr->muboy_dedx);
-    float* muon_dedx = const_cast<float*>(scott_dedx.data());
-    
-    double max_edep = 0;
-    int max_edep_bin=0;
-    for(int i=0;i<111;i++){
-      double e_dep_in_window = 0 ;
-      for(int j=0;j<9;j++){
-	e_dep_in_window = e_dep_in_window + muon_dedx[i+j];
-      }
-      if(e_dep_in_window > max_edep){
-	max_edep_bin = i+4;
-	max_edep = e_dep_in_window;
-      }
-    }
-    double max_energy_dep_pos = 50.*max_edep_bin;
-    float dll = max_energy_dep_pos - appr;
+    float dll = mu.max_energy_dep_pos - appr;
 
     if (dll == 0.0){
-      std::cout << "CalculateSpallationVariables::Execute - dll = 0, dumping args of getdl_" << std::endl;
-      std::cout<<"calling getdl_ with:\n"
-	       <<"\trelic po: ("<<relic_pos[0]<<", "<<relic_pos[1]<<", "<<relic_pos[2]<<")\n"
+      std::cout << "CalculateSpallationVariables::Execute - dll = 0, dumping args of TrackDistances" << std::endl;
+      std::cout<<"calling TrackDistances with:\n"
+	       <<"\trelic po: ("<<batch.x[i]<<", "<<batch.y[i]<<", "<<batch.z[i]<<")\n"
 	       <<"\tmuon entry point: ("<<muon_entrypoint[0]<<", "<<muon_entrypoint[1]<<", "<<muon_entrypoint[2]<<")\n"
 	       <<"\tmuon entry dir: ("<<muon_direction[0]<<", "<<muon_direction[1]<<", "<<muon_direction[2]<<")"<<")\n"
-	       <<"\tmax_energy_dp_pos: "<< max_energy_dep_pos<< ", appr: "<<appr<<std::endl;
+	       <<"\tmax_energy_dp_pos: "<< mu.max_energy_dep_pos<< ", appr: "<<appr<<std::endl;
       throw std::runtime_error("CalculateSpallationVariables:: bad dll");
     }
 
+    PairingInfo p = {batch.dt[i], dlt, dll, mu.muqismsk, mu.resQ, mu.muon_type, batch.bse[i]};
+    RecordPairing(p);
+  }
 
-    dt > 0 ? pre_dll_hist.Fill(dll) : post_dll_hist.Fill(dll);
+  batch.clear();
+}
 
-    /* muqismsk - max charge deposited in the detector by the muon*/
-    float muqismsk = (MU_ptr->muqismsk);
-    dt > 0 ? pre_muqismsk_hist.Fill(muqismsk) : post_muqismsk_hist.Fill(muqismsk);
-    
-    /* 
-       resQ - residual charge deposited by the muon compared to the value expected from the min ionization. 
-       reQ = muqismsk - q_MI * L, where q_MI is the number of photoelectrons per cm expected from the min ionization
-       and L is the track length. L = sum_{i}(Li) for multiple tracks. Does that not make sense to you? yeah well get in line
-    */
-
-    double pe_per_coulomb = 30;     // this might come back to bite me but break in the sun till the sun breaks down old boy
-    const float pe_per_cm = 26.78;
-    double pe_from_muon = MU_ptr->muqismsk * (pe_per_cm / pe_per_coulomb);  // pe*cm^-1 / pe*C^-1 = C/cm
-    double pe_from_MIP = muon_tracklen * pe_per_cm;
-    float resQ = pe_from_muon - pe_from_MIP;
-    dt > 0 ? pre_resQ_hist.Fill(resQ) : post_resQ_hist.Fill(resQ);
-
-    /* lastly, we need the type of muon event: misfit=0, single_through=1, single_stopping=2, multi=3,4, corner=5 */
-    int muon_type = MU_ptr->muboy_status;
-
-    /* oh we also need to the bsenergy: */
-    float bse = LOWE_ptr->bsenergy;
-    
-    PairingInfo p = {dt, dlt, dll, muqismsk, resQ, muon_type, bse};
-    std::string p_str = GetPairingString(p);
-    pairings[p_str].push_back(p);
+void CalculateSpallationVariables::RecordPairing(const PairingInfo& p){
+  const float dt = p.dt;
+  dt > 0 ? pre_dlt_hist.Fill(p.dlt) : post_dlt_hist.Fill(p.dlt);
+  dt > 0 ? pre_dll_hist.Fill(p.dll) : post_dll_hist.Fill(p.dll);
+  dt > 0 ? pre_muqismsk_hist.Fill(p.muqismsk) : post_muqismsk_hist.Fill(p.muqismsk);
+  dt > 0 ? pre_resQ_hist.Fill(p.resQ) : post_resQ_hist.Fill(p.resQ);
+  std::string p_str = GetPairingString(p);
+  pairings[p_str].push_back(p);
+}
+
+void CalculateSpallationVariables::ProcessPendingPairs(){
+
+  // visit the pairings in order of relic entry, so the relic tree is read sequentially
+  // and each entry at most once, however many muons it was matched to
+  std::vector<size_t> order(pending_pairs.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b){
+    return pending_pairs[a].relic_entry < pending_pairs[b].relic_entry;
+  });
+
+  long loaded_entry = -1;
+  for (size_t i : order){
+    PendingPair& pair = pending_pairs[i];
+    if (pair.relic_entry != loaded_entry){
+      relic_tree_ptr->GetEntry(pair.relic_entry);
+      GetRelicBranchValues();
+      loaded_entry = pair.relic_entry;
+    }
+    for (int j = 0; j < 3; ++j) pair.bsvertex[j] = LOWE_ptr->bsvertex[j];
+    pair.bsenergy = LOWE_ptr->bsenergy;
   }
-  
-  return true;
+  Log(m_unique_name+": joined "+toString(pending_pairs.size())+" pairings from "+toString(pending_muons.size())
+      +" muons against the relic tree",v_message,m_verbose);
+
+  // then calculate and record them in the original order, one muon at a time
+  for (size_t i = 0; i < pending_pairs.size(); ++i){
+    const PendingPair& pair = pending_pairs[i];
+    AddRelic(pair.dt, pair.bsvertex, pair.bsenergy);
+    if (i+1 == pending_pairs.size() || pending_pairs[i+1].muon_idx != pair.muon_idx){
+      CalculatePairings(pending_muons[pair.muon_idx]);
+    }
+  }
+  pending_pairs.clear();
+  pending_muons.clear();
 }
 
 
 bool CalculateSpallationVariables::Finalise(){
+
+  if (sorted_join) ProcessPendingPairs();
   
   std::string outputfile_str = "";
   m_variables.Get("outputfile_str", outputfile_str);
@@ -193,7 +282,9 @@ bool CalculateSpallationVariables::Finalise(){
   
   for (const auto& [name, v_pairing] : pairings){
     std::cout << "name: " << name << std::endl;
-    CreateLikelihood(name, v_pairing);
+    if (!CreateLikelihood(name, v_pairing)){
+      Log(m_unique_name+": failed to write PDFs to "+pdf_output_prefix+name+".bin",v_error,m_verbose);
+    }
     
   }
   
@@ -274,7 +365,7 @@ std::string CalculateSpallationVariables::GetPairingString(PairingInfo p) const
   return hist_str;
 }
 
-void CalculateSpallationVariables::CreateLikelihood(const std::string& name, const std::vector<PairingInfo>& vp) const {
+bool CalculateSpallationVariables::CreateLikelihood(const std::string& name, const std::vector<PairingInfo>& vp) const {
   TH1D pre_dt("pre_dt", "pre_dt", nbins, 0, 60), post_dt("post_dt", "post_dt", nbins, 0, 60),
     pre_dlt("pre_dlt", "pre_dlt", nbins, 0, 5000), post_dlt("post_dlt", "post_dlt", nbins, 0, 5000),
     pre_dll("pre_dll", "pre_dll", nbins, -5000, 5000), post_dll("post_dll", "post_dll", nbins, -5000, 5000),
@@ -361,33 +452,57 @@ void CalculateSpallationVariables::CreateLikelihood(const std::string& name, con
   resQ_spall.Write();
   resQ_rand.Write();
 
-  TH1D likepre(("likepre_"+name).c_str(), "likepre;L_{spall}", nbins, -30, 30);
-  TH1D likepost(("likepost_"+name).c_str(), "likepost;L_{spall}", nbins, -30, 30);
+  // freeze the PDFs into lookup tables.
+  // n.b. the resQ PDFs hold the contents of the pre/post histograms, so take their range from those
+  SpallationLikelihood likelihood;
+  likelihood.SetSmoothing(pdf_smoothing);
+  likelihood.SetFloor(pdf_floor);
+  likelihood.SetInterpolate(pdf_interpolate);
+  if (!pdf_input_prefix.empty()){
+    const std::string pdf_file = pdf_input_prefix + name + ".bin";
+    if (!likelihood.Read(pdf_file)){
+      throw std::runtime_error("CalculateSpallationVariables::CreateLikelihood - couldn't read PDFs from "+pdf_file);
+    }
+  } else {
+    const std::pair<const TH1D*, const TH1D*> pdfs[SpallationLikelihood::kNumVariables] =
+      {{&dt_spall, &dt_rand}, {&dlt_spall, &dlt_rand}, {&dll_spall, &dll_rand},
+       {&muqismsk_spall, &muqismsk_rand}, {&resQ_spall, &resQ_rand}};
+    const TH1D* ranges[SpallationLikelihood::kNumVariables] = {&pre_dt, &pre_dlt, &pre_dll, &pre_muqismsk, &pre_resQ};
+    for (int var = 0; var < SpallationLikelihood::kNumVariables; ++var){
+      const TAxis* axis = ranges[var]->GetXaxis();
+      // GetArray includes the underflow bin
+      likelihood.SetPDF(var, axis->GetXmin(), axis->GetXmax(), nbins,
+			pdfs[var].first->GetArray()+1, pdfs[var].second->GetArray()+1);
+    }
+  }
+  // the likelihood is still made if the PDFs can't be saved; the caller reports it
+  const bool pdfs_written = pdf_output_prefix.empty() || likelihood.Write(pdf_output_prefix + name + ".bin");
 
+  // evaluate all pairings together, one array per variable
+  std::vector<float> values[SpallationLikelihood::kNumVariables];
+  for (auto& v : values) v.reserve(vp.size());
   for (const auto& p : vp){
+    values[SpallationLikelihood::kDt].push_back(abs(p.dt));
+    values[SpallationLikelihood::kDlt].push_back(p.dlt);
+    values[SpallationLikelihood::kDll].push_back(p.dll);
+    values[SpallationLikelihood::kMuqismsk].push_back(p.muqismsk);
+    values[SpallationLikelihood::kResQ].push_back(p.resQ);
+  }
+  const float* value_ptrs[SpallationLikelihood::kNumVariables];
+  for (int var = 0; var < SpallationLikelihood::kNumVariables; ++var) value_ptrs[var] = values[var].data();
+  std::vector<float> likelihoods(vp.size());
+  likelihood.Evaluate(vp.size(), value_ptrs, likelihoods.data(), likelihood_threads);
 
-    const int dt_bin = nbins * ((abs(p.dt) / (60)));
-    const int dlt_bin = nbins * (p.dlt / 5000);
-    const int dll_bin = nbins * ((p.dll + 5000)/(10000));
-    const int muqismsk_bin = nbins * (p.muqismsk / 250000);
-    const int resQ_bin = nbins * ((p.resQ + 100000)/(200000));
-
-    //std::cout << dt_bin << dlt_bin << dll_bin << muqismsk_bin << resQ_bin << std::endl;
-    
-    double likelihood = std::log10(
-				   dt_spall.GetBinContent(dt_bin) / dt_rand.GetBinContent(dt_bin) *
-				   dlt_spall.GetBinContent(dlt_bin) / dlt_rand.GetBinContent(dlt_bin) *
-				   dll_spall.GetBinContent(dll_bin) / dll_rand.GetBinContent(dll_bin) *
-				   muqismsk_spall.GetBinContent(muqismsk_bin) / muqismsk_rand.GetBinContent(muqismsk_bin) *
-				   resQ_spall.GetBinContent(resQ_bin) / resQ_rand.GetBinContent(resQ_bin));
-
-    p.dt > 0 ? likepre.Fill(likelihood) : likepost.Fill(likelihood);
-    
+  TH1D likepre(("likepre_"+name).c_str(), "likepre;L_{spall}", nbins, -30, 30);
+  TH1D likepost(("likepost_"+name).c_str(), "likepost;L_{spall}", nbins, -30, 30);
+  for (size_t i = 0; i < vp.size(); ++i){
+    vp[i].dt > 0 ? likepre.Fill(likelihoods[i]) : likepost.Fill(likelihoods[i]);
   }
 
   likepre.Write();
   likepost.Write();
   
+  return pdfs_written;
 }
 
 double CalculateSpallationVariables::CalculateTrackLen(float* muon_entrypoint, float* muon_direction, double* exitpt){
@@ -30,11 +30,52 @@ public:
 
 private:
 
+  // per-muon quantities, independent of the relic it is paired with
+  struct MuonTrackInfo {
+    float entrypoint[3];
+    float direction[3];
+    double tracklen = 0;
+    double max_energy_dep_pos = 0;
+    float muqismsk = 0;
+    float resQ = 0;
+    int muon_type = 0;
+  };
+  // a pairing awaiting the sorted join
+  struct PendingPair {
+    long relic_entry;
+    size_t muon_idx;  // in pending_muons
+    float dt;
+    float bsvertex[3];
+    float bsenergy;
+  };
+  // relics to be paired with the current muon, one array per variable for TrackDistances
+  struct RelicBatch {
+    std::vector<float> dt, x, y, z, bse, dlt, appr;
+    void clear(){ dt.clear(); x.clear(); y.clear(); z.clear(); bse.clear(); dlt.clear(); appr.clear(); }
+  };
+
   void GetMuonBranchValues();
   void GetRelicBranchValues();
   std::string GetPairingString(PairingInfo) const;
   double CalculateTrackLen(float*, float*, double* exit=nullptr);
-  void CreateLikelihood(const std::string&, const std::vector<PairingInfo>&) const;
+  bool CreateLikelihood(const std::string&, const std::vector<PairingInfo>&) const; // false if the PDFs couldn't be written
+  MuonTrackInfo GetMuonTrackInfo();
+  void AddRelic(float dt, const float* bsvertex, float bsenergy);
+  void CalculatePairings(MuonTrackInfo&);
+  void RecordPairing(const PairingInfo&);
+  void ProcessPendingPairs();
+
+  bool sorted_join = false;
+  std::vector<MuonTrackInfo> pending_muons;
+  std::vector<PendingPair> pending_pairs;
+  RelicBatch batch;
+
+  std::string pdf_input_prefix = "";
+  std::string pdf_output_prefix = "";
+  int pdf_smoothing = 0;
+  double pdf_floor = 1e-9;
+  bool pdf_interpolate = false;
+  int likelihood_threads = 1;
 
   std::string run_type_str = "";
   
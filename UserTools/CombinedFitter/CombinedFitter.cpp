@@ -25,7 +25,6 @@
 #include "goodness.h"
 
 #include <TCanvas.h>
-#include <TRandom.h>
 
 CombinedFitter::CombinedFitter():Tool(){}
 
@@ -47,6 +46,7 @@ bool CombinedFitter::Initialise(std::string configfile, DataModel &data){
 	m_variables.Get("dataSrc",dataSrc);        // where to get the data from (common blocks/tqreal)
 	m_variables.Get("bonsaiSrc",bonsaiSrc);    // which bonsai to use (skofl or local)
 	m_variables.Get("addNoise",addNoise);      // whether to add noise to AFT
+	m_variables.Get("noiseSeed",noiseSeed);    // random seed for the AFT noise
 	m_variables.Get("outputFile",outputFile);  // name of file to save ntuples to
 	
 	// use the readerName to find the LUN associated with this file
@@ -178,12 +178,12 @@ bool CombinedFitter::Execute(){
 		int idetector[32], ithr[32], it0_offset[32], ipret0[32] ,ipostt0[32];
 		softtrg_get_cond_(idetector,ithr,it0_offset,ipret0,ipostt0);
 		SLE_threshold = ithr[2];
-		Log(m_unique_name+": SLE threshold"+toString(SLE_threshold),v_debug,m_verbose);
+		LOG_LAZY(m_unique_name+": SLE threshold"+toString(SLE_threshold),v_debug,m_verbose);
 		
 		// Update the water transparency
 		int days_to_run_start = skday_data_.relapse[skhead_.nrunsk];
 		lfwater_(&days_to_run_start, &watert);
-		Log(m_unique_name+" loaded new water transparency value "+toString(watert)
+		LOG_LAZY(m_unique_name+" loaded new water transparency value "+toString(watert)
 			+" for run "+toString(skhead_.nrunsk),v_debug,m_verbose);
 		nrunsk_last = skhead_.nrunsk;
 	}
@@ -191,6 +191,7 @@ bool CombinedFitter::Execute(){
 	if(MC && (skhead_.nrunsk!=nrunsk_last || skhead_.nsubsk!=nsubsk_last)){
 		int ierr;
 		skbadch_(&skhead_.nrunsk,&skhead_.nsubsk,&ierr);
+		m_data->UpdateChannelStatus(skhead_.nrunsk, skhead_.nsubsk);
 		nrunsk_last = skhead_.nrunsk;
 		nsubsk_last = skhead_.nsubsk;
 		if(skhead_.nrunsk!=nrunsk_last) darklf_(&skhead_.nrunsk);
@@ -199,6 +200,10 @@ bool CombinedFitter::Execute(){
 		int sk_geometry = skheadg_.sk_geometry;
 		if (sk_geometry>=4) darkmc = mc->darkds*0.7880; //(1/1.269)
 		if (darkmc==0) darkmc = 5000;
+		// n.b. cables up to numPMTs-1, as kept for the raw hits in SetAftHits
+		darkNoise.SetSeed(noiseSeed);
+		darkNoise.SetUniformRate(numPMTs-1, darkmc, &m_data->GetChannelStatus());
+		darkNoise.SetRun(skhead_.nrunsk);
 	}
 	
 	// Start by clearing all variables
@@ -341,7 +346,7 @@ bool CombinedFitter::Execute(){
 					posmcAFT[1] = secondaries->vtxprnt[isecondary][1];
 					posmcAFT[2] = secondaries->vtxprnt[isecondary][2];
 					mct_ncapture = secondaries->tscnd[isecondary];
-					Log(m_unique_name+" ncapture time "+toString(mct_ncapture),v_debug,m_verbose);
+					LOG_LAZY(m_unique_name+" ncapture time "+toString(mct_ncapture),v_debug,m_verbose);
 					break; // stop looking once we have found one
 				}
 			}
@@ -429,7 +434,7 @@ bool CombinedFitter::Execute(){
 		last_prompt = mct_ncapture; // using the mc time for now, to check the fit
 		
 		// MCInfo.prim_pret0 saves the time difference between the trigger time and geant_t0
-		Log(m_unique_name+": first prompt hit time "+toString(first_prompt)+", pret0 "+toString(mc->prim_pret0[0]),v_debug,m_verbose);
+		LOG_LAZY(m_unique_name+": first prompt hit time "+toString(first_prompt)+", pret0 "+toString(mc->prim_pret0[0]),v_debug,m_verbose);
 		float prompt_trigger_t0 = mc->prim_pret0[0]+500.;
 		
 		// Do the single-event BONSAI fit
@@ -470,7 +475,7 @@ bool CombinedFitter::Execute(){
 			}
 		}
 		nhitsAFT_raw = timesRaw.size();
-		Log(m_unique_name+": number of hits in the AFT before dark rate - "+toString(timesRaw.size()),v_debug,m_verbose);
+		LOG_LAZY(m_unique_name+": number of hits in the AFT before dark rate - "+toString(timesRaw.size()),v_debug,m_verbose);
 		// Get the hits for the peak number of events in 200 ns
 		std::vector<int> cableIDsAFT;
 		std::vector<float> chargesAFT;
@@ -480,7 +485,7 @@ bool CombinedFitter::Execute(){
 			nhitsAFT = SetAftHits(prompt_trigger_t0,SLE_threshold,addNoise,numPMTs,darkmc,last_prompt,chargesRaw,timesRaw,cableIDsRaw,nhitsRaw,chargesAFT,timesAFT,cableIDsAFT);
 		}
 		
-		Log(m_unique_name+": number of in-gate hits in the AFT trigger - "+toString(nhitsAFT),v_debug,m_verbose);
+		LOG_LAZY(m_unique_name+": number of in-gate hits in the AFT trigger - "+toString(nhitsAFT),v_debug,m_verbose);
 //		for (int hit=0;hit<nhitsAFT;hit++){
 //			Log(m_unique_name+"AFT hit time,charge,cable: "+toString(timesAFT[hit])+", "+toString(chargesAFT[hit])+", "+toString(cableIDsAFT[hit]),v_debug,m_verbose);
 //			timesAFT[hit]-=(timesAFT[0]-bstimes[0]);
@@ -601,7 +606,7 @@ bool CombinedFitter::Execute(){
 		if (bsvertex[0]<9999)
 		{
 			std::vector<int> cableIDs_n50;
-			Log(m_unique_name+" calculating NX",v_debug,m_verbose);
+			LOG_LAZY(m_unique_name+" calculating NX",v_debug,m_verbose);
 			skroot_lowe_.bsn50 = CalculateNX(50,bsvertex,cableIDs,times,cableIDs_n50);
 			
 			// TODO can we avoid using more of the fortran routines?
@@ -1021,11 +1026,8 @@ int CombinedFitter::SetAftHits(float prompt_trigger_t0, int SLE_threshold, int a
 //		timesRawz.push_back(sktqz_.tiskz[i]);
 //	}
 	
-	// Create a vector of IDs for removing bad channels
-	std::vector<int> badIDs;
-	for (int ibadch=0; ibadch< combad_.nbad; ibadch++){
-		badIDs.push_back(combad_.isqbad[ibadch]);
-	}
+	// bad channels of the current run/subrun
+	const ChannelStatus& channelStatus = m_data->GetChannelStatus();
 	
 	// Loop over all raw hits after the SHE and remove OD hits, bad channels, etc
 	for (int ihit = 0; ihit<nhitsRaw; ihit++){
@@ -1037,9 +1039,9 @@ int CombinedFitter::SetAftHits(float prompt_trigger_t0, int SLE_threshold, int a
 			continue;
 		
 		// Remove bad channels TODO missing channels
-		bool bad = (find(badIDs.begin(),badIDs.end(),cableIDsRaw[ihit]) != badIDs.end());
+		bool bad = channelStatus.IsBad(cableIDsRaw[ihit]);
 		if (bad){
-			Log(m_unique_name+" removing bad channel "+toString(cableIDsRaw[ihit]),v_debug,m_verbose);
+			LOG_LAZY(m_unique_name+" removing bad channel "+toString(cableIDsRaw[ihit]),v_debug,m_verbose);
 			continue; 
 		}
 		
@@ -1057,48 +1059,19 @@ int CombinedFitter::SetAftHits(float prompt_trigger_t0, int SLE_threshold, int a
 		[](HitInfo const& i, HitInfo const& j) {return i.time < j.time;});
 	
 	if (addNoise){
-		Log(m_unique_name+" Warning, adding dark noise",v_debug,m_verbose);
-		TRandom rnd;
-		// Get a random dark rate for this event
-		float darkRate = numPMTs*darkmc;// total expected dark rate in Hz
-		float ndark = rnd.Poisson(darkRate); // dark rate
-		ndark *= 1e-9;
-		Log(m_unique_name+" Dark hits per ns "+toString(ndark),v_debug,m_verbose);
+		LOG_LAZY(m_unique_name+" Warning, adding dark noise",v_debug,m_verbose);
+		// add noise from 300 ns before the first hit to 100 ns after the last;
+		// the noise hits come out in time order, so are merged in rather than re-sorting
 		float tstartNoise = hits_tmp[0].time-300;
 		float tendNoise = hits_tmp[hits_tmp.size()-1].time+100;
-		float noiseWindow = tendNoise - tstartNoise; // total in the AFT
-		ndark *= noiseWindow;// total 
-		Log(m_unique_name+" Dark rate "+toString(darkRate),v_debug,m_verbose);
-		Log(m_unique_name+" Noise window "+toString(noiseWindow),v_debug,m_verbose);
-		Log(m_unique_name+" Total dark hits "+toString(ndark),v_debug,m_verbose);
-		// loop over randomly generated dark hits and assign random dark
-		// rate where event rate is below dark rate for hits in trigger
-		for (int darkhit = 0; darkhit<ndark; darkhit++){
-			
-			// pick a random cable ID (PMT) and random time
-			int cableDark = (int)(numPMTs*rnd.Rndm())+1;
-			bool bad = (find(badIDs.begin(),badIDs.end(),cableDark) != badIDs.end());
-			// Remove bad channels and hits not in the inner detector
-			if (bad) 
-				continue;
-			if (cableDark<0 || cableDark>=numPMTs)
-				continue;
-			// TODO remove missing channels
-			
-			// pick a random time between the end of the SHE - 1000 ns (the neutron
-			// capture at the moment, for testing purposes) and 1000 ns after 
-			// the last neutron-capture hit
-			float timeDark = tstartNoise + noiseWindow*rnd.Rndm();
-			
-			// Randomly generate a cable ID and charge and add the hit to 
-			// our list of raw hits
-			hits_tmp.push_back({abs(rnd.Gaus(1,0.7)), timeDark, cableDark});
-			nhitsRaw++;
-		} // end of loop over dark hits
-		
-		// Re-sort the hits in order of ascending time
-		sort(hits_tmp.begin(),hits_tmp.end(),
-			[](HitInfo const& i, HitInfo const& j) {return i.time < j.time;});
+		int ndark = darkNoise.Generate(skhead_.nrunsk, skhead_.nevsk, 0, tstartNoise, tendNoise, noiseHits);
+		LOG_LAZY(m_unique_name+" Dark rate "+toString(darkNoise.GetTotalRate()),v_debug,m_verbose);
+		LOG_LAZY(m_unique_name+" Noise window "+toString(tendNoise-tstartNoise),v_debug,m_verbose);
+		LOG_LAZY(m_unique_name+" Total dark hits "+toString(ndark),v_debug,m_verbose);
+		DarkNoise::Merge(hits_tmp, noiseHits,
+			[](DarkNoise::Hit const& h) { return HitInfo{h.charge, h.time, h.cable}; },
+			[](HitInfo const& h) { return h.time; });
+		nhitsRaw += ndark;
 	} // endif
 	
 	
@@ -1153,7 +1126,7 @@ int CombinedFitter::SetAftHits(float prompt_trigger_t0, int SLE_threshold, int a
 		chargesAFT.push_back(ihit.charge);
 		timesAFT.push_back(ihit.time-t_trigger + prompt_trigger_t0); // 500 time offset and make prompt and delayed trigger times the same
 	}
-	Log(m_unique_name+": prompt trigger "+toString(prompt_trigger_t0)+", delayed trigger time "+toString(t_trigger)+", time of first hit in delayed trigger "+toString(timesAFT[0]),v_debug,m_verbose);
+	LOG_LAZY(m_unique_name+": prompt trigger "+toString(prompt_trigger_t0)+", delayed trigger time "+toString(t_trigger)+", time of first hit in delayed trigger "+toString(timesAFT[0]),v_debug,m_verbose);
 	
 	return(hits_tmp.size());
 }
@@ -10,6 +10,7 @@
 #include "pmt_geometry.h"
 #include "bonsaifit.h"
 #include "pairlikelihood.h"
+#include "DarkNoise.h"
 
 #include <TH1.h>
 
@@ -104,6 +105,7 @@ class CombinedFitter: public Tool {
 	int ev=0;
 	bool MC=false;
 	bool addNoise = true;
+	int noiseSeed = 0; // noise for each (run, event) is reproducible for a given seed
 	int dataSrc=0;     // 0=sktqz_ common block, 1=TQReal branch
 	int bonsaiSrc = 0; // 0= built-in bonsai calls; 1 = direct bonsai functions
 
@@ -113,6 +115,10 @@ class CombinedFitter: public Tool {
 	pairlikelihood* bspairlike;
 	bonsaifit *bspairfit;
 
+	// dark noise for the AFT, rates set on each new run/subrun
+	DarkNoise darkNoise;
+	std::vector<DarkNoise::Hit> noiseHits;
+
 
 };
 
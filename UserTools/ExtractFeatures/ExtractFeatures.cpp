@@ -1,10 +1,26 @@
 #include "ExtractFeatures.h"
 
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <memory>
+
 #include "skheadC.h"
 #include "geotnkC.h"
 
 #include "Calculator.h"
 #include "SK_helper_functions.h"
+#include "EventContext.h"
+
+EVENT_PARALLEL_TOOL(ExtractFeatures);
+
+const std::array<std::string, ExtractFeatures::nFeatures> ExtractFeatures::featureNames = {
+    "NHits", "N50", "N200", "N1300", "ReconCT", "TRMS", "QSum",
+    "Beta1", "Beta2", "Beta3", "Beta4", "Beta5",
+    "AngleMean", "AngleSkew", "AngleStdev", "CaptureType",
+    "DWall", "DWallMeanDir", "ThetaMeanDir", "DWall_n", "prompt_nfit",
+    "decay_e_like", "TrmsFitVertex_X", "TrmsFitVertex_Y", "TrmsFitVertex_Z"
+};
 
 bool ExtractFeatures::Initialise(std::string configfile, DataModel &data)
 {
@@ -34,17 +50,16 @@ bool ExtractFeatures::Initialise(std::string configfile, DataModel &data)
         if (!m_variables.Get("TMATCHWINDOW", tMatchWindow)) tMatchWindow = 50;
     }
     
-    // define key list to branch
-    // TODO again this needs to match the list of features in the ApplyTMVA Tool,
-    // so we should ensure that somehow.
-    std::vector<std::string>keyList = {"NHits", "N50", "N200", "N1300", "ReconCT", "TRMS", "QSum", 
-                                       "Beta1", "Beta2", "Beta3", "Beta4", "Beta5", 
-                                       "AngleMean", "AngleSkew", "AngleStdev", "CaptureType",
-                                       "DWall", "DWallMeanDir", "ThetaMeanDir", "DWall_n", "prompt_nfit",
-                                       "decay_e_like", "TrmsFitVertex_X", "TrmsFitVertex_Y", "TrmsFitVertex_Z"};
-    
-    // register keys to the feature map
-    m_data->eventCandidates.RegisterFeatureNames(keyList);
+    // threads to extract the features of the candidates of each event on; 0 for the calling thread.
+    // Under ParallelEvents each event slot has its own workers
+    m_variables.Get("NTHREADS", nThreads);
+    if (nThreads > 0) scheduler.Start(nThreads);
+    scratch.resize(std::max(nThreads, 1));
+
+    // register the features to the candidate feature schema, and keep their columns.
+    // ApplyTMVA checks at its Initialise that the features it needs are registered.
+    for (int f = 0; f < nFeatures; f++)
+        featureIDs[f] = m_data->eventCandidates.RegisterFeatureName(featureNames[f]);
 
     return true;
 }
@@ -70,122 +85,193 @@ bool ExtractFeatures::Execute()
 
     EventPMTHits* eventHits = &(m_data->eventPMTHits);
     EventCandidates* eventCans = &(m_data->eventCandidates);
-    EventTrueCaptures* eventCaps = &(m_data->eventTrueCaptures);
-    EventParticles* eventSecs = &(m_data->eventSecondaries);
 
     unsigned int nCandidates = eventCans->GetSize();
 
+    // from here the event hits are only read, so the candidates can be processed concurrently
     if (!eventHits->HasVertex())
         eventHits->SetVertex(promptVertex);
+    if (!eventHits->IsSorted())
+        eventHits->Sort();
 
-    // loop over candidates
-    for (unsigned int i = 0; i < nCandidates; i++) {
-        Candidate* candidate = &(eventCans->At(i));
-        int firstHitID = candidate->HitID();
-
-        PMTHitCluster hitsInTWIDTH = eventHits->Slice(firstHitID, tWidth);
-        PMTHitCluster hitsIn50ns   = eventHits->Slice(firstHitID, tWidth/2.- 50, tWidth/2.+ 50);
-        PMTHitCluster hitsIn200ns  = eventHits->Slice(firstHitID, tWidth/2.-100, tWidth/2.+100);
-        PMTHitCluster hitsIn1300ns = eventHits->Slice(firstHitID, tWidth/2.-520, tWidth/2.+780);
-
-        // Number of hits
-        candidate->Set("NHits", hitsInTWIDTH.GetSize());
-        candidate->Set("N50",   hitsIn50ns.GetSize());
-        candidate->Set("N200",  hitsIn200ns.GetSize());
-        candidate->Set("N1300", hitsIn1300ns.GetSize());
-
-        // Time
-        float reconCT = hitsInTWIDTH.Find(HitFunc::T, Calc::Mean) * 1e-3;
-        candidate->Set("ReconCT", reconCT);
-        candidate->Set("TRMS", hitsInTWIDTH.Find(HitFunc::T, Calc::RMS));
-
-        // Charge
-        candidate->Set("QSum", hitsInTWIDTH.Find(HitFunc::Q, Calc::Sum));
-
-        // Beta's
-        std::array<float, 6> beta = hitsInTWIDTH.GetBetaArray();
-        candidate->Set("Beta1", beta[1]);
-        candidate->Set("Beta2", beta[2]);
-        candidate->Set("Beta3", beta[3]);
-        candidate->Set("Beta4", beta[4]);
-        candidate->Set("Beta5", beta[5]);
-
-        // DWall
-        auto dirVec = hitsInTWIDTH[HitFunc::Dir];
-        auto meanDir = GetMean(dirVec).Unit();
-        candidate->Set("DWall", dWall);
-        candidate->Set("DWallMeanDir", GetDWallInDirection(promptVertex, meanDir));
-
-        // Mean angle formed by all hits and the mean hit direction
-        std::vector<float> angles;
-        for (auto const& dir: dirVec) {
-            angles.push_back((180/M_PI)*meanDir.Angle(dir));
-        }
-        float meanAngleWithMeanDirection = GetMean(angles);
-        candidate->Set("ThetaMeanDir", meanAngleWithMeanDirection);
-
-        // Opening angle stats
-        OpeningAngleStats openingAngleStats = hitsInTWIDTH.GetOpeningAngleStats();
-        candidate->Set("AngleMean",  openingAngleStats.mean);
-        candidate->Set("AngleStdev", openingAngleStats.stdev);
-        candidate->Set("AngleSkew",  openingAngleStats.skewness);
-
-        // TRMS-fit
-        TVector3 trmsFitVertex = hitsInTWIDTH.FindTRMSMinimizingVertex(/* TRMS-fit options */
-                                                                   initGridWidth, minGridWidth, gridShrinkRate, vertexSearchRange);
-        candidate->Set("TrmsFitVertex_X", trmsFitVertex.X());
-        candidate->Set("TrmsFitVertex_Y", trmsFitVertex.Y());
-        candidate->Set("TrmsFitVertex_Z", trmsFitVertex.Z());
-        candidate->Set("DWall_n", GetDWall(trmsFitVertex));
-        candidate->Set("prompt_nfit", (promptVertex-trmsFitVertex).Mag());
-
-        int passDecayECut = 0;
-        if ((candidate->Get("N50") > 50) && reconCT < 20) {
-            passDecayECut = 1;
-        }
-        candidate->Set("decay_e_like", passDecayECut);
-
-        // BONSAI
-
-        // MC info
-        if (inputIsMC) {
-            Log("MC!",5,m_verbose);
-            // default: not a capture
-            int captureType = 0;
-            int nTrueCaptures = eventCaps->GetSize();
-            int nSecondaries = eventSecs->GetSize();
-
-            // label candidates as signal if a true capture with matching capture time exists
-            for (int iCapture = 0; iCapture < nTrueCaptures; iCapture++) {
-                TrueCapture& capture = eventCaps->At(iCapture);
-                if (fabs(capture.Time() - reconCT*1e3) < tMatchWindow) {
-                    if (capture.Energy() > 6.) captureType = 2; // Gd
-                    else                       captureType = 1; // H
-                }
-            }
-            
-            // search for a matching decay electron and overwrite label
-            for (int iSec = 0; iSec < nSecondaries; iSec++) {
-                Particle& secondary = eventSecs->At(iSec);
-
-                // decay electron from a parent muon
-                if (fabs(secondary.PID()) == 11 &&
-                    fabs(secondary.ParentPID()) == 13 &&
-                    secondary.IntID() == 5) {
-                    // check if ReconCT matches the decay within TMATCHWINDOW
-                    if (fabs(secondary.Time() - reconCT*1e3) < tMatchWindow) {
-                        captureType = 3; // decay electron
-                    }
+    if (nThreads > 0 && nCandidates > 1) {
+        // each task takes the next unprocessed candidate until there are none left,
+        // so a few slow TRMS fits don't hold up the rest
+        std::atomic<unsigned int> nextCandidate(0);
+        std::vector<std::future<void>> done;
+        for (int iTask = 0; iTask < nThreads && iTask < (int)nCandidates; iTask++) {
+            auto promise = std::make_shared<std::promise<void>>();
+            done.push_back(promise->get_future());
+            scheduler.Submit([&, promise]() {
+                try {
+                    Scratch& workerScratch = scratch.at(WorkStealingScheduler::CurrentWorker());
+                    for (unsigned int i = nextCandidate++; i < nCandidates; i = nextCandidate++)
+                        ExtractCandidate(i, promptVertex, dWall, workerScratch);
+                    promise->set_value();
+                } catch (...) {
+                    // scheduler tasks must not throw; hand it to the waiting thread
+                    promise->set_exception(std::current_exception());
                 }
+            });
+        }
+        bool ok = true;
+        for (auto& taskDone: done) {
+            try {
+                taskDone.get();
+            } catch (std::exception& e) {
+                Log(std::string("Feature extraction failed: ") + e.what(), pERROR, m_verbose);
+                ok = false;
+            } catch (...) {
+                Log("Feature extraction failed!", pERROR, m_verbose);
+                ok = false;
             }
-            candidate->Set("CaptureType", captureType);
+        }
+        if (!ok) return false;
+    }
+    else {
+        for (unsigned int i = 0; i < nCandidates; i++)
+            ExtractCandidate(i, promptVertex, dWall, scratch[0]);
+    }
+
+    // MC info
+    if (inputIsMC) {
+        Log("MC!",5,m_verbose);
+        SortTrueTimes();
+        for (unsigned int i = 0; i < nCandidates; i++) {
+            float* features = eventCans->Row(i);
+            features[featureIDs[kCaptureType]] = GetCaptureType(features[featureIDs[kReconCT]]);
         }
     }
 
     return true;
 }
 
+void ExtractFeatures::ExtractCandidate(unsigned int i, const TVector3& promptVertex, float dWall, Scratch& workerScratch)
+{
+    EventPMTHits* eventHits = &(m_data->eventPMTHits);
+    EventCandidates* eventCans = &(m_data->eventCandidates);
+
+    Candidate* candidate = &(eventCans->At(i));
+    int firstHitID = candidate->HitID();
+    float* features = eventCans->Row(i);
+    auto Set = [&](Feature f, float value) { features[featureIDs[f]] = value; };
+
+    PMTHitCluster hitsInTWIDTH = eventHits->Slice(firstHitID, tWidth);
+    PMTHitCluster hitsIn50ns   = eventHits->Slice(firstHitID, tWidth/2.- 50, tWidth/2.+ 50);
+    PMTHitCluster hitsIn200ns  = eventHits->Slice(firstHitID, tWidth/2.-100, tWidth/2.+100);
+    PMTHitCluster hitsIn1300ns = eventHits->Slice(firstHitID, tWidth/2.-520, tWidth/2.+780);
+
+    // Number of hits
+    Set(kNHits, hitsInTWIDTH.GetSize());
+    Set(kN50,   hitsIn50ns.GetSize());
+    Set(kN200,  hitsIn200ns.GetSize());
+    Set(kN1300, hitsIn1300ns.GetSize());
+
+    // Time
+    float reconCT = hitsInTWIDTH.Find(HitFunc::T, Calc::Mean) * 1e-3;
+    Set(kReconCT, reconCT);
+    Set(kTRMS, hitsInTWIDTH.Find(HitFunc::T, Calc::RMS));
+
+    // Charge
+    Set(kQSum, hitsInTWIDTH.Find(HitFunc::Q, Calc::Sum));
+
+    // Beta's
+    std::array<float, 6> beta = hitsInTWIDTH.GetBetaArray();
+    Set(kBeta1, beta[1]);
+    Set(kBeta2, beta[2]);
+    Set(kBeta3, beta[3]);
+    Set(kBeta4, beta[4]);
+    Set(kBeta5, beta[5]);
+
+    // DWall
+    auto dirVec = hitsInTWIDTH[HitFunc::Dir];
+    auto meanDir = GetMean(dirVec).Unit();
+    Set(kDWall, dWall);
+    Set(kDWallMeanDir, GetDWallInDirection(promptVertex, meanDir));
+
+    // Mean angle formed by all hits and the mean hit direction
+    std::vector<float>& angles = workerScratch.angles;
+    angles.clear();
+    for (auto const& dir: dirVec) {
+        angles.push_back((180/M_PI)*meanDir.Angle(dir));
+    }
+    float meanAngleWithMeanDirection = GetMean(angles);
+    Set(kThetaMeanDir, meanAngleWithMeanDirection);
+
+    // Opening angle stats
+    OpeningAngleStats openingAngleStats = hitsInTWIDTH.GetOpeningAngleStats();
+    Set(kAngleMean,  openingAngleStats.mean);
+    Set(kAngleStdev, openingAngleStats.stdev);
+    Set(kAngleSkew,  openingAngleStats.skewness);
+
+    // TRMS-fit
+    TVector3 trmsFitVertex = hitsInTWIDTH.FindTRMSMinimizingVertex(/* TRMS-fit options */
+                                                               initGridWidth, minGridWidth, gridShrinkRate, vertexSearchRange);
+    Set(kTrmsFitVertexX, trmsFitVertex.X());
+    Set(kTrmsFitVertexY, trmsFitVertex.Y());
+    Set(kTrmsFitVertexZ, trmsFitVertex.Z());
+    Set(kDWall_n, GetDWall(trmsFitVertex));
+    Set(kPromptNFit, (promptVertex-trmsFitVertex).Mag());
+
+    int passDecayECut = 0;
+    if ((hitsIn50ns.GetSize() > 50) && reconCT < 20) {
+        passDecayECut = 1;
+    }
+    Set(kDecayELike, passDecayECut);
+
+    // BONSAI
+}
+
+void ExtractFeatures::SortTrueTimes()
+{
+    EventTrueCaptures* eventCaps = &(m_data->eventTrueCaptures);
+    EventParticles* eventSecs = &(m_data->eventSecondaries);
+
+    captureTimes.clear();
+    for (int iCapture = 0; iCapture < (int)eventCaps->GetSize(); iCapture++)
+        captureTimes.emplace_back(eventCaps->At(iCapture).Time(), iCapture);
+    std::sort(captureTimes.begin(), captureTimes.end());
+
+    // decay electrons from a parent muon
+    decayETimes.clear();
+    for (int iSec = 0; iSec < (int)eventSecs->GetSize(); iSec++) {
+        Particle& secondary = eventSecs->At(iSec);
+        if (fabs(secondary.PID()) == 11 &&
+            fabs(secondary.ParentPID()) == 13 &&
+            secondary.IntID() == 5)
+            decayETimes.push_back(secondary.Time());
+    }
+    std::sort(decayETimes.begin(), decayETimes.end());
+}
+
+int ExtractFeatures::GetCaptureType(float reconCT) const
+{
+    // the true times t with fabs(t - reconCT*1e3) < TMATCHWINDOW.
+    // t - reconCT*1e3 only grows with t, so they are a contiguous range of the sorted times
+    const double candidateTime = reconCT*1e3;
+    auto IsBefore = [&](double t) { return t - candidateTime <= -tMatchWindow; };
+    auto IsNotAfter = [&](double t) { return t - candidateTime < tMatchWindow; };
+
+    // a matching decay electron overrides any capture
+    auto decayE = std::partition_point(decayETimes.begin(), decayETimes.end(), IsBefore);
+    if (decayE != decayETimes.end() && IsNotAfter(*decayE))
+        return 3; // decay electron
+
+    // signal if a true capture with matching capture time exists; the last one in the event decides
+    auto first = std::partition_point(captureTimes.begin(), captureTimes.end(),
+                                      [&](const std::pair<double, int>& capture) { return IsBefore(capture.first); });
+    int iMatch = -1;
+    for (auto capture = first; capture != captureTimes.end() && IsNotAfter(capture->first); ++capture)
+        iMatch = std::max(iMatch, capture->second);
+    if (iMatch < 0)
+        return 0; // not a capture
+
+    if (m_data->eventTrueCaptures.At(iMatch).Energy() > 6.) return 2; // Gd
+    else                                                    return 1; // H
+}
+
 bool ExtractFeatures::Finalise()
 {
+    scheduler.Stop();
     return true;
 }
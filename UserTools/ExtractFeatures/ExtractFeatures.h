@@ -1,9 +1,15 @@
 #ifndef EXTRACTFEATURES_HH
 #define EXTRACTFEATURES_HH
 
-#include "Tool.h"
+#include <array>
+#include <vector>
 
-class ExtractFeatures : public Tool
+#include "EventParallelTool.h"
+#include "WorkStealingScheduler.h"
+
+class TVector3;
+
+class ExtractFeatures : public EventParallelTool
 {
     public:
         ExtractFeatures():
@@ -14,6 +20,18 @@ class ExtractFeatures : public Tool
         bool Initialise(std::string configfile, DataModel &data);
         bool Execute();
         bool Finalise();
+
+        // the features this Tool fills for each candidate
+        enum Feature {
+            kNHits, kN50, kN200, kN1300, kReconCT, kTRMS, kQSum,
+            kBeta1, kBeta2, kBeta3, kBeta4, kBeta5,
+            kAngleMean, kAngleSkew, kAngleStdev, kCaptureType,
+            kDWall, kDWallMeanDir, kThetaMeanDir, kDWall_n, kPromptNFit,
+            kDecayELike, kTrmsFitVertexX, kTrmsFitVertexY, kTrmsFitVertexZ,
+            nFeatures
+        };
+        // feature names, indexed by Feature
+        static const std::array<std::string, nFeatures> featureNames;
 	
     private:
         std::string name;
@@ -22,6 +40,26 @@ class ExtractFeatures : public Tool
         float initGridWidth, minGridWidth, gridShrinkRate, vertexSearchRange;
         
         bool inputIsMC;
+
+        // column of each Feature in the EventCandidates feature matrix
+        std::array<int, nFeatures> featureIDs;
+
+        // candidates are shared out between nThreads workers, each with its own scratch space
+        struct Scratch {
+            std::vector<float> angles;
+        };
+        int nThreads = 0;
+        WorkStealingScheduler scheduler;
+        std::vector<Scratch> scratch;
+        // fills the features of candidate i, other than the MC truth label. Only reads the event hits,
+        // so may be called for several candidates concurrently
+        void ExtractCandidate(unsigned int i, const TVector3& promptVertex, float dWall, Scratch& workerScratch);
+
+        // MC truth times (ns) with the index of the capture or particle, sorted by time
+        std::vector<std::pair<double, int>> captureTimes;
+        std::vector<double> decayETimes;
+        void SortTrueTimes();
+        int GetCaptureType(float reconCT) const;
 };
 
 #endif
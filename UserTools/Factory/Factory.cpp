@@ -1,6 +1,7 @@
 #include "Factory.h"
+#include "ProfiledTool.h"
 
-Tool* Factory(std::string tool){
+Tool* Factory(std::string tool, bool allow_profiling){
 Tool* ret=0;
 
 // if (tool=="Type") tool=new Type;
@@ -98,6 +99,14 @@ if (tool=="RemoveBadHits") ret=new RemoveBadHits;
 if (tool=="SolarPreSelection") ret=new SolarPreSelection;
 if (tool=="SolarPostSelection") ret=new SolarPostSelection;
 if (tool=="WriteSolarMatches") ret=new WriteSolarMatches;
+if (tool=="WriteSyntheticSkroot") ret=new WriteSyntheticSkroot;
+if (tool=="ParallelEvents") ret=new ParallelEvents;
+
+// if requested in the ToolChainConfig, wrap the Tool in a proxy that records per-Tool timing statistics
+int profile_tools=0;
+if(ret!=0 && allow_profiling && DataModel::GetInstance()!=0 && DataModel::GetInstance()->vars.Get("profile_tools",profile_tools) && profile_tools){
+  ret=new ProfiledTool(ret,tool);
+}
 return ret;
 }
 
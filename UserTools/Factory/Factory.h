@@ -8,7 +8,8 @@
 /**
  * Global Factory function for creating Tools.
  @param tool Name of the Tool class to create.
+ @param allow_profiling If false, never wrap the Tool in a ProfiledTool (e.g. for Tools run on worker threads).
  */
-Tool* Factory(std::string tool);
+Tool* Factory(std::string tool, bool allow_profiling=true);
 
 #endif
@@ -0,0 +1,47 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "ProfiledTool.h"
+#include "ToolProfiler.h"
+#include "DataModel.h"
+
+ProfiledTool::ProfiledTool(Tool* toolin, std::string toolname) : Tool(), tool(toolin){
+	// the ToolChain builds its DataModel before loading the Tools, so the instance exists by now
+	DataModel* data = DataModel::GetInstance();
+	if(data->toolProfiler==nullptr){
+		std::string outfile="";
+		int verbosity=1;
+		data->vars.Get("profile_output",outfile);
+		data->vars.Get("profile_verbosity",verbosity);
+		data->toolProfiler = new ToolProfiler(outfile, verbosity);
+	}
+	profiler = data->toolProfiler;
+	profile_index = profiler->Register(toolname);
+}
+
+ProfiledTool::~ProfiledTool(){
+	delete tool;
+}
+
+bool ProfiledTool::Initialise(std::string configfile, DataModel &data){
+	m_data= &data;
+	m_log= m_data->Log;
+	profiler->SetConfigFile(profile_index, configfile);
+	ToolProfiler::Snapshot start = profiler->Start();
+	bool ok = tool->Initialise(configfile, data);
+	profiler->StopInitialise(profile_index, start);
+	return ok;
+}
+
+bool ProfiledTool::Execute(){
+	ToolProfiler::Snapshot start = profiler->Start();
+	bool ok = tool->Execute();
+	profiler->StopExecute(profile_index, start, ok);
+	return ok;
+}
+
+bool ProfiledTool::Finalise(){
+	ToolProfiler::Snapshot start = profiler->Start();
+	bool ok = tool->Finalise();
+	// the summary is printed and written when the last profiled Tool is finalised
+	profiler->StopFinalise(profile_index, start);
+	return ok;
+}
@@ -0,0 +1,37 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#ifndef ProfiledTool_H
+#define ProfiledTool_H
+
+#include <string>
+
+#include "Tool.h"
+
+class ToolProfiler;
+
+/**
+* \class ProfiledTool
+*
+* Transparent proxy around a Tool that records the time, allocations and MTreeReader I/O
+* of each Initialise/Execute/Finalise call with the DataModel's ToolProfiler.
+* Created by the Factory in place of the real Tool when `profile_tools 1` is set in the ToolChainConfig.
+* The wrapped Tool is owned by, and deleted with, the proxy.
+*/
+
+class ProfiledTool: public Tool {
+	
+	public:
+	
+	ProfiledTool(Tool* toolin, std::string toolname); ///< Wrap an existing Tool instance
+	~ProfiledTool();
+	bool Initialise(std::string configfile,DataModel &data); ///< Forwards to the wrapped Tool's Initialise
+	bool Execute();  ///< Forwards to the wrapped Tool's Execute
+	bool Finalise(); ///< Forwards to the wrapped Tool's Finalise
+	
+	private:
+	Tool* tool=nullptr;
+	ToolProfiler* profiler=nullptr;
+	size_t profile_index=0;
+	
+};
+
+#endif
@@ -6,6 +6,7 @@
 #include "type_name_as_string.h"
 #include "MTreeReader.h"
 #include "MTreeSelection.h"
+#include "DtToyStudy.h"
 
 #include "TROOT.h"
 #include "TFile.h"
@@ -50,6 +51,9 @@ bool FitLi9Lifetime::Initialise(std::string configfile, DataModel &data){
 	m_variables.Get("li9_lifetime_dtmax",li9_lifetime_dtmax);
 	m_variables.Get("outputFile",outputFile);          // where to save data. If empty, current TFile
 	m_variables.Get("treeReaderName",treeReaderName);
+	m_variables.Get("n_toys",n_toys);                  // toy experiments of the likelihood fit, 0 for none
+	m_variables.Get("toy_seed",toy_seed);
+	m_variables.Get("toy_threads",toy_threads);
 	
 	myTreeReader = m_data->Trees.at(treeReaderName);
 	myTreeSelections = m_data->Selectors.at(treeReaderName);
@@ -178,7 +182,49 @@ bool FitLi9Lifetime::PlotLi9LifetimeDt(){
 	std::cout<<"doing Li9 lifetime binned chi2 fit"<<std::endl;
 	double binned_estimate = BinnedLi9DtChi2Fit(&li9_muon_dt_hist);
 	
-	// TODO (un)binned extended likelihood fit to also extract number of Li9 events?
+	// unbinned extended likelihood fit, with toy experiments to check its bias and coverage
+	if(n_toys>0) Li9DtLikelihoodToys();
+	
+	return true;
+}
+
+bool FitLi9Lifetime::Li9DtLikelihoodToys(){
+	// fit Li9 + constant background, with the Li9 lifetime floating, to the dt values,
+	// then throw toys from the fitted model and refit them the same way
+	const std::vector<double> dts(li9_muon_dt_vals.begin(), li9_muon_dt_vals.end());
+	SpallationDtLikelihood nll(li9_lifetime_dtmin, li9_lifetime_dtmax);
+	nll.AddExponential("9Li", li9_lifetime_secs);
+	nll.AddConstant("bg");
+	nll.SetEvents(dts);
+	if(nll.GetNumEvents()==0){
+		Log(m_unique_name+" Error! No Li9 candidates in the fit range for toys",v_error,m_verbose);
+		return false;
+	}
+	// start with half the events in each
+	std::vector<double> pars{0.5*nll.GetNumEvents()/nll.ExpectedEvents(0,1.),
+	                         0.5*nll.GetNumEvents()/nll.ExpectedEvents(1,1.)};
+	std::vector<double> errors;
+	const std::vector<bool> fixed(pars.size(), false);
+	// the lifetime is searched for within a decade either side of the nominal one
+	const double lifetime_min = 0.1*li9_lifetime_secs, lifetime_max = 10*li9_lifetime_secs;
+	if(!DtToyStudy::FitLifetime(nll, dts, {}, 0, lifetime_min, lifetime_max, fixed, pars, &errors)){
+		Log(m_unique_name+" Warning! Li9 dt likelihood fit did not converge",v_warning,m_verbose);
+	}
+	std::cout<<"li9 dt unbinned likelihood fit: lifetime "<<pars[2]<<" +- "<<errors[2]<<" s, "
+	         <<nll.ExpectedEvents(0,pars[0])<<" +- "<<nll.ExpectedEvents(0,errors[0])<<" Li9 events and "
+	         <<nll.ExpectedEvents(1,pars[1])<<" +- "<<nll.ExpectedEvents(1,errors[1])<<" background events in range"<<std::endl;
+	
+	// nll is left at the fitted lifetime, which the toys are thrown with
+	Log(m_unique_name+" running "+toString(n_toys)+" toy experiments",v_message,m_verbose);
+	pars.pop_back();
+	DtToyStudy toys(nll, pars);
+	toys.SetFloatLifetime(0, lifetime_min, lifetime_max);
+	toys.SetSeed(toy_seed);
+	toys.SetNThreads(toy_threads);
+	toys.Run(n_toys);
+	if(m_verbose) toys.PrintSummary();
+	TDirectory* toydir = gDirectory->mkdir("li9_dt_toys");
+	toys.Write(toydir ? toydir : gDirectory);
 	
 	return true;
 }
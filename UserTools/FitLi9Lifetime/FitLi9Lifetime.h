@@ -38,6 +38,9 @@ class FitLi9Lifetime: public Tool {
 	float li9_lifetime_dtmax;         // for Li9 candidates, seconds
 	std::string outputFile="";
 	std::string treeReaderName;
+	int n_toys=0;                     // toy experiments for the bias/pull/coverage of the likelihood fit
+	int toy_seed=0;
+	int toy_threads=1;
 	MTreeReader* myTreeReader=nullptr;
 	MTreeSelection* myTreeSelections=nullptr;
 	
@@ -47,6 +50,7 @@ class FitLi9Lifetime: public Tool {
 	bool PlotLi9BetaEnergy();
 	bool PlotLi9LifetimeDt();
 	double BinnedLi9DtChi2Fit(TH1F* li9_muon_dt_hist);
+	bool Li9DtLikelihoodToys();
 	
 	// tool variables
 	// ==============
@@ -6,6 +6,7 @@
 #include "type_name_as_string.h"
 #include "MTreeReader.h"
 #include "MTreeSelection.h"
+#include "DtToyStudy.h"
 
 #include "TROOT.h"
 #include "TFile.h"
@@ -45,6 +46,9 @@ bool FitPurewaterLi9NcaptureDt::Initialise(std::string configfile, DataModel &da
 	m_variables.Get("li9_ncapture_dtmin",ncap_dtmin);
 	m_variables.Get("li9_ncapture_dtmax",ncap_dtmax);
 	m_variables.Get("treeReaderName",treeReaderName);
+	m_variables.Get("n_toys",n_toys);                  // toy experiments of the likelihood fit, 0 for none
+	m_variables.Get("toy_seed",toy_seed);
+	m_variables.Get("toy_threads",toy_threads);
 	
 	myTreeReader = m_data->Trees.at(treeReaderName);
 	myTreeSelections = m_data->Selectors.at(treeReaderName);
@@ -132,12 +136,15 @@ bool FitPurewaterLi9NcaptureDt::PlotNcaptureDt(){
 	// there's no data beyond 500us. What's going on?
 	std::cout<<"first 100 ncapture times were: {";
 	int ncpi=0;
+	std::vector<double> ncap_dts;
+	ncap_dts.reserve(li9_ntag_dt_vals.size());
 	for(auto&& aval : li9_ntag_dt_vals){
 		// XXX FIXME REMOVE AFTER REPROCESSING IN ANALYSE XXX XXX XXX XXX XXX XXX 
 		double ncap_time_adjusted = aval < 50000 ? aval : aval - 65000;
 		ncap_time_adjusted /= 1E9;
 		if(ncpi<100){ std::cout<<ncap_time_adjusted<<", "; ++ncpi; }
 		li9_ncap_dt_hist.Fill(ncap_time_adjusted);  // FIXME weight by num_post_muons and num neutrons
+		ncap_dts.push_back(ncap_time_adjusted);
 	}
 	std::cout<<"}"<<std::endl;
 	std::cout<<"saving to file"<<std::endl;
@@ -158,6 +165,9 @@ bool FitPurewaterLi9NcaptureDt::PlotNcaptureDt(){
 	std::cout<<"doing binned chi2 fit"<<std::endl;
 	double binned_estimate = BinnedNcapDtChi2Fit(&li9_ncap_dt_hist);
 	
+	// extended likelihood fit, with toy experiments to check its bias and coverage
+	if(n_toys>0) NcapDtLikelihoodToys(ncap_dts);
+	
 	// perform an unbinned likelihood fit
 	std::cout<<"doing unbinned likelihood fit"<<std::endl;
 	UnbinnedNcapDtLogLikeFit(&li9_ncap_dt_hist, binned_estimate);
@@ -165,6 +175,41 @@ bool FitPurewaterLi9NcaptureDt::PlotNcaptureDt(){
 	return true;
 }
 
+bool FitPurewaterLi9NcaptureDt::NcapDtLikelihoodToys(const std::vector<double>& ncap_dts){
+	// fit ncapture + constant background, with the capture lifetime fixed, to the dt values [s],
+	// then throw and refit toys from the fitted model
+	SpallationDtLikelihood nll(ncap_dtmin, ncap_dtmax);
+	nll.AddExponential("ncapture", ncapture_lifetime_secs);
+	nll.AddConstant("bg");
+	nll.SetEvents(ncap_dts);
+	if(nll.GetNumEvents()==0){
+		Log(m_unique_name+" Error! No ncapture candidates in the fit range for toys",v_error,m_verbose);
+		return false;
+	}
+	// start with half the events in each
+	std::vector<double> pars{0.5*nll.GetNumEvents()/nll.ExpectedEvents(0,1.),
+	                         0.5*nll.GetNumEvents()/nll.ExpectedEvents(1,1.)};
+	std::vector<double> errors;
+	const std::vector<bool> fixed(pars.size(), false);
+	if(!DtToyStudy::Fit(nll, fixed, pars, &errors)){
+		Log(m_unique_name+" Warning! ncapture dt likelihood fit did not converge",v_warning,m_verbose);
+	}
+	std::cout<<"ncapture dt extended likelihood fit: "<<nll.ExpectedEvents(0,pars[0])<<" +- "
+	         <<nll.ExpectedEvents(0,errors[0])<<" Li9+n events and "<<nll.ExpectedEvents(1,pars[1])<<" +- "
+	         <<nll.ExpectedEvents(1,errors[1])<<" background events in range"<<std::endl;
+	
+	Log(m_unique_name+" running "+toString(n_toys)+" toy experiments",v_message,m_verbose);
+	DtToyStudy toys(nll, pars);
+	toys.SetSeed(toy_seed);
+	toys.SetNThreads(toy_threads);
+	toys.Run(n_toys);
+	if(m_verbose) toys.PrintSummary();
+	TDirectory* toydir = gDirectory->mkdir("ncap_dt_toys");
+	toys.Write(toydir ? toydir : gDirectory);
+	
+	return true;
+}
+
 double FitPurewaterLi9NcaptureDt::BinnedNcapDtChi2Fit(TH1F* li9_ncap_dt_hist){
 	// this fits the lifetime of ncapture to extract the amount of exponential and constant
 	std::cout<<"making TF1 for binned chi2 fit with "<<li9_ncap_dt_hist->GetEntries()<<" values"<<std::endl;
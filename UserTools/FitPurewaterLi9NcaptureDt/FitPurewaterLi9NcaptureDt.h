@@ -37,6 +37,7 @@ class FitPurewaterLi9NcaptureDt: public Tool {
 	bool PlotNcaptureDt();
 	double BinnedNcapDtChi2Fit(TH1F* li9_ncap_dt_hist);
 	bool UnbinnedNcapDtLogLikeFit(TH1F* li9_ncap_dt_hist, double num_li9_events);
+	bool NcapDtLikelihoodToys(const std::vector<double>& ncap_dts);
 	double ncap_lifetime_loglike(double* x, double* par);
 	
 	// tool variables
@@ -46,6 +47,9 @@ class FitPurewaterLi9NcaptureDt: public Tool {
 	float ncap_dtmin;                 // range of dt_mu_ncap values to accept
 	float ncap_dtmax;                 // for Li9 abundance extraction, **microseconds**
 	std::string treeReaderName;
+	int n_toys=0;                     // toy experiments for the bias/pull/coverage of the likelihood fit
+	int toy_seed=0;
+	int toy_threads=1;
 	MTreeReader* myTreeReader=nullptr;
 	MTreeSelection* myTreeSelections=nullptr;
 	
@@ -6,6 +6,10 @@
 #include "type_name_as_string.h"
 #include "MTreeReader.h"
 #include "MTreeSelection.h"
+#include "SpallationDtLikelihood.h"
+#include "DtToyStudy.h"
+
+#include <memory>
 
 #include "TROOT.h"
 #include "TFile.h"
@@ -16,6 +20,9 @@
 #include "TF1.h"
 #include "TFitResult.h"
 #include "TFitResultPtr.h"
+#include "Math/Minimizer.h"
+#include "Math/Factory.h"
+#include "Math/IFunction.h"
 
 FitSpallationDt::FitSpallationDt():Tool(){}
 
@@ -129,6 +136,22 @@ bool FitSpallationDt::Initialise(std::string configfile, DataModel &data){
 	// two expontial terms with a shared amplitude, i.e. (A/2)*{exp(-t/t1)+exp(-t/t2)}
 	// or combine them into one term with an average lifetime, i.e. A*(exp(-t/{(t1+t2)*0.5}))
 	
+	// instead of the staged histogram fits, all isotopes may be fit at once over the whole dt range
+	// with an extended likelihood fit to the unbinned dt values, or to a finely log-binned histogram of them
+	m_variables.Get("fit_method",fit_method);            // 'staged', 'unbinned' or 'binned'
+	m_variables.Get("fit_nbins",fit_nbins);              // number of bins for 'binned' likelihood fit
+	m_variables.Get("fit_threads",fit_threads);          // threads used to evaluate the likelihood
+	m_variables.Get("dt_fit_min",dt_fit_min);            // likelihood fit range [s]
+	m_variables.Get("dt_fit_max",dt_fit_max);
+	m_variables.Get("n_toys",n_toys);                    // toy experiments of the likelihood fit, 0 for none
+	m_variables.Get("toy_seed",toy_seed);
+	m_variables.Get("toy_threads",toy_threads);
+	if(fit_method!="staged" && fit_method!="unbinned" && fit_method!="binned"){
+		Log(m_unique_name+" Error! Unknown fit_method '"+fit_method+"', must be staged, unbinned or binned",
+		    v_error,m_verbose);
+		return false;
+	}
+	
 	// energy threshold efficiencies, from FLUKA
 	m_variables.Get("efficienciesFile",efficienciesFile);
 	
@@ -370,8 +393,13 @@ bool FitSpallationDt::PlotSpallationDt(){
 //	gPad->WaitPrimitive();
 	
 	// Now we have our histogram, fit it!
-	// we do the fitting in 5 stages, initially fitting sub-ranges of the distribution
-	for(int i=0; i<5; ++i) FitDtDistribution(*the_hist_to_fit, i);
+	if(fit_method=="staged"){
+		// we do the fitting in 5 stages, initially fitting sub-ranges of the distribution
+		for(int i=0; i<5; ++i) FitDtDistribution(*the_hist_to_fit, i);
+	} else {
+		// or all at once, to the dt values
+		FitDtUnbinned(*the_hist_to_fit);
+	}
 	
 	// the production rate integrated over the whole energy range is given by:
 	// Ri = Ni / (FV * T * eff_i)
@@ -811,6 +839,155 @@ bool FitSpallationDt::FitDtDistribution(TH1& dt_mu_lowe_hist, int rangenum){
 	return true;
 }
 
+namespace {
+	// adapts SpallationDtLikelihood for the ROOT minimisers, so that they use its analytic gradient
+	class DtNLLFunction : public ROOT::Math::IMultiGradFunction {
+		public:
+		DtNLLFunction(const SpallationDtLikelihood& nll_in) : nll(nll_in), grad(nll_in.GetNParameters()) {}
+		ROOT::Math::IMultiGenFunction* Clone() const override { return new DtNLLFunction(nll); }
+		unsigned int NDim() const override { return nll.GetNParameters(); }
+		void Gradient(const double* x, double* g) const override { nll.NLLAndGradient(x, g); }
+		void FdF(const double* x, double& f, double* g) const override { f = nll.NLLAndGradient(x, g); }
+		
+		private:
+		double DoEval(const double* x) const override { return nll.NLL(x); }
+		double DoDerivative(const double* x, unsigned int icoord) const override {
+			nll.NLLAndGradient(x, grad.data());
+			return grad[icoord];
+		}
+		const SpallationDtLikelihood& nll;
+		mutable std::vector<double> grad;
+	};
+}
+
+bool FitSpallationDt::FitDtUnbinned(TH1& dt_mu_lowe_hist){
+	/* Alternative to the staged fits of FitDtDistribution: one extended maximum likelihood fit of
+	   all isotopes and the constant background together, over the whole dt range, to the dt values
+	   themselves (fit_method 'unbinned') or to a finely log-binned histogram of them ('binned').
+	   Abundances are limited to >=0 in the minimiser, rather than by taking their magnitude.
+	   The fitted function is drawn over the histogram given, for comparison with the staged fit.
+	*/
+	const std::vector<std::string> isotopes{"12B","12N","16N","11Be","9Li","8He_9C","8Li_8B","15C"};
+	if(useHack){
+		Log(m_unique_name+" Warning! useHack is not supported by the "+fit_method+" fit and will be ignored",
+		    v_warning,m_verbose);
+	}
+	if(random_subtract){
+		Log(m_unique_name+" Warning! random_subtract is not supported by the "+fit_method
+		    +" fit, random backgrounds are fit by the constant term",v_warning,m_verbose);
+	}
+	
+	// build the model, using the same isotopes and lifetimes as the final staged fit
+	SpallationDtLikelihood nll(dt_fit_min, dt_fit_max);
+	nll.SetNThreads(fit_threads);
+	for(const std::string& anisotope : isotopes){
+		if(split_iso_pairs && anisotope.find("_")!=std::string::npos){
+			std::string first_isotope = anisotope.substr(0,anisotope.find_first_of("_"));
+			std::string second_isotope = anisotope.substr(anisotope.find_first_of("_")+1,std::string::npos);
+			nll.AddExponentialPair(anisotope, lifetimes.at(first_isotope), lifetimes.at(second_isotope));
+		} else {
+			nll.AddExponential(anisotope, lifetimes.at(anisotope));
+		}
+	}
+	const int const_par = nll.AddConstant("const");
+	
+	// spallation candidates, as in the dt histograms
+	std::vector<double> spall_dts;
+	spall_dts.reserve(dt_mu_lowe_vals.size());
+	for(auto&& aval : dt_mu_lowe_vals) if(!(aval>0)) spall_dts.push_back(fabs(aval));
+	std::vector<double> binedges;
+	if(fit_method=="binned"){
+		// log bins, with the first bin extended down to the start of the fit range
+		const double log_min = log10(std::max(dt_fit_min, 1e-4));
+		const double log_max = log10(dt_fit_max);
+		if(dt_fit_min<pow(10,log_min)) binedges.push_back(dt_fit_min);
+		for(int i=0; i<=fit_nbins; ++i) binedges.push_back(pow(10, log_min + (log_max-log_min)*double(i)/fit_nbins));
+		binedges.back() = dt_fit_max;
+		nll.SetBinnedEvents(spall_dts, binedges);
+	} else {
+		nll.SetEvents(spall_dts);
+	}
+	const double nevents = nll.GetNumEvents();
+	Log(m_unique_name+" "+fit_method+" likelihood fit of "+toString(nevents)+" events in "
+	    +toString(nll.GetNPoints())+" points",v_debug,m_verbose);
+	if(nevents==0){
+		Log(m_unique_name+" Error! No events to fit in range "+toString(dt_fit_min)+"-"+toString(dt_fit_max)+"s",
+		    v_error,m_verbose);
+		return false;
+	}
+	
+	// starting values: background rate from the last third of the range,
+	// with the remaining events shared between the isotopes
+	const double span = dt_fit_max - dt_fit_min;
+	double nlate = 0;
+	for(double adt : spall_dts) if(adt>dt_fit_max-span/3. && adt<=dt_fit_max) ++nlate;
+	const double const_start = std::max(1., nlate/(span/3.));
+	const double iso_events = std::max(nevents - const_start*span, 0.1*nevents)/isotopes.size();
+	
+	std::unique_ptr<ROOT::Math::Minimizer> minimizer(ROOT::Math::Factory::CreateMinimizer("Minuit2","Migrad"));
+	DtNLLFunction func(nll);
+	minimizer->SetFunction(func);
+	minimizer->SetErrorDef(0.5);   // negative log-likelihood
+	minimizer->SetMaxFunctionCalls(100000);
+	minimizer->SetTolerance(0.01);
+	minimizer->SetPrintLevel((m_verbose>2) ? 1 : 0);
+	for(int par=0; par<nll.GetNParameters(); ++par){
+		double start = (par==const_par) ? const_start : std::max(1., iso_events/nll.ExpectedEvents(par,1.));
+		minimizer->SetLowerLimitedVariable(par, nll.GetName(par), start, std::max(0.1, 0.1*start), 0.);
+	}
+	if(fix_const) minimizer->SetFixedVariable(const_par, "const", 0.);
+	
+	bool fit_ok = minimizer->Minimize();
+	fit_ok = minimizer->Hesse() && fit_ok;
+	if(!fit_ok){
+		Log(m_unique_name+" Warning! "+fit_method+" likelihood fit did not converge, status "
+		    +toString(minimizer->Status()),v_warning,m_verbose);
+	}
+	const double* vals = minimizer->X();
+	const double* errs = minimizer->Errors();
+	
+	// record the results like the final staged fit; the constant is in events per bin width, as in the TF1s
+	for(int par=0; par<nll.GetNParameters(); ++par){
+		if(par==const_par) continue;
+		PushFitAmp(vals[par], nll.GetName(par));
+	}
+	fit_amps["const_4"] = vals[const_par]*binwidth;
+	if(m_verbose){
+		std::cout<<"results of "<<fit_method<<" likelihood fit, -logL = "<<minimizer->MinValue()<<":"<<std::endl;
+		for(int par=0; par<nll.GetNParameters(); ++par){
+			std::cout<<nll.GetName(par)<<": "<<vals[par]<<" +- "<<errs[par]
+			         <<((par==const_par) ? " /s" : "")<<" ("<<nll.ExpectedEvents(par, vals[par])<<" events in range)"
+			         <<std::endl;
+		}
+	}
+	
+	// overlay the fitted function on the histogram and save it
+	TF1 func_sum = BuildFunctionNoHack(isotopes, dt_fit_min, dt_fit_max);
+	func_sum.SetName((fit_method+"_likelihood_fit").c_str());
+	for(const std::string& anisotope : isotopes) PullFitAmp(func_sum, anisotope, false);
+	PullFitAmp(func_sum, "const_4", false);
+	func_sum.SetLineColor(kRed);
+	dt_mu_lowe_hist.GetListOfFunctions()->Add(func_sum.Clone());
+	dt_mu_lowe_hist.Write();   // again, now with the fit attached
+	func_sum.Write();
+	
+	// bias, pull and coverage from toys thrown from the fitted model
+	if(n_toys>0){
+		Log(m_unique_name+" running "+toString(n_toys)+" toy experiments",v_message,m_verbose);
+		DtToyStudy toys(nll, std::vector<double>(vals, vals+nll.GetNParameters()));
+		if(fit_method=="binned") toys.SetBinning(binedges);
+		if(fix_const) toys.SetFixed(const_par);
+		toys.SetSeed(toy_seed);
+		toys.SetNThreads(toy_threads);
+		toys.Run(n_toys);
+		if(m_verbose) toys.PrintSummary();
+		TDirectory* toydir = gDirectory->mkdir((fit_method+"_likelihood_toys").c_str());
+		toys.Write(toydir ? toydir : gDirectory);
+	}
+	
+	return fit_ok;
+}
+
 // =========================================================================
 // =========================================================================
 
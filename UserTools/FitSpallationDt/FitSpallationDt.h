@@ -43,6 +43,7 @@ class FitSpallationDt: public Tool {
 	bool GetEnergyCutEfficiencies();
 	bool PlotSpallationDt();
 	bool FitDtDistribution(TH1& dt_mu_lowe_hist_short, int rangenum);
+	bool FitDtUnbinned(TH1& dt_mu_lowe_hist);
 	// helper functions used in FitSpallationDt
 	std::vector<double> MakeLogBins(double xmin, double xmax, int nbins);
 	void FixLifetime(TF1& func, std::string isotope);
@@ -83,6 +84,14 @@ class FitSpallationDt: public Tool {
 	int n_dt_bins=5000;
 	int binning_type=0;
 	bool random_subtract=false;
+	std::string fit_method="staged";   // staged TF1 fits, or simultaneous 'unbinned' or 'binned' likelihood fit
+	int fit_nbins=2000;                // log bins for the 'binned' likelihood fit
+	int fit_threads=1;
+	double dt_fit_min=0;
+	double dt_fit_max=30;
+	int n_toys=0;                      // toy experiments for the bias/pull/coverage of the likelihood fit
+	int toy_seed=0;
+	int toy_threads=1;
 	
 	// energy threshold comparison
 	// ===========================
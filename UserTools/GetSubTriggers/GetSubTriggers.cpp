@@ -1,5 +1,10 @@
 #include "GetSubTriggers.h"
 
+#include <algorithm>
+
+#include "fortran_routines.h"
+#include "Constants.h"
+
 GetSubTriggers::GetSubTriggers():Tool(){}
 
 
@@ -12,6 +17,16 @@ bool GetSubTriggers::Initialise(std::string configfile, DataModel &data){
   m_log= m_data->Log;
 
   if(!m_variables.Get("verbosity",m_verbose)) m_verbose=1;
+  m_variables.Get("use_fortran_softtrg",use_fortran_softtrg);
+  m_variables.Get("max_subtriggers",max_subtriggers);
+  // sizes the output array, which get_sub_triggers_ fills up to this bound
+  if(max_subtriggers<=0){
+    Log(m_unique_name+" max_subtriggers must be > 0, not "+toString(max_subtriggers),v_error,m_verbose);
+    return false;
+  }
+  if(!use_fortran_softtrg){
+    Log(m_unique_name+" using the native SLE search, which is not validated against get_sub_triggers_",v_warning,m_verbose);
+  }
 
   return true;
 }
@@ -20,16 +35,37 @@ bool GetSubTriggers::Initialise(std::string configfile, DataModel &data){
 bool GetSubTriggers::Execute(){
 
   int ntrigsfound=0;
-  int MAX_SUBTRIGS=32;
+  int MAX_SUBTRIGS=max_subtriggers;
   std::vector<int> t0_sub(MAX_SUBTRIGS,-1);  // relative time of subtrigger to IT0SK                                                                           
   int SLE_idx = TriggerType::SLE;
 
-  get_sub_triggers_(&SLE_idx, &ntrigsfound, t0_sub.data(), &MAX_SUBTRIGS);
+  if(use_fortran_softtrg){
+    get_sub_triggers_(&SLE_idx, &ntrigsfound, t0_sub.data(), &MAX_SUBTRIGS);
+  } else {
+    // trigger settings are per run
+    if(softtrg.GetRun()!=skhead_.nrunsk) LoadTriggerConditions();
+    // in-gate ID hits in the readout. n.b. get_sub_triggers_ makes its own hit selection within SKOFL,
+    // which this does not reproduce exactly, so the subtrigger lists of the two may differ
+    hit_times.clear();
+    for(int i=0; i<sktqz_.nqiskz; ++i){
+      if(sktqz_.icabiz[i]>MAXPM || sktqz_.icabiz[i]<=0) continue;
+      if((sktqz_.ihtiflz[i] & 0x02)==0) continue;
+      hit_times.push_back(sktqz_.tiskz[i]);
+    }
+    std::sort(hit_times.begin(), hit_times.end());
+    triggers.clear();
+    softtrg.Find(hit_times, {SLE_idx}, triggers);
+    for(const SoftwareTrigger::Trigger& trigger : triggers){
+      if(ntrigsfound==MAX_SUBTRIGS) break;
+      // ns -> clock ticks
+      t0_sub[ntrigsfound++] = trigger.time*COUNT_PER_NSEC;
+    }
+  }
 
   t0_sub.resize(ntrigsfound);
 
-  std::cout << "GetSubTriggers found " << ntrigsfound << " triggers, they were:" << std::endl;
-  for (const auto& t: t0_sub){std::cout << t << std::endl;}
+  Log(m_unique_name+" found "+toString(ntrigsfound)+" triggers",v_message,m_verbose);
+  for (const auto& t: t0_sub){Log("\t"+toString(t)+" ticks from it0sk",v_debug,m_verbose);}
   
   m_data->CStore.Set("trigger_times_soft", t0_sub);
   m_data->CStore.Set("n_subtriggers_soft", ntrigsfound);
@@ -38,6 +74,29 @@ bool GetSubTriggers::Execute(){
 }
 
 
+void GetSubTriggers::LoadTriggerConditions(){
+
+  const int trig_type = TriggerType::SLE;
+  SoftwareTrigger::Condition cond;
+  cond.threshold = skruninf_.softtrg_thr[trig_type];
+  if(cond.threshold==0) cond.threshold = GetTriggerThreshold(trig_type);
+  int posttrg_ticks = skruninf_.softtrg_post_t0[trig_type];
+  if(posttrg_ticks==0) posttrg_ticks = GetTriggerPostTrgTicks(trig_type);
+  int t0_offset_ticks = skruninf_.softtrg_t0_offset[trig_type];
+  if(t0_offset_ticks==0) t0_offset_ticks = GetTriggerT0OffsetTicks(trig_type);
+  cond.t0_offset = double(t0_offset_ticks)/COUNT_PER_NSEC;
+  // no new trigger within the readout gate of the last
+  cond.holdoff = double(posttrg_ticks)/COUNT_PER_NSEC;
+  softtrg.ClearConditions();
+  softtrg.SetCondition(trig_type, cond);
+  softtrg.SetRun(skhead_.nrunsk);
+
+  Log(m_unique_name+" run "+toString(skhead_.nrunsk)+" SLE threshold "+toString(cond.threshold)
+      +", readout gate "+toString(cond.holdoff)+" ns",v_debug,m_verbose);
+
+}
+
+
 bool GetSubTriggers::Finalise(){
 
   return true;
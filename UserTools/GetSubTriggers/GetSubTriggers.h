@@ -5,12 +5,16 @@
 #include <iostream>
 
 #include "Tool.h"
+#include "SoftwareTrigger.h"
 
 
 /**
 * \class GetSubTriggers
 *
-* Please fill out the descripton and author information.
+* Searches the readout for SLE software triggers, passing their times (in clock ticks from it0sk)
+* to downstream tools via the CStore as "trigger_times_soft" and "n_subtriggers_soft".
+* By default uses get_sub_triggers_; use_fortran_softtrg 0 uses the native SoftwareTrigger emulation over the
+* in-gate ID hits instead. That approximates the SKOFL trigger and its hit selection, so it is for validation only.
 *
 * $Author: ?.????? $
 * $Date: ????/??/?? $
@@ -28,6 +32,14 @@ class GetSubTriggers: public Tool {
 
  private:
 
+  bool use_fortran_softtrg = true;
+  int max_subtriggers = 32;
+  SoftwareTrigger softtrg;  // SLE condition, refreshed when the run changes
+  std::vector<double> hit_times;
+  std::vector<SoftwareTrigger::Trigger> triggers;
+
+  void LoadTriggerConditions();
+
 };
 
 
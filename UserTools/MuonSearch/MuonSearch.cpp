@@ -7,6 +7,7 @@
 // TODO run fh2h.pl on $SKOFL_ROOT/inc/softtrg_tblF.h and put it in $SKOFL_ROOT/inc
 
 #include <bitset>
+#include <algorithm>
 
 MuonSearch::MuonSearch():Tool(){}
 
@@ -23,6 +24,7 @@ bool MuonSearch::Initialise(std::string configfile, DataModel &data){
 	
 	m_variables.Get("verbosity",m_verbose);
 	m_variables.Get("coincidence_threshold",coincidence_threshold);
+	m_variables.Get("use_fortran_softtrg",use_fortran_softtrg);
 	
 	// add a cut to the selector if being used
 	get_ok = m_variables.Get("selectorName", selectorName);
@@ -70,58 +72,31 @@ bool MuonSearch::Execute(){
 	// TODO switch to config variable to optionally do this search anyway when we support >1 muon per relic
 	else {
 		
-		// get trigger settings from file (get those we're interested in - HE, OD thresholds for this run)
-		int idetector [32], ithr [32], it0_offset [32],ipret0 [32],ipostt0 [32];
-		softtrg_get_cond_(idetector,ithr,it0_offset,ipret0,ipostt0);
+		// times of HE and OD software triggers in this readout
+		std::vector<double> he_times, od_times;
+		if(use_fortran_softtrg) FortranTriggerTimes(he_times, od_times);
+		else NativeTriggerTimes(he_times, od_times);
 		
-		// disable all triggers except 1 (HE) and 3 (OD) by setting threshold to 100k and window size to 0
-		for(int i = 0; i < 32; i++){
-			if(i != 1 && i != 3){
-				ithr[i] = 100000;
-				it0_offset[i]=0;
-				ipret0[i]=0;
-				ipostt0[i]=0;
-			}
-		}
-		// pass to the software trigger algorithm
-		softtrg_set_cond_(idetector,ithr,it0_offset,ipret0,ipostt0);
-		
-		// call softtrg_inittrgtbl_ to populate the swtrgtbl_ common block.
-		int max_qb = 1280;
-		int one = 1;
-		int zero = 0;
-		int ntrg = softtrg_inittrgtbl_(&skhead_.nrunsk, &zero, &one, &max_qb);
-		
-		Log(m_unique_name+" found "+toString(ntrg)+" software triggers...",v_debug,m_verbose);
+		Log(m_unique_name+" found "+toString(he_times.size())+" HE and "+toString(od_times.size())
+		    +" OD software triggers...",v_debug,m_verbose);
 		
 		// search for pairs of HE+OD within a 100ns window - consider these muons
+		std::vector<std::pair<size_t,size_t>> he_od_pairs;
+		SoftwareTrigger::Coincidences(he_times, od_times, coincidence_threshold, he_od_pairs);
 		int untagged_count=0;
 		bool found_prim=false;
-		for(int i = 0; i < ntrg; i++){                                                   // loop over triggers found
-			Log(m_unique_name+" trigger "+toString(i)+" is of type "
-			    +toString(swtrgtbl_.swtrgtype[i])+" at time "+toString(swtrgtbl_.swtrgt0ctr[i]),v_debug,m_verbose);
-			if(swtrgtbl_.swtrgtype[i] == 1){                                             // for each HE trigger...
-				Log(m_unique_name+" found HE trigger, looking for coincident OD trigger",v_debug,m_verbose);
-				for(int j = 0; j < ntrg; j++){                                           // loop over triggers again
-					Log("\t"+m_unique_name+" trigger "+toString(i)+" is of type "
-					    +toString(swtrgtbl_.swtrgtype[i]),v_debug,m_verbose);
-					if(swtrgtbl_.swtrgtype[j] == 3){                                     // looking for OD triggers...
-						Log(m_unique_name+" SHE+OD pair with Δt="                        // in time coincidence
-						    +toString(swtrgtbl_.swtrgt0ctr[j] - swtrgtbl_.swtrgt0ctr[i]),v_debug,m_verbose);
-						if(std::abs(swtrgtbl_.swtrgt0ctr[j] - swtrgtbl_.swtrgt0ctr[i])< coincidence_threshold){
-							// skip it if this is the primary trigger
-							// assumes primary trigger time is matched to SHE time not OD time...?
-							if( prim_mu && (swtrgtbl_.swtrgt0ctr[i]< coincidence_threshold) ){
-								found_prim=true;
-							} else {
-								// n.b. swtrgt0ctr is t0_sub, so time from it0sk. We would need to add it0sk to get it0xsk.
-								untaggedMuonTime.push_back(swtrgtbl_.swtrgt0ctr[i]);
-								++untagged_count;
-							}
-							break;
-						}
-					}
-				}
+		for(const std::pair<size_t,size_t>& he_od : he_od_pairs){
+			const double he_time = he_times[he_od.first];
+			Log(m_unique_name+" SHE+OD pair with Δt="
+			    +toString(od_times[he_od.second] - he_time),v_debug,m_verbose);
+			// skip it if this is the primary trigger
+			// assumes primary trigger time is matched to SHE time not OD time...?
+			if( prim_mu && (he_time < coincidence_threshold) ){
+				found_prim=true;
+			} else {
+				// n.b. trigger times are t0_sub, so time from it0sk. We would need to add it0sk to get it0xsk.
+				untaggedMuonTime.push_back(int(he_time));
+				++untagged_count;
 			}
 		}
 		
@@ -161,6 +136,93 @@ bool MuonSearch::Execute(){
 }
 
 
+void MuonSearch::FortranTriggerTimes(std::vector<double>& he_times, std::vector<double>& od_times){
+	
+	// get trigger settings from file (get those we're interested in - HE, OD thresholds for this run)
+	int idetector [32], ithr [32], it0_offset [32],ipret0 [32],ipostt0 [32];
+	softtrg_get_cond_(idetector,ithr,it0_offset,ipret0,ipostt0);
+	
+	// disable all triggers except 1 (HE) and 3 (OD) by setting threshold to 100k and window size to 0
+	for(int i = 0; i < 32; i++){
+		if(i != 1 && i != 3){
+			ithr[i] = 100000;
+			it0_offset[i]=0;
+			ipret0[i]=0;
+			ipostt0[i]=0;
+		}
+	}
+	// pass to the software trigger algorithm
+	softtrg_set_cond_(idetector,ithr,it0_offset,ipret0,ipostt0);
+	
+	// call softtrg_inittrgtbl_ to populate the swtrgtbl_ common block.
+	int max_qb = 1280;
+	int one = 1;
+	int zero = 0;
+	int ntrg = softtrg_inittrgtbl_(&skhead_.nrunsk, &zero, &one, &max_qb);
+	
+	for(int i = 0; i < ntrg; i++){
+		Log(m_unique_name+" trigger "+toString(i)+" is of type "
+		    +toString(swtrgtbl_.swtrgtype[i])+" at time "+toString(swtrgtbl_.swtrgt0ctr[i]),v_debug,m_verbose);
+		if(swtrgtbl_.swtrgtype[i] == TriggerType::HE) he_times.push_back(swtrgtbl_.swtrgt0ctr[i]);
+		else if(swtrgtbl_.swtrgtype[i] == TriggerType::OD_or_Fission) od_times.push_back(swtrgtbl_.swtrgt0ctr[i]);
+	}
+	// the merge needs them in time order
+	std::sort(he_times.begin(), he_times.end());
+	std::sort(od_times.begin(), od_times.end());
+	
+}
+
+void MuonSearch::LoadTriggerConditions(){
+	
+	// get the HE and OD trigger settings for this run
+	int idetector [32], ithr [32], it0_offset [32],ipret0 [32],ipostt0 [32];
+	softtrg_get_cond_(idetector,ithr,it0_offset,ipret0,ipostt0);
+	
+	softtrg.ClearConditions();
+	for(int trig_type : {int(TriggerType::HE), int(TriggerType::OD_or_Fission)}){
+		SoftwareTrigger::Condition cond;
+		cond.threshold = ithr[trig_type];
+		if(cond.threshold==0) cond.threshold = GetTriggerThreshold(trig_type);
+		int posttrg_ticks = ipostt0[trig_type];
+		if(posttrg_ticks==0) posttrg_ticks = GetTriggerPostTrgTicks(trig_type);
+		// no new trigger of the same type within the readout gate of the last
+		cond.holdoff = double(posttrg_ticks)/COUNT_PER_NSEC;
+		cond.t0_offset = double(it0_offset[trig_type])/COUNT_PER_NSEC;
+		softtrg.SetCondition(trig_type, cond);
+		Log(m_unique_name+" run "+toString(skhead_.nrunsk)+" "+TriggerIDToName(trig_type)+" threshold "
+		    +toString(cond.threshold)+", t0 offset "+toString(cond.t0_offset)+" ns",v_debug,m_verbose);
+	}
+	softtrg.SetRun(skhead_.nrunsk);
+	
+}
+
+void MuonSearch::NativeTriggerTimes(std::vector<double>& he_times, std::vector<double>& od_times){
+	
+	if(softtrg.GetRun()!=skhead_.nrunsk) LoadTriggerConditions();
+	
+	// all hits in the readout; the HE hitsum is over ID hits, the OD hitsum over OD hits
+	id_hit_times.clear();
+	for(int i=0; i<sktqz_.nqiskz; ++i){
+		if(sktqz_.icabiz[i]>MAXPM || sktqz_.icabiz[i]<=0) continue;
+		id_hit_times.push_back(sktqz_.tiskz[i]);
+	}
+	od_hit_times.assign(sktqaz_.taskz, sktqaz_.taskz+sktqaz_.nhitaz);
+	std::sort(id_hit_times.begin(), id_hit_times.end());
+	std::sort(od_hit_times.begin(), od_hit_times.end());
+	
+	triggers.clear();
+	softtrg.Find(id_hit_times, {TriggerType::HE}, triggers);
+	softtrg.Find(od_hit_times, {TriggerType::OD_or_Fission}, triggers);
+	for(const SoftwareTrigger::Trigger& trigger : triggers){
+		// hit times are in ns from it0sk, the Fortran trigger table in clock ticks
+		const double ticks = trigger.time*COUNT_PER_NSEC;
+		Log(m_unique_name+" trigger of type "+toString(trigger.type)+" at time "+toString(ticks),v_debug,m_verbose);
+		if(trigger.type==TriggerType::HE) he_times.push_back(ticks);
+		else od_times.push_back(ticks);
+	}
+	
+}
+
 bool MuonSearch::Finalise(){
 	
 	return true;
@@ -9,6 +9,7 @@
 #include "MTreeReader.h"
 #include "skroot.h"
 #include "ConnectionTable.h"
+#include "SoftwareTrigger.h"
 
 
 /**
@@ -34,9 +35,20 @@ class MuonSearch: public Tool {
 	private:
 	
 	double coincidence_threshold=100;
+	bool use_fortran_softtrg=true;   // run the SKOFL softtrg routines rather than the native emulation
 	std::string selectorName;
 	EventType eventType;
 	
+	SoftwareTrigger softtrg;         // HE and OD conditions, refreshed when the run changes
+	std::vector<double> id_hit_times;
+	std::vector<double> od_hit_times;
+	std::vector<SoftwareTrigger::Trigger> triggers;
+	
+	// times of HE and OD software triggers in the readout, in clock ticks from it0sk, in time order
+	void FortranTriggerTimes(std::vector<double>& he_times, std::vector<double>& od_times);
+	void NativeTriggerTimes(std::vector<double>& he_times, std::vector<double>& od_times);
+	void LoadTriggerConditions();
+	
 };
 
 
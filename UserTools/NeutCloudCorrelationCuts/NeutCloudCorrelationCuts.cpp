@@ -5,6 +5,7 @@
 #include "TFile.h"
 
 #include "MTreeReader.h"
+#include "skheadC.h"
 
 NeutCloudCorrelationCuts::NeutCloudCorrelationCuts():Tool(){}
 
@@ -47,6 +48,14 @@ bool NeutCloudCorrelationCuts::Initialise(std::string configfile, DataModel &dat
   post_sample_m69_dl = TH1D("post_sample_m69_dl", "m = 6-9;distance from relic candidate [cm]", 100, 0, 5000);
   post_sample_m10_dl = TH1D("post_sample_m10_dl", "m = 10+;distance from relic candidate [cm]", 100, 0, 5000);  
 
+  // find clouds near each relic from an index of clouds, rather than the muons matched upstream
+  m_variables.Get("use_cloud_index", use_cloud_index);
+  m_variables.Get("cloud_search_radius", cloud_search_radius);
+  m_variables.Get("cloud_search_dt", cloud_search_dt);
+  double cloud_grid_cell = 200;
+  m_variables.Get("cloud_grid_cell", cloud_grid_cell);
+  cloud_index = NeutronCloudIndex(cloud_grid_cell);
+
   GetTreeReaders();
   
   return true;
@@ -54,135 +63,222 @@ bool NeutCloudCorrelationCuts::Initialise(std::string configfile, DataModel &dat
 
 bool NeutCloudCorrelationCuts::Execute(){
 
+  if (use_cloud_index){
+    // all clouds near the relic in space and time, from an index of this run's clouds
+    if (skhead_.nrunsk != cloud_index_run){BuildCloudIndex(skhead_.nrunsk);}
+
+    // relic time in ticks, with rollovers unwrapped as for the clouds
+    const int64_t relic_ticks = relic_clock.Unwrap(TickUnwrapper::EventTicks(skheadqb_.nevhwsk, skheadqb_.it0sk));
+    const double relic_time = relic_ticks / (COUNT_PER_NSEC * 1E9);
+    const float relic_vertex[3] = {skroot_lowe_.bsvertex[0], skroot_lowe_.bsvertex[1], skroot_lowe_.bsvertex[2]};
+
+    cloud_matches.clear();
+    cloud_index.Query(relic_vertex, relic_time, cloud_search_radius, cloud_search_dt, cloud_matches);
+    for (const size_t match : cloud_matches){
+      const NeutronCloudIndex::Cloud& cloud = cloud_index.Get(match);
+      ProcessCloud(cloud, cloud.time - relic_time);
+    }
+    return true;
+  }
+
+  // otherwise, the muons matched to this relic upstream
   bool ok = relic_tree_reader->Get("MatchedOutEntryNums", relicMatchedEntryNums);
   if (!ok){throw std::runtime_error("NeutCloudCorrelationCuts::Execute - couldn't retrieve matched entries");}
   ok = relic_tree_reader->Get("MatchedTimeDiffs", relicTimeDiffs);
   if (!ok){throw std::runtime_error("NeutCloudCorrelationCuts::Execute - couldn't retrieve matched time differences");}  
 
-  if (relicMatchedEntryNums->empty()){return true;}
-
   for (size_t i = 0; i < relicMatchedEntryNums->size(); ++i){
+    NeutronCloudIndex::Cloud cloud;
+    if (!GetCloud(relicMatchedEntryNums->at(i), cloud)){
+      throw std::runtime_error("NeutCloudCorrelationCuts::Execute - failed to retrieve cloud file entry");
+    }
+    // matched time differences are in ns
+    ProcessCloud(cloud, relicTimeDiffs->at(i) * 1E-9);
+  }
+  
+  return true;
+}
 
-    const int match_idx = relicMatchedEntryNums->at(i);
-    std::cout << "match_idx: " << match_idx << std::endl;
-    const double dt = relicTimeDiffs->at(i);
-    std::cout << "matched time diff" << std::endl;
-
-    ok = m_data->getTreeEntry(cloud_tree_reader_str, match_idx);
-    if (!ok){throw std::runtime_error("NeutCloudCorrelationCuts::Execute - failed to retrieve cloud file entry");} 
+void NeutCloudCorrelationCuts::ProcessCloud(const NeutronCloudIndex::Cloud& cloud, const double dt){
 
-    std::vector<double> muon_dir = {}; //std::vector<double>(skroot_mu_.mudir, skroot_mu_.mudir +3);
-    std::vector<double> neutron_cloud_vertex = {};
-    int* multiplicity = nullptr;
+  // clouds with no neutrons have no vertex
+  if (cloud.multiplicity == 0){return;}
+  const int multiplicity = cloud.multiplicity;
 
-    // cloud_tree_reader->Get("neutron_cloud_vertex", neutron_cloud_vertex);
-    // cloud_tree_reader->Get("neutron_cloud_multiplicity", *multiplicity);
-    // cloud_tree_reader->Get("muon_dir", muon_dir);
-  
-    std::vector<TVector3> coord_change_tensor = GetTensor(muon_dir, neutron_cloud_vertex);
+  const std::vector<double> muon_dir(cloud.muon_dir, cloud.muon_dir + 3);
+  const std::vector<double> neutron_cloud_vertex(cloud.vertex, cloud.vertex + 3);
+  std::vector<TVector3> coord_change_tensor = GetTensor(muon_dir, neutron_cloud_vertex);
      
-    // old - regular sk coordinate system
-    // new - cloud coordinate system with z aligning with muon track
-    const TVector3 dr_old = TVector3(neutron_cloud_vertex.data()) - TVector3(skroot_lowe_.bsvertex);
-    const std::vector<double> dr_squared_new = {
-      pow(dr_old.Dot(coord_change_tensor.at(0)), 2),
-      pow(dr_old.Dot(coord_change_tensor.at(1)), 2),
-      pow(dr_old.Dot(coord_change_tensor.at(2)),2)
-    };
-
-    const double dL = std::inner_product(dr_squared_new.begin(), dr_squared_new.end(), dr_squared_new.begin(), 0);
-
+  // old - regular sk coordinate system
+  // new - cloud coordinate system with z aligning with muon track
+  const TVector3 dr_old = TVector3(neutron_cloud_vertex.data()) - TVector3(skroot_lowe_.bsvertex);
+  const std::vector<double> dr_squared_new = {
+    pow(dr_old.Dot(coord_change_tensor.at(0)), 2),
+    pow(dr_old.Dot(coord_change_tensor.at(1)), 2),
+    pow(dr_old.Dot(coord_change_tensor.at(2)),2)
+  };
+
+  const double dL = dr_old.Mag();
+
+  if (dt < 0){
+    pre_sample_total_dl.Fill(dL);
+    pre_sample_total_dt.Fill(dt);
+  } else {
+    post_sample_total_dl.Fill(dL);
+    post_sample_total_dt.Fill(dt);
+  }
+       
+  const auto ellipse = [dr_squared_new](double a, double b, double c){
+    return
+      ((dr_squared_new.at(0) / a) +
+       (dr_squared_new.at(1) / b) +
+       (dr_squared_new.at(2) / c));
+  };
+      
+  //ellipse cuts
+  if (multiplicity == 2){
     if (dt < 0){
-      pre_sample_total_dl.Fill(dL);
-      pre_sample_total_dt.Fill(dt);
+      pre_sample_m2_dl.Fill(dL);
+      pre_sample_m2_dt.Fill(dt);
     } else {
-      post_sample_total_dl.Fill(dL);
-      post_sample_total_dt.Fill(dt);
+      post_sample_m2_dl.Fill(dL);
+      post_sample_m2_dt.Fill(dt);
     }
-       
-    const auto ellipse = [dr_squared_new](double a, double b, double c){
-      return
-	((dr_squared_new.at(0) / a) +
-	 (dr_squared_new.at(1) / b) +
-	 (dr_squared_new.at(2) / c));
-    };
-      
-    //ellipse cuts
-    if (*multiplicity == 2){
-      if (dt < 0){
-	pre_sample_m2_dl.Fill(dL);
-	pre_sample_m2_dt.Fill(dt);
-      } else {
-	post_sample_m2_dl.Fill(dL);
-	post_sample_m2_dt.Fill(dt);
-      }
-      if ((std::abs(dt) < 30) && ellipse(40000, 40000, 160000) < 1.2){
-	SkipEntry();
-      }
+    if ((std::abs(dt) < 30) && ellipse(40000, 40000, 160000) < 1.2){
+      SkipEntry();
     }
+  }
 
-    if (*multiplicity == 3){
-      if (dt < 0){
-	pre_sample_m3_dl.Fill(dL);
-	pre_sample_m3_dt.Fill(dt);
-      } else {
-	post_sample_m3_dl.Fill(dL);
-	post_sample_m3_dt.Fill(dt);
-      }      
-      if ((std::abs(dt) < 60) && ellipse(60000, 60000, 250000) < 1.2){
-	SkipEntry();
-      }
+  if (multiplicity == 3){
+    if (dt < 0){
+      pre_sample_m3_dl.Fill(dL);
+      pre_sample_m3_dt.Fill(dt);
+    } else {
+      post_sample_m3_dl.Fill(dL);
+      post_sample_m3_dt.Fill(dt);
+    }      
+    if ((std::abs(dt) < 60) && ellipse(60000, 60000, 250000) < 1.2){
+      SkipEntry();
     }
+  }
   
-    if((*multiplicity == 4) || (*multiplicity == 5)){
-      if (dt < 0){
-	pre_sample_m45_dl.Fill(dL);
-	pre_sample_m45_dt.Fill(dt);
-      } else {
-	post_sample_m45_dl.Fill(dL);
-	post_sample_m45_dt.Fill(dt);
-      }
-      if ((std::abs(dt) < 60) && ellipse(120000, 120000, 302500) < 1.2){
-	SkipEntry();
-      }
+  if((multiplicity == 4) || (multiplicity == 5)){
+    if (dt < 0){
+      pre_sample_m45_dl.Fill(dL);
+      pre_sample_m45_dt.Fill(dt);
+    } else {
+      post_sample_m45_dl.Fill(dL);
+      post_sample_m45_dt.Fill(dt);
     }
-    
-    if ((*multiplicity > 6) && (*multiplicity < 9)){
-      if (dt < 0){
-	pre_sample_m69_dl.Fill(dL);
-	pre_sample_m69_dt.Fill(dt);
-      } else {
-	post_sample_m69_dl.Fill(dL);
-	post_sample_m69_dt.Fill(dt);
-      }
-      if ((std::abs(dt) < 60) && ellipse(200000, 200000, 422500) < 1.2){
-	SkipEntry();
-      }
+    if ((std::abs(dt) < 60) && ellipse(120000, 120000, 302500) < 1.2){
+      SkipEntry();
     }
+  }
     
-    if (*multiplicity >= 10){
-      if (dt < 0){
-	pre_sample_m10_dl.Fill(dL);
-	pre_sample_m10_dt.Fill(dt);
-      } else {
-	post_sample_m10_dl.Fill(dL);
-	post_sample_m10_dt.Fill(dt);
-      }
-      if ((std::abs(dt) < 60) && ellipse(250000, 250000, 490000) < 1.2){
-	SkipEntry();
-      }
+  if ((multiplicity >= 6) && (multiplicity <= 9)){
+    if (dt < 0){
+      pre_sample_m69_dl.Fill(dL);
+      pre_sample_m69_dt.Fill(dt);
+    } else {
+      post_sample_m69_dl.Fill(dL);
+      post_sample_m69_dt.Fill(dt);
     }
-
-    //box cuts
-    if ((*multiplicity > 2) && ((std::abs(dt) < 0.1 && dL < 1200) || (std::abs(dt) < 1 && dL < 800))){
+    if ((std::abs(dt) < 60) && ellipse(200000, 200000, 422500) < 1.2){
       SkipEntry();
     }
+  }
     
+  if (multiplicity >= 10){
+    if (dt < 0){
+      pre_sample_m10_dl.Fill(dL);
+      pre_sample_m10_dt.Fill(dt);
+    } else {
+      post_sample_m10_dl.Fill(dL);
+      post_sample_m10_dt.Fill(dt);
+    }
+    if ((std::abs(dt) < 60) && ellipse(250000, 250000, 490000) < 1.2){
+      SkipEntry();
+    }
+  }
+
+  //box cuts
+  if ((multiplicity > 2) && ((std::abs(dt) < 0.1 && dL < 1200) || (std::abs(dt) < 1 && dL < 800))){
+    SkipEntry();
   }
   
+  return;
+}
+
+bool NeutCloudCorrelationCuts::GetCloud(const long entry, NeutronCloudIndex::Cloud& cloud){
+
+  if (m_data->getTreeEntry(cloud_tree_reader_str, entry) <= 0){return false;}
+
+  std::vector<double>* vertex = nullptr;
+  std::vector<double>* muon_dir = nullptr;
+  ULong64_t ticks = 0;
+  bool ok = cloud_tree_reader->Get("neutron_cloud_vertex", vertex) &&
+            cloud_tree_reader->Get("neutron_cloud_multiplicity", cloud.multiplicity) &&
+            cloud_tree_reader->Get("muon_dir", muon_dir) &&
+            cloud_tree_reader->Get("event_ticks", ticks);
+  if (!ok || vertex->size() != 3 || muon_dir->size() != 3){return false;}
+
+  for (int dim = 0; dim < 3; ++dim){
+    cloud.vertex[dim] = vertex->at(dim);
+    cloud.muon_dir[dim] = muon_dir->at(dim);
+  }
+  cloud.time = ticks / (COUNT_PER_NSEC * 1E9);
+  cloud.entry = entry;
   return true;
 }
 
+void NeutCloudCorrelationCuts::BuildCloudIndex(const int run){
+
+  // find the entries of each run on first use; the cloud tree is in muon (so run) order
+  if (cloud_run_entries.empty()){
+    const long n_entries = cloud_tree_reader->GetEntries();
+    for (long entry = 0; entry < n_entries; ++entry){
+      int cloud_run = 0;
+      if (m_data->getTreeEntry(cloud_tree_reader_str, entry) <= 0 ||
+          !cloud_tree_reader->Get("nrunsk", cloud_run)){
+        throw std::runtime_error("NeutCloudCorrelationCuts::BuildCloudIndex - failed to read cloud run numbers");
+      }
+      auto it = cloud_run_entries.find(cloud_run);
+      if (it == cloud_run_entries.end()){
+        cloud_run_entries.emplace(cloud_run, std::make_pair(entry, entry + 1));
+      } else {
+        it->second.second = entry + 1;
+      }
+    }
+  }
+
+  cloud_index.Clear();
+  cloud_index_run = run;
+  relic_clock.Reset();
+  auto it = cloud_run_entries.find(run);
+  if (it != cloud_run_entries.end()){
+    NeutronCloudIndex::Cloud cloud;
+    for (long entry = it->second.first; entry < it->second.second; ++entry){
+      if (!GetCloud(entry, cloud)){
+        throw std::runtime_error("NeutCloudCorrelationCuts::BuildCloudIndex - failed to retrieve cloud file entry");
+      }
+      // the first cloud of the run has no rollovers added, so its ticks are the raw clock the cloud times
+      // were unwrapped from. Unwrap the relics from the same point, so a rollover is counted on both
+      if (entry == it->second.first){
+        ULong64_t first_ticks = 0;
+        cloud_tree_reader->Get("event_ticks", first_ticks);
+        relic_clock.Reset(first_ticks);
+      }
+      int cloud_run = 0;
+      cloud_tree_reader->Get("nrunsk", cloud_run);
+      if (cloud_run == run && cloud.multiplicity > 0){cloud_index.Add(cloud);}
+    }
+  }
+  cloud_index.Build();
+  Log(m_unique_name+" indexed "+std::to_string(cloud_index.Size())+" neutron clouds for run "+std::to_string(run),
+      v_debug, m_verbose);
+  
+  return;
+}
 
 bool NeutCloudCorrelationCuts::Finalise(){
   
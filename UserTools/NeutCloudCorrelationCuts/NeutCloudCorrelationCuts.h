@@ -3,9 +3,13 @@
 
 #include <string>
 #include <iostream>
+#include <map>
+#include <vector>
 
 #include "Tool.h"
 #include "MTreeReader.h"
+#include "NeutronCloudIndex.h"
+#include "TickUnwrapper.h"
 
 #include "TH1D.h"
 
@@ -24,6 +28,9 @@ class NeutCloudCorrelationCuts: public Tool {
   std::vector<TVector3> GetTensor(const std::vector<double>&, const std::vector<double>&) const;
   void SkipEntry();
   void GetTreeReaders();
+  bool GetCloud(const long entry, NeutronCloudIndex::Cloud& cloud);
+  void BuildCloudIndex(const int run);
+  void ProcessCloud(const NeutronCloudIndex::Cloud& cloud, const double dt);
 
   TH1D pre_sample_total_dt;
   TH1D pre_sample_m2_dt;
@@ -59,6 +66,15 @@ class NeutCloudCorrelationCuts: public Tool {
   
   std::vector<int>* relicMatchedEntryNums = nullptr;
   std::vector<float>* relicTimeDiffs = nullptr;
+
+  bool use_cloud_index = true;
+  double cloud_search_radius = 5000; // cm
+  double cloud_search_dt = 60;       // s
+  NeutronCloudIndex cloud_index;
+  int cloud_index_run = -1;
+  TickUnwrapper relic_clock; // relic times on the clock of the run's clouds
+  std::map<int, std::pair<long, long>> cloud_run_entries; // [first, last) cloud tree entry of each run
+  std::vector<size_t> cloud_matches;
  
 };
 
@@ -0,0 +1,257 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "ParallelEvents.h"
+#include "Factory.h"
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <exception>
+
+#include "TThread.h"
+
+ParallelEvents::ParallelEvents():Tool(){}
+
+ParallelEvents::~ParallelEvents(){
+	// Tools are deleted here rather than in Finalise since the DataModel may still
+	// hold pointers to their configurations (tool_configs) until the ToolChain ends
+	for(EventSlot* slot : slots){
+		for(Tool* tool : slot->tools) delete tool;
+		delete slot;
+	}
+	for(Tool* tool : commit_tools) delete tool;
+}
+
+bool ParallelEvents::Initialise(std::string configfile, DataModel &data){
+
+	if(configfile!="")  m_variables.Initialise(configfile);
+	//m_variables.Print();
+
+	m_data= &data;
+	m_log= m_data->Log;
+
+	if(!m_variables.Get("verbosity",m_verbose)) m_verbose=1;
+
+	std::string workerToolsFile, commitToolsFile;
+	m_variables.Get("workerTools",workerToolsFile);   // list of Tools to run on worker threads
+	m_variables.Get("commitTools",commitToolsFile);   // list of Tools to run serially on finished events
+	m_variables.Get("nThreads",nThreads);             // number of worker threads; 0 for one per core
+	m_variables.Get("maxInFlight",maxInFlight);       // maximum number of events queued or in progress
+
+	// eventVariables entries to carry with each event: all those set by Tools before this one
+	// that are needed by the workers or commit Tools, and all those set by the workers.
+	// Entries not listed are silently lost, so there is no default: the list depends on the Tools run.
+	std::string eventVariablesList;
+	if(!m_variables.Get("eventVariables",eventVariablesList) || eventVariablesList.empty()){
+		Log(m_unique_name+" Error! eventVariables must list the eventVariables entries (name:type,...)"
+		    " to carry with each event",v_error,m_verbose);
+		return false;
+	}
+	if(!ParseEventVariables(eventVariablesList, event_variables)){
+		Log(m_unique_name+" Error parsing eventVariables '"+eventVariablesList+"'",v_error,m_verbose);
+		return false;
+	}
+
+	if(!ReadToolList(workerToolsFile, worker_specs)) return false;
+	if(!commitToolsFile.empty() && !ReadToolList(commitToolsFile, commit_specs)) return false;
+	if(worker_specs.empty()){
+		Log(m_unique_name+" Error! No worker Tools given",v_error,m_verbose);
+		return false;
+	}
+	for(auto&& spec : worker_specs){
+		if(!IsEventParallelTool(spec.toolclass)){
+			Log(m_unique_name+" Error! Tool "+spec.toolclass+" has not been declared event-parallel"
+			    " and cannot be run on worker threads. Move it before ParallelEvents or into the commitTools",
+			    v_error,m_verbose);
+			return false;
+		}
+	}
+
+	if(nThreads<=0) nThreads = std::thread::hardware_concurrency();
+	if(nThreads<=0) nThreads = 1;
+	if(maxInFlight<=0) maxInFlight = 2*nThreads;
+
+	// ROOT needs to know there may be concurrent access (e.g. from TMVA readers)
+	TThread::Initialize();
+
+	// each event slot gets its own DataModel and Tool instances, so a Tool instance
+	// is only ever used by one thread at a time and Tools need not be thread-safe
+	Log(m_unique_name+" Initialising "+toString(maxInFlight)+" copies of "+toString(worker_specs.size())
+	    +" worker Tools",v_message,m_verbose);
+	for(int i=0; i<maxInFlight; ++i){
+		EventSlot* slot = new EventSlot(m_data);
+		slots.push_back(slot);
+		for(auto&& spec : worker_specs){
+			// the profiler is not thread-safe, so worker Tools are not profiled individually
+			Tool* tool = Factory(spec.toolclass, false);
+			if(tool==nullptr){
+				Log(m_unique_name+" Error! Unknown Tool class "+spec.toolclass,v_error,m_verbose);
+				return false;
+			}
+			slot->tools.push_back(tool);
+			if(!tool->Initialise(spec.configfile, slot->context.data)){
+				Log(m_unique_name+" Error! Failed to Initialise worker Tool "+spec.name,v_error,m_verbose);
+				return false;
+			}
+		}
+		free_slots.push_back(slot);
+	}
+
+	// output Tools run on the main DataModel, and need to know the candidate features
+	// and Tool configurations that the worker Tools registered on their own DataModels.
+	DataModel& first = slots.front()->context.data;
+	// registered in the same order, so the feature matrices swap without rearranging columns
+	m_data->eventCandidates.RegisterFeatureNames(first.eventCandidates.GetSchema().Names());
+	for(auto&& config : first.tool_configs){
+		if(m_data->tool_configs.count(config.first)==0) m_data->tool_configs.emplace(config.first, config.second);
+	}
+
+	for(auto&& spec : commit_specs){
+		Tool* tool = Factory(spec.toolclass);
+		if(tool==nullptr){
+			Log(m_unique_name+" Error! Unknown Tool class "+spec.toolclass,v_error,m_verbose);
+			return false;
+		}
+		commit_tools.push_back(tool);
+		if(!tool->Initialise(spec.configfile, *m_data)){
+			Log(m_unique_name+" Error! Failed to Initialise commit Tool "+spec.name,v_error,m_verbose);
+			return false;
+		}
+	}
+
+	scheduler.Start(nThreads);
+	Log(m_unique_name+" running with "+toString(nThreads)+" worker threads and up to "
+	    +toString(maxInFlight)+" events in flight",v_message,m_verbose);
+
+	return true;
+}
+
+bool ParallelEvents::Execute(){
+
+	bool ok=true;
+
+	// the current event must be captured before any other is committed,
+	// since committing overwrites the common blocks and eventVariables.
+	// There is always a free slot, since we ensure one is left at the end of each call.
+	EventSlot* slot = free_slots.back();
+	free_slots.pop_back();
+	slot->context.sequence = next_sequence++;
+	slot->context.Capture(*m_data, event_variables);
+	in_flight.push_back(slot);
+	scheduler.Submit([this,slot](){ RunWorkers(slot); });
+
+	// pass on any events that have finished, keeping them in order
+	while(!in_flight.empty() && in_flight.front()->context.done) ok &= CommitNext();
+
+	// if all slots are in use, wait for the oldest event so there is room for the next one
+	if(free_slots.empty()) ok &= CommitNext();
+
+	return ok;
+}
+
+bool ParallelEvents::Finalise(){
+
+	// process the remaining events
+	bool ok=true;
+	while(!in_flight.empty()) ok &= CommitNext();
+	scheduler.Stop();
+
+	Log(m_unique_name+" processed "+toString(events_committed)+" events, of which "
+	    +toString(events_failed)+" had worker Tool errors",v_message,m_verbose);
+
+	for(Tool* tool : commit_tools) ok &= tool->Finalise();
+	for(EventSlot* slot : slots){
+		for(Tool* tool : slot->tools) ok &= tool->Finalise();
+	}
+
+	return ok;
+}
+
+void ParallelEvents::RunWorkers(EventSlot* slot){
+	// runs on a worker thread
+	EventContext& context = slot->context;
+	context.data.vars.Set("Skip",false);
+	try {
+		for(Tool* tool : slot->tools){
+			if(!tool->Execute()){
+				context.ok=false;
+				break;
+			}
+			bool skip=false;
+			if(context.data.vars.Get("Skip",skip) && skip) break;
+		}
+	} catch(std::exception& e){
+		context.log.emplace_back(v_error, m_unique_name+" worker caught exception: "+e.what());
+		context.ok=false;
+	} catch(...){
+		context.log.emplace_back(v_error, m_unique_name+" worker caught unknown exception");
+		context.ok=false;
+	}
+	{
+		std::lock_guard<std::mutex> lock(done_mtx);
+		context.done=true;
+	}
+	done_cv.notify_all();
+}
+
+bool ParallelEvents::CommitNext(){
+	// wait for the oldest event to finish, then load it into the main DataModel
+	// and run the commit Tools over it
+	EventSlot* slot = in_flight.front();
+	EventContext& context = slot->context;
+	{
+		std::unique_lock<std::mutex> lock(done_mtx);
+		done_cv.wait(lock, [&context]{ return context.done.load(); });
+	}
+	in_flight.pop_front();
+
+	// print what the worker Tools logged for this event; they don't use the Logging themselves,
+	// as it is not thread-safe
+	for(auto&& line : context.log) Log(line.second, line.first, line.first);
+
+	bool ok=context.ok;
+	if(!ok){
+		++events_failed;
+		Log(m_unique_name+" Error! worker Tools failed on event "+toString(context.sequence),v_error,m_verbose);
+	}
+
+	context.Load(*m_data, event_variables);
+	bool skip=false;
+	context.data.vars.Get("Skip",skip);
+	if(ok && !skip){
+		for(Tool* tool : commit_tools){
+			if(!tool->Execute()){
+				ok=false;
+				break;
+			}
+		}
+	}
+	int stoploop=0;
+	if(context.data.vars.Get("StopLoop",stoploop) && stoploop) m_data->vars.Set("StopLoop",1);
+	context.Unload(*m_data);
+
+	++events_committed;
+	free_slots.push_back(slot);
+	return ok;
+}
+
+bool ParallelEvents::ReadToolList(std::string toolsfile, std::vector<ToolSpec>& specs){
+	// same format as a ToolsConfig file: 'uniqueName ToolClass configfile' on each line
+	std::ifstream infile(toolsfile.c_str());
+	if(!infile.is_open()){
+		Log(m_unique_name+" Error! Could not open Tools file '"+toolsfile+"'",v_error,m_verbose);
+		return false;
+	}
+	std::string line;
+	while(std::getline(infile, line)){
+		if(line.find('#')!=std::string::npos) line.erase(line.find('#'));
+		std::stringstream ss(line);
+		ToolSpec spec;
+		if(!(ss >> spec.name)) continue;  // blank line
+		if(!(ss >> spec.toolclass >> spec.configfile)){
+			Log(m_unique_name+" Error! Malformed line in '"+toolsfile+"': "+line,v_error,m_verbose);
+			return false;
+		}
+		specs.push_back(spec);
+	}
+	return true;
+}
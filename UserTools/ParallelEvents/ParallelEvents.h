@@ -0,0 +1,78 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef ParallelEvents_H
+#define ParallelEvents_H
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+#include "Tool.h"
+#include "EventContext.h"
+#include "WorkStealingScheduler.h"
+
+/**
+* \class ParallelEvents
+*
+* Runs a sequence of event-parallel Tools on several events concurrently.
+* Each call to Execute moves the current event (its common blocks, event-wise DataModel members
+* and a configured set of eventVariables) into an EventContext and queues it on a pool of worker
+* threads, each context having its own instances of the worker Tools. Finished events are then
+* loaded back into the main DataModel one at a time, in the order they arrived, and passed to a
+* second sequence of 'commit' Tools (e.g. output writers) that run serially on the ToolChain thread.
+* Worker Tools must be declared with EVENT_PARALLEL_TOOL (see EventContext.h).
+* Results of an event only become visible to the commit Tools, some Execute calls after the event
+* was read; Tools placed after this one in the ToolChain will not see them.
+*/
+
+class ParallelEvents: public Tool {
+
+	public:
+
+	ParallelEvents();
+	~ParallelEvents();
+	bool Initialise(std::string configfile,DataModel &data);
+	bool Execute();
+	bool Finalise();
+
+	private:
+	struct ToolSpec {
+		std::string name;
+		std::string toolclass;
+		std::string configfile;
+	};
+	struct EventSlot {
+		EventSlot(DataModel* parent) : context(parent){}
+		EventContext context;
+		std::vector<Tool*> tools;   // one instance of each worker Tool per slot
+	};
+
+	bool ReadToolList(std::string toolsfile, std::vector<ToolSpec>& specs);
+	void RunWorkers(EventSlot* slot);
+	bool CommitNext();
+
+	std::vector<ToolSpec> worker_specs;
+	std::vector<ToolSpec> commit_specs;
+	std::vector<Tool*> commit_tools;
+	std::vector<EventVariable> event_variables;
+
+	std::vector<EventSlot*> slots;
+	std::vector<EventSlot*> free_slots;
+	std::deque<EventSlot*> in_flight;  // in order of arrival
+	long next_sequence=0;
+
+	WorkStealingScheduler scheduler;
+	std::mutex done_mtx;
+	std::condition_variable done_cv;
+
+	int nThreads=0;
+	int maxInFlight=0;
+	long events_committed=0;
+	long events_failed=0;
+
+};
+
+
+#endif
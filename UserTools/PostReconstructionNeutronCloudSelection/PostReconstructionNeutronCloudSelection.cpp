@@ -2,6 +2,7 @@
 
 #include "NeutronInfo.h"
 #include "MTreeReader.h"
+#include "MuonTrackGeometry.h"
 
 #include "TFile.h"
 
@@ -249,17 +250,10 @@ float PostReconstructionNeutronCloudSelection::CalculateDistanceToMuon(float* mu
   // spallation calcultion determines both dlt and dll, where latter is calculated from
   // point of maximum energy deposition along the muon track. Do we do the same here?
   
-  // FIXME would be better not to duplicate this functionality already in RelicMuonPlots/CalculateSpallationVariables
   // get transverse distance and distance along muon track of point of closest approach
   float dlt = 0, appr = 0;
-  getdl_(muon_direction,
-         &bs_vertex[0],
-         &bs_vertex[1],
-         &bs_vertex[2],
-         muon_entrypoint,
-         &dlt,
-         &appr);
-  Log(m_unique_name+": getdl suggests transvese distance of "+toString(dlt)+" cm with point of closest approach at "
+  MuonTrackGeometry::TrackDistance(muon_direction, muon_entrypoint, bs_vertex, dlt, appr);
+  Log(m_unique_name+": transvese distance of "+toString(dlt)+" cm with point of closest approach at "
            +toString(appr)+" cm along muon track",v_debug,m_verbose);
   pre_ldt_cut2.Fill(dlt);
   
@@ -269,19 +263,7 @@ float PostReconstructionNeutronCloudSelection::CalculateDistanceToMuon(float* mu
   //return dlt;
   
   // find point of maximum energy deposition along muon track
-  double max_edep = 0;
-  int max_edep_bin=0;
-  for(int i=0;i<111;i++){
-    double e_dep_in_window = 0 ;
-    for(int j=0;j<9;j++){
-      e_dep_in_window = e_dep_in_window + muon_dedx[i+j];
-    }
-    if(e_dep_in_window > max_edep){
-      max_edep_bin = i+4;
-      max_edep = e_dep_in_window;
-    }
-  }
-  double max_energy_dep_pos = 50.*max_edep_bin;
+  double max_energy_dep_pos = MuonTrackGeometry::MaxDedxPosition(muon_dedx);
   float dll = max_energy_dep_pos - appr;
   Log(m_unique_name+": max e dep at "+toString(max_energy_dep_pos)+" cm along track, or "+toString(dll)
      +" cm from point of closest approach",v_debug,m_verbose);
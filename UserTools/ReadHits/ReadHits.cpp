@@ -30,21 +30,15 @@ bool ReadHits::Execute()
         return true;
     }
     
-    // Copy hits from sktqz_ common block to eventHits in the DataModel
+    // Copy in-gate hits from sktqz_ common block to eventHits in the DataModel
     // --------------------------------------------------------------------
     Log("Recording prompt event hits");
-    for (int iHit = 0; iHit < sktqz_.nqiskz; iHit++) {
-        
-        PMTHit hit{ /*T*/ sktqz_.tiskz[iHit],
-                    /*Q*/ sktqz_.qiskz[iHit],
-                    /*I*/ sktqz_.icabiz[iHit]
-                  };
-        
-        // Use in-gate hits only
-        if (sktqz_.ihtiflz[iHit] & (1<<1)) {
-            //hit.Dump();
-            eventHits->Append(hit);
-        }
+    const HitStore& inGateHits = m_data->GetInGateHits();
+    for (size_t iHit = 0; iHit < inGateHits.Size(); iHit++) {
+        eventHits->Append({ /*T*/ inGateHits.T[iHit],
+                            /*Q*/ inGateHits.Q[iHit],
+                            /*I*/ inGateHits.cable[iHit]
+                          });
     }
     
     // if this is an SHE with AFT and we loaded both together,
@@ -58,17 +52,13 @@ bool ReadHits::Execute()
         PMTHit lastHit(0, 0, 0);
         lastHit = eventHits->GetLastHit();   // get the last SHE hit
         float tOffset = 0.;
-        int iHit;  // carry this over, so we only start copying from the next hit after the matching one
-        bool coincidenceFound=false;
-        for (iHit = 0; iHit < sktqz_.nqiskz; iHit++) {
-            // match the last hit by same cable number and charge
-            if (sktqz_.qiskz[iHit] == lastHit.q() && sktqz_.icabiz[iHit] == lastHit.i()) {
-                tOffset = lastHit.t() - sktqz_.tiskz[iHit];
-                coincidenceFound = true;
-                Log(Form("coinciding hit: t: %f ns q: %f i: %d", sktqz_.tiskz[iHit], sktqz_.qiskz[iHit], sktqz_.icabiz[iHit]));
-                Log(Form("Coincidence found: t = %f ns, (offset: %f ns)", lastHit.t(), tOffset));
-                break;
-            }
+        // match the last hit by same cable number and charge
+        long matchingHit = HitStore::FindHit(sktqz_.nqiskz, sktqz_.icabiz, sktqz_.qiskz, lastHit.i(), lastHit.q());
+        bool coincidenceFound = (matchingHit >= 0);
+        if (coincidenceFound) {
+            tOffset = lastHit.t() - sktqz_.tiskz[matchingHit];
+            Log(Form("coinciding hit: t: %f ns q: %f i: %d", sktqz_.tiskz[matchingHit], sktqz_.qiskz[matchingHit], sktqz_.icabiz[matchingHit]));
+            Log(Form("Coincidence found: t = %f ns, (offset: %f ns)", lastHit.t(), tOffset));
         }
         if(!coincidenceFound){
             Log("Error! ReadHits could not find a coincident hit between SHE and following AFT events! "
@@ -81,16 +71,14 @@ bool ReadHits::Execute()
             //eventHits->DumpAllElements();
             
             Log("Appending AFT hits");
-            for (iHit = iHit; iHit < sktqz_.nqiskz; iHit++) {
-                PMTHit hit{ /*T*/ sktqz_.tiskz[iHit] + tOffset,
-                            /*Q*/ sktqz_.qiskz[iHit],
-                            /*I*/ sktqz_.icabiz[iHit]
-                          };
-                // Use in-gate hits only
-                if (sktqz_.ihtiflz[iHit] & (1<<1)) {
-                    //hit.Dump();
-                    eventHits->Append(hit);
-                }
+            // only copy from the matching hit onwards
+            const HitStore& aftHits = m_data->GetInGateHits();
+            for (size_t iHit = 0; iHit < aftHits.Size(); iHit++) {
+                if (aftHits.raw_index[iHit] < matchingHit) continue;
+                eventHits->Append({ /*T*/ aftHits.T[iHit] + tOffset,
+                                    /*Q*/ aftHits.Q[iHit],
+                                    /*I*/ aftHits.cable[iHit]
+                                  });
             }
         }
         
@@ -103,24 +103,24 @@ bool RelicMuonMatching::Execute(){
 	// we still want to save it with the associated primary event,
 	// so identify that explicitly from the trigger bit
 	if(skhead_.idtgsk & (1<<29)){
-		std::deque<ParticleCand>* thedeque=nullptr;
+		TimeOrderedCandStore* thestore=nullptr;
 		if(lastEventType==EventType::Muon){
-			thedeque = &m_data->muonCandDeque;
+			thestore = &m_data->muonCandStore;
 		} else if(lastEventType==EventType::LowE){
-			thedeque = &m_data->relicCandDeque;
+			thestore = &m_data->relicCandStore;
 		}
-		if(thedeque!=nullptr && thedeque->size() && thedeque->back().EventNumber==(skhead_.nevsk-1)){
-			Log(m_unique_name+" Setting AFT flag for "+(lastEventType==EventType::Muon ? "Muon " : "relic ")
-			         +toString(thedeque->back().EventNumber),v_debug,m_verbose);
-			thedeque->back().hasAFT = true;
-			thedeque->back().AFTEntryNum = rfmReader->GetEntryNumber();
+		if(thestore!=nullptr && !thestore->Empty() && thestore->Back().EventNumber==(skhead_.nevsk-1)){
+			LOG_LAZY(m_unique_name+" Setting AFT flag for "+(lastEventType==EventType::Muon ? "Muon " : "relic ")
+			         +toString(thestore->Back().EventNumber),v_debug,m_verbose);
+			thestore->Back().hasAFT = true;
+			thestore->Back().AFTEntryNum = rfmReader->GetEntryNumber();
 			/*
 			// no longer do this: we merge AFT with primary event
 			if(lastEventType==EventType::LowE){
 				// the next entry in the output relic tree will be an AFT, so advance our relic entry counter
 				Log(m_unique_name+" Advancing relic entry to account for AFT after relic",v_debug,m_verbose);
 				++nextrelicentry;
-			} else if(lastEventType==EventType::Muon && thedeque->back().matchedParticleEvNum.size()>0){
+			} else if(lastEventType==EventType::Muon && thestore->BackPayload().matchedParticleEvNum.size()>0){
 				Log(m_unique_name+" Advancing muon entry to account for AFT after muon",v_debug,m_verbose);
 				++nextmuentry;
 			}
@@ -357,46 +357,64 @@ bool RelicMuonMatching::Execute(){
 		
 	}
 	
-	// prune any match candidates that have dropped off our window of interest
-	if(muonsToRemove) RemoveFromDeque(m_data->muonCandDeque);
-	if(relicsToRemove) RemoveFromDeque(m_data->relicCandDeque);
+	// remove any match candidates that have dropped off our window of interest
+	RemoveFlagged();
 	
-	Log(m_unique_name+" Relics to Write out: "+toString(m_data->writeOutRelics.size())+
+	LOG_LAZY(m_unique_name+" Relics to Write out: "+toString(m_data->writeOutRelics.size())+
 	                  ", muons to write out: "+toString(m_data->muonsToRec.size()),v_debug,m_verbose);
 	
 	return true;
 }
 
 
+void RelicMuonMatching::RemoveFlagged(){
+	// write out (or drop) the candidates flagged during this Execute, in the order they were flagged
+	for(TimeOrderedCandStore::Index i : flaggedRelics){
+		m_data->writeOutRelics.push_back(m_data->relicCandStore.Take(i));
+	}
+	flaggedRelics.clear();
+	for(auto& [i, write] : flaggedMuons){
+		if(write) m_data->muonsToRec.push_back(m_data->muonCandStore.Take(i));
+		else m_data->muonCandStore.Remove(i);  // unmatched muons are just dropped
+	}
+	flaggedMuons.clear();
+}
+
 bool RelicMuonMatching::Finalise(){
 	
 	// write out any remaining relics still being matched
-	for(int i = 0; i < m_data->relicCandDeque.size(); i++){
-		ParticleCand& targetCand = m_data->relicCandDeque.at(i);
+	TimeOrderedCandStore& relicStore = m_data->relicCandStore;
+	for(TimeOrderedCandStore::Index i = relicStore.Begin(); i < relicStore.End(); i++){
+		if(!relicStore.IsLive(i)) continue;
+		ParticleCandCore& targetCand = relicStore.At(i);
+		ParticleCandPayload& targetMatches = relicStore.Payload(i);
 		if(!targetCand.flaggedForWrite){
 			targetCand.flaggedForWrite=true;
 			if(!relicSelectorName.empty()){
 				m_data->ApplyCut(relicSelectorName, m_unique_name,
-				                 targetCand.matchedParticleEvNum.size());
+				                 targetMatches.matchedParticleEvNum.size());
 			}
 			Log(m_unique_name+" Adding a relic to write out!",v_warning,m_verbose);
-			m_data->writeOutRelics.push_back(targetCand);
+			m_data->writeOutRelics.push_back(relicStore.Take(i));
 		}
 	}
-	m_data->relicCandDeque.clear();
+	relicStore.Clear();
 	
 	// write out any remaining muons with a match
-	for(int i = 0; i < m_data->muonCandDeque.size(); i++){
-		ParticleCand& targetCand = m_data->muonCandDeque.at(i);
+	TimeOrderedCandStore& muonStore = m_data->muonCandStore;
+	for(TimeOrderedCandStore::Index i = muonStore.Begin(); i < muonStore.End(); i++){
+		if(!muonStore.IsLive(i)) continue;
+		ParticleCandCore& targetCand = muonStore.At(i);
+		ParticleCandPayload& targetMatches = muonStore.Payload(i);
 		if(!targetCand.flaggedForWrite){
 			targetCand.flaggedForWrite=true;
 			if(!muSelectorName.empty()){
 				m_data->ApplyCut(muSelectorName, m_unique_name,
-				                 targetCand.matchedParticleEvNum.size());
+				                 targetMatches.matchedParticleEvNum.size());
 			}
-			if(targetCand.matchedParticleEvNum.size()){
+			if(targetMatches.matchedParticleEvNum.size()){
 				Log(m_unique_name+" Adding a muon to write out!",v_warning,m_verbose);
-				m_data->muonsToRec.push_back(targetCand);
+				m_data->muonsToRec.push_back(muonStore.Take(i));
 				
 				/* insanity check - not triggered
 				if(mu_nevsks.count(targetCand.EventNumber)!=0){
@@ -410,10 +428,15 @@ bool RelicMuonMatching::Finalise(){
 			}
 		}
 	}
-	m_data->muonCandDeque.clear();
+	muonStore.Clear();
 	
 	std::cout<<"checked "<<muoncount<<" muons and "<<reliccount<<" relics"<<std::endl;
 	std::cout<<"compared "<<tdiffcount<<" muon-relic pairs and found "<<passing_tdiffcount<<" that were within 60s of each other"<<std::endl;
+	if(m_data->muonCandStore.GetNumClamped() || m_data->relicCandStore.GetNumClamped()){
+		Log(m_unique_name+" Warning! "+toString(m_data->muonCandStore.GetNumClamped())+" muons and "
+		    +toString(m_data->relicCandStore.GetNumClamped())+" relics had event times earlier than the"
+		    " preceding candidate",v_warning,m_verbose);
+	}
 	
 	/*
 	// sanity check
@@ -433,16 +456,6 @@ bool RelicMuonMatching::Finalise(){
 	return true;
 }
 
-bool RelicMuonMatching::RemoveFromDeque(std::deque<ParticleCand>& particleDeque){
-	// erase-remove idiom
-	auto isFlaggedForWrite = [](ParticleCand& targetCand){ return targetCand.flaggedForWrite; };
-	particleDeque.erase(
-		std::remove_if(particleDeque.begin(), particleDeque.end(), isFlaggedForWrite),
-		particleDeque.end()
-	);
-	return true;
-}
-
 bool RelicMuonMatching::RelicMuonMatch(bool loweEventFlag, int64_t currentTicks, int subtrg_num, int32_t it0xsk){
 	
 	// make a new ParticleCand to encapsulate the minimal info about this muon/relic candidate.
@@ -466,33 +479,40 @@ bool RelicMuonMatching::RelicMuonMatch(bool loweEventFlag, int64_t currentTicks,
 //	muonsToRemove.push_back(currentParticle.EventNumber);
 //	// XXX XXX XXX DEBUG Force insertion of muon XXX XXX XXX
 	
-	// get the deque of in-memory targets to match this new event against
+	// time key for the candidate stores, with clock rollovers unwrapped
+	int64_t currentKey = tickUnwrapper.Unwrap(currentTicks);
+	
+	// get the store of in-memory targets to match this new event against
 	// if this event is a muon then the targets are relic candidates, and vice versa
-	std::deque<ParticleCand>* currentDeque = nullptr;
-	std::deque<ParticleCand>* targetDeque = nullptr;
+	TimeOrderedCandStore* currentStore = nullptr;
+	TimeOrderedCandStore* targetStore = nullptr;
 	if(loweEventFlag){
 		currentParticle.PID = 1;
-		currentDeque = &m_data->relicCandDeque;
-		targetDeque = &m_data->muonCandDeque;
+		currentStore = &m_data->relicCandStore;
+		targetStore = &m_data->muonCandStore;
 		// we save every relic, so can already assign its output ttree entry number
 		currentParticle.OutEntryNumber = nextrelicentry;
 		++nextrelicentry;
 	} else {
 		currentParticle.PID = 2;
-		currentDeque = &m_data->muonCandDeque;
-		targetDeque = &m_data->relicCandDeque;
+		currentStore = &m_data->muonCandStore;
+		targetStore = &m_data->relicCandStore;
 		// we'll assign its output tree entry number if/when it gets matched to a relic
 	}
 	
-	// scan over targets, oldest to newest
-	if(targetDeque->size()){
+	// scan over targets, oldest to newest.
+	// every held target is either within the window (a match) or has just dropped out of it,
+	// in which case it is written out and removed, so this loop is linear in the number of matches.
+	if(!targetStore->Empty()){
 		Log(m_unique_name+" matching this "+(loweEventFlag ? "lowE" : "muon")+" candidate to "
-		    +toString(targetDeque->size())+" targets",v_warning,m_verbose);
+		    +toString(targetStore->Size())+" targets",v_warning,m_verbose);
 	}
 	
 	bool firstmatch=true;
-	for(int i = 0; i < targetDeque->size(); i++){
-		ParticleCand& targetCand = targetDeque->at(i);
+	for(TimeOrderedCandStore::Index i = targetStore->Begin(); i < targetStore->End(); i++){
+		if(!targetStore->IsLive(i)) continue;
+		ParticleCandCore& targetCand = targetStore->At(i);
+		ParticleCandPayload& targetMatches = targetStore->Payload(i);
 		
 		// sanity check - current event should always have a greater nevsk than targets
 		if(targetCand.EventNumber >= currentParticle.EventNumber){
@@ -515,7 +535,7 @@ bool RelicMuonMatching::RelicMuonMatch(bool loweEventFlag, int64_t currentTicks,
 			return false;
 		}
 		
-		if(subtrg_num==0 && i==0){
+		if(subtrg_num==0 && i==targetStore->Begin()){
 			Log(m_unique_name+" secs to oldest candidate "+toString(i)+": "
 			   +toString(double(ticksDiff/COUNT_PER_NSEC)/1E9),v_warning,m_verbose);
 		}
@@ -570,7 +590,7 @@ bool RelicMuonMatching::RelicMuonMatch(bool loweEventFlag, int64_t currentTicks,
 			// if this is the first match of this particle, set its event number in the output file
 			// and increment the counter for the next event which will be written out
 			if(firstmatch){
-				Log(m_unique_name+" First match for current "
+				LOG_LAZY(m_unique_name+" First match for current "
 				   +((loweEventFlag) ? "relic" : "muon"),v_debug,m_verbose);
 				if(!loweEventFlag){
 					currentParticle.OutEntryNumber = nextmuentry;
@@ -578,8 +598,8 @@ bool RelicMuonMatching::RelicMuonMatch(bool loweEventFlag, int64_t currentTicks,
 				}
 				firstmatch=false;
 			}
-			if(targetCand.matchedParticleEvNum.size()==0){
-				Log(m_unique_name+" First match for target "
+			if(targetMatches.matchedParticleEvNum.size()==0){
+				LOG_LAZY(m_unique_name+" First match for target "
 				    +((loweEventFlag) ? "muon" : "relic"),v_debug,m_verbose);
 				// if this is the first match for a muon, we now know we'll be writing it out
 				// so can set its output entry number and increment that for the next.
@@ -597,38 +617,37 @@ bool RelicMuonMatching::RelicMuonMatch(bool loweEventFlag, int64_t currentTicks,
 			currentParticle.matchedParticleOutEntryNum.push_back(targetCand.OutEntryNumber);
 			currentParticle.matchedParticleHasAFT.push_back(targetCand.hasAFT);
 			currentParticle.matchedParticleTimeDiff.push_back(ticksDiff / -COUNT_PER_NSEC);
-			currentParticle.matchedParticleBSEnergy.push_back(targetCand.LowECommon.bsenergy);
+			currentParticle.matchedParticleBSEnergy.push_back(targetMatches.LowECommon.bsenergy);
 			
-			targetCand.matchedParticleEvNum.push_back(currentParticle.EventNumber);
-			targetCand.matchedParticleInEntryNum.push_back(currentParticle.InEntryNumber);
-			targetCand.matchedParticleOutEntryNum.push_back(currentParticle.OutEntryNumber);
-			targetCand.matchedParticleHasAFT.push_back(currentParticle.hasAFT);
-			targetCand.matchedParticleTimeDiff.push_back(ticksDiff / COUNT_PER_NSEC);
-			targetCand.matchedParticleBSEnergy.push_back(currentParticle.LowECommon.bsenergy);
+			targetMatches.matchedParticleEvNum.push_back(currentParticle.EventNumber);
+			targetMatches.matchedParticleInEntryNum.push_back(currentParticle.InEntryNumber);
+			targetMatches.matchedParticleOutEntryNum.push_back(currentParticle.OutEntryNumber);
+			targetMatches.matchedParticleHasAFT.push_back(currentParticle.hasAFT);
+			targetMatches.matchedParticleTimeDiff.push_back(ticksDiff / COUNT_PER_NSEC);
+			targetMatches.matchedParticleBSEnergy.push_back(currentParticle.LowECommon.bsenergy);
 			
 		// otherwise the current event came more than 60 seconds after the target event.
 		// since any subsequent events will also be >60s after this target event there will
 		// be no more matches for this target, and we can write it out if appropriate.
 		} else {
-			Log(m_unique_name+((loweEventFlag) ? "relic" : "muon")+" entry "
+			LOG_LAZY(m_unique_name+((loweEventFlag) ? "relic" : "muon")+" entry "
 			    +toString(currentParticle.InEntryNumber)+" is >60s after target entry "
 			    +toString(targetCand.InEntryNumber),v_debug,m_verbose);
 			if(loweEventFlag){
-				Log(m_unique_name+" Muon "+toString(targetCand.InEntryNumber)+" matched to "
-				    +toString(targetCand.matchedParticleEvNum.size())+" relics",v_debug,m_verbose);
+				LOG_LAZY(m_unique_name+" Muon "+toString(targetCand.InEntryNumber)+" matched to "
+				    +toString(targetMatches.matchedParticleEvNum.size())+" relics",v_debug,m_verbose);
 				// we'll find a lot of muons, but we're only interested in ones matched to relic candidates.
 				// only add it to the set of muons to record if it was matched to at least one relic.
 				if(!targetCand.flaggedForWrite){
 					targetCand.flaggedForWrite=true;
-					muonsToRemove=true;
 					if(!muSelectorName.empty()){
 						m_data->ApplyCut(muSelectorName, m_unique_name,
-						                 targetCand.matchedParticleEvNum.size());
+						                 targetMatches.matchedParticleEvNum.size());
 					}
 					// make a note of this muon and its number of matches
-					if(targetCand.matchedParticleEvNum.size()){
+					flaggedMuons.emplace_back(i, targetMatches.matchedParticleEvNum.size()>0);
+					if(targetMatches.matchedParticleEvNum.size()){
 						Log(m_unique_name+" Adding a muon to write out!",v_warning,m_verbose);
-						m_data->muonsToRec.push_back(targetCand);
 						
 						/* insanity check - not triggered
 						if(mu_nevsks.count(targetCand.EventNumber)!=0){
@@ -642,25 +661,24 @@ bool RelicMuonMatching::RelicMuonMatch(bool loweEventFlag, int64_t currentTicks,
 					}
 				}
 			} else {
-				Log(m_unique_name+" Relic "+toString(targetCand.InEntryNumber)+" matched to "
-				    +toString(targetCand.matchedParticleEvNum.size())+" muons",v_debug,m_verbose);
+				LOG_LAZY(m_unique_name+" Relic "+toString(targetCand.InEntryNumber)+" matched to "
+				    +toString(targetMatches.matchedParticleEvNum.size())+" muons",v_debug,m_verbose);
 				// add it to the set of relic candidates ready to write out
 				if(!targetCand.flaggedForWrite){
 					targetCand.flaggedForWrite=true;
-					relicsToRemove=true;
 					// make a note of this relic and its number of matches
 					if(!relicSelectorName.empty()){
 						m_data->ApplyCut(relicSelectorName, m_unique_name,
-						                 targetCand.matchedParticleEvNum.size());
+						                 targetMatches.matchedParticleEvNum.size());
 					}
 					Log(m_unique_name+" Adding a relic to write out!",v_warning,m_verbose);
-					m_data->writeOutRelics.push_back(targetCand);
+					flaggedRelics.push_back(i);
 				}
 			}
 		}
 	}
 	
-	currentDeque->push_back(currentParticle);
+	currentStore->Push(std::move(currentParticle), currentKey);
 	
 	//There are ~2.5 cosmic ray muons interating in SK per second,
 	//whereas relic candidates passing upstream cuts may be quite rare.
@@ -668,11 +686,22 @@ bool RelicMuonMatching::RelicMuonMatch(bool loweEventFlag, int64_t currentTicks,
 	//we could end up accumulating an unreasonably large stack.
 	//We can safely prune any muons more than 60s older than the current event that have no matches.
 	//only bother with this scan if we have >150 muons (~60s) of muons
-	if(!loweEventFlag && currentDeque->size() > 150){
-		Log(m_unique_name+" We have "+toString(currentDeque->size())
+	if(!loweEventFlag && currentStore->Size() > 150){
+		LOG_LAZY(m_unique_name+" We have "+toString(currentStore->Size())
 		    +" muons, dropping any more than 60s older than the current one",v_debug,m_verbose);
-		for(int i = 0; i < (int(currentDeque->size()) - 2); i++){
-			ParticleCand& targetCand = currentDeque->at(i);
+		// muons before this are more than the match window older than the current one
+		TimeOrderedCandStore::Index windowStart = currentStore->LowerBound(currentKey - match_window_ticks);
+		// the newest two muons are never dropped here. Removed entries still hold their slots
+		// until they reach an end of the store, so count back over the live ones
+		TimeOrderedCandStore::Index lastToCheck = currentStore->End();
+		for(int nlive=0; nlive<2 && lastToCheck>currentStore->Begin(); ){
+			--lastToCheck;
+			if(currentStore->IsLive(lastToCheck)) ++nlive;
+		}
+		for(TimeOrderedCandStore::Index i = currentStore->Begin(); i < windowStart && i < lastToCheck; i++){
+			if(!currentStore->IsLive(i)) continue;
+			ParticleCandCore& targetCand = currentStore->At(i);
+			ParticleCandPayload& targetMatches = currentStore->Payload(i);
 			
 			/*
 			std::cout<<"currentTicks:" <<currentTicks<<", target ticks: "<<targetCand.EventTicks<<std::endl;
@@ -712,14 +741,13 @@ bool RelicMuonMatching::RelicMuonMatch(bool loweEventFlag, int64_t currentTicks,
 			if(ticksDiff > match_window_ticks){
 				if(!targetCand.flaggedForWrite){
 					targetCand.flaggedForWrite=true;
-					muonsToRemove=true;
 					if(!muSelectorName.empty()){
 						m_data->ApplyCut(muSelectorName, m_unique_name,
-						                 targetCand.matchedParticleEvNum.size());
+						                 targetMatches.matchedParticleEvNum.size());
 					}
-					if(targetCand.matchedParticleEvNum.size()){
+					flaggedMuons.emplace_back(i, targetMatches.matchedParticleEvNum.size()>0);
+					if(targetMatches.matchedParticleEvNum.size()){
 						Log(m_unique_name+" Adding a muon to write out!",v_warning,m_verbose);
-						m_data->muonsToRec.push_back(targetCand);
 						
 						/* insanity check - not triggered
 						if(mu_nevsks.count(targetCand.EventNumber)!=0){
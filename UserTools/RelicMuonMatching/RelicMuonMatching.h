@@ -8,6 +8,8 @@
 #include "MTreeReader.h"
 #include "skroot.h"
 #include "ParticleCand.h"
+#include "TimeOrderedCandStore.h"
+#include "TickUnwrapper.h"
 #include "HistogramBuilder.h"
 
 /**
@@ -31,8 +33,13 @@ class RelicMuonMatching: public Tool {
 	std::string relicSelectorName;
 	MTreeReader* rfmReader = nullptr;
 	
-	bool RemoveFromDeque(std::deque<ParticleCand>& particleDeque);
 	bool RelicMuonMatch(bool loweEventFlag, int64_t currentTicks, int subtrg_num=0, int32_t it0xsk=0);
+	void RemoveFlagged();
+	
+	// candidates flagged for writing out during this Execute, in the order flagged. They are left in their
+	// stores until the end of Execute, so any further matching in the event still sees them, as with the deques.
+	std::vector<TimeOrderedCandStore::Index> flaggedRelics;
+	std::vector<std::pair<TimeOrderedCandStore::Index, bool>> flaggedMuons;  // and whether to write it out
 	
 	EventType eventType;
 	int currentSubRun=999;
@@ -43,8 +50,7 @@ class RelicMuonMatching: public Tool {
 	int64_t match_window_ticks;
 	bool check_in_60s=true;
 	
-	bool relicsToRemove=false;
-	bool muonsToRemove=false;
+	TickUnwrapper tickUnwrapper; // time keys of the candidate stores
 	
 	int32_t lastnevhwsk, lastit0sk, last_rollover_nevsk;
 	int64_t firsteventticks, lasteventticks=0, lastmuticks, lastrelicticks;
@@ -7,6 +7,7 @@
 #include <bitset>
 #include "geotnkC.h"  // for SK tank geometric constants
 #include "type_name_as_string.h"
+#include "MuonTrackGeometry.h"
 
 RelicMuonPlots::RelicMuonPlots():Tool(){}
 
@@ -660,21 +661,10 @@ bool RelicMuonPlots::MakePairVariables(){
 	
 	// find position of max dedx
 	// defined as bin where a sliding window of 4.5m (9x 50cm bins) has maximum sum
+	// (over the first 111 windows, as in mu_info.C - XXX why 111? muboy_dedx array is 200 bins in length...?)
 	double max_edep = 0;
 	int max_edep_bin=0;
-	for(int i=0;i<111;i++){   // from mu_info.C - XXX why 111? muboy_dedx array is 200 bins in length...?
-		// calculate sum of dedx in 9 bins from bin i to i+9
-		// (use 9 as an odd number so we have one central bin)
-		double e_dep_in_window = 0 ;
-		for(int j=0;j<9;j++){
-			e_dep_in_window = e_dep_in_window + muon_dedx[i+j]; // will be qpeak
-		}
-		if(e_dep_in_window > max_edep){
-			max_edep_bin = i+4;  // +4 to get centre bin
-			max_edep = e_dep_in_window;
-		}
-	}
-	double max_edep_pos = 50.*max_edep_bin;
+	double max_edep_pos = MuonTrackGeometry::MaxDedxPosition(muon_dedx, &max_edep_bin, &max_edep);
 	Log(m_unique_name+" muon track max dE/dx: "+toString(max_edep)+" at "+toString(max_edep_pos)+" cm "
 	         +"(bin "+toString(max_edep_bin)+"/115) along the track",v_debug,m_verbose);
 	
@@ -713,13 +703,13 @@ bool RelicMuonPlots::MakePairVariables(){
 	float appr;  // output: XXX is this "foot point"? distance along track where dlt is defined relative to?
 	
 	/*
-	std::cout<<"calling getdl_ with:\n"
+	std::cout<<"calling TrackDistance with:\n"
 	         <<"\trelic vertex: ("<<relic_vertex[0]<<", "<<relic_vertex[1]<<", "<<relic_vertex[2]<<")\n"
 	         <<"\tmuon entry point: ("<<muon_entrypoint[0]<<", "<<muon_entrypoint[1]<<", "<<muon_entrypoint[2]<<")\n"
 	         <<"\tmuon entry dir: ("<<muon_direction[0]<<", "<<muon_direction[1]<<", "<<muon_direction[2]<<")"<<std::endl;
 	*/
 	
-	getdl_(muon_direction, &relic_vertex[0], &relic_vertex[1], &relic_vertex[2], muon_entrypoint, &dlt, &appr);
+	MuonTrackGeometry::TrackDistance(muon_direction, muon_entrypoint, relic_vertex, dlt, appr);
 	
 	Log(m_unique_name+" transverse distance: "+std::to_string(dlt)+", with foot point at "+std::to_string(appr)
 	    +" cm along muon track",v_debug,m_verbose);
@@ -34,6 +34,7 @@ bool RemoveBadHits::Execute(){
 	Log(m_unique_name+": truncating nqiskz from "+toString(sktqz_.nqiskz)+" to "+toString(hit_idx),v_debug,m_verbose);
 	sktqz_.nqiskz=hit_idx;
 	rawtqinfo_.nqisk_raw=hit_idx;
+	m_data->InvalidateInGateHits();
 	
 	TQReal* TQREAL = nullptr;
 	tree_reader->Get("TQREAL", TQREAL);
@@ -38,7 +38,7 @@ SK2p2MeV::SK2p2MeV (const Float_t (*geomxyz)[3])
     
     // Bad & missing ch.
     NBAD=NMIS=0;
-    IBAD=IMIS=0;
+    BADMIS.Clear();
     
     // bonsai
     bonsai_ini_();
@@ -83,29 +83,23 @@ void SK2p2MeV::Print()
 
 Bool_t SK2p2MeV::CheckBadMis (const Int_t cab)
 {
-    //std::cout << NBAD << " " << NMIS << std::endl;
     // Check if cab is bad or missing. Retrun true if yes.
-    for (Int_t i=0; i<NBAD; i++) {
-        if ( IBAD[i] == cab ) return kTRUE;
-    }
-    for (Int_t i=0; i<NMIS; i++) {
-        if ( IMIS[i] == cab ) return kTRUE;
-    }
-    return kFALSE;
+    return BADMIS.IsBadOrMissing(cab);
 }
 
 void SK2p2MeV::SetBadch (const Int_t nb, const Int_t *ib)
 {
     // Set bad channel info
+    // n.b. the list is copied, so callers may reuse their array
     NBAD = nb;
-    IBAD = ib;
+    BADMIS.SetBad(nb, ib);
 }
 
 void SK2p2MeV::SetMisch (const Int_t nm, const Int_t *im)
 {
     // Set missing channel info
     NMIS = nm;
-    IMIS = im;
+    BADMIS.SetMissing(nm, im);
 }
 
 // Fill in prompt events
@@ -22,6 +22,7 @@
 #include "MTreeReader.h"
 #include "SkrootHeaders.h"
 #include "fortran_routines.h"
+#include "ChannelStatus.h"
 
 // use anonymous namespace to keep these local to SK2p2MeV
 namespace {
@@ -304,11 +305,12 @@ class SK2p2MeV: public TObject {
     
     // Bad channel info
     Int_t NBAD;        // # of back channels
-    const Int_t *IBAD; // Cable number of bad channels
     
     // Missing channel info
     Int_t NMIS;        // # of missing channels
-    const Int_t *IMIS; // Calbe number of missing channels
+    
+    // Cable numbers of bad and missing channels, for CheckBadMis
+    ChannelStatus BADMIS;
     
     // Private functions
     Int_t   N200Max  (Float_t tstart, Float_t tend);
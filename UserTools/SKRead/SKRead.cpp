@@ -47,6 +47,7 @@ bool SKRead::Initialise(std::string configfile, DataModel &data)
         int refSubRunNo = 0;
         int outputErrorStatus = 0;
         skbadch_(&refRunNo, &refSubRunNo, &outputErrorStatus);
+        m_data->UpdateChannelStatus(refRunNo, refSubRunNo);
         skbadopt_(&skBadChOption);
     }
 
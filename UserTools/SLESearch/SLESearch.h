@@ -3,6 +3,8 @@
 
 #include <string>
 #include <iostream>
+#include <deque>
+#include <vector>
 
 #include "Tool.h"
 
@@ -30,6 +32,11 @@ class SLESearch: public Tool {
   double SLE_deadtime=0;
   double SLE_t0_offset=0; //-885.417;
   
+  int trigger_conditions_run = -1;  // the run the SLE settings above were read for
+  std::vector<double> hits;
+  std::deque<double> window;
+  
+  void LoadTriggerConditions();
   double TimeOfFlight(const float*, const float*) const;
 
   TH1D hit_times_plot;
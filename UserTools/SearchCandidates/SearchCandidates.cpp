@@ -1,5 +1,8 @@
 #include "SearchCandidates.h"
 #include "Candidate.h"
+#include "EventContext.h"
+
+EVENT_PARALLEL_TOOL(SearchCandidates);
 
 
 bool SearchCandidates::Initialise(std::string configfile, DataModel &data)
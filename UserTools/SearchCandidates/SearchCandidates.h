@@ -1,10 +1,10 @@
 #ifndef SEARCHCANDIDATES_HH
 #define SEARCHCANDIDATES_HH
 
-#include "Tool.h"
+#include "EventParallelTool.h"
 #include "TVector3.h"
 
-class SearchCandidates : public Tool
+class SearchCandidates : public EventParallelTool
 {
     public:
         SearchCandidates():
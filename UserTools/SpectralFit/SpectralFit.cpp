@@ -1,5 +1,37 @@
 #include "SpectralFit.h"
 
+#include <cmath>
+#include <random>
+#include <algorithm>
+
+#include "TFile.h"
+#include "TH1D.h"
+#include "TGraph.h"
+#include "Math/Minimizer.h"
+#include "Math/Factory.h"
+#include "Math/IFunction.h"
+
+namespace {
+  // adaptor so that the minimiser gets the analytic gradient
+  class TemplateNLLFunction : public ROOT::Math::IMultiGradFunction {
+  public:
+    TemplateNLLFunction(const BinnedTemplateLikelihood& nll_in) : nll(nll_in), grad(nll_in.GetNParameters()) {}
+    ROOT::Math::IMultiGenFunction* Clone() const override { return new TemplateNLLFunction(nll); }
+    unsigned int NDim() const override { return nll.GetNParameters(); }
+    void Gradient(const double* x, double* g) const override { nll.NLLAndGradient(x, g); }
+    void FdF(const double* x, double& f, double* g) const override { f = nll.NLLAndGradient(x, g); }
+
+  private:
+    double DoEval(const double* x) const override { return nll.NLL(x); }
+    double DoDerivative(const double* x, unsigned int icoord) const override {
+      nll.NLLAndGradient(x, grad.data());
+      return grad[icoord];
+    }
+    const BinnedTemplateLikelihood& nll;
+    mutable std::vector<double> grad;
+  };
+}
+
 SpectralFit::SpectralFit():Tool(){}
 
 bool SpectralFit::Initialise(std::string configfile, DataModel &data){
@@ -9,34 +41,304 @@ bool SpectralFit::Initialise(std::string configfile, DataModel &data){
 
   m_data= &data;
   m_log= m_data->Log;
-  
+
   if(!m_variables.Get("verbosity",m_verbose)) m_verbose=1;
-  
-  GetPDFs();
-  
+
+  m_variables.Get("n_energy_bins", n_energy_bins);
+  m_variables.Get("energy_min", energy_min);
+  m_variables.Get("energy_max", energy_max);
+  m_variables.Get("energy_scale_sigma", energy_scale_sigma);
+  m_variables.Get("n_toys", n_toys);
+  m_variables.Get("toy_seed", toy_seed);
+  m_variables.Get("scan_distribution", scan_distribution);
+  m_variables.Get("scan_points", scan_points);
+  m_variables.Get("scan_min", scan_min);
+  m_variables.Get("scan_max", scan_max);
+  if(!m_variables.Get("outfile_name", outfile_name)) outfile_name = "spectral_fit.root";
+
+  if(n_energy_bins<1 || !(energy_max>energy_min)){
+    Log(m_unique_name+" Error! Invalid energy binning",v_error,m_verbose);
+    return false;
+  }
+
+  if(!GetPDFs()) return false;
+  if(!GetData()) return false;
+
   return true;
 }
 
 bool SpectralFit::Execute(){
 
-  // line up all regions along the x axis to make a global function
-  // normalise distributions across all regions
-  // construct functional fit
-  // do fit
-  // split up back into region plots
-  // be happy
-
-  // for (int i = 0; i < N_distributions){
-    
-  // }
-  
+  // the fit only needs doing once
+  if(fit_done) return true;
+  fit_done = true;
+  m_data->vars.Set("StopLoop",1);
+
+  best_fit_nll = Fit(best_fit, &best_fit_errors);
+  if(m_verbose){
+    std::cout<<"spectral fit results, -logL = "<<best_fit_nll<<":"<<std::endl;
+    for(int par=0; par<likelihood->GetNParameters(); ++par){
+      std::cout<<likelihood->GetName(par)<<": "<<best_fit[par]<<" +- "<<best_fit_errors[par]<<std::endl;
+    }
+  }
+
+  if(n_toys>0) RunToys();
+  if(scan_points>0) RunScan();
+
   return true;
 }
 
 bool SpectralFit::Finalise(){
+
+  if(!likelihood) return true;
+
+  TFile* outfile = TFile::Open(outfile_name.c_str(), "RECREATE");
+  if(outfile==nullptr || outfile->IsZombie()){
+    Log(m_unique_name+" Error! Could not open output file "+outfile_name,v_error,m_verbose);
+    return false;
+  }
+
+  // split the global bins back up into region plots
+  const int nbins = likelihood->GetNBins();
+  std::vector<double> pars = best_fit;
+  if(pars.empty()){
+    pars.resize(likelihood->GetNParameters());
+    likelihood->GetNominal(pars.data());
+  }
+  std::vector<double> total(nbins);
+  likelihood->Expectation(pars.data(), total.data());
+  std::vector<std::vector<double>> components(distribution_pars.size(), std::vector<double>(nbins));
+  for(size_t dist=0; dist<distribution_pars.size(); ++dist){
+    likelihood->TemplateExpectation(pars.data(), distribution_pars[dist], components[dist].data());
+  }
+  const std::vector<double>& counts = likelihood->GetData();
+  for(int region=0; region<N_regions; ++region){
+    const std::string rname = "r"+std::to_string(region);
+    TH1D data_hist((rname+"_data").c_str(), (region_names[region]+";Reconstructed Energy [MeV];Events").c_str(),
+                   n_energy_bins, energy_min, energy_max);
+    TH1D fit_hist((rname+"_fit").c_str(), (region_names[region]+";Reconstructed Energy [MeV];Events").c_str(),
+                  n_energy_bins, energy_min, energy_max);
+    for(int bin=0; bin<n_energy_bins; ++bin){
+      data_hist.SetBinContent(bin+1, counts[region*n_energy_bins+bin]);
+      data_hist.SetBinError(bin+1, std::sqrt(counts[region*n_energy_bins+bin]));
+      fit_hist.SetBinContent(bin+1, total[region*n_energy_bins+bin]);
+    }
+    data_hist.Write();
+    fit_hist.Write();
+    for(size_t dist=0; dist<distribution_pars.size(); ++dist){
+      const std::string dname = rname+"_dist"+std::to_string(distribution_index[dist]);
+      TH1D dist_hist(dname.c_str(), (distribution_names[distribution_index[dist]]+", "+region_names[region]
+                     +";Reconstructed Energy [MeV];Events").c_str(), n_energy_bins, energy_min, energy_max);
+      for(int bin=0; bin<n_energy_bins; ++bin){
+        dist_hist.SetBinContent(bin+1, components[dist][region*n_energy_bins+bin]);
+      }
+      dist_hist.Write();
+    }
+  }
+
+  // fitted parameters of each toy
+  for(int par=0; par<likelihood->GetNParameters() && !toy_fits.empty(); ++par){
+    double lo=toy_fits.front()[par], hi=lo;
+    for(const std::vector<double>& toy : toy_fits){
+      lo = std::min(lo, toy[par]);
+      hi = std::max(hi, toy[par]);
+    }
+    TH1D toy_hist(("toys_par"+std::to_string(par)).c_str(), (likelihood->GetName(par)+" in toys;Fitted value;Toys").c_str(),
+                  100, lo, (hi>lo) ? hi : lo+1);
+    for(const std::vector<double>& toy : toy_fits) toy_hist.Fill(toy[par]);
+    toy_hist.Write();
+  }
+
+  if(!scan_values.empty()){
+    TGraph scan(scan_values.size(), scan_values.data(), scan_delta_nll.data());
+    scan.SetName("profile_scan");
+    scan.SetTitle((distribution_names[scan_distribution]+" profile likelihood;Normalisation;#Delta(-log L)").c_str());
+    scan.Write();
+  }
+
+  outfile->Close();
+  delete outfile;
+
   return true;
 }
 
-void SpectralFit::GetPDFs(){
-  return;
+void SpectralFit::FillRegionBins(const TH1& hist, double energy_scale, double* out) const {
+  // spread each histogram bin's content uniformly over its (scaled) energy range
+  const double width = (energy_max-energy_min)/n_energy_bins;
+  for(int bin=0; bin<n_energy_bins; ++bin) out[bin] = 0;
+  for(int hbin=1; hbin<=hist.GetNbinsX(); ++hbin){
+    const double content = hist.GetBinContent(hbin);
+    if(content==0) continue;
+    const double lo = hist.GetXaxis()->GetBinLowEdge(hbin)*energy_scale;
+    const double hi = hist.GetXaxis()->GetBinUpEdge(hbin)*energy_scale;
+    if(hi<=energy_min || lo>=energy_max || !(hi>lo)) continue;
+    const int first = std::max(0, int((lo-energy_min)/width));
+    const int last = std::min(n_energy_bins-1, int((hi-energy_min)/width));
+    for(int bin=first; bin<=last; ++bin){
+      const double bin_lo = energy_min + bin*width;
+      const double overlap = std::min(hi, bin_lo+width) - std::max(lo, bin_lo);
+      if(overlap>0) out[bin] += content*overlap/(hi-lo);
+    }
+  }
+}
+
+bool SpectralFit::GetPDFs(){
+
+  // one file of region histograms from MakeSpectralFitHistos per distribution
+  const int nbins = N_regions*n_energy_bins;
+  likelihood.reset(new BinnedTemplateLikelihood(nbins));
+  std::vector<std::vector<double>> scaled_up, scaled_down;
+  for(int dist=0; dist<N_distributions; ++dist){
+    std::string template_file;
+    if(!m_variables.Get("template_file_"+std::to_string(dist), template_file)){
+      Log(m_unique_name+" No template for "+distribution_names[dist]+", it will not be fit",v_warning,m_verbose);
+      continue;
+    }
+    TFile* infile = TFile::Open(template_file.c_str(), "READ");
+    if(infile==nullptr || infile->IsZombie()){
+      Log(m_unique_name+" Error! Could not open template file "+template_file,v_error,m_verbose);
+      return false;
+    }
+    std::vector<double> nominal(nbins), up(nbins), down(nbins);
+    for(int region=0; region<N_regions; ++region){
+      TH1* hist = static_cast<TH1*>(infile->Get(("r"+std::to_string(region)).c_str()));
+      if(hist==nullptr){
+        Log(m_unique_name+" Error! No histogram r"+std::to_string(region)+" in "+template_file,v_error,m_verbose);
+        infile->Close();
+        delete infile;
+        return false;
+      }
+      FillRegionBins(*hist, 1., &nominal[region*n_energy_bins]);
+      if(energy_scale_sigma>0){
+        FillRegionBins(*hist, 1.+energy_scale_sigma, &up[region*n_energy_bins]);
+        FillRegionBins(*hist, 1.-energy_scale_sigma, &down[region*n_energy_bins]);
+      }
+    }
+    infile->Close();
+    delete infile;
+
+    double norm_sigma = 0;
+    m_variables.Get("norm_sigma_"+std::to_string(dist), norm_sigma);
+    distribution_pars.push_back(likelihood->AddTemplate(distribution_names[dist], nominal, norm_sigma));
+    distribution_index.push_back(dist);
+    scaled_up.push_back(up);
+    scaled_down.push_back(down);
+  }
+  if(distribution_pars.empty()){
+    Log(m_unique_name+" Error! No templates given",v_error,m_verbose);
+    return false;
+  }
+  if(scan_points>0 && std::find(distribution_index.begin(), distribution_index.end(), scan_distribution)==distribution_index.end()){
+    Log(m_unique_name+" Error! scan_distribution has no template",v_error,m_verbose);
+    return false;
+  }
+
+  if(energy_scale_sigma>0){
+    const int escale_par = likelihood->AddShapeNuisance("energy scale");
+    for(size_t dist=0; dist<distribution_pars.size(); ++dist){
+      likelihood->SetMorph(escale_par, distribution_pars[dist], scaled_up[dist], scaled_down[dist]);
+    }
+  }
+
+  return true;
+}
+
+bool SpectralFit::GetData(){
+
+  const int nbins = likelihood->GetNBins();
+  std::vector<double> counts(nbins);
+  std::string data_file;
+  if(!m_variables.Get("data_file", data_file)){
+    // Asimov dataset: the nominal prediction
+    Log(m_unique_name+" No data_file given, fitting the nominal prediction",v_warning,m_verbose);
+    std::vector<double> nominal(likelihood->GetNParameters());
+    likelihood->GetNominal(nominal.data());
+    likelihood->Expectation(nominal.data(), counts.data());
+    likelihood->SetData(counts);
+    return true;
+  }
+  TFile* infile = TFile::Open(data_file.c_str(), "READ");
+  if(infile==nullptr || infile->IsZombie()){
+    Log(m_unique_name+" Error! Could not open data file "+data_file,v_error,m_verbose);
+    return false;
+  }
+  for(int region=0; region<N_regions; ++region){
+    TH1* hist = static_cast<TH1*>(infile->Get(("r"+std::to_string(region)).c_str()));
+    if(hist==nullptr){
+      Log(m_unique_name+" Error! No histogram r"+std::to_string(region)+" in "+data_file,v_error,m_verbose);
+      infile->Close();
+      delete infile;
+      return false;
+    }
+    FillRegionBins(*hist, 1., &counts[region*n_energy_bins]);
+  }
+  infile->Close();
+  delete infile;
+  likelihood->SetData(counts);
+  return true;
+}
+
+double SpectralFit::Fit(std::vector<double>& pars, std::vector<double>* errors, int fixed_par, double fixed_value){
+
+  std::unique_ptr<ROOT::Math::Minimizer> minimizer(ROOT::Math::Factory::CreateMinimizer("Minuit2", "Migrad"));
+  TemplateNLLFunction func(*likelihood);
+  minimizer->SetFunction(func);
+  minimizer->SetErrorDef(0.5);   // negative log-likelihood
+  minimizer->SetMaxFunctionCalls(100000);
+  minimizer->SetTolerance(0.01);
+  minimizer->SetPrintLevel((m_verbose>2) ? 1 : 0);
+  const int npars = likelihood->GetNParameters();
+  std::vector<double> start(npars);
+  likelihood->GetNominal(start.data());
+  for(int par=0; par<npars; ++par){
+    if(par==fixed_par){
+      minimizer->SetFixedVariable(par, likelihood->GetName(par), fixed_value);
+    } else if(likelihood->IsNuisance(par)){
+      minimizer->SetVariable(par, likelihood->GetName(par), start[par], 0.5);
+    } else {
+      minimizer->SetLowerLimitedVariable(par, likelihood->GetName(par), start[par], 0.1, 0.);
+    }
+  }
+
+  bool fit_ok = minimizer->Minimize();
+  if(errors) fit_ok = minimizer->Hesse() && fit_ok;
+  if(!fit_ok){
+    Log(m_unique_name+" Warning! Spectral fit did not converge, status "+std::to_string(minimizer->Status()),
+        v_warning,m_verbose);
+  }
+  pars.assign(minimizer->X(), minimizer->X()+npars);
+  if(errors) errors->assign(minimizer->Errors(), minimizer->Errors()+npars);
+  return minimizer->MinValue();
+}
+
+void SpectralFit::RunToys(){
+
+  // toys are thrown from the best fit, using the same templates, then refit
+  const std::vector<double> data = likelihood->GetData();
+  std::mt19937_64 rng(toy_seed);
+  std::vector<double> counts, pars;
+  toy_fits.clear();
+  for(int toy=0; toy<n_toys; ++toy){
+    likelihood->ThrowToy(rng, best_fit.data(), counts);
+    likelihood->SetData(counts);
+    Fit(pars);
+    toy_fits.push_back(pars);
+  }
+  likelihood->SetData(data);
+  Log(m_unique_name+" Fit "+std::to_string(n_toys)+" toys",v_message,m_verbose);
+}
+
+void SpectralFit::RunScan(){
+
+  // profile: refit everything else at each fixed normalisation
+  const int scan_par = distribution_pars[std::find(distribution_index.begin(), distribution_index.end(),
+                                         scan_distribution) - distribution_index.begin()];
+  std::vector<double> pars;
+  scan_values.clear();
+  scan_delta_nll.clear();
+  for(int point=0; point<scan_points; ++point){
+    const double value = (scan_points>1) ? scan_min + (scan_max-scan_min)*point/(scan_points-1) : scan_min;
+    scan_values.push_back(value);
+    scan_delta_nll.push_back(Fit(pars, nullptr, scan_par, value) - best_fit_nll);
+  }
 }
@@ -4,19 +4,26 @@
 #include <string>
 #include <vector>
 #include <iostream>
-#include <map>
+#include <array>
+#include <memory>
 
-#include "TGraph.h"
+#include "TH1.h"
 
 #include "Tool.h"
+#include "BinnedTemplateLikelihood.h"
 
 static const int N_regions = 6;
 static const int N_distributions = 6;
 
-struct Distribution {
-  std::array<TGraph, N_regions> regions;
-};
-
+/**
+* \class SpectralFit
+*
+* Simultaneous binned Poisson likelihood fit of the signal and background energy spectra in all the
+* angle / neutron-tag regions of MakeSpectralFitHistos. Each distribution has one normalisation,
+* shared by all regions, which may be free or constrained; an optional energy scale nuisance morphs
+* the templates. Optionally throws toy datasets from the fitted model and refits them, and scans the
+* profile likelihood of one normalisation.
+*/
 class SpectralFit: public Tool {
 
 public:
@@ -28,27 +35,58 @@ public:
 
 private:
 
-  void GetPDFs();
+  bool GetPDFs();
+  bool GetData();
+  // fill a region's analysis bins from a histogram, with its energy axis scaled
+  void FillRegionBins(const TH1& hist, double energy_scale, double* out) const;
+  // minimise the likelihood, optionally with one parameter fixed; returns the minimum -log(L)
+  double Fit(std::vector<double>& pars, std::vector<double>* errors=nullptr, int fixed_par=-1, double fixed_value=0);
+  void RunToys();
+  void RunScan();
 
   const std::array<std::string, N_distributions> distribution_names = {
-    "SRN signal"
+    "SRN signal",
     "Invisible muons and pions",
     "nu_e CC interactions",
     "mu/pi-producing interactions",
     "NCQE interactions",
     "Spallation backgrounds"};
 
+  // in the order of the histograms r0-r5 written by MakeSpectralFitHistos
   const std::array<std::string, N_regions> region_names = {
-    "20-38deg, N_tagged = 1",
-    "38-50deg, N_tagged = 1",
-    "78-90deg, N_tagged = 1",
     "20-38deg, N_tagged != 1",
-    "38-50deg, N_tagged != 1",
-    "78-90deg, N_tagged != 1"};
-  
-  std::map<std::string, std::array<TGraph, N_regions>> distributions;
-  std::array<TGraph, N_distributions> global_distributions;
-  
+    "38-53deg, N_tagged != 1",
+    "70-90deg, N_tagged != 1",
+    "20-38deg, N_tagged = 1",
+    "38-53deg, N_tagged = 1",
+    "70-90deg, N_tagged = 1"};
+
+  // analysis binning of each region; the global bins are the regions' bins one after the other
+  int n_energy_bins = 16;
+  double energy_min = 16;
+  double energy_max = 80;
+  double energy_scale_sigma = 0;
+
+  std::unique_ptr<BinnedTemplateLikelihood> likelihood;
+  std::vector<int> distribution_pars;    // parameter of each loaded distribution
+  std::vector<int> distribution_index;   // into distribution_names
+  bool fit_done = false;
+  std::vector<double> best_fit;
+  std::vector<double> best_fit_errors;
+  double best_fit_nll = 0;
+
+  int n_toys = 0;
+  unsigned long toy_seed = 0;
+  std::vector<std::vector<double>> toy_fits;
+  int scan_distribution = 0;
+  int scan_points = 0;
+  double scan_min = 0;
+  double scan_max = 2;
+  std::vector<double> scan_values;
+  std::vector<double> scan_delta_nll;
+
+  std::string outfile_name;
+
 };
 
 #endif
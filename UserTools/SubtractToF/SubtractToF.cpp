@@ -3,6 +3,9 @@
 
 #include "SubtractToF.h"
 #include "TVector3.h"
+#include "EventContext.h"
+
+EVENT_PARALLEL_TOOL(SubtractToF);
 
 bool SubtractToF::Initialise(std::string configfile, DataModel &data)
 {
@@ -1,9 +1,9 @@
 #ifndef SUBTRACTTOF_HH
 #define SUBTRACTTOF_HH
 
-#include "Tool.h"
+#include "EventParallelTool.h"
 
-class SubtractToF : public Tool
+class SubtractToF : public EventParallelTool
 {
     public:
         SubtractToF() { name = "SubtractToF"; }
@@ -655,6 +655,7 @@ bool TreeReader::Initialise(std::string configfile, DataModel &data){
 					    toString(skroot_ref_run),v_error,m_verbose);
 					return false;
 				}
+				m_data->UpdateChannelStatus(skroot_ref_run, refSubRunNo);
 			}
 		}
 		
@@ -731,8 +732,9 @@ bool TreeReader::Initialise(std::string configfile, DataModel &data){
 	std::function<bool()> loadAFT = std::bind(std::mem_fn(&TreeReader::LoadAFT), std::ref(*this));
 	std::function<bool(int)> loadCommons = std::bind(std::mem_fn(&TreeReader::LoadCommons), std::ref(*this), std::placeholders::_1);
 	std::function<int(long)> getTreeEntry = std::bind(std::mem_fn(&TreeReader::ReadEntry), std::ref(*this), std::placeholders::_1, false);
+	std::function<int()> numBufferedCommons = [this](){ return int(commons_vec.size()); };
 	// TODO we could remove the first argument now that the MTreeReader knows its name
-	m_data->RegisterReader(readerName, &myTreeReader, hasAFT, loadSHE, loadAFT, loadCommons, getTreeEntry);
+	m_data->RegisterReader(readerName, &myTreeReader, hasAFT, loadSHE, loadAFT, loadCommons, getTreeEntry, numBufferedCommons);
 	
 	// get first entry to process
 	if(firstEntry<0) firstEntry=0;
@@ -809,7 +811,7 @@ bool TreeReader::Execute(){
 	// but still want to use the TreeReader tool to populate SK common blocks.
 	if(!autoRead) return true;
 	
-	Log(m_unique_name+" getting entry "+toString(entrynum),v_debug,m_verbose);
+	LOG_LAZY(m_unique_name+" getting entry "+toString(entrynum),v_debug,m_verbose);
 	
 	// optionally buffer N entries per Execute call
 	// clear the buffers before we start, unless we're buffering events between loops
@@ -830,17 +832,17 @@ bool TreeReader::Execute(){
 		do {
 			
 			// load next entry
-			Log(m_unique_name+" Reading entry "+toString(entrynum),v_debug,m_verbose);
+			LOG_LAZY(m_unique_name+" Reading entry "+toString(entrynum),v_debug,m_verbose);
 			get_ok = ReadEntry(entrynum, true);
-			Log(m_unique_name+" ReadEntry returned "+toString(get_ok),v_debug,m_verbose);
+			LOG_LAZY(m_unique_name+" ReadEntry returned "+toString(get_ok),v_debug,m_verbose);
 			
 			// if we're processing ZBS files and ran off the end of this file,
 			// load the next file if we have one and re-try the read.
 			if(get_ok==0 && skrootMode==SKROOTMODE::ZEBRA && list_of_files.size()>0){
-				Log(m_unique_name+" hit end of this ZBS file, loading next one",v_debug,m_verbose);
+				LOG_LAZY(m_unique_name+" hit end of this ZBS file, loading next one",v_debug,m_verbose);
 				skclosef_(&LUN);
 				get_ok = LoadNextZbsFile();
-				Log(m_unique_name+" loaded next ZBS file, return was "+toString(get_ok),v_debug,m_verbose);
+				LOG_LAZY(m_unique_name+" loaded next ZBS file, return was "+toString(get_ok),v_debug,m_verbose);
 				if(get_ok==0){
 					Log(m_unique_name+" failure loading next ZBS file! Ending toolchain",v_error,m_verbose);
 				} else {
@@ -904,9 +906,9 @@ bool TreeReader::Execute(){
 				
 				// if we're reading *only* SHE+AFT pairs, skip the entry if it's not SHE
 				if(get_ok>0 && onlyPairs && !trigger_bits.test(28)){
-					Log(m_unique_name+" Prompt entry is not SHE",v_debug,m_verbose);
+					LOG_LAZY(m_unique_name+" Prompt entry is not SHE",v_debug,m_verbose);
 					// its not SHE. If we only want SHE+AFT pairs, skip this entry.
-					Log(m_unique_name+" Re-starting read process",v_debug,m_verbose);
+					LOG_LAZY(m_unique_name+" Re-starting read process",v_debug,m_verbose);
 					get_ok=-999;
 				}
 				
@@ -919,7 +921,7 @@ bool TreeReader::Execute(){
 					// returns: -999 if not AFT (or error reading AFT) and we're only processing pairs
 					// returns: <=0  if error during AFT read and we're not only processing pairs
 				} else if(get_ok>0 && loadSheAftPairs){
-					Log(m_unique_name+" PairLoading mode on but prompt event is not SHE, skipping follow-up read",
+					LOG_LAZY(m_unique_name+" PairLoading mode on but prompt event is not SHE, skipping follow-up read",
 					    v_debug,m_verbose);
 				}
 				
@@ -937,7 +939,7 @@ bool TreeReader::Execute(){
 				// already loaded in the common block buffers.
 				// If we don't want to read this entry, then discard it from the buffer.
 				if(buffered_entry>0 && buffered_entry != entrynum){
-					Log(m_unique_name+" Discarding buffered SHE from AFT search, since it is "
+					LOG_LAZY(m_unique_name+" Discarding buffered SHE from AFT search, since it is "
 					   +"not in our selection entry list",v_debug,m_verbose);
 					PopCommons();
 				}
@@ -958,8 +960,8 @@ bool TreeReader::Execute(){
 			skhead_.nsubsk = 1;
 		}
 		
+		if(get_ok==0) break;  // end of file; nothing new to buffer
 		if(entriesPerExecute>1) PushCommons();
-		if(get_ok==0) break;  // end of file
 	} // read and buffer loop
 	
 	// 'aft_loaded' indicates whether common blocks currently hold SHE or AFT when reading both together.
@@ -976,6 +978,17 @@ bool TreeReader::Execute(){
 		return false;
 	}
 	
+	// if we hit the end of the file part-way through filling the buffer, return the entries we have
+	// and stop after this loop. The failed read may have changed the live commons, so put the last
+	// buffered entry back into them, as after a full buffer.
+	if(get_ok==0 && entriesPerExecute>1 && commons_vec.size()>0){
+		LOG_LAZY(m_unique_name+" end of file with "+toString(commons_vec.size())+" of "
+		         +toString(entriesPerExecute)+" entries buffered",v_debug,m_verbose);
+		commons_vec.back().Restore();
+		m_data->vars.Set("StopLoop",true);
+		get_ok = 1;
+	}
+	
 	// when processing SKROOT files we can't rely on LoadTree(next_entry)
 	// to indicate that there are more events to process - all remaining entries
 	// may be pedestals that get skipped! If we skipped until we hit the end
@@ -1034,11 +1047,11 @@ bool TreeReader::Execute(){
 	*/
 	
 	if(skrootMode!=::SKROOTMODE::NONE){
-		Log(m_unique_name+" Returning entry skhead_.nevsk " + toString(skhead_.nevsk),v_debug,m_verbose);
+		LOG_LAZY(m_unique_name+" Returning entry skhead_.nevsk " + toString(skhead_.nevsk),v_debug,m_verbose);
 		//std::cout<<"entry "<<entrynum<<", nevsk "<<skhead_.nevsk<<std::endl;
 		//std::cout<<skhead_.nevsk<<"\tthis evt nevhwsk: "<<skheadqb_.nevhwsk<<", it0sk: "<<skheadqb_.it0sk<<std::endl;
 	} else {
-		Log(m_unique_name+" Returning entry "+toString(entrynum),v_debug,m_verbose);
+		LOG_LAZY(m_unique_name+" Returning entry "+toString(entrynum),v_debug,m_verbose);
 	}
 	
 	return true;
@@ -1127,6 +1140,7 @@ bool TreeReader::SubrunChange(){
 		Log(m_unique_name+" Error calling skbadch_ in SubrunChange!",v_error,m_verbose);
 		get_ok = false;
 	} else {
+		m_data->UpdateChannelStatus(skroot_ref_run, skhead_.nsubsk);
 		Log(m_unique_name+" bad channel list updated",v_debug,m_verbose);
 	}
 	
@@ -1292,13 +1306,15 @@ TreeReader::~TreeReader(){
 
 int TreeReader::ReadEntry(long entry_number, bool use_buffered){
 	int bytesread=1;
+	// consecutive entries can share run/subrun/event numbers (e.g. MC), so drop any cached hits
+	m_data->InvalidateInGateHits();
 	// load next entry data from TTree
 	
 	// skip the very first read in zebra mode as we already loaded it when checking if MC in Initialize
 	if(skrootMode==SKROOTMODE::ZEBRA && entry_number==firstEntry){
-		Log(m_unique_name+" skipping very first read as we got it from Initialize",v_debug,m_verbose);
+		LOG_LAZY(m_unique_name+" skipping very first read as we got it from Initialize",v_debug,m_verbose);
 	} else if(skrootMode!=SKROOTMODE::NONE){
-		Log(m_unique_name+" ReadEntry using SK fortran routines to load data into common blocks",v_debug,m_verbose);
+		LOG_LAZY(m_unique_name+" ReadEntry using SK fortran routines to load data into common blocks",v_debug,m_verbose);
 		// Populating fortran common blocks with SKROOT entry data requires using
 		// SKRAWREAD and/or SKREAD.
 		// These functions call various skroot_get_* functions to retrieve branch data.
@@ -1356,8 +1372,8 @@ int TreeReader::ReadEntry(long entry_number, bool use_buffered){
 			// for now we'll only support sequential reads
 		}
 		
-		if(loadSheAftPairs && skrootMode==SKROOTMODE::ZEBRA && use_buffered && skhead_vec.size()>0){
-			Log(m_unique_name+" buffered ZEBRA entry, using in place of read",v_debug,m_verbose);
+		if(loadSheAftPairs && skrootMode==SKROOTMODE::ZEBRA && use_buffered && commons_vec.size()>0){
+			LOG_LAZY(m_unique_name+" buffered ZEBRA entry, using in place of read",v_debug,m_verbose);
 			// if we have a buffered entry in hand, but it is not marked as an AFT trigger
 			// for the current readout, then the buffered entry is an unprocessed event.
 			// bypass the read and just load in the buffered data into the common blocks.
@@ -1365,11 +1381,11 @@ int TreeReader::ReadEntry(long entry_number, bool use_buffered){
 			// then pop off the buffered data
 			PopCommons();
 		} else {
-			Log(m_unique_name+" reading next entry from file",v_debug,m_verbose);
+			LOG_LAZY(m_unique_name+" reading next entry from file",v_debug,m_verbose);
 			// use skread / skrawread to get the next TTree entry and populate Fortran common blocks
 			// skreadMode: 0=skread only, 1=skrawread only, 2=both
 			if(bytesread>0 && skreadMode!=0){
-				Log(m_unique_name+" calling SKRAWREAD",v_debug,m_verbose);
+				LOG_LAZY(m_unique_name+" calling SKRAWREAD",v_debug,m_verbose);
 				skcrawread_(&LUN, &get_ok); // N.B. positive LUN (see above)
 				// for ZBS this doesn't seem to flag non-physics events as per for SKROOT...?
 				// manually add in checks as per headsk.F for ROOT ... FIXME ? is this appropriate?
@@ -1407,7 +1423,7 @@ int TreeReader::ReadEntry(long entry_number, bool use_buffered){
 				}
 			}
 			if(bytesread>0 && skreadMode!=1){  // skip skread if skrawread had an error
-				Log(m_unique_name+" calling SKREAD",v_debug,m_verbose);
+				LOG_LAZY(m_unique_name+" calling SKREAD",v_debug,m_verbose);
 				int LUN2 = LUN;
 				if(skreadMode==2) LUN2 = -LUN;  // if we already called skrawread, use a negative LUN
 				skcread_(&LUN2, &get_ok);
@@ -1436,11 +1452,11 @@ int TreeReader::ReadEntry(long entry_number, bool use_buffered){
 			// As mentioned above, neither of these load all TTree branches.
 			// To do that we need to call skroot_get_entry.
 			if(bytesread>0 && skrootMode!=SKROOTMODE::ZEBRA){
-				Log(m_unique_name+" calling skroot_get_entry",v_debug,m_verbose);
+				LOG_LAZY(m_unique_name+" calling skroot_get_entry",v_debug,m_verbose);
 				skroot_get_entry_(&LUN);
 			}
 			if(bytesread > 0 && skrootMode == SKROOTMODE::ZEBRA){
-			  Log(m_unique_name+" calling nerdnebk to retrieve NEUT bank", v_debug, m_verbose);
+			  LOG_LAZY(m_unique_name+" calling nerdnebk to retrieve NEUT bank", v_debug, m_verbose);
 			  std::array<float, 3> interaction_pos = {};
 			  nerdnebk_(interaction_pos.data());
 			}
@@ -1448,18 +1464,18 @@ int TreeReader::ReadEntry(long entry_number, bool use_buffered){
 		
 	}
 	if(bytesread >0 && skrootMode!=SKROOTMODE::ZEBRA) {
-		Log(m_unique_name+" using MTreeReader to get next TTree entry",v_debug,m_verbose);
+		LOG_LAZY(m_unique_name+" using MTreeReader to get next TTree entry",v_debug,m_verbose);
 		// if in SKROOT mode we've already read from disk, just want to update
 		// the internal MTreeReader variables, so skip the actual TTree::GetEntry call
 		bytesread = myTreeReader.GetEntry(entry_number, (skrootMode!=SKROOTMODE::NONE));
 	}
-	Log(m_unique_name+" bytesread is "+toString(bytesread),v_debug,m_verbose);
+	LOG_LAZY(m_unique_name+" bytesread is "+toString(bytesread),v_debug,m_verbose);
 	
 	// stop loop if we ran off the end of the tree
 	if(bytesread==0){
 		Log(m_unique_name+" entry "+toString(entry_number)+" off end of input file!",v_error,m_verbose);
 	} else if(bytesread==-999){
-		Log(m_unique_name+" skrawread pedestal or status event",v_debug+10,m_verbose);
+		LOG_LAZY(m_unique_name+" skrawread pedestal or status event",v_debug+10,m_verbose);
 	}
 	// stop loop if we had an error of some kind
 	else if(bytesread<0){
@@ -1473,7 +1489,7 @@ int TreeReader::ReadEntry(long entry_number, bool use_buffered){
 
 int TreeReader::AFTRead(long entry_number){
 	
-	Log(m_unique_name+" Prompt entry is SHE, checking next entry for AFT", v_debug,m_verbose);
+	LOG_LAZY(m_unique_name+" Prompt entry is SHE, checking next entry for AFT", v_debug,m_verbose);
 	has_aft=false; // default assumption
 	
 	// do a pre-check to see if we need to read the next entry.
@@ -1502,12 +1518,12 @@ int TreeReader::AFTRead(long entry_number){
 	}
 	
 	// if the pre-check indicated we need to do a follow up read, do that now.
-	Log(m_unique_name+" Re-Invoking ReadEntry to check next entry",v_debug,m_verbose);
+	LOG_LAZY(m_unique_name+" Re-Invoking ReadEntry to check next entry",v_debug,m_verbose);
 	
 	// i assume that if there's an AFT, it'll always be the next entry,
 	// i.e. there won't be things like status entries in between the SHE and AFT.
 	get_ok = ReadEntry(entrynum+1, false);
-	Log(m_unique_name+" Follow-up read returned "+toString(get_ok),v_debug,m_verbose);
+	LOG_LAZY(m_unique_name+" Follow-up read returned "+toString(get_ok),v_debug,m_verbose);
 	
 	PrintTriggerBits();
 	
@@ -1533,7 +1549,7 @@ int TreeReader::AFTRead(long entry_number){
 		}
 		
 		if(get_ok==1){
-			Log(m_unique_name+" Successfully found SHE+AFT pair",v_debug,m_verbose);
+			LOG_LAZY(m_unique_name+" Successfully found SHE+AFT pair",v_debug,m_verbose);
 			has_aft=true;
 		} else if(get_ok == -100){
 			// not AFT, but we're noy only reading pairs
@@ -1557,7 +1573,7 @@ int TreeReader::CheckForAFTROOT(long entry_number){
 	
 	// this event is SHE, and we're looking for SHE+AFT pairs.
 	// Peek at the next TTree entry to see if it's an associated AFT.
-	Log(m_unique_name+" prompt event is SHE, peeking at next entry for AFT check",v_debug,m_verbose);
+	LOG_LAZY(m_unique_name+" prompt event is SHE, peeking at next entry for AFT check",v_debug,m_verbose);
 	
 	int retval=-1;
 	
@@ -1575,20 +1591,20 @@ int TreeReader::CheckForAFTROOT(long entry_number){
 			next_trigger_bits = header->idtgsk;
 		}
 	} else {
-		Log(m_unique_name+" can't check for AFT, no further entries in HEADER branch",
+		LOG_LAZY(m_unique_name+" can't check for AFT, no further entries in HEADER branch",
 			v_debug,m_verbose);
 			return -100;  // no error reading but no AFT
 	}
 	
 	if(next_trigger_bits.test(29)){
-		Log(m_unique_name+" next entry is AFT, requesting follow-up read",v_debug,m_verbose);
+		LOG_LAZY(m_unique_name+" next entry is AFT, requesting follow-up read",v_debug,m_verbose);
 		// The next entry is indeed an AFT. We need to read it in properly now,
 		// so buffer the current SHE data...
 		PushCommons();
 		// ... and indicate that we want to re-run ReadEntry to get the AFT entry.
 		retval=-103;
 	} else {
-		Log(m_unique_name+" next entry is not AFT, no AFT this time.",v_debug,m_verbose);
+		LOG_LAZY(m_unique_name+" next entry is not AFT, no AFT this time.",v_debug,m_verbose);
 		if(!onlyPairs){
 			// if we're not explicitly requesting pairs we'll still process this SHE event
 			// rewind Header branch so that anyone using the MTreeReader gets the right data
@@ -1614,7 +1630,7 @@ int TreeReader::CheckForAFTZebra(long entry_number){
 
 int TreeReader::LoadAFTROOT(){
 	// we peeked, so we already know this is an AFT trigger.
-	Log(m_unique_name+" Successfully found SHE+AFT pair",v_debug,m_verbose);
+	LOG_LAZY(m_unique_name+" Successfully found SHE+AFT pair",v_debug,m_verbose);
 	has_aft=true;
 	
 	// We now we have an SHE in the buffer and an AFT currently loaded.
@@ -1628,14 +1644,14 @@ int TreeReader::LoadAFTZebra(){
 	// At this point we currently have an unprocessed SHE event in the common block buffers,
 	// and we've just read the next zebra file entry into the fortran common blocks.
 	// Let's now check if the next zebra file entry is an AFT associated to our buffered SHE.
-	Log(m_unique_name+" we have the next entry in active commons "
+	LOG_LAZY(m_unique_name+" we have the next entry in active commons "
 		+"and a prompt entry buffered. Checking trigger word",v_debug,m_verbose);
 	
 	int bytesread=-1;
 	
 	std::bitset<sizeof(int)*8> trigger_bits = skhead_.idtgsk;
 	if(trigger_bits.test(29)){
-		Log(m_unique_name+" Successfully found an SHE+AFT pair",v_debug,m_verbose);
+		LOG_LAZY(m_unique_name+" Successfully found an SHE+AFT pair",v_debug,m_verbose);
 		// this means we have an SHE in buffer and an AFT in the common blocks right now.
 		// swap the SHE event back into the common blocks and AFT into the buffer.
 		LoadCommons(0);
@@ -1643,12 +1659,12 @@ int TreeReader::LoadAFTZebra(){
 		bytesread = 1;
 		
 	} else {
-		Log(m_unique_name+" Follow-up entry is not AFT",v_debug,m_verbose);
+		LOG_LAZY(m_unique_name+" Follow-up entry is not AFT",v_debug,m_verbose);
 		
 		// we have two options for proceeding here.
 		// If the user ONLY wants SHE+AFT pairs...
 		if(onlyPairs){
-			Log(m_unique_name+" Dropping old SHE since we only want pairs",v_debug,m_verbose);
+			LOG_LAZY(m_unique_name+" Dropping old SHE since we only want pairs",v_debug,m_verbose);
 			// The currently buffered SHE did not have an associated AFT, so we have no use for it.
 			PopCommons();  // drop it from the buffer.
 			// we'll start this read all over, so put the new entry into the buffer
@@ -1656,7 +1672,7 @@ int TreeReader::LoadAFTZebra(){
 			PushCommons();
 			bytesread = -999;
 		} else {
-			Log(m_unique_name+" Swapping back previous entry, keeping next entry for next Execute call",
+			LOG_LAZY(m_unique_name+" Swapping back previous entry, keeping next entry for next Execute call",
 				v_debug,m_verbose);
 			// else the user wants an AFT if there is one, but will still accept SHE events
 			// without one. In that case, we still want to process our buffered entry,
@@ -1913,6 +1929,7 @@ int TreeReader::LoadConfig(std::string configfile){
 			Log(m_unique_name+" Error! readSheAftTogether and entriesPerExecute>1 cannot "
 				+"both be used at the same time. Setting entriesPerExecute=1.",v_warning,m_verbose);
 			entriesPerExecute=1;
+			m_variables.Set("entriesPerExecute",entriesPerExecute);  // as used, for Tools that fit the buffer
 		} else if(onlyPairs){
 			skip_ped_evts = true;
 		}
@@ -2015,221 +2032,47 @@ bool TreeReader::LoadNextZbsFile(){
 }
 
 int TreeReader::PushCommons(){
-	if(loadSheAftPairs && skhead_vec.size()){
+	if(loadSheAftPairs && commons_vec.size()){
 		std::cerr<<"PUSH COMMONS WITH ALREADY EXISTING ENTRY!"<<std::endl;
 		exit(-1);
 	}
 	// make a buffered copy of the current state of event-wise fortran common blocks
 	// so that the user may access both SHE and AFT (or potentially arbitrary) events
-	// TODO remove any that are not set by skread and used by reco algorithms
+	// See EventCommons for the list of buffered common blocks.
 	// XXX we could consider using or looking at `skroot_set_tree_(&lun);`
 	// which populates the SKROOT branches based on common blocks.
 	// Perhaps we could call this and then buffer the generated e.g. TQREAL objects?
+	commons_vec.emplace_back();
+	commons_vec.back().Capture();
 	
-	// event header - run, event numbers, trigger info...
-	skhead_vec.emplace_back(skhead_);            // skhead_common
-	skheada_vec.emplace_back(skheada_);          // skheada_common
-	skheadg_vec.emplace_back(skheadg_);          // skheadg_common
-	skheadf_vec.emplace_back(skheadf_);          // skheadf_common
-	skheadc_vec.emplace_back(skheadc_);          // skheadc_common
-	skheadqb_vec.emplace_back(skheadqb_);        // skheadqb_common
-	
-	// low-e event variables
-	skroot_lowe_vec.emplace_back(skroot_lowe_);  // skroot_lowe_common
-	skroot_mu_vec.emplace_back(skroot_mu_);      // skroot_mu_common
-	skroot_sle_vec.emplace_back(skroot_sle_);    // skroot_sle_common
-	
-	// commons containing arrays of T, Q, ICAB....
-	// not sure which of these may be populated by skread
-	skq_vec.emplace_back(skq_);                  // skq_common
-	skqa_vec.emplace_back(skqa_);                // skqa_common
-	skt_vec.emplace_back(skt_);                  // skt_common
-	skta_vec.emplace_back(skta_);                // skta_common
-	skchnl_vec.emplace_back(skchnl_);            // skchnl_common
-	skthr_vec.emplace_back(skthr_);              // skthr_common
-	sktqz_vec.emplace_back(sktqz_);              // sktqz_common
-	sktqaz_vec.emplace_back(sktqaz_);            // sktqaz_common
-	rawtqinfo_vec.emplace_back(rawtqinfo_);      // rawtqinfo_common
-	
-	sktrighit_vec.emplace_back(sktrighit_);      // sktrighit_common
-	skqv_vec.emplace_back(skqv_);                // skqv_common
-	sktv_vec.emplace_back(sktv_);                // sktv_common
-	skchlv_vec.emplace_back(skchlv_);            // skchlv_common
-	skthrv_vec.emplace_back(skthrv_);            // skthrv_common
-	skhitv_vec.emplace_back(skhitv_);            // skhitv_common
-	skpdstv_vec.emplace_back(skpdstv_);          // skpdstv_common
-	skatmv_vec.emplace_back(skatmv_);            // skatmv_common
-	
-	// OD mask....? nhits, charge, flag...?
-	odmaskflag_vec.emplace_back(odmaskflag_);    // odmaskflag_common
-	
-	// hardware trigger variables; counters, trigger words, prevt0...
-	// no idea how many, if any, of these are populated by skread,
-	// or moreover how many are needed by reconstruction algorithms.
-	
-	// spacer and trigger info.
-	skdbstat_vec.emplace_back(skdbstat_);        // skdbstat_common
-	skqbstat_vec.emplace_back(skqbstat_);        // skqbstat_common
-	skspacer_vec.emplace_back(skspacer_);        // skspacer_common
-	
-	// gps word and time.
-	skgps_vec.emplace_back(skgps_);              // skgps_common
-	t2kgps_vec.emplace_back(t2kgps_);            // t2kgps_common
-	
-	// hw counter difference to previous event.
-	prevt0_vec.emplace_back(prevt0_);            // prevt0_common
-//	tdiff_vec.emplace_back(tdiff_);              // tdiff_common
-	mintdiff_vec.emplace_back(mintdiff_);        // mintdiff_common
-	
-	// trigger hardware counters, word, spacer length...
-	sktrg_vec.emplace_back(sktrg_);              // sktrg_common
-	
-	// MC particles and vertices, event-wise.
-	vcvrtx_vec.emplace_back(vcvrtx_);            // vcvrtx_common
-	vcwork_vec.emplace_back(vcwork_);            // vcwork_common
-	
-	return skhead_vec.size();
+	return commons_vec.size();
 }
 
 int TreeReader::PopCommons(){
 	// drop an entry from the buffered common blocks
-	// TODO remove any that are not set by skread and used by reco algorithms
-	
-	skhead_vec.pop_back();
-	skheada_vec.pop_back();
-	skheadg_vec.pop_back();
-	skheadf_vec.pop_back();
-	skheadc_vec.pop_back();
-	skheadqb_vec.pop_back();
-	skroot_lowe_vec.pop_back();
-	skroot_mu_vec.pop_back();
-	skroot_sle_vec.pop_back();
-	skq_vec.pop_back();
-	skqa_vec.pop_back();
-	skt_vec.pop_back();
-	skta_vec.pop_back();
-	skchnl_vec.pop_back();
-	skthr_vec.pop_back();
-	sktqz_vec.pop_back();
-	sktqaz_vec.pop_back();
-	rawtqinfo_vec.pop_back();
-	sktrighit_vec.pop_back();
-	skqv_vec.pop_back();
-	sktv_vec.pop_back();
-	skchlv_vec.pop_back();
-	skthrv_vec.pop_back();
-	skhitv_vec.pop_back();
-	skpdstv_vec.pop_back();
-	skatmv_vec.pop_back();
-	odmaskflag_vec.pop_back();
-	skdbstat_vec.pop_back();
-	skqbstat_vec.pop_back();
-	skspacer_vec.pop_back();
-	skgps_vec.pop_back();
-	t2kgps_vec.pop_back();
-	prevt0_vec.pop_back();
-//	tdiff_vec.pop_back();
-	mintdiff_vec.pop_back();
-	sktrg_vec.pop_back();
-	vcvrtx_vec.pop_back();
-	vcwork_vec.pop_back();
-	
-	return skhead_vec.size();
+	commons_vec.pop_back();
+	
+	return commons_vec.size();
 }
 
 int TreeReader::FlushCommons(){
 	// drop all entries from the buffered common blocks
-	// TODO remove any that are not set by skread and used by reco algorithms
-	if(skhead_vec.size()==0) return 1;
-	
-	skhead_vec.clear();
-	skheada_vec.clear();
-	skheadg_vec.clear();
-	skheadf_vec.clear();
-	skheadc_vec.clear();
-	skheadqb_vec.clear();
-	skroot_lowe_vec.clear();
-	skroot_mu_vec.clear();
-	skroot_sle_vec.clear();
-	skq_vec.clear();
-	skqa_vec.clear();
-	skt_vec.clear();
-	skta_vec.clear();
-	skchnl_vec.clear();
-	skthr_vec.clear();
-	sktqz_vec.clear();
-	sktqaz_vec.clear();
-	rawtqinfo_vec.clear();
-	sktrighit_vec.clear();
-	skqv_vec.clear();
-	sktv_vec.clear();
-	skchlv_vec.clear();
-	skthrv_vec.clear();
-	skhitv_vec.clear();
-	skpdstv_vec.clear();
-	skatmv_vec.clear();
-	odmaskflag_vec.clear();
-	skdbstat_vec.clear();
-	skqbstat_vec.clear();
-	skspacer_vec.clear();
-	skgps_vec.clear();
-	t2kgps_vec.clear();
-	prevt0_vec.clear();
-//	tdiff_vec.clear();
-	mintdiff_vec.clear();
-	sktrg_vec.clear();
-	vcvrtx_vec.clear();
-	vcwork_vec.clear();
+	if(commons_vec.size()==0) return 1;
+	
+	commons_vec.clear();
 	
 	return 1;
 }
 
 bool TreeReader::LoadCommons(int buffer_i){
 	// check we have such a buffered entry
-	if(buffer_i>=skhead_vec.size()){
+	if(buffer_i>=commons_vec.size()){
 		Log(m_unique_name+" Error! Asked to load common block buffer entry "+toString(buffer_i)
-			+" out of range 0->"+skhead_vec.size()+"!",v_error,m_verbose);
+			+" out of range 0->"+commons_vec.size()+"!",v_error,m_verbose);
 		return false;
 	}
 	
-	std::swap(skhead_, skhead_vec.at(buffer_i));
-	std::swap(skheada_, skheada_vec.at(buffer_i));
-	std::swap(skheadg_, skheadg_vec.at(buffer_i));
-	std::swap(skheadf_, skheadf_vec.at(buffer_i));
-	std::swap(skheadc_, skheadc_vec.at(buffer_i));
-	std::swap(skheadqb_, skheadqb_vec.at(buffer_i));
-	std::swap(skroot_lowe_,skroot_lowe_vec.at(buffer_i));
-	std::swap(skroot_mu_,skroot_mu_vec.at(buffer_i));
-	std::swap(skroot_sle_,skroot_sle_vec.at(buffer_i));
-	std::swap(skq_, skq_vec.at(buffer_i));
-	std::swap(skqa_, skqa_vec.at(buffer_i));
-	std::swap(skt_, skt_vec.at(buffer_i));
-	std::swap(skta_, skta_vec.at(buffer_i));
-	std::swap(skchnl_, skchnl_vec.at(buffer_i));
-	std::swap(skthr_, skthr_vec.at(buffer_i));
-	std::swap(sktqz_, sktqz_vec.at(buffer_i));
-	std::swap(sktqaz_, sktqaz_vec.at(buffer_i));
-	std::swap(rawtqinfo_, rawtqinfo_vec.at(buffer_i));
-	std::swap(sktrighit_, sktrighit_vec.at(buffer_i));
-	std::swap(skqv_, skqv_vec.at(buffer_i));
-	std::swap(sktv_, sktv_vec.at(buffer_i));
-	std::swap(skchlv_, skchlv_vec.at(buffer_i));
-	std::swap(skthrv_, skthrv_vec.at(buffer_i));
-	std::swap(skhitv_, skhitv_vec.at(buffer_i));
-	std::swap(skpdstv_, skpdstv_vec.at(buffer_i));
-	std::swap(skatmv_, skatmv_vec.at(buffer_i));
-	std::swap(odmaskflag_, odmaskflag_vec.at(buffer_i));
-	std::swap(skdbstat_, skdbstat_vec.at(buffer_i));
-	std::swap(skqbstat_, skqbstat_vec.at(buffer_i));
-	std::swap(skspacer_, skspacer_vec.at(buffer_i));
-	std::swap(skgps_, skgps_vec.at(buffer_i));
-	std::swap(t2kgps_, t2kgps_vec.at(buffer_i));
-	std::swap(prevt0_, prevt0_vec.at(buffer_i));
-//	std::swap(tdiff_, tdiff_vec.at(buffer_i));   // segfauts?????
-	std::swap(mintdiff_, mintdiff_vec.at(buffer_i));
-	std::swap(sktrg_, sktrg_vec.at(buffer_i));
-	std::swap(vcvrtx_, vcvrtx_vec.at(buffer_i));
-	std::swap(vcwork_, vcwork_vec.at(buffer_i));
+	commons_vec.at(buffer_i).Swap();
 	
 	return true;
 }
@@ -9,6 +9,7 @@
 #include "MTreeReader.h"
 #include "SkrootHeaders.h" // MCInfo, Header etc.
 #include "Constants.h"
+#include "EventCommons.h"
 
 #include "fortran_routines.h"
 
@@ -122,70 +123,10 @@ class TreeReader: public Tool {
 	
 	// common blocks to buffer
 	// =======================
-	// TODO trim down this list, almost certainly many of these are either
-	// not populated by skread/skrawread, or are not used by reconstruction algorithms
-	// and therefore do not need to be buffered.
-	// TODO right now these do not really need to be vectors, since we only ever fill
-	// them with at most one entry. Generlizing for storing buffering many entries,
+	// TODO right now this does not really need to be a vector, since we only ever fill
+	// it with at most one entry. Generlizing for storing buffering many entries,
 	// but ... simplify if this is not useful.
-	
-	// event header - run, event numbers, trigger info...
-	std::vector<skhead_common> skhead_vec;
-	std::vector<skheada_common> skheada_vec;
-	std::vector<skheadg_common> skheadg_vec;
-	std::vector<skheadf_common> skheadf_vec;
-	std::vector<skheadc_common> skheadc_vec;
-	std::vector<skheadqb_common> skheadqb_vec;
-	
-	// low-e event variables
-	std::vector<skroot_lowe_common> skroot_lowe_vec;
-	std::vector<skroot_mu_common> skroot_mu_vec;
-	std::vector<skroot_sle_common> skroot_sle_vec;
-	
-	// commons containing arrays of T, Q, ICAB....
-	std::vector<skq_common> skq_vec;
-	std::vector<skqa_common> skqa_vec;
-	std::vector<skt_common> skt_vec;
-	std::vector<skta_common> skta_vec;
-	std::vector<skchnl_common> skchnl_vec;
-	std::vector<skthr_common> skthr_vec;
-	std::vector<sktqz_common> sktqz_vec;
-	std::vector<sktqaz_common> sktqaz_vec;
-	std::vector<rawtqinfo_common> rawtqinfo_vec;
-	
-	std::vector<sktrighit_common> sktrighit_vec;
-	std::vector<skqv_common> skqv_vec;
-	std::vector<sktv_common> sktv_vec;
-	std::vector<skchlv_common> skchlv_vec;
-	std::vector<skthrv_common> skthrv_vec;
-	std::vector<skhitv_common> skhitv_vec;
-	std::vector<skpdstv_common> skpdstv_vec;
-	std::vector<skatmv_common> skatmv_vec;
-	
-	// OD mask....? nhits, charge, flag...
-	std::vector<odmaskflag_common> odmaskflag_vec;
-	
-	// hardware trigger variables; counters, trigger words, prevt0...
-	// spacer and trigger info.
-	std::vector<skdbstat_common> skdbstat_vec;
-	std::vector<skqbstat_common> skqbstat_vec;
-	std::vector<skspacer_common> skspacer_vec;
-	
-	// gps word and time.
-	std::vector<skgps_common> skgps_vec;
-	std::vector<t2kgps_common> t2kgps_vec;
-	
-	// hw counter difference to previous event.
-	std::vector<prevt0_common> prevt0_vec;
-	std::vector<tdiff_common> tdiff_vec;
-	std::vector<mintdiff_common> mintdiff_vec;
-	
-	// trigger hardware counters, word, spacer length...
-	std::vector<sktrg_common> sktrg_vec;
-	
-	// MC particles and vertices, event-wise.
-	std::vector<vcvrtx_common> vcvrtx_vec;
-	std::vector<vcwork_common> vcwork_vec;
+	std::vector<EventCommons> commons_vec;
 	
 };
 
@@ -93,3 +93,5 @@
 #include "SolarPreSelection.h"
 #include "SolarPostSelection.h"
 #include "WriteSolarMatches.h"
+#include "WriteSyntheticSkroot.h"
+#include "ParallelEvents.h"
@@ -42,6 +42,15 @@ bool VertexFitter::Initialise(std::string configfile, DataModel &data){
     m_variables.Get("readerName",readerName);  // name given to the TreeReader used for file handling
     m_variables.Get("dataSrc",dataSrc);        // where to get the data from (common blocks/tqreal)
     m_variables.Get("bonsaiSrc",bonsaiSrc);    // which bonsai to use (skofl or local)
+    int maxRepeatedWarnings=10;
+    m_variables.Get("maxRepeatedWarnings",maxRepeatedWarnings); // per-event warnings to print before suppressing, -1 for all
+    m_log_limiter.SetMaxRepeats(maxRepeatedWarnings);
+    m_variables.Get("fitThreads",fitThreads);  // threads for BONSAI fits (bonsaiSrc 1), 0 to fit on the ToolChain thread
+    m_variables.Get("entriesPerExecute",entriesPerExecute); // entries buffered by the TreeReader per Execute, to fit together
+    int usePrefit=0;
+    m_variables.Get("prefit",usePrefit);       // seed BONSAI with a native prefit (bonsaiSrc 1)
+    m_variables.Get("prefitTMin",prefitOptions.tmin);  // time residuals from the seed of the hits given to BONSAI
+    m_variables.Get("prefitTMax",prefitOptions.tmax);
 
     // use the readerName to find the LUN associated with this file
     std::map<std::string,int> lunlist;
@@ -74,6 +83,7 @@ bool VertexFitter::Initialise(std::string configfile, DataModel &data){
     if (bonsaiSrc==0) {
         Log(m_unique_name+": Initialising BONSAI using built-in function cfbsinit_.",v_message,m_verbose);
         m_data->BonsaiInit();
+        if (usePrefit) Log(m_unique_name+": Warning: the prefit needs bonsaiSrc 1, not seeding BONSAI.",v_warning,m_verbose);
     }
     // Use BONSAI direct (currently local)
     else{
@@ -81,9 +91,48 @@ bool VertexFitter::Initialise(std::string configfile, DataModel &data){
         bsgeom = new pmt_geometry(numPMTs,xyzpm);
         bslike = new likelihood(bsgeom->cylinder_radius(),bsgeom->cylinder_height());
         bsfit = new bonsaifit(bslike);
+        if (usePrefit){
+            // with a seed the hit limit applies to the hits BONSAI is given, not to the whole event
+            Log(m_unique_name+": Seeding BONSAI with the native prefit.",v_message,m_verbose);
+            prefit.reset(new VertexPrefit(numPMTs,xyzpm));
+            prefitOptions.prefit = prefit.get();
+            prefitOptions.max_hits = max_nqisk_for_clusfit;
+            fitService.SetPrefit(prefitOptions);
+        }
+        if (fitThreads>0){
+            Log(m_unique_name+": Fitting on "+toString(fitThreads)+" threads.",v_message,m_verbose);
+            fitService.Start(fitThreads,numPMTs,xyzpm);
+        }
     }
     Log(m_unique_name+": BONSAI initialised.",v_message,m_verbose);
 
+    // fitting a batch of entries together needs fits that can run off the ToolChain thread,
+    // and everything for each entry to be in the commons buffered by the TreeReader
+    if (entriesPerExecute>1){
+        std::string reason="";
+        if (bonsaiSrc==0 || fitThreads<1) reason = "it needs bonsaiSrc 1 and fitThreads > 0";
+        else if (dataSrc==2) reason = "TQREAL branch hits are not buffered (use dataSrc 0 or 1)";
+        else if (MC) reason = "MC truth is read from the MC branch, which is not buffered";
+        if (reason!=""){
+            Log(m_unique_name+": Warning: cannot fit "+toString(entriesPerExecute)+" entries per Execute: "
+                +reason+". Fitting one entry per Execute.",v_warning,m_verbose);
+            entriesPerExecute=1;
+        }
+    }
+    // and the TreeReader must buffer as many entries per Execute, or some would not be fit
+    int readerEntriesPerExecute=1;
+    if (m_data->tool_configs.count("TreeReader "+readerName))
+        m_data->tool_configs.at("TreeReader "+readerName)->Get("entriesPerExecute",readerEntriesPerExecute);
+    if (readerEntriesPerExecute>1 && entriesPerExecute!=readerEntriesPerExecute){
+        Log(m_unique_name+": error! TreeReader "+readerName+" buffers "+toString(readerEntriesPerExecute)
+            +" entries per Execute, but "+toString(entriesPerExecute)+" are fit per Execute",v_error,m_verbose);
+        return false;
+    } else if (entriesPerExecute>1 && readerEntriesPerExecute<=1){
+        Log(m_unique_name+": Warning: TreeReader "+readerName+" does not buffer entries (entriesPerExecute 1)."
+            " Fitting one entry per Execute.",v_warning,m_verbose);
+        entriesPerExecute=1;
+    }
+
     // check where we are getting the hit info from
     if (dataSrc==0) 
         Log(m_unique_name+": Getting hit info from common blocks skt_/skq_",v_message,m_verbose);
@@ -106,6 +155,43 @@ bool VertexFitter::Initialise(std::string configfile, DataModel &data){
 
 bool VertexFitter::Execute(){
 
+    if (entriesPerExecute<=1) return ProcessEvent(-1);
+
+    // Fit the entries buffered by the TreeReader together: first queue the fit of each
+    // entry's hits, then process each entry in turn as its fit completes.
+    // n.b. LoadCommons swaps a buffered entry with the live commons, so calling it again restores them.
+    // The last batch of a file may be short.
+    const int nbuffered = m_data->NumBufferedCommons(readerName);
+    if (nbuffered==0){
+        // nothing buffered, so the entry is only in the live commons
+        LOG_LIMITED(m_log_limiter,m_unique_name+": Warning: no entries buffered by TreeReader "+readerName
+                    +", fitting the current entry alone",v_warning,m_verbose);
+        return ProcessEvent(-1);
+    }
+    pendingFits.clear();
+    for (int entry=0; entry<nbuffered; entry++){
+        m_data->LoadCommons(entry,readerName);
+        BonsaiFitService::Hits hits;
+        int nhit = GetHits(nullptr,hits);
+        if (Reconstructable(nhit)) pendingFits.push_back(fitService.Submit(std::move(hits)));
+        else pendingFits.emplace_back();  // not fit
+        m_data->LoadCommons(entry,readerName);
+    }
+
+    bool ok = true;
+    for (size_t entry=0; entry<pendingFits.size(); entry++){
+        m_data->LoadCommons(entry,readerName);
+        ok = ProcessEvent(entry) && ok;
+        m_data->LoadCommons(entry,readerName);
+    }
+    pendingFits.clear();
+
+    return ok;
+}
+
+
+bool VertexFitter::ProcessEvent(int batch_index){
+
     // Get the branches we need from the tree
     // TODO we don't need to call this for each entry
     std::cerr<<"vertexfitter getting tree"<<std::endl;
@@ -131,7 +217,7 @@ bool VertexFitter::Execute(){
         std::cerr<<"updating water transparency with run "<<skhead_.nrunsk<<std::endl;
         int days_to_run_start = skday_data_.relapse[skhead_.nrunsk];  // defined in skdayC.h
         lfwater_(&days_to_run_start, &watert);
-        Log(m_unique_name+" loaded new water transparency value "+toString(watert)
+        LOG_LAZY(m_unique_name+" loaded new water transparency value "+toString(watert)
             +" for run "+toString(skhead_.nrunsk),v_debug,m_verbose);
         nrunsk_last = skhead_.nrunsk;
     }
@@ -141,6 +227,7 @@ bool VertexFitter::Execute(){
             std::cerr<<"updating bad channel list with run "<<skhead_.nrunsk<<", subrun "<<skhead_.nsubsk<<std::endl;
             int ierr;
             skbadch_(&skhead_.nrunsk,&skhead_.nsubsk,&ierr);
+            m_data->UpdateChannelStatus(skhead_.nrunsk, skhead_.nsubsk);
             nrunsk_last = skhead_.nrunsk;
             nsubsk_last = skhead_.nsubsk;
             if(skhead_.nrunsk!=nrunsk_last){
@@ -188,7 +275,6 @@ bool VertexFitter::Execute(){
     std::cerr<<"calling lfclear_all"<<std::endl;
     lfclear_all_();
 
-    int max_nqisk_for_clusfit = 800;//(MC) ? 800 : 1000;  //  maximum number of hits to reconstruct
 
     //--------------Get the MC information we want----------------------//
     // Assumes IBD events - TODO does this need to work for other types?
@@ -321,101 +407,11 @@ bool VertexFitter::Execute(){
     // the neutron capture. We can do this with a simple hit sum and look
     // for all secondary 'triggers' occurring after the prompt SHE trigger.
     std::cerr<<"getting hit info"<<std::endl;
-    int nqisk = (int)skq_.nqisk;
-    float charges[nqisk];  // final array of hit charges
-    float times[nqisk];    // final array of hit times
-    int cableIDs[nqisk];
-    lbfset0(cableIDs,&nqisk);
-    lbfset0(charges,&nqisk);
-    lbfset0(times,&nqisk);
-    int nhit=0;
-    
-    if (dataSrc == 0) {
-        // Get the hit information stored in the common blocks (skt_/skq_) - preferred method
-        // These are the common blocks stored by skread
-        // ---------------------------------------------------
-        nhit = skq_.nqisk;
-        std::cerr<<"copying from skq"<<std::endl;
-        for (int i=0;i<skq_.nqisk; i++){
-            //skt_, skq_, skchnl_ common blocks
-            cableIDs[i] = skchnl_.ihcab[i];
-            charges[i] = skq_.qisk[skchnl_.ihcab[i]-1];
-            times[i]   = skt_.tisk[skchnl_.ihcab[i]-1];
-        }
-        
-    }
-        
-    else if (dataSrc==1)
-    {
-        // Get raw hit time and charge info from the common blocks (sktqz)
-        // TODO these hits need to be processed as per the tqreal branch 
-        // to remove bad channels etc so this will yield different results
-        std::cerr<<"copying from sktqz"<<std::endl;
-        nhit = sktqz_.nqiskz;
-        for (int i=0;i<nhit; i++) {
-            cableIDs[i] = sktqz_.icabiz[i];
-            charges[i] = sktqz_.qiskz[i];
-            times[i]   = sktqz_.tiskz[i];
-        }
-    }
-
-    else {
-        //Get hit time and charge info from the tqreal branch
-        //---------------------------------------------------
-        
-        /*  NB We can access hit time and charge info from the TQREAL branch
-        *   but these are raw values and not corrected for 
-        *   e.g. out-of-gate hits and bad channels .
-        *   TODO Here, I have tried to go through the process
-        *   which is usually carried out by tqrealsk ($SKOFL_ROOT/src/skrd/tqrealsk.F)
-        *   when skread is called.
-        */
-        //  myTreeReader->Get("TQREAL", tqreal);
-        // 'raw' in the following means pre-skread i.e. info for all hits
-        std::cerr<<"copying from TQREAL"<<std::endl;
-        int nhits_raw = tqreal->nhits;
-        Int_t *cableIDs_raw = new Int_t[MAXPM];       //from TQREAL
-        Float_t *charges_raw = new Float_t[MAXPM];    //from TQREAL
-        Float_t *times_raw = new Float_t[MAXPM];      //from TQREAL
-        Float_t *times_relative = new Float_t[MAXPM]; //times relative to initial trigger
-        
-        // TODO get some info about the trigger timing. Not really working at the moment. 
-        float sub_trigger_time = tqreal->it0xsk;// at the moment this is only looking at the first trigger time
-        float initial_trigger_time = skheadqb_.it0sk;
-        float count_per_nsec = COUNT_PER_NSEC;
-        //int ntrigsk = (sub_trigger_time-initial_trigger_time)/count_per_nsec/10.; //number of triggers - yields 0
-        for (int i = 0;i<nhits_raw;i++){
-        
-            // first get the raw values from the tqreal branch
-            // NB these are raw in the sense that they are for 
-            // all of the hits, although in data some pre-processing
-            // has been done by this stage e.g. to convert charge to pe.(by skrawread)
-            --------------------------------------------------------------------------
-            // get the charge and cable (PMT no.) data
-            charges_raw[i]=tqreal->Q[i];
-            cableIDs_raw[i] = tqreal->cables[i] & ( (1<<16)-1);//cable ID (i.e. PMT number) is stored in 1st 16 bits
-            // then get the times relative to the trigger
-            times_relative[i]=tqreal->T[i]-(sub_trigger_time-initial_trigger_time)/count_per_nsec;//(tqrealsk.F::122), count_per_nsec set in skhead.h;
-            
-            // then apply some selection to ensure the hits are in-gate (1.3us)
-            // and in the inner detector
-            int in_gate = ( (tqreal->cables[i] >> 16) &1 ); // Upper 16 bits are the hit flags. We want the first of these.
-            if (cableIDs_raw[i]>0 && cableIDs_raw[i]<=MAXPM && in_gate){
-                //TODO if BTEST( ISKBIT, 31-25).AND.IBAD(ICAB).NE.0) GOTO 120 ! skip badch if MC
-                //TODO mask bad channels
-                //BTEST returns logical true if bit a POS in I is set: BTEST(I,POS)
-                //std::bitset < sizeof(int)*32 > iskbit;
-                //iskbit = skopt_.iskbit;
-                //if ( iskbit.test(31-25) ){
-                // save the selected hits into arrays
-                cableIDs[nhit]=cableIDs_raw[i];
-                times[nhit] = times_relative[i];
-                charges[nhit] = charges_raw[i];
-                nhit++;
-                //}
-            }
-        }
-    }
+    BonsaiFitService::Hits hits;
+    int nhit = GetHits(tqreal,hits);
+    int* cableIDs = hits.cables.data();
+    float* times = hits.times.data();
+    float* charges = hits.charges.data();
     
     
     //-------------------------------------------------------------------------------//
@@ -450,7 +446,7 @@ bool VertexFitter::Execute(){
     
     
     std::cerr<<"doing reconstruction with "<<nhit<<" hits?"<<std::endl;
-    if (nhit>9 && nhit<=max_nqisk_for_clusfit) // reconstruction unstable with < 10 hits, slow with > 800 hits
+    if (Reconstructable(nhit))
     {
     std::cerr<<"yes"<<std::endl;
         // Do the BONSAI fit
@@ -466,45 +462,36 @@ bool VertexFitter::Execute(){
         
         // Bonsai
         
+        int bsn50 = 0;
         if (bonsaiSrc==0){
-            int* nhits = &skq_.nqisk;
             std::cerr<<"calling bonsaifit fortran"<<std::endl;
-            int nbf = bonsaifit_(&bsvertex[0],&bsresult[0],&bsgood[0],&nsel,&skq_.nqisk,&cableIDs[0],&times[0],&charges[0]);
+            int nbf = bonsaifit_(&bsvertex[0],&bsresult[0],&bsgood[0],&nsel,&nhit,&cableIDs[0],&times[0],&charges[0]);
             std::cerr<<"bonsai returned "<<nbf<<std::endl;
         }
         
         else {
             std::cerr<<"calling bonsai++"<<std::endl;
-            goodness *bshits = new goodness(bslike->sets(),bslike->chargebins(),bsgeom,nhit,cableIDs,times,charges);
-            int nsel = bshits->nselected();
-            if (bshits->nselected()<4) {
-                Log(m_unique_name+": Event "+toString(ev)+", "+toString(bshits->nselected())+" selected hits not enough, not reconstructed.",v_warning,m_verbose);
+            // fit on a worker thread if we have them, otherwise here.
+            // n.b. BONSAI may modify the hit arrays, so in batches it is given its own copy
+            BonsaiFitService::Result fit;
+            if (batch_index>=0) fit = pendingFits.at(batch_index).get();
+            else if (fitService.GetNThreads()>0) fit = fitService.Submit(hits).get();
+            else fit = BonsaiFitService::Fit(*bsgeom,*bslike,*bsfit,hits,geopmt_.xyzpm,&prefitOptions);
+            // with a prefit, events with too many hits near the seed for BONSAI are not reconstructed,
+            // as without a prefit; the seed is not a BONSAI fit, so it is not written as one
+            if (fit.nbonsai==0 && fit.seed[0]<9999) {
+                LOG_LIMITED(m_log_limiter,m_unique_name+": Event "+toString(ev)+", too many hits near the prefit vertex for BONSAI, not reconstructed.",v_warning,m_verbose);
+            }
+            else if (fit.nselected<4) {
+                LOG_LIMITED(m_log_limiter,m_unique_name+": Event "+toString(ev)+", "+toString(fit.nselected)+" selected hits not enough, not reconstructed.",v_warning,m_verbose);
                 return false;
             }
-            fourhitgrid* bsgrid = new fourhitgrid(bsgeom->cylinder_radius(),bsgeom->cylinder_height(),bshits);
-            
-            std::cerr<<"setting hits"<<std::endl;
-            bslike->set_hits(bshits);
-            std::cerr<<"maxising"<<std::endl;
-            bslike->maximize(bsfit,bsgrid);
-            int nbf = bslike->nfit();
-            if (nbf >0) {
-                std::cerr<<"getting best vertex"<<std::endl;
-                // get best reconstructed vertex and time if the fit was successful
-                bsvertex[0] = bsfit->xfit();      //reco x
-                bsvertex[1] = bsfit->yfit();      //reco y
-                bsvertex[2] = bsfit->zfit();      //reco z
-                bsvertex[3] = bslike->get_zero(); //is there an offset?  //reco t0
-                // get maximal log likelihood
-                float gdn[bslike->sets()];
-                bsgood[2] = bslike->goodness(*bsgood,bsvertex,gdn);    //not sure what all the bsgood vals are
-                bslike->tgood(bsvertex,0,bsgood[1]);                   //position (timing) goodness
-                //bsnsel[1] = bslike->nwind(bsvertex,-6,12);
-                *skroot_lowe_.bsgood = bsfit->maxq();                  //max charge???
-                bsfit->fitresult();
-                bslike->get_dir(skroot_lowe_.bsresult);                //direction
-                skroot_lowe_.bsresult[5] = bslike->get_ll0();          //maximal log likelihood
-                bslike->set_hits(NULL);
+            if (fit.nfit >0) {
+                // best reconstructed vertex and time, goodness and direction
+                for (int i=0; i<4; i++) bsvertex[i] = fit.vertex[i];
+                for (int i=0; i<3; i++) bsgood[i] = fit.good[i];
+                for (int i=0; i<6; i++) bsresult[i] = fit.result[i];
+                bsn50 = fit.n50;
             }
         }
         std::cerr<<"bonsai done"<<std::endl;
@@ -521,8 +508,9 @@ bool VertexFitter::Execute(){
         // output: nhit (maximal number of hits in timing window), ihitcab[nhit] (array with cable numbers of these hits)
         if (bsvertex[0]<9999) {
             int cableIDs_n50[500];
-            Log(m_unique_name+": calculating NX",v_debug,m_verbose);
-            skroot_lowe_.bsn50 = CalculateNX(50,bsvertex,cableIDs,times,cableIDs_n50);
+            LOG_LAZY(m_unique_name+": calculating NX",v_debug,m_verbose);
+            if (bonsaiSrc==0) skroot_lowe_.bsn50 = CalculateNX(50,bsvertex,cableIDs,times,cableIDs_n50);
+            else skroot_lowe_.bsn50 = bsn50;
             
             // TODO can we avoid using more of the fortran routines?
             
@@ -779,10 +767,17 @@ bool VertexFitter::Finalise(){
     //TH1D *h1 = new TH1D();
     //t->Draw("sqrt(pow(LOWE.posmc[0]-LOWE.bsvertex[0],2)+pow(LOWE.posmc[1]-LOWE.bsvertex[1],2)+pow(LOWE.posmc[2]-LOWE.bsvertex[2],2))");
     //ht->Draw();
+    fitService.Stop();
     return true;
 }
 
 
+bool VertexFitter::Reconstructable(int nhit) const {
+    // reconstruction unstable with < 10 hits, slow with > 800 hits
+    // unless the prefit picks out the hits for BONSAI
+    return nhit>9 && (prefit || nhit<=max_nqisk_for_clusfit);
+}
+
 void VertexFitter::lbfset0(void *dat, int *numdat){
 
     size_t nsize;
@@ -792,6 +787,112 @@ void VertexFitter::lbfset0(void *dat, int *numdat){
     memset(dat,iset,(size_t)nsize);
 }
 
+int VertexFitter::GetHits(TQReal* tqreal, BonsaiFitService::Hits& hits)
+{
+    // Get the hit information in one of three ways
+    hits.cables.clear();
+    hits.charges.clear();
+    hits.times.clear();
+    int nhit=0;
+    
+    if (dataSrc == 0) {
+        // Get the hit information stored in the common blocks (skt_/skq_) - preferred method
+        // These are the common blocks stored by skread
+        // ---------------------------------------------------
+        nhit = skq_.nqisk;
+        std::cerr<<"copying from skq"<<std::endl;
+        hits.cables.resize(nhit);
+        hits.charges.resize(nhit);
+        hits.times.resize(nhit);
+        for (int i=0;i<skq_.nqisk; i++){
+            //skt_, skq_, skchnl_ common blocks
+            hits.cables[i] = skchnl_.ihcab[i];
+            hits.charges[i] = skq_.qisk[skchnl_.ihcab[i]-1];
+            hits.times[i]   = skt_.tisk[skchnl_.ihcab[i]-1];
+        }
+        
+    }
+        
+    else if (dataSrc==1)
+    {
+        // Get raw hit time and charge info from the common blocks (sktqz)
+        // TODO these hits need to be processed as per the tqreal branch 
+        // to remove bad channels etc so this will yield different results
+        std::cerr<<"copying from sktqz"<<std::endl;
+        nhit = sktqz_.nqiskz;
+        hits.cables.resize(nhit);
+        hits.charges.resize(nhit);
+        hits.times.resize(nhit);
+        for (int i=0;i<nhit; i++) {
+            hits.cables[i] = sktqz_.icabiz[i];
+            hits.charges[i] = sktqz_.qiskz[i];
+            hits.times[i]   = sktqz_.tiskz[i];
+        }
+    }
+
+    else {
+        //Get hit time and charge info from the tqreal branch
+        //---------------------------------------------------
+        
+        /*  NB We can access hit time and charge info from the TQREAL branch
+        *   but these are raw values and not corrected for 
+        *   e.g. out-of-gate hits and bad channels .
+        *   TODO Here, I have tried to go through the process
+        *   which is usually carried out by tqrealsk ($SKOFL_ROOT/src/skrd/tqrealsk.F)
+        *   when skread is called.
+        */
+        //  myTreeReader->Get("TQREAL", tqreal);
+        // 'raw' in the following means pre-skread i.e. info for all hits
+        std::cerr<<"copying from TQREAL"<<std::endl;
+        int nhits_raw = tqreal->nhits;
+        std::vector<Int_t> cableIDs_raw(nhits_raw);       //from TQREAL
+        std::vector<Float_t> charges_raw(nhits_raw);      //from TQREAL
+        std::vector<Float_t> times_relative(nhits_raw);   //times relative to initial trigger
+        hits.cables.reserve(nhits_raw);
+        hits.charges.reserve(nhits_raw);
+        hits.times.reserve(nhits_raw);
+        
+        // TODO get some info about the trigger timing. Not really working at the moment. 
+        float sub_trigger_time = tqreal->it0xsk;// at the moment this is only looking at the first trigger time
+        float initial_trigger_time = skheadqb_.it0sk;
+        float count_per_nsec = COUNT_PER_NSEC;
+        //int ntrigsk = (sub_trigger_time-initial_trigger_time)/count_per_nsec/10.; //number of triggers - yields 0
+        for (int i = 0;i<nhits_raw;i++){
+        
+            // first get the raw values from the tqreal branch
+            // NB these are raw in the sense that they are for 
+            // all of the hits, although in data some pre-processing
+            // has been done by this stage e.g. to convert charge to pe.(by skrawread)
+            --------------------------------------------------------------------------
+            // get the charge and cable (PMT no.) data
+            charges_raw[i]=tqreal->Q[i];
+            cableIDs_raw[i] = tqreal->cables[i] & ( (1<<16)-1);//cable ID (i.e. PMT number) is stored in 1st 16 bits
+            // then get the times relative to the trigger
+            times_relative[i]=tqreal->T[i]-(sub_trigger_time-initial_trigger_time)/count_per_nsec;//(tqrealsk.F::122), count_per_nsec set in skhead.h;
+            
+            // then apply some selection to ensure the hits are in-gate (1.3us)
+            // and in the inner detector
+            int in_gate = ( (tqreal->cables[i] >> 16) &1 ); // Upper 16 bits are the hit flags. We want the first of these.
+            if (cableIDs_raw[i]>0 && cableIDs_raw[i]<=MAXPM && in_gate){
+                //TODO if BTEST( ISKBIT, 31-25).AND.IBAD(ICAB).NE.0) GOTO 120 ! skip badch if MC
+                //TODO mask bad channels
+                //BTEST returns logical true if bit a POS in I is set: BTEST(I,POS)
+                //std::bitset < sizeof(int)*32 > iskbit;
+                //iskbit = skopt_.iskbit;
+                //if ( iskbit.test(31-25) ){
+                // save the selected hits into arrays
+                hits.cables.push_back(cableIDs_raw[i]);
+                hits.times.push_back(times_relative[i]);
+                hits.charges.push_back(charges_raw[i]);
+                nhit++;
+                //}
+            }
+        }
+    }
+    
+    return nhit;
+}
+
 int VertexFitter::CalculateNX(int timewindow, float* vertex, int cableIDs[], float times[], int (&cableIDs_twindow)[500])
 {
     if (skq_.nqisk <= 0)
@@ -803,19 +904,19 @@ int VertexFitter::CalculateNX(int timewindow, float* vertex, int cableIDs[], flo
     float cns2cm =21.58333; // speed of light in medium
     // Find tof subtracted times for all hits at reconstructed vertex
     std::vector<float> tof;
-    Log(m_unique_name+": getting tof subtracted times for all hits",v_debug,m_verbose);
+    LOG_LAZY(m_unique_name+": getting tof subtracted times for all hits",v_debug,m_verbose);
     for (int hit=0; hit<skq_.nqisk; hit++)
     {
            tof.push_back(times[hit]-sqrt(pow((vertex[0]-geopmt_.xyzpm[cableIDs[hit]-1][0]),2)+pow((vertex[1]-geopmt_.xyzpm[cableIDs[hit]-1][1]),2)+pow((vertex[2]-geopmt_.xyzpm[cableIDs[hit]-1][2]),2))/cns2cm);
     }
     
-    Log(m_unique_name+": sorting tof subtracted times",v_debug,m_verbose);
+    LOG_LAZY(m_unique_name+": sorting tof subtracted times",v_debug,m_verbose);
     // Sort in ascending order
     auto tof_sorted = tof;
     sort(tof_sorted.begin(),tof_sorted.end());
        
     // Find the centre of the distribution
-    Log(m_unique_name+": finding the centre of the tof subtracted times distribution",v_debug,m_verbose);
+    LOG_LAZY(m_unique_name+": finding the centre of the tof subtracted times distribution",v_debug,m_verbose);
     
     int bsnwindow = 1;
     int hstart_test = 0 ;
@@ -835,8 +936,9 @@ int VertexFitter::CalculateNX(int timewindow, float* vertex, int cableIDs[], flo
     
     hstop=hstart+bsnwindow-1;
     // Make a list of cable IDs for the hits in the time window
+    // (at most the 500 that cableIDs_twindow holds; bsnwindow counts them all)
     int bsnwin = 0;
-    for(int hit=0; hit<skq_.nqisk; hit++)
+    for(int hit=0; hit<skq_.nqisk && bsnwin<500; hit++)
     {
         if (tof[hit]<tof_sorted[hstart]) continue;
         if (tof[hit]>tof_sorted[hstop]) continue;
@@ -3,6 +3,9 @@
 
 #include <string>
 #include <iostream>
+#include <vector>
+#include <future>
+#include <memory>
 
 #include "Tool.h"
 
@@ -11,8 +14,12 @@
 #include "likelihood.h"
 #include "goodness.h"
 #include "fourhitgrid.h"
+#include "BonsaiFitService.h"
+#include "VertexPrefit.h"
 
 #include <TH1.h>
+
+class TQReal;
 /**
  * \class VertexFitter
  *
@@ -37,6 +44,9 @@ class VertexFitter: public Tool {
  private:
 
 	// tool functions
+	bool ProcessEvent(int batch_index); // batch_index: entry in the current batch, or -1 if not batching
+	int GetHits(TQReal* tqreal, BonsaiFitService::Hits& hits);
+	bool Reconstructable(int nhit) const;
   	void lbfset0(void *dat, int *numdat);
 	int CalculateNX(int timewindow, float* vertex, int cableIDs[], float times[], int (&cableIDs_twindow)[500]);
     
@@ -61,6 +71,7 @@ class VertexFitter: public Tool {
     bool MC=false;
 	int dataSrc=0;     // 0=sktqz_ common block, 1=TQReal branch
 	int bonsaiSrc = 0; // 0= built-in bonsai calls; 1 = direct bonsai functions
+	LogRateLimiter m_log_limiter; // limit repeated per-event warnings
 
 	// bonsai
 	// ======
@@ -68,6 +79,16 @@ class VertexFitter: public Tool {
 	likelihood* bslike;
 	bonsaifit *bsfit;
 
+	// fits on worker threads, and the fits of the current batch of buffered entries
+	int fitThreads=0;
+	int entriesPerExecute=1;
+	int max_nqisk_for_clusfit = 800;//(MC) ? 800 : 1000;  //  maximum number of hits to reconstruct
+	// seeds BONSAI if enabled; must outlive the fit service's workers
+	std::unique_ptr<VertexPrefit> prefit;
+	BonsaiFitService::Prefit prefitOptions;
+	BonsaiFitService fitService;
+	std::vector<std::future<BonsaiFitService::Result>> pendingFits;
+
 };
 
 
@@ -155,7 +155,7 @@ bool WriteSpallCand::Finalise(){
 	return true;
 }
 
-bool WriteSpallCand::WriteInfo(ParticleCand Event){
+bool WriteSpallCand::WriteInfo(const ParticleCand& Event){
 	MatchedEvNums = Event.matchedParticleEvNum;
 	
 	for(int eventnum: MatchedEvNums){
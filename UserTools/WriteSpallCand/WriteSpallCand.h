@@ -21,7 +21,7 @@ class WriteSpallCand: public Tool {
 	
 	private:
 	
-	bool WriteInfo(ParticleCand Event);
+	bool WriteInfo(const ParticleCand& Event);
 	
 	std::string treeReaderName;
 	std::string treeWriterName;
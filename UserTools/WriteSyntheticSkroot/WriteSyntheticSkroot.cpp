@@ -0,0 +1,306 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+#include "WriteSyntheticSkroot.h"
+
+#include "SkrootHeaders.h" // Header, TQReal, LoweInfo
+#include "fortran_routines.h"
+#include "skheadC.h"  // COUNT_PER_NSEC
+#include "sktqC.h"    // QB_OD_OFFSET
+#include "geotnkC.h"
+
+#include "TFile.h"
+#include "TTree.h"
+
+#include <ctime>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+WriteSyntheticSkroot::WriteSyntheticSkroot():Tool(){}
+
+bool WriteSyntheticSkroot::Initialise(std::string configfile, DataModel &data){
+
+	if(configfile!="")  m_variables.Initialise(configfile);
+	//m_variables.Print();
+
+	m_data= &data;
+	m_log= m_data->Log;
+
+	if(!m_variables.Get("verbosity",m_verbose)) m_verbose=1;
+	m_variables.Get("outputFile",outputFile);
+	m_variables.Get("overwrite",overwrite);
+	m_variables.Get("nEvents",nEvents);
+	m_variables.Get("seed",seed);
+	m_variables.Get("runNumber",runNumber);
+	m_variables.Get("eventsPerSubrun",eventsPerSubrun);
+	m_variables.Get("SK_GEOMETRY",skGeometry);
+	m_variables.Get("eventRate",eventRate);
+	m_variables.Get("muonFraction",muonFraction);
+	m_variables.Get("aftFraction",aftFraction);
+	m_variables.Get("minEnergy",minEnergy);
+	m_variables.Get("maxEnergy",maxEnergy);
+	m_variables.Get("hitsPerMeV",hitsPerMeV);
+	m_variables.Get("meanCaptures",meanCaptures);
+	m_variables.Get("muonHits",muonHits);
+	m_variables.Get("muonODHits",muonODHits);
+	m_variables.Get("darkRate",darkRate);
+	m_variables.Get("triggerOffset",triggerOffset);
+	bool useSKGeometry=true;
+	m_variables.Get("useSKGeometry",useSKGeometry);
+
+	if(!overwrite && std::ifstream(outputFile).good()){
+		Log(m_unique_name+": using existing file "+outputFile,v_message,m_verbose);
+		return true;
+	}
+
+	// hits are placed on PMTs using geopmt_, so we want the real geometry if SKOFL tables are available
+	if(useSKGeometry){
+		skheadg_.sk_geometry = skGeometry;
+		geoset_();
+	} else {
+		SyntheticEventGenerator::FillGeometry(true);
+	}
+
+	generator.SetSeed(seed);
+	engine.seed(seed+1);
+	eventConfig.dark_rate_hz = darkRate;
+
+	return WriteFile();
+}
+
+bool WriteSyntheticSkroot::Execute(){
+	// the file is written in Initialise, so it's available for the TreeReader to open
+	return true;
+}
+
+bool WriteSyntheticSkroot::Finalise(){
+	return true;
+}
+
+bool WriteSyntheticSkroot::WriteFile(){
+
+	fout = TFile::Open(outputFile.c_str(), "RECREATE");
+	if(fout==nullptr || fout->IsZombie()){
+		Log(m_unique_name+" Error! Failed to open output file "+outputFile,v_error,m_verbose);
+		return false;
+	}
+	tree = new TTree("data", "synthetic SK data");
+	header = new Header;
+	tqreal = new TQReal;
+	tqareal = new TQReal;
+	lowe = new LoweInfo;
+	tree->Branch("HEADER", "Header", &header);
+	tree->Branch("TQREAL", "TQReal", &tqreal);
+	tree->Branch("TQAREAL", "TQReal", &tqareal);
+	tree->Branch("LOWE", "LoweInfo", &lowe);
+
+	Log(m_unique_name+": writing "+toString(nEvents)+" synthetic events to "+outputFile,v_message,m_verbose);
+
+	std::uniform_real_distribution<double> uni(0.,1.);
+	std::exponential_distribution<double> interval(eventRate);
+	std::vector<SyntheticHit> id_hits, aft_hits, od_hits;
+	// primary events are separated by at least the AFT window
+	const double min_spacing = 600e-6;
+	uint64_t ticks = uint64_t(1e9*COUNT_PER_NSEC);
+	int nevsk=0;
+	long entries=0;
+
+	for(long i=0; i<nEvents; ++i){
+		double dt = std::max(min_spacing, interval(engine));
+		ticks += uint64_t(dt*1e9*COUNT_PER_NSEC);
+		int nsubsk = 1 + i/eventsPerSubrun;
+
+		bool is_muon = uni(engine) < muonFraction;
+		bool with_aft = !is_muon && uni(engine) < aftFraction;
+
+		// reset any stale reconstruction
+		*lowe = LoweInfo();
+		if(is_muon){
+			MakeMuon(id_hits, od_hits);
+			FillHeader(SynthType::Muon, ticks, ++nevsk, nsubsk);
+		} else {
+			MakeLowE(id_hits, aft_hits, with_aft);
+			od_hits.clear();
+			FillHeader(SynthType::LowE, ticks, ++nevsk, nsubsk);
+		}
+		SyntheticEventGenerator::FillTQReal(id_hits, *tqreal);
+		SyntheticEventGenerator::FillTQReal(od_hits, *tqareal);
+		tqreal->it0xsk = header->t0;
+		tqareal->it0xsk = header->t0;
+		tree->Fill();
+		++entries;
+
+		if(with_aft){
+			// the AFT trigger opens at the end of the SHE gate
+			uint64_t aft_ticks = ticks + uint64_t(35000*COUNT_PER_NSEC);
+			*lowe = LoweInfo();
+			FillHeader(SynthType::AFT, aft_ticks, ++nevsk, nsubsk);
+			SyntheticEventGenerator::FillTQReal(aft_hits, *tqreal);
+			tqareal->cables.clear();
+			tqareal->T.clear();
+			tqareal->Q.clear();
+			tqareal->nhits = 0;
+			tqreal->it0xsk = header->t0;
+			tqareal->it0xsk = header->t0;
+			tree->Fill();
+			++entries;
+		}
+
+		if(((i+1)%1000)==0) Log(m_unique_name+": "+toString(i+1)+" events generated",v_debug,m_verbose);
+	}
+
+	tree->Write();
+	Log(m_unique_name+": wrote "+toString(entries)+" entries ("+toString(tree->GetZipBytes()/1.e6)
+	    +" MB compressed) to "+outputFile,v_message,m_verbose);
+	fout->Close();
+	delete fout;
+	fout=nullptr;
+	tree=nullptr;  // owned by the file
+	delete header;
+	delete tqreal;
+	delete tqareal;
+	delete lowe;
+	header=nullptr;
+	tqreal=tqareal=nullptr;
+	lowe=nullptr;
+
+	return true;
+}
+
+void WriteSyntheticSkroot::MakeLowE(std::vector<SyntheticHit>& she_hits, std::vector<SyntheticHit>& aft_hits, bool with_aft){
+
+	std::uniform_real_distribution<double> uni(0.,1.);
+	std::poisson_distribution<int> ncaptures(meanCaptures);
+
+	// random vertex and isotropic direction
+	float r = (RINTK-200.)*std::sqrt(uni(engine));
+	float phi = 2.*M_PI*uni(engine);
+	eventConfig.vertex[0] = r*std::cos(phi);
+	eventConfig.vertex[1] = r*std::sin(phi);
+	eventConfig.vertex[2] = (2.*uni(engine)-1.)*(ZPINTK-200.);
+	float costh = 2.*uni(engine)-1.;
+	float sinth = std::sqrt(1.-costh*costh);
+	phi = 2.*M_PI*uni(engine);
+	eventConfig.direction[0] = sinth*std::cos(phi);
+	eventConfig.direction[1] = sinth*std::sin(phi);
+	eventConfig.direction[2] = costh;
+
+	double energy = minEnergy + (maxEnergy-minEnergy)*uni(engine);
+	eventConfig.ring_hits = int(energy*hitsPerMeV);
+	eventConfig.ncaptures = ncaptures(engine);
+	eventConfig.t0 = 0;
+	// the SHE and AFT are generated as one event, then split at the end of the SHE gate
+	eventConfig.window_start = -5000;
+	eventConfig.window_end = with_aft ? 535000 : 35000;
+
+	generator.Generate(eventConfig, she_hits);
+
+	aft_hits.clear();
+	if(with_aft){
+		auto aft_start = std::lower_bound(she_hits.begin(), she_hits.end(), 35000.f,
+		                                  [](const SyntheticHit& hit, float t){ return hit.t < t; });
+		for(auto it=aft_start; it!=she_hits.end(); ++it){
+			aft_hits.push_back(*it);
+			aft_hits.back().t += triggerOffset - 35000.f;
+		}
+		she_hits.erase(aft_start, she_hits.end());
+	}
+	for(auto&& hit : she_hits) hit.t += triggerOffset;
+
+	// stand-in for the BONSAI fit: the true vertex, direction and energy
+	for(int j=0; j<3; ++j){
+		lowe->bsvertex[j] = eventConfig.vertex[j];
+		lowe->bsdir[j] = eventConfig.direction[j];
+	}
+	lowe->bsvertex[3] = triggerOffset;
+	lowe->bsenergy = energy;
+	lowe->bsgood[0] = lowe->bsgood[1] = lowe->bsgood[2] = 0.6;
+	lowe->bsdirks = 0.2;
+	lowe->bsn50 = eventConfig.ring_hits;
+
+}
+
+void WriteSyntheticSkroot::MakeMuon(std::vector<SyntheticHit>& id_hits, std::vector<SyntheticHit>& od_hits){
+
+	std::uniform_real_distribution<double> uni(0.,1.);
+	std::poisson_distribution<int> nhits(muonHits);
+	std::poisson_distribution<int> nodhits(muonODHits);
+	std::normal_distribution<double> charge(1., 0.7);
+
+	// downward-going, entering through the top cap. The ring from a single point
+	// is enough to reproduce the hit multiplicity, if not the track topology.
+	float r = RINTK*std::sqrt(uni(engine));
+	float phi = 2.*M_PI*uni(engine);
+	eventConfig.vertex[0] = r*std::cos(phi);
+	eventConfig.vertex[1] = r*std::sin(phi);
+	eventConfig.vertex[2] = ZPINTK-1.;
+	float costh = -0.5-0.5*uni(engine);
+	float sinth = std::sqrt(1.-costh*costh);
+	phi = 2.*M_PI*uni(engine);
+	eventConfig.direction[0] = sinth*std::cos(phi);
+	eventConfig.direction[1] = sinth*std::sin(phi);
+	eventConfig.direction[2] = costh;
+	eventConfig.ring_hits = nhits(engine);
+	eventConfig.ncaptures = 0;
+	eventConfig.t0 = 0;
+	eventConfig.window_start = -5000;
+	eventConfig.window_end = 35000;
+
+	generator.Generate(eventConfig, id_hits);
+	for(auto&& hit : id_hits) hit.t += triggerOffset;
+
+	// OD hits around the entry time
+	od_hits.clear();
+	int nod = nodhits(engine);
+	for(int j=0; j<nod; ++j){
+		int cable = QB_OD_OFFSET + 1 + int(uni(engine)*MAXPMA);
+		float t = triggerOffset - 20. + 100.*uni(engine);
+		od_hits.push_back({cable, t, float(std::abs(charge(engine))*5.), 0x03, true});
+	}
+	std::sort(od_hits.begin(), od_hits.end(), [](const SyntheticHit& a, const SyntheticHit& b){ return a.t<b.t; });
+
+}
+
+void WriteSyntheticSkroot::FillHeader(SynthType type, uint64_t ticks, int nevsk, int nsubsk){
+
+	*header = Header();
+	header->nrunsk = runNumber;
+	header->nsubsk = nsubsk;
+	header->nevsk = nevsk;
+	header->mdrnsk = 1;           // normal data run (not MC)
+	header->sk_geometry = skGeometry;
+	header->ifevsk = 0;
+
+	// 48-bit clock: the low 32 bits are it0sk, the upper bits go in counter_32
+	// above the 17-bit hardware event counter (see TreeReader first event time)
+	header->t0 = int(ticks & 0xFFFFFFFF);
+	header->counter_32 = int(((ticks >> 32) << 17) | (uint64_t(nevsk) & 0x1FFFF));
+
+	switch(type){
+		case SynthType::LowE:
+			header->idtgsk = (1<<0) | (1<<1) | (1<<28);             // LE, HE, SHE
+			header->gate_width = int(40000*COUNT_PER_NSEC);
+			break;
+		case SynthType::Muon:
+			header->idtgsk = (1<<0) | (1<<1) | (1<<3) | (1<<28);    // LE, HE, OD, SHE
+			header->gate_width = int(40000*COUNT_PER_NSEC);
+			break;
+		case SynthType::AFT:
+			header->idtgsk = (1<<29);                               // AFT
+			header->gate_width = int(500000*COUNT_PER_NSEC);
+			break;
+	}
+
+	// wall-clock date and time, starting from an arbitrary date in SK-VI
+	time_t start = 1593561600;  // 2020/07/01 00:00:00 UTC
+	double seconds = ticks/(COUNT_PER_NSEC*1e9);
+	time_t now = start + time_t(seconds);
+	std::tm* utc = std::gmtime(&now);
+	header->ndaysk[0] = utc->tm_year % 100;
+	header->ndaysk[1] = utc->tm_mon + 1;
+	header->ndaysk[2] = utc->tm_mday;
+	header->ntimsk[0] = utc->tm_hour;
+	header->ntimsk[1] = utc->tm_min;
+	header->ntimsk[2] = utc->tm_sec;
+	header->ntimsk[3] = int((seconds-std::floor(seconds))*100);
+
+}
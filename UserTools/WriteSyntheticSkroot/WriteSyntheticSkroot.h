@@ -0,0 +1,78 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef WriteSyntheticSkroot_H
+#define WriteSyntheticSkroot_H
+
+#include <string>
+#include <iostream>
+#include <vector>
+#include <random>
+
+#include "Tool.h"
+#include "SyntheticEvent.h"
+
+class TFile;
+class TTree;
+class Header;
+class TQReal;
+class LoweInfo;
+
+/**
+* \class WriteSyntheticSkroot
+*
+* Writes an SKROOT-like file of synthetic data events during Initialise, for use as a
+* stand-in input when benchmarking ToolChains without real data files.
+* The file contains a 'data' tree with HEADER, TQREAL, TQAREAL and LOWE branches populated with
+* low-energy SHE events (optionally followed by an AFT), and muon events with ID and OD hits.
+* Hits are produced by the SyntheticEventGenerator, and LOWE holds the true vertex, direction
+* and energy in place of a BONSAI fit. Place this Tool before the TreeReader that reads the file.
+*/
+class WriteSyntheticSkroot: public Tool {
+
+	public:
+	WriteSyntheticSkroot();
+	bool Initialise(std::string configfile,DataModel &data);
+	bool Execute();
+	bool Finalise();
+
+	private:
+	enum class SynthType { LowE, AFT, Muon };
+	bool WriteFile();
+	void MakeLowE(std::vector<SyntheticHit>& she_hits, std::vector<SyntheticHit>& aft_hits, bool with_aft);
+	void MakeMuon(std::vector<SyntheticHit>& id_hits, std::vector<SyntheticHit>& od_hits);
+	void FillHeader(SynthType type, uint64_t ticks, int nevsk, int nsubsk);
+
+	// config
+	std::string outputFile="synthetic_skroot.root";
+	bool overwrite=true;
+	long nEvents=1000;          // number of primary (SHE or muon) events
+	uint64_t seed=12345;
+	int runNumber=80000;
+	int eventsPerSubrun=1000;
+	int skGeometry=6;
+	double eventRate=10;        // [Hz] mean rate of primary events
+	double muonFraction=0.2;    // fraction of primary events that are muons
+	double aftFraction=0.5;     // fraction of low-energy events followed by an AFT
+	double minEnergy=6;         // [MeV] low-energy events are uniform in energy
+	double maxEnergy=20;
+	double hitsPerMeV=6;
+	double meanCaptures=1;      // mean number of neutron captures per low-energy event
+	int muonHits=6000;          // mean number of ID hits from a muon
+	int muonODHits=300;
+	double darkRate=4.5e3;      // [Hz] per ID PMT
+	float triggerOffset=1000;   // [ns] time of the primary trigger within TQREAL
+
+	SyntheticEventGenerator generator;
+	SyntheticEventConfig eventConfig;
+	std::mt19937_64 engine;
+
+	TFile* fout=nullptr;
+	TTree* tree=nullptr;
+	Header* header=nullptr;
+	TQReal* tqreal=nullptr;
+	TQReal* tqareal=nullptr;
+	LoweInfo* lowe=nullptr;
+
+};
+
+
+#endif
@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""Export a trained ntag_BDT model (a joblib file) to a JSON tree dump that ntag_BDT evaluates natively.
+
+    export_bdt.py model.joblib model.json [--feature-names n10,theta,...]
+
+scikit-learn GradientBoostingClassifier, HistGradientBoostingClassifier, RandomForestClassifier and
+ExtraTreesClassifier are written in the 'sklearn-tree-ensemble' format read by DecisionForest::LoadSklearn
+(native_model_format sklearn). An XGBoost XGBClassifier is saved with XGBoost's own JSON format
+(native_model_format xgboost).
+
+The output of the dump is predict_proba(X)[:,1], the neutron5 of ntag_BDT.
+"""
+
+import argparse
+import json
+import math
+import sys
+
+import joblib
+import numpy as np
+
+
+def sklearn_tree(tree, leaf_scale=1.0, leaf_value=None):
+    """Nodes of a fitted sklearn.tree._tree.Tree. Inputs <= threshold go to the left child."""
+    nodes = {"feature": [], "threshold": [], "left": [], "right": [], "value": []}
+    for i in range(tree.node_count):
+        left, right = int(tree.children_left[i]), int(tree.children_right[i])
+        leaf = left < 0
+        nodes["feature"].append(-1 if leaf else int(tree.feature[i]))
+        nodes["threshold"].append(0.0 if leaf else float(tree.threshold[i]))
+        nodes["left"].append(-1 if leaf else left)
+        nodes["right"].append(-1 if leaf else right)
+        nodes["value"].append(float(leaf_value(tree.value[i]) if leaf_value else leaf_scale * tree.value[i][0][0]))
+    if hasattr(tree, "missing_go_to_left"):
+        # sklearn >= 1.3 trees trained with missing values
+        nodes["missing_left"] = [bool(m) for m in tree.missing_go_to_left[:tree.node_count]]
+    return nodes
+
+
+def class1_fraction(value):
+    # class counts (or fractions) at a leaf of a classification tree
+    total = float(value[0][0] + value[0][1])
+    return value[0][1] / total if total > 0 else 0.0
+
+
+def export_gradient_boosting(model):
+    if model.n_classes_ != 2:
+        raise ValueError("only binary classifiers are supported")
+    if model.init_ == "zero":
+        base = 0.0
+    else:
+        base = float(model._raw_predict_init(np.zeros((1, model.n_features_in_)))[0][0])
+    trees = [sklearn_tree(stage[0].tree_, leaf_scale=model.learning_rate) for stage in model.estimators_]
+    return {"base": base, "transform": "logistic", "norm": 1.0, "trees": trees}
+
+
+def export_forest(model):
+    if model.n_classes_ != 2:
+        raise ValueError("only binary classifiers are supported")
+    trees = [sklearn_tree(estimator.tree_, leaf_value=class1_fraction) for estimator in model.estimators_]
+    return {"base": 0.0, "transform": "mean", "norm": float(len(trees)), "trees": trees}
+
+
+def export_hist_gradient_boosting(model):
+    if model.n_trees_per_iteration_ != 1:
+        raise ValueError("only binary classifiers are supported")
+    trees = []
+    for predictors in model._predictors:
+        nodes = predictors[0].nodes
+        if np.any(nodes["is_categorical"]):
+            raise ValueError("categorical splits are not supported")
+        tree = {"feature": [], "threshold": [], "left": [], "right": [], "value": [], "missing_left": []}
+        for node in nodes:
+            leaf = bool(node["is_leaf"])
+            tree["feature"].append(-1 if leaf else int(node["feature_idx"]))
+            tree["threshold"].append(0.0 if leaf else float(node["num_threshold"]))
+            tree["left"].append(-1 if leaf else int(node["left"]))
+            tree["right"].append(-1 if leaf else int(node["right"]))
+            tree["value"].append(float(node["value"]) if leaf else 0.0)
+            tree["missing_left"].append(bool(node["missing_go_to_left"]))
+        trees.append(tree)
+    base = float(np.ravel(model._baseline_prediction)[0])
+    return {"base": base, "transform": "logistic", "norm": 1.0, "trees": trees}
+
+
+EXPORTERS = {
+    "GradientBoostingClassifier": export_gradient_boosting,
+    "RandomForestClassifier": export_forest,
+    "ExtraTreesClassifier": export_forest,
+    "HistGradientBoostingClassifier": export_hist_gradient_boosting,
+}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("model", help="joblib file of the trained model")
+    parser.add_argument("output", help="JSON file to write")
+    parser.add_argument("--feature-names", help="comma separated names of the inputs, in order")
+    args = parser.parse_args()
+
+    model = joblib.load(args.model)
+    estimator = type(model).__name__
+
+    if hasattr(model, "get_booster"):
+        # XGBoost writes its own JSON, read with native_model_format xgboost
+        model.get_booster().save_model(args.output)
+        print(f"wrote {estimator} as an XGBoost JSON model to {args.output}")
+        return
+
+    if estimator not in EXPORTERS:
+        sys.exit(f"can't export a {estimator}; supported are {', '.join(EXPORTERS)} and XGBoost models")
+
+    dump = {"format": "sklearn-tree-ensemble", "estimator": estimator, "n_features": int(model.n_features_in_)}
+    if args.feature_names:
+        dump["feature_names"] = args.feature_names.split(",")
+    elif hasattr(model, "feature_names_in_"):
+        dump["feature_names"] = [str(name) for name in model.feature_names_in_]
+    if "feature_names" in dump and len(dump["feature_names"]) != dump["n_features"]:
+        sys.exit(f"{len(dump['feature_names'])} feature names given for {dump['n_features']} features")
+    dump.update(EXPORTERS[estimator](model))
+
+    # thresholds and leaf values are written with repr precision, so they are read back exactly
+    for tree in dump["trees"]:
+        for value in tree["threshold"] + tree["value"]:
+            if not math.isfinite(value):
+                sys.exit("non-finite threshold or leaf value in the model")
+    with open(args.output, "w") as output:
+        json.dump(dump, output)
+    print(f"wrote {len(dump['trees'])} trees of a {estimator} to {args.output}")
+
+
+if __name__ == "__main__":
+    main()
@@ -1,8 +1,12 @@
-#if defined PYTHON
 #include "ntag_BDT.h"
 
+#include <cmath>
+#include <algorithm>
+
 ntag_BDT::ntag_BDT():Tool(){
+#ifdef PYTHON
 	Py_Initialize(); // XXX THIS MUST BE CALLED IN THE CONSTRUCTOR TO USE PYBIND XXX
+#endif
 }
 
 bool ntag_BDT::Initialise(std::string configfile, DataModel &data){
@@ -34,20 +38,64 @@ bool ntag_BDT::Initialise(std::string configfile, DataModel &data){
 	N10TH = 6;
 	m_variables.Get("n10_threshold",N10TH);
 	
-	// BDT model
-	std::string BDT_model= "051_10M.joblib";
-	m_variables.Get("BDT_model",BDT_model);
-	
-	// Import Python modules
-	// when do we need to call this?
-	//py::scoped_interpreter guard{};  // XXX
-	py::object numpy = py::module::import("numpy");
-	py::object joblib = py::module::import("joblib");
-	py::object jobload = joblib.attr("load");
+	// BDT model: a JSON dump evaluated natively, and/or the joblib model evaluated in python
+	std::string native_model="";
+	std::string native_model_format="sklearn";
+	m_variables.Get("native_model",native_model);
+	m_variables.Get("native_model_format",native_model_format);
+	m_variables.Get("validate_native",validate_entries);
+	m_variables.Get("validation_tolerance",validation_tolerance);
+	use_native = (native_model!="");
+	if(use_native){
+		if(native_model_format=="sklearn"){
+			get_ok = forest.LoadSklearn(native_model);
+		} else if(native_model_format=="xgboost"){
+			get_ok = forest.LoadXGBoost(native_model);
+		} else {
+			Log(m_unique_name+": unknown native_model_format '"+native_model_format
+			    +"', should be 'sklearn' or 'xgboost'",v_error,m_verbose);
+			return false;
+		}
+		if(!get_ok){
+			Log(m_unique_name+": failed to load native_model "+native_model+": "+forest.GetError(),v_error,m_verbose);
+			return false;
+		}
+		if(forest.GetNInputs()!=NTAG_VARS){
+			Log(m_unique_name+": native_model "+native_model+" takes "+toString(forest.GetNInputs())
+			    +" inputs, but the BDT has "+toString(NTAG_VARS),v_error,m_verbose);
+			return false;
+		}
+		Log(m_unique_name+": loaded "+toString(forest.GetNTrees())+" trees from "+native_model,v_debug,m_verbose);
+	} else {
+		validate_entries = 0;
+	}
 	
-	// load pre-trained BDT
-	py::object bdt5 = jobload(BDT_model);
-	predict_proba5 = bdt5.attr("predict_proba");
+#ifdef PYTHON
+	if(!use_native || validate_entries>0){
+		std::string BDT_model= "051_10M.joblib";
+		m_variables.Get("BDT_model",BDT_model);
+		
+		// Import Python modules
+		// when do we need to call this?
+		//py::scoped_interpreter guard{};  // XXX
+		py::object numpy = py::module::import("numpy");
+		py::object joblib = py::module::import("joblib");
+		py::object jobload = joblib.attr("load");
+		
+		// load pre-trained BDT
+		py::object bdt5 = jobload(BDT_model);
+		predict_proba5 = bdt5.attr("predict_proba");
+	}
+#else
+	if(!use_native){
+		Log(m_unique_name+": no native_model given, and the joblib BDT_model needs a build with python",v_error,m_verbose);
+		return false;
+	}
+	if(validate_entries>0){
+		Log(m_unique_name+": validate_native needs a build with python; not validating",v_warning,m_verbose);
+		validate_entries = 0;
+	}
+#endif
 	
 	// make output file
 	// FIXME move output to datamodel
@@ -141,12 +189,9 @@ bool ntag_BDT::Execute(){
 	// vector of indices passing preselection
 	std::vector<int> passing_indices;
 	
-	// a vector to store a flattened array of all data; i.e.
-	// {{candidate1},{candidate2}} where each {candidate} is an array of BDT input variable values
-	std::vector<double> neutronvars;
-	
-	// number of variables in each candidate array
-	int NTAG_VARS;
+	// a flattened array of all data; i.e. {{candidate1},{candidate2}}
+	// where each {candidate} is the array of NTAG_VARS BDT input variable values
+	candidate_rows.clear();
 	
 	// loop over neutron capture candidates
 	for(int j=0; j<np; j++){
@@ -166,36 +211,33 @@ bool ntag_BDT::Execute(){
 		
 		// append the set of input variables for this neutron capture candidate
 		// to the flattened array to be passed to the BDT
-		neutronvars.push_back(n10[j]);        // N10
+		candidate_rows.push_back(n10[j]);        // N10
 		// geometrical variables
-		neutronvars.push_back(theta[j]);      // θmean                  ?
-		neutronvars.push_back(dthetarms[j]);  // θrms?
-		neutronvars.push_back(phi[j]);        // ϕrms
-		neutronvars.push_back(nlow[j]);       // Nlow
-		neutronvars.push_back(nc[j]);         // Ncluster               ?
-		neutronvars.push_back(nnlowtheta[j]); // Nlowθ
-		neutronvars.push_back(nnback[j]);     // Nback
+		candidate_rows.push_back(theta[j]);      // θmean                  ?
+		candidate_rows.push_back(dthetarms[j]);  // θrms?
+		candidate_rows.push_back(phi[j]);        // ϕrms
+		candidate_rows.push_back(nlow[j]);       // Nlow
+		candidate_rows.push_back(nc[j]);         // Ncluster               ?
+		candidate_rows.push_back(nnlowtheta[j]); // Nlowθ
+		candidate_rows.push_back(nnback[j]);     // Nback
 		// PMT noise variables
-		neutronvars.push_back(n300[j]);       // N300
-		neutronvars.push_back(nnhighq[j]);    // NhighQ
-		neutronvars.push_back(dqmean[j]);     // Qmean
-		neutronvars.push_back(dqrms[j]);      // Qrms
-		neutronvars.push_back(trmsold[j]);    // Trms
-		neutronvars.push_back(mintrms3[j]);   // minTrms(3)
-		neutronvars.push_back(mintrms6[j]);   // minTrms(6)
+		candidate_rows.push_back(n300[j]);       // N300
+		candidate_rows.push_back(nnhighq[j]);    // NhighQ
+		candidate_rows.push_back(dqmean[j]);     // Qmean
+		candidate_rows.push_back(dqrms[j]);      // Qrms
+		candidate_rows.push_back(trmsold[j]);    // Trms
+		candidate_rows.push_back(mintrms3[j]);   // minTrms(3)
+		candidate_rows.push_back(mintrms6[j]);   // minTrms(6)
 		// Neut-Fit variables
-		neutronvars.push_back(fwall[j]);      // NFwall                 ?
-		neutronvars.push_back(n10d[j]);       // δN10                   ?
-		neutronvars.push_back(trmsdiff[j]);   // δTrms                  ?
+		candidate_rows.push_back(fwall[j]);      // NFwall                 ?
+		candidate_rows.push_back(n10d[j]);       // δN10                   ?
+		candidate_rows.push_back(trmsdiff[j]);   // δTrms                  ?
 		// Bonsai vertex variables
-		neutronvars.push_back(bswall[j]);     // BSwall
-		neutronvars.push_back(bse[j]);        // BSenergy
+		candidate_rows.push_back(bswall[j]);     // BSwall
+		candidate_rows.push_back(bse[j]);        // BSenergy
 		// fit agreement variables
-		neutronvars.push_back(bfdist[j]);     // BFdist
-		neutronvars.push_back(fpdist[j]);     // FPdist
-		
-		// if this is the first passing candidate, note the number of variables
-		if(j==0) NTAG_VARS = neutronvars.size();
+		candidate_rows.push_back(bfdist[j]);     // BFdist
+		candidate_rows.push_back(fpdist[j]);     // FPdist
 		
 	}
 	Log(m_unique_name+": "+toString(passing_indices.size())+" candidates passed preselection",v_debug,m_verbose);
@@ -207,31 +249,42 @@ bool ntag_BDT::Execute(){
 		std::fill(neutron5, neutron5 + MAX_EVENTS, 0); // strictly overkill to fill out to MAX_EVENTS, np would be sufficient
 	} else {
 		
-		// when do we need to call this?
-		//py::scoped_interpreter guard{};  // XXX ???
-		
-		// Make a Numpy array with variable info for current event
-		// the constructor constructs a 2D Numpy array from a pointer and the dimensions
-		const int ncount = neutronvars.size()/NTAG_VARS;
-		Log(m_unique_name+": Building pyarray from candidate data",v_debug,m_verbose);
-		if(m_verbose>v_debug){
-			std::cout<<"ncount = "<<ncount<<", NTAG_VARS="<<NTAG_VARS
-				     <<", neutronvars.data()="<<neutronvars.data()
-				     <<", neutronvars.size()="<<neutronvars.size()<<std::endl;
+		const size_t ncount = passing_indices.size();
+		candidate_outputs.resize(ncount);
+		if(use_native){
+			Log(m_unique_name+": Evaluating BDT on candidates",v_debug,m_verbose);
+			forest.Evaluate(candidate_rows.data(), ncount, NTAG_VARS, candidate_outputs.data());
 		}
-		auto arr = py::array_t<double>{{ncount,NTAG_VARS}, neutronvars.data()};
-		
-		// Make predictions
-		Log(m_unique_name+": Calling predict on candidates",v_debug,m_verbose);
-		py::array_t<double, py::array::c_style | py::array::forcecast> probas5 = predict_proba5(arr);
-		Log(m_unique_name+": Prediction done",v_debug,m_verbose);
-		auto probas_u5 = probas5.unchecked<2>();
+#ifdef PYTHON
+		if(!use_native){
+			PythonPredict(candidate_rows, candidate_outputs);
+		} else if(n_validated<validate_entries){
+			// compare against the python model
+			std::vector<double> python_outputs(ncount);
+			PythonPredict(candidate_rows, python_outputs);
+			double max_entry_difference = 0;
+			for(size_t k=0; k<ncount; ++k){
+				const double difference = std::abs(candidate_outputs[k]-python_outputs[k]);
+				max_entry_difference = std::max(max_entry_difference, difference);
+				if(!(difference<=validation_tolerance)){
+					++n_over_tolerance;
+					Log(m_unique_name+": candidate "+toString(passing_indices[k])+" native output "
+					    +toString(candidate_outputs[k])+" != python output "+toString(python_outputs[k]),
+					    v_warning,m_verbose);
+				}
+			}
+			max_difference = std::max(max_difference, max_entry_difference);
+			n_validated_candidates += ncount;
+			++n_validated;
+			Log(m_unique_name+": max |native-python| this entry "+toString(max_entry_difference),v_debug,m_verbose);
+		}
+#endif
 		
 		// map the output metric values back onto the array of all neutron candidates
 		// i.e. if neutrons 1,3,5 passed preselection, BDT metrics 0,1,2 should map
 		// to output branch array indexes 1,3,5
-		for(int k = 0; k < passing_indices.size(); k++){
-			neutron5[passing_indices[k]] = probas_u5(k,1);
+		for(size_t k = 0; k < ncount; k++){
+			neutron5[passing_indices[k]] = candidate_outputs[k];
 		}
 	}
 	
@@ -252,6 +305,13 @@ bool ntag_BDT::Execute(){
 
 bool ntag_BDT::Finalise(){
 	
+	if(n_validated){
+		Log(m_unique_name+": validated native BDT on "+toString(n_validated_candidates)+" candidates in "
+		    +toString(n_validated)+" entries; max |native-python| "+toString(max_difference)+", "
+		    +toString(n_over_tolerance)+" over tolerance "+toString(validation_tolerance),
+		    (n_over_tolerance ? v_warning : v_message),m_verbose);
+	}
+	
 	if(outfile){
 		outfile->Write("*",TObject::kOverwrite);
 		outfile->Close();
@@ -262,6 +322,34 @@ bool ntag_BDT::Finalise(){
 	return true;
 }
 
+#ifdef PYTHON
+void ntag_BDT::PythonPredict(const std::vector<float>& rows, std::vector<double>& outputs){
+	
+	// when do we need to call this?
+	//py::scoped_interpreter guard{};  // XXX ???
+	
+	// Make a Numpy array with variable info for current event
+	// the constructor constructs a 2D Numpy array from a pointer and the dimensions
+	std::vector<double> neutronvars(rows.begin(), rows.end());
+	const int ncount = neutronvars.size()/NTAG_VARS;
+	Log(m_unique_name+": Building pyarray from candidate data",v_debug,m_verbose);
+	if(m_verbose>v_debug){
+		std::cout<<"ncount = "<<ncount<<", NTAG_VARS="<<NTAG_VARS
+			     <<", neutronvars.data()="<<neutronvars.data()
+			     <<", neutronvars.size()="<<neutronvars.size()<<std::endl;
+	}
+	auto arr = py::array_t<double>{{ncount,NTAG_VARS}, neutronvars.data()};
+	
+	// Make predictions
+	Log(m_unique_name+": Calling predict on candidates",v_debug,m_verbose);
+	py::array_t<double, py::array::c_style | py::array::forcecast> probas5 = predict_proba5(arr);
+	Log(m_unique_name+": Prediction done",v_debug,m_verbose);
+	auto probas_u5 = probas5.unchecked<2>();
+	for(int k=0; k<ncount; ++k) outputs[k] = probas_u5(k,1);
+	
+}
+#endif
+
 bool ntag_BDT::GetBranchValues(){
 	
 	get_ok  = (myTreeReader->Get( "HEADER",          HEADER        ));
@@ -347,5 +435,3 @@ Int_t ntag_BDT::GetNlowIndex(Float_t rsqred, Float_t z, const Int_t init){
 	
 	return id;
 }
-
-#endif
@@ -1,20 +1,16 @@
 #ifndef ntag_BDT_H
 #define ntag_BDT_H
 
-#ifndef PYTHON
-// dummy class
-#include "DummyTool.h"
-class ntag_BDT : public DummyTool{ public: ntag_BDT(){}; };
-#else
-
 #include <string>
 #include <iostream>
+#include <vector>
 
 #include "Tool.h"
 #include "MTreeReader.h"
 #include "SkrootHeaders.h" // MCInfo, Header etc.
 #include "DataModel.h"
 #include "Algorithms.h"
+#include "DecisionForest.h"
 
 #include "TFile.h"
 #include "TTree.h"
@@ -29,9 +25,18 @@ class ntag_BDT : public DummyTool{ public: ntag_BDT(){}; };
 /*#include "TMVA/MethodCuts.h"*/
 /*#endif*/
 
+#ifdef PYTHON
 namespace py = pybind11;
 using namespace pybind11::literals;
+#endif
 
+/**
+* \class ntag_BDT
+*
+* Applies the neutron tagging BDT to the candidates of each entry of an SK2p2MeV output tree.
+* The model is evaluated natively by a DecisionForest read from a JSON dump (export_bdt.py), or, in builds with
+* Python, by the original joblib model; the validation mode runs both and compares their outputs.
+*/
 class ntag_BDT : public Tool {
 	
 	public:
@@ -59,7 +64,21 @@ class ntag_BDT : public Tool {
 	int NLOWINDEX;
 	
 	// BDT model
+	static constexpr int NTAG_VARS = 22;  // input variables per candidate
+	bool use_native = false;
+	DecisionForest forest;
+	int validate_entries = 0;         // compare native and python outputs for this many entries
+	double validation_tolerance = 1e-6;
+	int n_validated = 0;
+	long n_validated_candidates = 0;
+	long n_over_tolerance = 0;
+	double max_difference = 0;
+	std::vector<float> candidate_rows;   // NTAG_VARS inputs of each passing candidate
+	std::vector<double> candidate_outputs;
+#ifdef PYTHON
 	py::object predict_proba5;
+	void PythonPredict(const std::vector<float>& rows, std::vector<double>& outputs);
+#endif
 	
 	// variables read from input file
 	const Header *HEADER = nullptr;
@@ -110,5 +129,4 @@ class ntag_BDT : public Tool {
 };
 
 
-#endif // no python
 #endif
@@ -0,0 +1,130 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef BenchHarness_H
+#define BenchHarness_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+
+/*
+ Minimal timing harness for the kernel microbenchmarks.
+
+ RunBench calls the given function repeatedly, doubling the number of iterations until
+ at least min_seconds have elapsed, and reports the mean time per call and per hit.
+ Results are appended to a tab-separated file together with a label (e.g. a git hash)
+ so that runs before and after a change can be compared with CompareToBaseline.
+*/
+
+// prevent the compiler from optimising away a benchmarked result
+template<typename T>
+inline void DoNotOptimize(const T& value){
+	asm volatile("" : : "g"(&value) : "memory");
+}
+
+struct BenchResult {
+	std::string name;
+	double nhits=0;           // hits processed per call
+	long iterations=0;
+	double seconds=0;
+
+	double ns_per_call() const { return (iterations>0) ? seconds*1e9/iterations : 0; }
+	double ns_per_hit() const { return (nhits>0) ? ns_per_call()/nhits : 0; }
+	double hits_per_second() const { return (seconds>0) ? nhits*iterations/seconds : 0; }
+};
+
+template<typename F>
+BenchResult RunBench(const std::string& name, double nhits_per_call, F&& func, double min_seconds=0.5){
+	BenchResult result;
+	result.name = name;
+	result.nhits = nhits_per_call;
+	func();  // warm up caches and any lazily initialised state
+	long iterations=1;
+	while(true){
+		auto start = std::chrono::steady_clock::now();
+		for(long i=0; i<iterations; ++i) func();
+		auto stop = std::chrono::steady_clock::now();
+		double elapsed = std::chrono::duration<double>(stop-start).count();
+		if(elapsed>=min_seconds || iterations>=(1L<<30)){
+			result.iterations = iterations;
+			result.seconds = elapsed;
+			break;
+		}
+		iterations *= 2;
+	}
+	return result;
+}
+
+inline void PrintBenchHeader(){
+	std::cout<<std::left<<std::setw(40)<<"benchmark"<<std::right
+	         <<std::setw(10)<<"hits"<<std::setw(12)<<"iters"
+	         <<std::setw(14)<<"ns/call"<<std::setw(12)<<"ns/hit"
+	         <<std::setw(14)<<"Mhits/s"<<std::endl;
+}
+
+inline void PrintBenchResult(const BenchResult& r){
+	std::cout<<std::left<<std::setw(40)<<r.name<<std::right<<std::fixed
+	         <<std::setw(10)<<std::setprecision(0)<<r.nhits
+	         <<std::setw(12)<<r.iterations
+	         <<std::setw(14)<<std::setprecision(1)<<r.ns_per_call()
+	         <<std::setw(12)<<std::setprecision(3)<<r.ns_per_hit()
+	         <<std::setw(14)<<std::setprecision(3)<<r.hits_per_second()*1e-6
+	         <<std::defaultfloat<<std::endl;
+}
+
+// append results to a tab-separated file, writing a header if the file is new
+inline bool WriteBenchResults(const std::string& filename, const std::string& label, const std::vector<BenchResult>& results){
+	bool exists = std::ifstream(filename).good();
+	std::ofstream out(filename, std::ios::app);
+	if(!out.is_open()){
+		std::cerr<<"WriteBenchResults: failed to open "<<filename<<std::endl;
+		return false;
+	}
+	if(!exists) out<<"# label\tbenchmark\tnhits\titerations\tns_per_call\tns_per_hit\thits_per_s\n";
+	for(auto&& r : results){
+		out<<label<<"\t"<<r.name<<"\t"<<r.nhits<<"\t"<<r.iterations<<"\t"
+		   <<r.ns_per_call()<<"\t"<<r.ns_per_hit()<<"\t"<<r.hits_per_second()<<"\n";
+	}
+	return true;
+}
+
+// read ns_per_call by benchmark name from a results file. If a label is given only matching
+// rows are used; otherwise the last row for each benchmark wins.
+inline std::map<std::string,double> ReadBenchResults(const std::string& filename, const std::string& label=""){
+	std::map<std::string,double> baseline;
+	std::ifstream in(filename);
+	std::string line;
+	while(std::getline(in, line)){
+		if(line.empty() || line[0]=='#') continue;
+		std::stringstream ss(line);
+		std::string rowlabel, name, nhits, iterations, ns_per_call;
+		std::getline(ss, rowlabel, '\t');
+		std::getline(ss, name, '\t');
+		std::getline(ss, nhits, '\t');
+		std::getline(ss, iterations, '\t');
+		std::getline(ss, ns_per_call, '\t');
+		if(!label.empty() && rowlabel!=label) continue;
+		try { baseline[name] = std::stod(ns_per_call); } catch(...){ }
+	}
+	return baseline;
+}
+
+inline void CompareToBaseline(const std::map<std::string,double>& baseline, const std::vector<BenchResult>& results){
+	if(baseline.empty()) return;
+	std::cout<<"\n"<<std::left<<std::setw(40)<<"benchmark"<<std::right
+	         <<std::setw(16)<<"baseline ns"<<std::setw(16)<<"current ns"<<std::setw(10)<<"speedup"<<std::endl;
+	for(auto&& r : results){
+		auto it = baseline.find(r.name);
+		if(it==baseline.end() || r.ns_per_call()<=0) continue;
+		std::cout<<std::left<<std::setw(40)<<r.name<<std::right<<std::fixed<<std::setprecision(1)
+		         <<std::setw(16)<<it->second<<std::setw(16)<<r.ns_per_call()
+		         <<std::setw(9)<<std::setprecision(2)<<(it->second/r.ns_per_call())<<"x"
+		         <<std::defaultfloat<<std::endl;
+	}
+}
+
+#endif
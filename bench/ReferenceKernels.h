@@ -0,0 +1,172 @@
+/* vim:set noexpandtab tabstop=4 wrap filetype=cpp */
+#ifndef ReferenceKernels_H
+#define ReferenceKernels_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "skparmC.h"
+#include "geopmtC.h"
+
+/*
+ Standalone copies of kernels that are private to their Tools (or inline in Execute),
+ so they can be timed without constructing the Tool and its inputs.
+ These must be kept in step with the Tool code they mirror; the comment on each
+ function gives the origin.
+*/
+namespace BenchReference {
+
+// VertexFitter::CalculateNX, with the hit count passed in rather than read from skq_.nqisk, and without its logging
+inline int CalculateNX(int nhits, int timewindow, const float* vertex, const int cableIDs[], const float times[], int (&cableIDs_twindow)[500]){
+	if(nhits <= 0) return 0;
+
+	float cns2cm = 21.58333;
+	std::vector<float> tof;
+	for(int hit=0; hit<nhits; hit++){
+		tof.push_back(times[hit]-sqrt(pow((vertex[0]-geopmt_.xyzpm[cableIDs[hit]-1][0]),2)+pow((vertex[1]-geopmt_.xyzpm[cableIDs[hit]-1][1]),2)+pow((vertex[2]-geopmt_.xyzpm[cableIDs[hit]-1][2]),2))/cns2cm);
+	}
+
+	auto tof_sorted = tof;
+	std::sort(tof_sorted.begin(),tof_sorted.end());
+
+	int bsnwindow = 1;
+	int hstart_test = 0;
+	int hstart = 0;
+	int hstop = 0;
+	while(hstart_test < nhits-bsnwindow){
+		hstop = hstart_test+bsnwindow;
+		while((hstop<nhits) && (tof_sorted[hstop]-tof_sorted[hstart_test]<=timewindow)){
+			hstart = hstart_test;
+			bsnwindow++;
+			hstop++;
+		}
+		hstart_test++;
+	}
+
+	hstop=hstart+bsnwindow-1;
+	int bsnwin = 0;
+	for(int hit=0; hit<nhits && bsnwin<500; hit++){
+		if(tof[hit]<tof_sorted[hstart]) continue;
+		if(tof[hit]>tof_sorted[hstop]) continue;
+		cableIDs_twindow[bsnwin++]=cableIDs[hit];
+	}
+	return bsnwindow;
+}
+
+// CalculatePreactivityObservables::CalculateGoodness
+inline double PreactivityGoodness(const double& t1, const double& t2){
+	const double dt2 = pow(t2-t1, 2.)/25.;
+	return dt2 < 25 ? exp(-0.5 * dt2) : 0;
+}
+
+// CalculatePreactivityObservables::AssignGoodness, then the maximum goodness as taken in Execute.
+// times must be sorted; goodness is overwritten. Returns the maximum goodness.
+inline double PreactivityGoodnessLoop(const std::vector<double>& times, std::vector<double>& goodness){
+	goodness.assign(times.size(), 0.);
+	const double kernel_support = 25;
+	size_t band_end = 0;
+	for(size_t i = 0; i < times.size(); ++i){
+		if(band_end < i+1) band_end = i+1;
+		while(band_end < times.size() && times[band_end] - times[i] < kernel_support) ++band_end;
+		for(size_t j = i+1; j < band_end; ++j){
+			double g = PreactivityGoodness(times[i], times[j]);
+			goodness[i] += g;
+			goodness[j] += g;
+		}
+	}
+	return goodness.empty() ? 0 : *std::max_element(goodness.begin(), goodness.end());
+}
+
+// the all-pairs goodness loop previously in CalculatePreactivityObservables::Execute
+inline double PreactivityGoodnessAllPairs(const std::vector<double>& times, std::vector<double>& goodness){
+	goodness.assign(times.size(), 0.);
+	for(size_t i = 0; i < times.size(); ++i){
+		for(size_t j = i+1; j < times.size(); ++j){
+			double g = PreactivityGoodness(times.at(i), times.at(j));
+			goodness.at(i) += g;
+			goodness.at(j) += g;
+		}
+	}
+	return goodness.empty() ? 0 : *std::max_element(goodness.begin(), goodness.end());
+}
+
+// position of maximum energy deposition along a muon track, as previously in
+// CalculateSpallationVariables, RelicMuonPlots and PostReconstructionNeutronCloudSelection
+inline double MaxDedxPosition(const float* muon_dedx){
+	double max_edep = 0;
+	int max_edep_bin=0;
+	for(int i=0;i<111;i++){
+		double e_dep_in_window = 0 ;
+		for(int j=0;j<9;j++){
+			e_dep_in_window = e_dep_in_window + muon_dedx[i+j];
+		}
+		if(e_dep_in_window > max_edep){
+			max_edep_bin = i+4;
+			max_edep = e_dep_in_window;
+		}
+	}
+	return 50.*max_edep_bin;
+}
+
+// the per-pairing likelihood in CalculateSpallationVariables::CreateLikelihood, with the spall and rand
+// PDF histogram contents (including underflow, as from TH1D::GetArray) passed in as arrays. Returns the sum.
+inline double SpallationLikelihoodLoop(int nbins, const std::vector<double>* spall, const std::vector<double>* rand,
+                                       size_t npairs, const float* const* values){
+	double sum=0;
+	for(size_t i=0; i<npairs; ++i){
+		const int dt_bin = nbins * ((std::abs(values[0][i]) / (60)));
+		const int dlt_bin = nbins * (values[1][i] / 5000);
+		const int dll_bin = nbins * ((values[2][i] + 5000)/(10000));
+		const int muqismsk_bin = nbins * (values[3][i] / 250000);
+		const int resQ_bin = nbins * ((values[4][i] + 100000)/(200000));
+		double likelihood = std::log10(
+		                               spall[0][dt_bin] / rand[0][dt_bin] *
+		                               spall[1][dlt_bin] / rand[1][dlt_bin] *
+		                               spall[2][dll_bin] / rand[2][dll_bin] *
+		                               spall[3][muqismsk_bin] / rand[3][muqismsk_bin] *
+		                               spall[4][resQ_bin] / rand[4][resQ_bin]);
+		sum += likelihood;
+	}
+	return sum;
+}
+
+// a node of a TMVA::DecisionTree, linked to its children by pointers
+struct DecisionTreeNode {
+	int input = 0;
+	float cut = 0;
+	bool cut_type = true;    // inputs >= cut go right
+	int type = 0;            // 0 for internal nodes, +-1 for leaves
+	const DecisionTreeNode* left = nullptr;
+	const DecisionTreeNode* right = nullptr;
+};
+
+// TMVA::MethodBDT::PrivateGetMvaValue with TMVA::DecisionTree::CheckEvent (AdaBoost, yes-no leaves), as the
+// TMVA Reader evaluates one candidate: each tree walked from the root until a leaf. Returns the sum of outputs.
+inline double BDTCandidateLoop(const std::vector<const DecisionTreeNode*>& roots, const std::vector<double>& boost_weights,
+                               size_t ncandidates, size_t stride, const std::vector<int>& columns, const float* rows){
+	double sum=0;
+	std::vector<float> event(columns.size());
+	for(size_t i=0; i<ncandidates; ++i){
+		// the Reader copies the variables into its event first
+		for(size_t var=0; var<columns.size(); ++var) event[var] = rows[i*stride+columns[var]];
+		double mva=0, norm=0;
+		for(size_t tree=0; tree<roots.size(); ++tree){
+			const DecisionTreeNode* current = roots[tree];
+			while(current->type==0){
+				bool result = event[current->input] >= current->cut;
+				bool goes_right = current->cut_type ? result : !result;
+				current = goes_right ? current->right : current->left;
+			}
+			mva += boost_weights[tree]*double(current->type);
+			norm += boost_weights[tree];
+		}
+		sum += (norm>std::numeric_limits<double>::epsilon()) ? mva/norm : 0;
+	}
+	return sum;
+}
+
+} // namespace BenchReference
+
+#endif
@@ -0,0 +1,540 @@
+/* vim:set noexpandtab tabstop=4 wrap */
+/*
+ Microbenchmarks for the hit-processing kernels used in reconstruction and neutron tagging.
+ Events are produced by the SyntheticEventGenerator, so no input files are required and
+ results are reproducible for a given seed. Build with `make bench` and run e.g.
+	./bench/bench_kernels -l before -o bench/results.tsv
+	(make changes, rebuild)
+	./bench/bench_kernels -l after -o bench/results.tsv -c bench/results.tsv -b before
+ See bench/README.md for details.
+*/
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <memory>
+#include <cstdlib>
+#include <cmath>
+#include <random>
+#include <algorithm>
+#include <array>
+
+#include "TVector3.h"
+#include "tqrealroot.h"
+#include "pmt_geometry.h"
+#include "likelihood.h"
+#include "bonsaifit.h"
+
+#include "PMTHitCluster.h"
+#include "SK2p2MeV.h"
+#include "MuonTrackGeometry.h"
+#include "SpallationLikelihood.h"
+#include "VertexPrefit.h"
+#include "BonsaiFitService.h"
+#include "DecisionForest.h"
+#include "fortran_routines.h"
+
+#include "SyntheticEvent.h"
+#include "BenchHarness.h"
+#include "ReferenceKernels.h"
+
+// exposes the protected SK2p2MeV search functions for benchmarking
+class BenchSK2p2MeV : public SK2p2MeV {
+	public:
+	BenchSK2p2MeV() : SK2p2MeV(geopmt_.xyzpm){
+		TQI = new TQReal;
+		TQA = nullptr;
+		LOWE = nullptr;
+		HEADER = nullptr;
+		is_signal = signal_flags.data();
+		SetVerbosity(0);
+		SetVertex(0,0,0);
+	}
+	~BenchSK2p2MeV(){ is_signal = nullptr; }
+	void Analyze(long entry, bool last_entry){}
+
+	TQReal* GetTQI(){ return TQI; }
+	void SetSignalFlags(const std::vector<SyntheticHit>& hits){
+		for(size_t i=0; i<hits.size() && i<signal_flags.size(); ++i) signal_flags[i] = hits[i].signal;
+	}
+	results_t& GetResults(){ return res; }
+
+	using SK2p2MeV::N200Max;
+	using SK2p2MeV::NeutronSearch;
+	using SK2p2MeV::MinimizeTrms;
+
+	private:
+	std::vector<int> signal_flags = std::vector<int>(MAXHITS,0);
+};
+
+void PrintUsage(const char* name){
+	std::cout<<"usage: "<<name<<" [-o results.tsv] [-l label] [-c baseline.tsv] [-b baseline_label]"
+	         <<" [-s seed] [-t min_seconds] [-f filter]\n"
+	         <<"  -o  append results to this file\n"
+	         <<"  -l  label for this run in the results file (default 'current')\n"
+	         <<"  -c  compare against results in this file\n"
+	         <<"  -b  only compare against rows with this label (default: last row per benchmark)\n"
+	         <<"  -s  generator seed (default 12345)\n"
+	         <<"  -t  minimum time per benchmark in seconds (default 0.5)\n"
+	         <<"  -f  only run benchmarks whose name contains this string"<<std::endl;
+}
+
+int main(int argc, char** argv){
+
+	std::string outfile="";
+	std::string label="current";
+	std::string baselinefile="";
+	std::string baselinelabel="";
+	std::string filter="";
+	uint64_t seed=12345;
+	double min_seconds=0.5;
+	for(int i=1; i<argc; ++i){
+		std::string arg = argv[i];
+		if(arg=="-h" || arg=="--help"){ PrintUsage(argv[0]); return 0; }
+		if(i+1>=argc){ PrintUsage(argv[0]); return 1; }
+		if(arg=="-o") outfile = argv[++i];
+		else if(arg=="-l") label = argv[++i];
+		else if(arg=="-c") baselinefile = argv[++i];
+		else if(arg=="-b") baselinelabel = argv[++i];
+		else if(arg=="-s") seed = std::strtoull(argv[++i], nullptr, 10);
+		else if(arg=="-t") min_seconds = std::atof(argv[++i]);
+		else if(arg=="-f") filter = argv[++i];
+		else { PrintUsage(argv[0]); return 1; }
+	}
+	// read the baseline before we append to the same file
+	std::map<std::string,double> baseline;
+	if(!baselinefile.empty()) baseline = ReadBenchResults(baselinefile, baselinelabel);
+
+	SyntheticEventGenerator::FillGeometry();
+	SyntheticEventGenerator generator(seed);
+	std::vector<BenchResult> results;
+	auto run = [&](const std::string& name, double nhits, std::function<void()> func){
+		if(!filter.empty() && name.find(filter)==std::string::npos) return;
+		results.push_back(RunBench(name, nhits, func, min_seconds));
+		PrintBenchResult(results.back());
+	};
+
+	PrintBenchHeader();
+
+	// ----------------------------------------------------------------
+	// PMTHitCluster kernels, on a full AFT-length event and on candidate-sized clusters
+	// ----------------------------------------------------------------
+	SyntheticEventConfig aftconfig;
+	aftconfig.window_start = -1000;
+	aftconfig.window_end = 535000;
+	aftconfig.ncaptures = 2;
+	std::vector<SyntheticHit> aft_hits;
+	generator.Generate(aftconfig, aft_hits);
+
+	PMTHitCluster event_cluster;
+	SyntheticEventGenerator::FillCluster(aft_hits, event_cluster);
+	event_cluster.Sort();
+	event_cluster.SetVertex(TVector3(0,0,0));
+	const int nevent = event_cluster.GetSize();
+	// N10-like sliding window, as in the candidate search
+	run("PMTHitCluster::Slice(10ns) sweep", nevent, [&](){
+		int total=0;
+		for(int i=0; i<nevent; i+=10) total += event_cluster.Slice(i, 10.).GetSize();
+		DoNotOptimize(total);
+	});
+	run("PMTHitCluster::Slice(-5,+35ns) sweep", nevent, [&](){
+		int total=0;
+		for(int i=0; i<nevent; i+=10) total += event_cluster.Slice(i, -5., 35.).GetSize();
+		DoNotOptimize(total);
+	});
+
+	for(int nhits : {7, 10, 15}){
+		std::vector<SyntheticHit> cluster_hits;
+		float vertex[3];
+		generator.GenerateCluster(nhits, cluster_hits, vertex);
+		PMTHitCluster cluster;
+		SyntheticEventGenerator::FillCluster(cluster_hits, cluster);
+		cluster.SetVertex(TVector3(vertex[0], vertex[1], vertex[2]));
+		std::string n = std::to_string(nhits);
+		run("PMTHitCluster::GetBetaArray n="+n, nhits, [&](){
+			auto beta = cluster.GetBetaArray();
+			DoNotOptimize(beta);
+		});
+		run("PMTHitCluster::GetOpeningAngleStats n="+n, nhits, [&](){
+			auto stats = cluster.GetOpeningAngleStats();
+			DoNotOptimize(stats);
+		});
+		run("PMTHitCluster::FindTRMSMinimizingVertex n="+n, nhits, [&](){
+			TVector3 v = cluster.FindTRMSMinimizingVertex();
+			DoNotOptimize(v);
+		});
+	}
+
+	// ----------------------------------------------------------------
+	// SK2p2MeV neutron search
+	// ----------------------------------------------------------------
+	{
+		BenchSK2p2MeV sk2p2;
+		SyntheticEventGenerator::FillTQReal(aft_hits, *sk2p2.GetTQI());
+		sk2p2.SetSignalFlags(aft_hits);
+		const double ntq = aft_hits.size();
+		run("SK2p2MeV::N200Max", ntq, [&](){
+			Float_t t200m=0;
+			Int_t n200 = sk2p2.N200Max(6000., 535000.-12000., t200m);
+			DoNotOptimize(n200);
+		});
+		run("SK2p2MeV::NeutronSearch", ntq, [&](){
+			sk2p2.Clear();
+			sk2p2.NeutronSearch(1050, 535000.-12000.);
+			DoNotOptimize(sk2p2.GetResults().np);
+		});
+
+		std::vector<SyntheticHit> cluster_hits;
+		float vertex[3];
+		generator.GenerateCluster(10, cluster_hits, vertex);
+		std::vector<Float_t> t0(cluster_hits.size());
+		std::vector<Int_t> cab0(cluster_hits.size());
+		for(size_t i=0; i<cluster_hits.size(); ++i){ t0[i]=cluster_hits[i].t; cab0[i]=cluster_hits[i].cable; }
+		std::vector<Float_t> t(t0.size());
+		std::vector<Int_t> cab(cab0.size()), index(cab0.size());
+		for(float discut : {200.f, 10000.f}){
+			// MinimizeTrms reorders its inputs, so restore them for each call
+			run("SK2p2MeV::MinimizeTrms discut="+std::to_string(int(discut)), t0.size(), [&](){
+				t = t0;
+				cab = cab0;
+				Float_t cvx, cvy, cvz;
+				Float_t trms = sk2p2.MinimizeTrms(t.data(), cab.data(), 0, index.data(), t.size(),
+				                                  cvx, cvy, cvz, vertex[0], vertex[1], vertex[2], discut);
+				DoNotOptimize(trms);
+			});
+		}
+	}
+
+	// ----------------------------------------------------------------
+	// VertexFitter::CalculateNX, for low-energy events of increasing size
+	// ----------------------------------------------------------------
+	for(int ring_hits : {30, 60, 200}){
+		SyntheticEventConfig config;
+		config.ring_hits = ring_hits;
+		config.ncaptures = 0;
+		config.window_start = -400;
+		config.window_end = 900;
+		std::vector<SyntheticHit> hits;
+		generator.Generate(config, hits);
+		std::vector<int> cables;
+		std::vector<float> times;
+		for(auto&& hit : hits){ cables.push_back(hit.cable); times.push_back(hit.t); }
+		float vertex[3] = {config.vertex[0], config.vertex[1], config.vertex[2]};
+		int cableIDs_twindow[500];
+		for(int twindow : {20, 50}){
+			run("CalculateNX N"+std::to_string(twindow)+" ring="+std::to_string(ring_hits), cables.size(), [&](){
+				int nx = BenchReference::CalculateNX(cables.size(), twindow, vertex, cables.data(), times.data(), cableIDs_twindow);
+				DoNotOptimize(nx);
+			});
+		}
+	}
+
+	// ----------------------------------------------------------------
+	// CalculatePreactivityObservables goodness, at the occupancy of a normal
+	// SHE window and of a high dark-rate run
+	// ----------------------------------------------------------------
+	for(double dark_rate : {4.5e3, 9e3}){
+		SyntheticEventConfig config;
+		config.dark_rate_hz = dark_rate;
+		config.window_start = -5000;    // SHE readout window
+		config.window_end = 35000;
+		config.ncaptures = 0;
+		std::vector<SyntheticHit> hits;
+		generator.Generate(config, hits);
+		std::vector<double> times, goodness;
+		for(auto&& hit : hits) times.push_back(hit.t);
+		std::vector<double> goodness_all_pairs;
+		if(BenchReference::PreactivityGoodnessLoop(times, goodness) != BenchReference::PreactivityGoodnessAllPairs(times, goodness_all_pairs)
+		   || goodness != goodness_all_pairs){
+			std::cout<<"warning: band-limited preactivity goodness differs from the all-pairs loop"<<std::endl;
+		}
+		const std::string dark = std::to_string(int(dark_rate))+"Hz";
+		run("Preactivity goodness all pairs dark="+dark, times.size(), [&](){
+			double maxg = BenchReference::PreactivityGoodnessAllPairs(times, goodness);
+			DoNotOptimize(maxg);
+		});
+		run("Preactivity goodness AssignGoodness dark="+dark, times.size(), [&](){
+			double maxg = BenchReference::PreactivityGoodnessLoop(times, goodness);
+			DoNotOptimize(maxg);
+		});
+	}
+
+	// ----------------------------------------------------------------
+	// muon-relic pair geometry from CalculateSpallationVariables: getdl_ per pair
+	// against the batched native kernel, for a muon paired with a typical number of relics
+	// ----------------------------------------------------------------
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+		float direction[3] = {0.3f, -0.2f, -0.93f};
+		const float norm = std::sqrt(direction[0]*direction[0]+direction[1]*direction[1]+direction[2]*direction[2]);
+		for(float& u : direction) u /= norm;
+		float entrypoint[3] = {-500.f, 400.f, 1810.f};
+		const float* entrypoints[1] = {entrypoint};
+		float dedx[200];
+		for(float& d : dedx) d = 50.f*(1.f+uniform(rng));
+		for(int npairs : {10, 1000}){
+			std::vector<float> vx(npairs), vy(npairs), vz(npairs), dlt(npairs), appr(npairs);
+			for(int i=0; i<npairs; ++i){
+				vx[i] = 1690.f*uniform(rng);
+				vy[i] = 1690.f*uniform(rng);
+				vz[i] = 1810.f*uniform(rng);
+			}
+			// check agreement before timing
+			float maxdiff = 0;
+			MuonTrackGeometry::TrackDistances(direction, entrypoints, 1, npairs, vx.data(), vy.data(), vz.data(), dlt.data(), appr.data());
+			for(int i=0; i<npairs; ++i){
+				float ref_dlt=0, ref_appr=0;
+				getdl_(direction, &vx[i], &vy[i], &vz[i], entrypoint, &ref_dlt, &ref_appr);
+				maxdiff = std::max(maxdiff, std::max(std::abs(ref_dlt-dlt[i]), std::abs(ref_appr-appr[i])));
+			}
+			std::cout<<"muon track distances n="<<npairs<<": max difference to getdl_ "<<maxdiff<<" cm"<<std::endl;
+			std::string n = std::to_string(npairs);
+			run("Muon track distance getdl_ n="+n, npairs, [&](){
+				float sum=0;
+				for(int i=0; i<npairs; ++i){
+					float d=0, a=0;
+					getdl_(direction, &vx[i], &vy[i], &vz[i], entrypoint, &d, &a);
+					sum += d + a;
+				}
+				DoNotOptimize(sum);
+			});
+			run("Muon track distance TrackDistances n="+n, npairs, [&](){
+				MuonTrackGeometry::TrackDistances(direction, entrypoints, 1, npairs, vx.data(), vy.data(), vz.data(), dlt.data(), appr.data());
+				DoNotOptimize(dlt[npairs-1]);
+			});
+		}
+		if(BenchReference::MaxDedxPosition(dedx) != MuonTrackGeometry::MaxDedxPosition(dedx)){
+			std::cout<<"warning: MaxDedxPosition differs from the reference"<<std::endl;
+		}
+		run("Muon max dE/dx position reference", 1, [&](){
+			double pos = BenchReference::MaxDedxPosition(dedx);
+			DoNotOptimize(pos);
+		});
+		run("Muon max dE/dx position MaxDedxPosition", 1, [&](){
+			double pos = MuonTrackGeometry::MaxDedxPosition(dedx);
+			DoNotOptimize(pos);
+		});
+	}
+
+	// ----------------------------------------------------------------
+	// spallation likelihood from CalculateSpallationVariables: per-pairing histogram lookups
+	// against the frozen tables, for a run's worth of pairings
+	// ----------------------------------------------------------------
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> uniform(0.f, 1.f);
+		const int nbins = 50000;
+		const double lo[SpallationLikelihood::kNumVariables] = {0, 0, -5000, 0, -100000};
+		const double hi[SpallationLikelihood::kNumVariables] = {60, 5000, 5000, 250000, 100000};
+		std::vector<double> spall[SpallationLikelihood::kNumVariables], rand[SpallationLikelihood::kNumVariables];
+		SpallationLikelihood likelihood;
+		for(int var=0; var<SpallationLikelihood::kNumVariables; ++var){
+			// with under/overflow bins, as from TH1D::GetArray
+			spall[var].resize(nbins+2);
+			rand[var].resize(nbins+2);
+			for(int i=0; i<nbins+2; ++i){ spall[var][i] = 0.1+uniform(rng); rand[var][i] = 0.1+uniform(rng); }
+			likelihood.SetPDF(var, lo[var], hi[var], nbins, spall[var].data()+1, rand[var].data()+1);
+		}
+		const size_t npairs = 100000;
+		std::vector<float> values[SpallationLikelihood::kNumVariables];
+		const float* value_ptrs[SpallationLikelihood::kNumVariables];
+		for(int var=0; var<SpallationLikelihood::kNumVariables; ++var){
+			values[var].resize(npairs);
+			for(float& value : values[var]) value = lo[var] + (hi[var]-lo[var])*0.999f*uniform(rng);
+			value_ptrs[var] = values[var].data();
+		}
+		std::vector<float> likelihoods(npairs);
+		run("Spallation likelihood reference", npairs, [&](){
+			double sum = BenchReference::SpallationLikelihoodLoop(nbins, spall, rand, npairs, value_ptrs);
+			DoNotOptimize(sum);
+		});
+		for(int nthreads : {1, 4}){
+			run("Spallation likelihood SpallationLikelihood threads="+std::to_string(nthreads), npairs, [&](){
+				likelihood.Evaluate(npairs, value_ptrs, likelihoods.data(), nthreads);
+				DoNotOptimize(likelihoods[npairs-1]);
+			});
+		}
+	}
+
+	// ----------------------------------------------------------------
+	// low-energy vertex fit: the native prefit alone, and the VertexFitter BONSAI fit without and
+	// with the prefit seed, for events at random vertices. Each call fits the whole set of events.
+	// ----------------------------------------------------------------
+	{
+		pmt_geometry bsgeom(MAXPM, &geopmt_.xyzpm[0][0]);
+		likelihood bslike(bsgeom.cylinder_radius(), bsgeom.cylinder_height());
+		bonsaifit bsfit(&bslike);
+		VertexPrefit prefit(MAXPM, &geopmt_.xyzpm[0][0]);
+		BonsaiFitService::Prefit seeded;
+		seeded.prefit = &prefit;
+		seeded.max_hits = 800;   // VertexFitter's limit on hits for BONSAI
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+		const int nevents = 20;
+		const float fiducial_r = prefit.GetRadius()-200, fiducial_z = prefit.GetHalfHeight()-200;
+		for(int ring_hits : {30, 60, 200, 2000}){
+			std::vector<BonsaiFitService::Hits> events(nevents);
+			std::vector<std::array<float,3>> true_vertices(nevents);
+			double nhits_total = 0;
+			for(int ev=0; ev<nevents; ++ev){
+				SyntheticEventConfig config;
+				config.ring_hits = ring_hits;
+				config.ncaptures = 0;
+				config.window_start = -400;
+				config.window_end = 900;
+				do {
+					config.vertex[0] = fiducial_r*uniform(rng);
+					config.vertex[1] = fiducial_r*uniform(rng);
+				} while(config.vertex[0]*config.vertex[0]+config.vertex[1]*config.vertex[1] > fiducial_r*fiducial_r);
+				config.vertex[2] = fiducial_z*uniform(rng);
+				std::vector<SyntheticHit> hits;
+				generator.Generate(config, hits);
+				for(auto&& hit : hits){
+					events[ev].cables.push_back(hit.cable);
+					events[ev].times.push_back(hit.t);
+					events[ev].charges.push_back(hit.q);
+				}
+				std::copy(config.vertex, config.vertex+3, true_vertices[ev].begin());
+				nhits_total += hits.size();
+			}
+
+			// resolution: median and 68th percentile distance to the true vertex
+			auto resolution = [&](const std::string& name, std::function<bool(BonsaiFitService::Hits&, float*)> fit){
+				if(!filter.empty() && (name+" ring="+std::to_string(ring_hits)).find(filter)==std::string::npos) return;
+				std::vector<float> distances;
+				for(int ev=0; ev<nevents; ++ev){
+					BonsaiFitService::Hits hits = events[ev];
+					float vertex[4];
+					if(!fit(hits, vertex)) continue;
+					float d2 = 0;
+					for(int i=0; i<3; ++i) d2 += (vertex[i]-true_vertices[ev][i])*(vertex[i]-true_vertices[ev][i]);
+					distances.push_back(std::sqrt(d2));
+				}
+				std::sort(distances.begin(), distances.end());
+				std::cout<<name<<" ring="<<ring_hits<<": "<<distances.size()<<"/"<<nevents<<" fit";
+				if(!distances.empty()) std::cout<<", median distance "<<distances[distances.size()/2]
+				                                <<" cm, 68% within "<<distances[(distances.size()*68)/100]<<" cm";
+				std::cout<<std::endl;
+			};
+			auto prefit_fit = [&](BonsaiFitService::Hits& hits, float* vertex){
+				VertexPrefit::Result res = prefit.Fit(hits.cables.size(), hits.cables.data(), hits.times.data());
+				std::copy(res.vertex, res.vertex+4, vertex);
+				return res.ok();
+			};
+			auto bonsai_fit = [&](BonsaiFitService::Hits& hits, float* vertex, const BonsaiFitService::Prefit* seed){
+				BonsaiFitService::Result res = BonsaiFitService::Fit(bsgeom, bslike, bsfit, hits, geopmt_.xyzpm, seed);
+				std::copy(res.vertex, res.vertex+4, vertex);
+				return res.vertex[0]<9999;
+			};
+			// as VertexFitter, BONSAI alone is not run on events with more than 800 hits
+			const bool unseeded = nhits_total/nevents <= seeded.max_hits;
+			resolution("Vertex prefit", prefit_fit);
+			if(unseeded) resolution("BONSAI", [&](BonsaiFitService::Hits& hits, float* vertex){ return bonsai_fit(hits, vertex, nullptr); });
+			resolution("BONSAI seeded", [&](BonsaiFitService::Hits& hits, float* vertex){ return bonsai_fit(hits, vertex, &seeded); });
+
+			const std::string n = std::to_string(ring_hits);
+			run("Vertex prefit ring="+n, nhits_total, [&](){
+				for(auto&& hits : events){
+					VertexPrefit::Result res = prefit.Fit(hits.cables.size(), hits.cables.data(), hits.times.data());
+					DoNotOptimize(res);
+				}
+			});
+			if(unseeded){
+				run("BONSAI ring="+n, nhits_total, [&](){
+					for(auto&& event : events){
+						BonsaiFitService::Hits hits = event;
+						float vertex[4];
+						DoNotOptimize(bonsai_fit(hits, vertex, nullptr));
+					}
+				});
+			}
+			run("BONSAI seeded ring="+n, nhits_total, [&](){
+				for(auto&& event : events){
+					BonsaiFitService::Hits hits = event;
+					float vertex[4];
+					DoNotOptimize(bonsai_fit(hits, vertex, &seeded));
+				}
+			});
+		}
+	}
+
+	// ----------------------------------------------------------------
+	// BDT classifier over candidate feature rows: the TMVA Reader's one candidate at a time walk of
+	// pointer-linked trees, against DecisionForest over the whole feature matrix. Random forests of
+	// 800 depth-3 trees (TMVA's defaults) on the 16 inputs of ApplyTMVA, from 26 feature columns.
+	// ----------------------------------------------------------------
+	{
+		const int ntrees = 800, maxdepth = 3, ninputs = 16, ncolumns = 26;
+		std::mt19937 rng(seed);
+		std::normal_distribution<float> gaussian(0.f, 1.f);
+		std::uniform_real_distribution<float> uniform(0.f, 1.f);
+		std::vector<int> columns(ninputs);
+		for(int var=0; var<ninputs; ++var) columns[var] = (var*7+3)%ncolumns;
+
+		std::vector<std::unique_ptr<BenchReference::DecisionTreeNode>> node_store;
+		std::vector<const BenchReference::DecisionTreeNode*> roots;
+		std::vector<double> boost_weights;
+		DecisionForest forest;
+		std::vector<DecisionForest::TreeNode> tree;
+		// returns the node's index in tree
+		std::function<int(int, BenchReference::DecisionTreeNode*&)> grow = [&](int depth, BenchReference::DecisionTreeNode*& node){
+			node_store.emplace_back(new BenchReference::DecisionTreeNode);
+			node = node_store.back().get();
+			const int index = tree.size();
+			tree.emplace_back();
+			if(depth==maxdepth || (depth>0 && uniform(rng)<0.2f)){
+				node->type = (uniform(rng)<0.5f) ? 1 : -1;
+				tree[index].value = boost_weights.back()*node->type;
+				return index;
+			}
+			node->input = std::uniform_int_distribution<int>(0, ninputs-1)(rng);
+			node->cut = gaussian(rng);
+			node->cut_type = uniform(rng)<0.5f;
+			BenchReference::DecisionTreeNode *left, *right;
+			int left_index = grow(depth+1, left), right_index = grow(depth+1, right);
+			node->left = left;
+			node->right = right;
+			tree[index].input = node->input;
+			tree[index].cut = node->cut;
+			tree[index].child[0] = node->cut_type ? left_index : right_index;
+			tree[index].child[1] = node->cut_type ? right_index : left_index;
+			return index;
+		};
+		double weight_sum = 0;
+		for(int t=0; t<ntrees; ++t){
+			boost_weights.push_back(0.1+uniform(rng));
+			weight_sum += boost_weights.back();
+			tree.clear();
+			BenchReference::DecisionTreeNode* root;
+			grow(0, root);
+			roots.push_back(root);
+			forest.AddTree(tree);
+		}
+		forest.SetTransform(DecisionForest::kWeightedMean, weight_sum);
+		forest.MapInputs(columns);
+
+		for(int ncandidates : {100, 5000}){
+			std::vector<float> rows(size_t(ncandidates)*ncolumns);
+			for(float& value : rows) value = gaussian(rng);
+			std::vector<double> outputs(ncandidates);
+			const std::string n = std::to_string(ncandidates);
+			run("BDT per-candidate reference candidates="+n, ncandidates, [&](){
+				double sum = BenchReference::BDTCandidateLoop(roots, boost_weights, ncandidates, ncolumns, columns, rows.data());
+				DoNotOptimize(sum);
+			});
+			run("BDT DecisionForest candidates="+n, ncandidates, [&](){
+				forest.Evaluate(rows.data(), ncandidates, ncolumns, outputs.data());
+				DoNotOptimize(outputs[ncandidates-1]);
+			});
+		}
+	}
+
+	if(!outfile.empty() && WriteBenchResults(outfile, label, results)){
+		std::cout<<"\nresults appended to "<<outfile<<" with label '"<<label<<"'"<<std::endl;
+	}
+	CompareToBaseline(baseline, results);
+
+	return 0;
+}